@@ -0,0 +1,89 @@
+/**
+ * Unit tests for obj-loader.ts - OBJ parsing
+ *
+ * The parity fixture is shared with wasm/tests/obj_parser_test.cpp: both
+ * expect the same per-group triangle corners, so OBJLoader.parse and the
+ * native parser (parseOBJInWasm) stay in agreement on group splitting,
+ * smoothing groups, `v` lines with a w component and negative indices.
+ */
+
+import { describe, test, expect } from "bun:test";
+import { OBJLoader } from "./obj-loader";
+import { Mesh } from "./primitives";
+
+const PARITY_OBJ = [
+  "# parity fixture",
+  "v 0 0 0",
+  "v 1 0 0 2.0", // Homogeneous w, not a color
+  "v 1 1 0",
+  "v 0 1 0 0.5 0.25 1", // Vertex color extension (native parser only)
+  "vt 0 0",
+  "vt 1 0",
+  "vt 1 1",
+  "vt 0 1",
+  "vn 0 0 1",
+  "g first",
+  "s off",
+  "f 1/1/1 2/2/1 3/3/1 4/4/1",
+  "g second",
+  "s 1",
+  "f -4/-4/-1 -2/-2/-1 -1/-1/-1",
+  "",
+].join("\n");
+
+// Expected corners per group: x, y, z, u, v
+const FIRST_CORNERS = [
+  [0, 0, 0, 0, 0],
+  [1, 0, 0, 1, 0],
+  [1, 1, 0, 1, 1],
+  [0, 0, 0, 0, 0],
+  [1, 1, 0, 1, 1],
+  [0, 1, 0, 0, 1],
+];
+const SECOND_CORNERS = [
+  [0, 0, 0, 0, 0],
+  [1, 1, 0, 1, 1],
+  [0, 1, 0, 0, 1],
+];
+
+function corners(mesh: Mesh): number[][] {
+  return mesh.indices.map((i) => {
+    const v = mesh.vertices[i];
+    return [v.position.x, v.position.y, v.position.z, v.u, v.v];
+  });
+}
+
+describe("OBJLoader.parse - native parser parity", () => {
+  test("splits groups and drops the empty default group", () => {
+    const result = OBJLoader.parse(PARITY_OBJ);
+    expect([...result.meshes.keys()]).toEqual(["first", "second"]);
+  });
+
+  test("triangulates faces and resolves negative indices", () => {
+    const result = OBJLoader.parse(PARITY_OBJ);
+    expect(corners(result.meshes.get("first")!)).toEqual(FIRST_CORNERS);
+    expect(corners(result.meshes.get("second")!)).toEqual(SECOND_CORNERS);
+  });
+
+  test("tracks smoothing groups per group", () => {
+    const result = OBJLoader.parse(PARITY_OBJ);
+    expect(result.meshes.get("first")!.smoothShading).toBe(false);
+    expect(result.meshes.get("second")!.smoothShading).toBe(true);
+  });
+
+  test("keeps one quad face and the file's normals", () => {
+    const mesh = OBJLoader.parse(PARITY_OBJ).meshes.get("first")!;
+    expect(mesh.faceData.length).toBe(1);
+    expect(mesh.faceData[0].vertices.length).toBe(4);
+    for (const v of mesh.vertices) {
+      expect(v.normal.z).toBe(1);
+    }
+  });
+
+  test("reads a fourth v component as w, not a position or color", () => {
+    const mesh = OBJLoader.parse(PARITY_OBJ).meshes.get("first")!;
+    const w = mesh.vertices[mesh.indices[1]];
+    expect([w.position.x, w.position.y, w.position.z]).toEqual([1, 0, 0]);
+    expect([w.color.r, w.color.g, w.color.b]).toEqual([255, 255, 255]);
+  });
+});
@@ -16,6 +16,7 @@ import {
   WasmRasterizerInstance,
   FLOATS_PER_VERTEX,
   uploadMeshToBuffer,
+  TEXTURE_MAPPING_PER_PIXEL,
 } from "./wasm-rasterizer";
 
 // ============================================================================
@@ -60,6 +61,8 @@ export interface RenderSettings {
   ambientLight: number;
   snapResolutionX: number;
   snapResolutionY: number;
+  textureMapping: number; // TEXTURE_MAPPING_* (wasm-rasterizer)
+  lightingLutBits: number; // Table lighting normal codes (0 = off, 8, 12)
   lightDirection: [number, number, number];
   lightColor: [number, number, number];
   lightIntensity: number;
@@ -313,8 +316,16 @@ interface GeometryBufferEntry {
   handle: number; // WASM geometry buffer handle (0 = invalid)
   version: number; // Last uploaded version (for dirty checking)
   lastUsedFrame: number; // Frame number when last used (for LRU eviction)
+  uploadedFrame: number; // Frame of the last upload (LODs wait for edits to settle)
+  lodBuilt: boolean; // LOD chain built for the current upload
 }
 
+// Meshes at least this dense get a LOD chain once unchanged for a while
+const LOD_MIN_TRIANGLES = 4096;
+const LOD_SETTLE_FRAMES = 30;
+const LOD_LEVELS = 4;
+const LOD_RATIO = 0.5;
+
 // Maps meshId -> cache entry
 const meshCache = new Map<string, GeometryBufferEntry>();
 let currentFrameNumber = 0;
@@ -352,6 +363,8 @@ function getGeometryBuffer(meshId: string): number {
           handle: retryHandle,
           version: -1,
           lastUsedFrame: currentFrameNumber,
+          uploadedFrame: currentFrameNumber,
+          lodBuilt: false,
         });
         return retryHandle;
       }
@@ -363,6 +376,8 @@ function getGeometryBuffer(meshId: string): number {
     handle,
     version: -1, // Will be updated on first upload
     lastUsedFrame: currentFrameNumber,
+    uploadedFrame: currentFrameNumber,
+    lodBuilt: false,
   });
   return handle;
 }
@@ -400,6 +415,8 @@ let settings: RenderSettings = {
   ambientLight: 0.2,
   snapResolutionX: 320,
   snapResolutionY: 240,
+  textureMapping: TEXTURE_MAPPING_PER_PIXEL,
+  lightingLutBits: 0,
   lightDirection: [0.5, 0.5, -1],
   lightColor: [1, 1, 1],
   lightIntensity: 0.8,
@@ -647,6 +664,8 @@ function applySettings(): void {
   wasmInstance.setEnableBackfaceCulling(settings.enableBackfaceCulling);
   wasmInstance.setEnableVertexSnapping(settings.enableVertexSnapping);
   wasmInstance.setEnableSmoothShading(settings.enableSmoothShading);
+  wasmInstance.setTextureMapping(settings.textureMapping);
+  wasmInstance.setLightingLut(settings.lightingLutBits);
   wasmInstance.setAmbientLight(settings.ambientLight);
   wasmInstance.setSnapResolution(
     settings.snapResolutionX,
@@ -770,6 +789,20 @@ function renderMeshSlotWasm(
     }
 
     entry.version = meshVersion;
+    entry.uploadedFrame = currentFrameNumber;
+    entry.lodBuilt = false;
+  }
+
+  // Simplified levels for dense meshes, once they stop being edited
+  if (
+    wasm.supportsLods &&
+    !entry.lodBuilt &&
+    currentFrameNumber - entry.uploadedFrame >= LOD_SETTLE_FRAMES
+  ) {
+    if (mesh.indices.length / 3 >= LOD_MIN_TRIANGLES) {
+      wasm.buildGeometryLods(handle, LOD_LEVELS, LOD_RATIO);
+    }
+    entry.lodBuilt = true;
   }
 
   // Compute MVP and model matrices
@@ -1400,6 +1433,11 @@ self.onmessage = async (e: MessageEvent<WorkerCommand>) => {
 
         wasmInstance = await loadWasmRasterizer(cmd.wasmPath);
         wasmInstance.setRenderResolution(renderWidth, renderHeight);
+        if (!wasmInstance.supportsLods) {
+          console.warn(
+            "rasterizer.wasm has no LOD exports; rebuild it with `bun run build:wasm`"
+          );
+        }
 
         // Disable WASM-side dithering since we do it in the shader now
         wasmInstance.setEnableDithering(false);
@@ -23,6 +23,7 @@ import {
   TextureUpload,
 } from "../render-worker";
 import { Texture } from "../texture";
+import { TEXTURE_MAPPING_PER_PIXEL } from "../wasm-rasterizer";
 import {
   Material,
   evaluateMaterial,
@@ -317,6 +318,8 @@ export function buildRenderSettings(
     ambientLight: 0.2,
     snapResolutionX: 320,
     snapResolutionY: 240,
+    textureMapping: TEXTURE_MAPPING_PER_PIXEL,
+    lightingLutBits: 0,
     lightDirection: [0.5, 0.5, -1],
     lightColor: [1, 1, 1],
     lightIntensity: 0.8,
@@ -30,9 +30,100 @@ export const BAKE_OP_ALPHA_CUTOFF = 7;
 export const BAKE_OP_NOISE = 8;
 export const BAKE_OP_END = 255;
 
+// Frame sequence export formats (must match C++ enum)
+export const EXPORT_FORMAT_Y4M = 0;
+export const EXPORT_FORMAT_RGBA = 1;
+const MAX_EXPORT_CAMERA_KEYS = 256;
+
 // Vertex format: x, y, z, nx, ny, nz, u, v, r, g, b, a (12 floats)
 const FLOATS_PER_VERTEX = 12;
 
+// Native OBJ parser: bytes copied into WASM per feed call
+const OBJ_INPUT_CHUNK_SIZE = 1 << 20;
+
+/** Mesh produced by the native OBJ parser (geometry lives in a geometry buffer) */
+export interface WasmObjMesh {
+  handle: number; // Geometry buffer handle
+  name: string;
+  material: string | null; // usemtl name
+  smooth: boolean; // Any face in a smoothing group
+  faceSizes: Uint32Array; // Vertex count per source polygon (copy)
+}
+
+// glTF accessor slots (must match C++ GltfAttribute enum)
+export const GLTF_ATTR_POSITION = 0;
+export const GLTF_ATTR_NORMAL = 1;
+export const GLTF_ATTR_TEXCOORD = 2;
+export const GLTF_ATTR_COLOR = 3;
+export const GLTF_ATTR_INDICES = 4;
+export const GLTF_ATTR_JOINTS = 5;
+export const GLTF_ATTR_WEIGHTS = 6;
+
+/** Material parsed by the native MTL parser (colors 0-1 as in the file) */
+export interface WasmMtlMaterial {
+  name: string;
+  diffuse: [number, number, number];
+  ambient: [number, number, number];
+  specular: [number, number, number];
+  shininess: number;
+  opacity: number;
+  diffuseMap: string | null;
+}
+
+// Lasso polygon capacity (must match wasm/rasterizer.cpp)
+const MAX_LASSO_POINTS = 4096;
+
+// Raycast batches (must match wasm/rasterizer.cpp)
+export const RAY_FLOATS = 8; // ox, oy, oz, tmin, dx, dy, dz, tmax
+const MAX_RAYCAST_RAYS = 65536;
+
+// Modifier types (must match wasm/rasterizer.cpp); params listed in order
+export const MODIFIER_MIRROR = 0; // axis (0-2), merge distance
+export const MODIFIER_ARRAY = 1; // count, offset x, y, z
+export const MODIFIER_SOLIDIFY = 2; // thickness
+export const MODIFIER_SUBDIVIDE = 3; // levels
+
+// Texture mapping modes for textured triangles (must match wasm/rasterizer.cpp)
+export const TEXTURE_MAPPING_PER_PIXEL = 0; // Affine-factor correction per pixel
+export const TEXTURE_MAPPING_AFFINE = 1; // PS1 screen-linear UVs along spans
+export const TEXTURE_MAPPING_SUBDIVIDED = 2; // Corrected every 16 pixels
+
+// Sprite batch layout and flags (must match wasm/rasterizer.cpp).
+// Per sprite: x, y, z, width, height, u0, v0, u1, v1, r, g, b
+export const SPRITE_FLOATS = 12;
+export const SPRITE_DEPTH_TEST = 1;
+export const SPRITE_DEPTH_WRITE = 2;
+export const SPRITE_WORLD = 4; // x, y, z is an object-space anchor (centered)
+export const SPRITE_WORLD_SIZE = 8; // width/height in object units
+export const SPRITE_TEXTURED = 16; // Sample the bound texture
+export const SPRITE_ID_WRITE = 32; // Tag the ID buffer (object ID, sprite index)
+
+// Scene light layout and types (must match wasm/rasterizer.cpp).
+// Per light: x, y, z, type, r, g, b, range
+export const LIGHT_FLOATS = 8;
+export const LIGHT_DIRECTIONAL = 0; // xyz = direction the light travels
+export const LIGHT_POINT = 1; // xyz = world position, range = falloff distance
+
+// Texture-space bake flags (must match wasm/rasterizer.cpp)
+export const LIGHTMAP_LIGHTING = 1;
+export const LIGHTMAP_AO = 2;
+
+// Face material table layout and flags (must match wasm/rasterizer.cpp).
+// Per material: texture buffer handle (0 = untextured), flags
+export const MATERIAL_INTS = 2;
+export const MATERIAL_UNLIT = 1; // Keep vertex colors (no lighting)
+export const MATERIAL_HIDDEN = 2; // Skip the material's triangles
+export const MAX_FACE_MATERIALS = 256; // Material ids are bytes
+
+/** Per-ray results; triangle is -1 on a miss, u/v weight corners 1 and 2 */
+export interface WasmRayHits {
+  triangle: Int32Array;
+  t: Float32Array;
+  u: Float32Array;
+  v: Float32Array;
+  hitCount: number;
+}
+
 export interface WasmRasterizerInstance {
   // Current resolution
   renderWidth: number;
@@ -85,6 +176,9 @@ export interface WasmRasterizerInstance {
   setEnableVertexSnapping(enable: boolean): void;
   setEnableSmoothShading(enable: boolean): void;
   setSnapResolution(x: number, y: number): void;
+  setTextureMapping(mode: number): void; // TEXTURE_MAPPING_*
+  setEnableGte(enable: boolean): void; // Fixed-point vertex projection (opt-in, not a render setting)
+  setLightingLut(bits: number): void; // 0 = off, 8 or 12-bit normal codes
 
   // Point rendering
   renderPoint(
@@ -99,6 +193,8 @@ export interface WasmRasterizerInstance {
     mvpMatrix: Float32Array,
     pointSize: number
   ): void;
+  // SPRT-style rectangles (SPRITE_FLOATS per sprite); returns sprites drawn
+  renderSprites(sprites: Float32Array, count: number, flags: number): number;
 
   // Material baking
   getBakeProgramBuffer(): Uint8Array;
@@ -134,6 +230,243 @@ export interface WasmRasterizerInstance {
   textureBufferGetWidth(handle: number): number;
   textureBufferGetHeight(handle: number): number;
   bindTextureBuffer(handle: number): void; // 0 = unbind
+
+  // Frame sequence export (turntables / camera paths)
+  getExportCameraKeysBuffer(): Float32Array; // eye xyz, target xyz per key
+  setExportCameraKeyCount(count: number): void;
+  setExportTurntable(
+    cx: number,
+    cy: number,
+    cz: number,
+    radius: number,
+    height: number,
+    startAngle: number
+  ): void;
+  setExportCameraParams(fovDegrees: number, near: number, far: number): void;
+  setExportClearColor(r: number, g: number, b: number): void;
+  exportClearDraws(): void;
+  exportAddDraw(geometryHandle: number, textureHandle: number): number; // Uses modelMatrix
+  exportBegin(
+    width: number,
+    height: number,
+    frameCount: number,
+    format: number,
+    fps: number
+  ): Uint8Array | null; // Stream header (empty for raw RGBA), null on failure or if a session is active
+  exportRenderNextFrame(): Uint8Array | null; // null when the sequence is done
+  exportEnd(): void;
+
+  // Native OBJ / MTL parsing (streams into geometry buffers)
+  objParserBegin(r: number, g: number, b: number): void; // Default vertex color
+  objParserFeed(chunk: Uint8Array): boolean;
+  objParserFinish(recenter: boolean): WasmObjMesh[];
+  objParserGetMtllib(): string | null;
+  objParserGetBounds(): Float32Array; // min xyz, max xyz (before recentering)
+  objParserReset(): void;
+  mtlParse(data: Uint8Array): WasmMtlMaterial[];
+
+  // Native GLB ingestion (accessors decoded straight into geometry buffers)
+  glbLoad(data: Uint8Array): boolean; // Copies the file in and parses chunks
+  glbGetJSON(): string | null;
+  glbGetBinView(byteOffset: number, byteLength: number): Uint8Array | null;
+  glbReset(): void;
+  gltfSetAccessor(
+    attribute: number,
+    byteOffset: number,
+    byteStride: number,
+    count: number,
+    componentType: number,
+    components: number,
+    normalized: boolean
+  ): void;
+  gltfClearAccessors(): void;
+  gltfSetMaterial(material: number): void; // Face material id for appended primitives, -1 = none
+  gltfAppendPrimitive(handle: number, mode: number, deindex: boolean): number;
+  gltfFinishMesh(handle: number): boolean; // True if flat normals were generated
+
+  // Compressed mesh codec (scene files / worker transfer)
+  meshEncode(
+    handle: number,
+    positionBits?: number,
+    uvBits?: number
+  ): Uint8Array | null; // Copy of the encoded bytes
+  meshDecode(handle: number, data: Uint8Array): number; // Vertex count, -1 on error
+
+  // Renderer state snapshot (geometry, textures, bake output)
+  snapshotState(): Uint8Array | null; // Copy of the versioned image
+  restoreState(image: Uint8Array): boolean; // Restores the original handles
+
+  // ID buffer picking (queries read the last rendered frame). Only the render
+  // worker has an instance; PickingManager keeps its synchronous JS raycast.
+  setEnableIdBuffer(enable: boolean): void;
+  setObjectId(id: number): void; // For subsequent draws, 0 = not pickable
+  pick(x: number, y: number): { objectId: number; face: number } | null;
+  pickRect(x0: number, y0: number, x1: number, y1: number): Uint32Array; // Object IDs
+  pickRectFaces(
+    objectId: number,
+    x0: number,
+    y0: number,
+    x1: number,
+    y1: number
+  ): Uint32Array; // Triangle indices
+  setPickViewProjection(matrix: Float32Array | number[]): void;
+  unprojectDepth(x: number, y: number): [number, number, number] | null;
+
+  // Triangle BVH raycasting (object-space rays, RAY_FLOATS per ray)
+  buildBvh(handle: number): number; // Node count, 0 on failure
+  refitBvh(handle: number, firstTriangle: number, triangleCount: number): boolean;
+  raycast(handle: number, rays: Float32Array): WasmRayHits | null;
+
+  // Screen-space vertex index (projects with the current MVP matrix). Worker
+  // side only; editor hover and box select keep their main-thread JS loops.
+  buildVertexIndex(handle: number): number; // On-screen vertex count, -1 on error
+  nearestVertex(
+    x: number,
+    y: number,
+    radius: number,
+    occlusion?: boolean
+  ): { index: number; distance: number } | null;
+  selectVerticesRect(
+    x0: number,
+    y0: number,
+    x1: number,
+    y1: number,
+    occlusion?: boolean
+  ): Uint32Array; // Bitset, one bit per vertex
+  selectVerticesLasso(
+    points: Float32Array | number[], // x, y pairs in pixels
+    occlusion?: boolean
+  ): Uint32Array; // Bitset, one bit per vertex
+
+  // Vertex spatial hash (co-location groups and welding). Worker side only;
+  // the editor's co-location queries stay in JS on the main thread.
+  buildSpatialHash(handle: number, epsilon?: number): number; // Group count, -1 on error
+  getColocatedVertices(handle: number, vertex: number): Int32Array;
+  getColocatedVerticesAt(handle: number, x: number, y: number, z: number): Int32Array;
+  getColocationGroups(
+    handle: number
+  ): { group: Int32Array; starts: Int32Array; members: Int32Array } | null;
+  weldVertices(handle: number, epsilon?: number): number; // New vertex count, -1 on error
+
+  // Half-edge edit meshes (polygon cages over a geometry buffer's vertices)
+  createEditMesh(geometryHandle: number): number; // 0 on failure
+  deleteEditMesh(handle: number): void;
+  setEditMeshFaces(handle: number, faces: number[][]): boolean; // false (mesh unchanged) on an invalid face
+  getEditMeshFaces(handle: number): number[][];
+  editMeshWriteBack(handle: number): number; // Index count written
+
+  // Normal recomputation (mode: 0 = area-weighted, 1 = angle-weighted)
+  computeNormals(handle: number, mode?: number): number; // Triangle count, -1 on error
+  updateNormals(
+    handle: number,
+    firstVertex: number,
+    vertexCount: number,
+    mode?: number
+  ): number; // Vertex normals rewritten, -1 on error
+  getFaceNormals(handle: number): Float32Array | null;
+
+  // Catmull-Clark subdivision surfaces over an edit mesh cage
+  createSubdivision(editMeshHandle: number, levels: number): number; // 0 on failure
+  deleteSubdivision(handle: number): void;
+  updateSubdivisionTopology(handle: number): number; // Levels built, -1 on error
+  evaluateSubdivision(handle: number, level: number): number; // Geometry handle, 0 on error
+  getSubdivisionLevelCount(handle: number): number;
+  getSubdivisionVertexCount(handle: number, level: number): number;
+  getSubdivisionTriangleCount(handle: number, level: number): number;
+
+  // Modifier stacks (lazily evaluated, trailing arrays drawn as instances)
+  createModifierStack(baseHandle: number): number; // 0 on failure
+  deleteModifierStack(handle: number): void;
+  touchModifierStack(handle: number, topologyChanged?: boolean): void;
+  addModifier(handle: number, type: number): number; // Index, -1 on error
+  removeModifier(handle: number, index: number): void;
+  setModifierParam(
+    handle: number,
+    index: number,
+    param: number,
+    value: number
+  ): void;
+  getModifierCount(handle: number): number;
+  evaluateModifierStack(handle: number): number; // Geometry handle, 0 on error
+  getModifierEvaluationCount(handle: number): number;
+  renderModifierStack(handle: number): number; // Instances drawn
+  materializeModifierStack(handle: number): number; // New geometry handle
+
+  // QEM simplified LOD chains (index lists over the buffer's own vertices)
+  supportsLods: boolean; // false for rasterizer.wasm builds without LOD exports
+  buildGeometryLods(handle: number, levels: number, ratio: number): number; // Levels incl. 0, -1 on error
+  clearGeometryLods(handle: number): void;
+  getGeometryLodCount(handle: number): number;
+  getGeometryLodIndices(handle: number, level: number): Uint32Array | null;
+  getGeometryLodError(handle: number, level: number): number;
+  setLodPixelError(pixels: number): void; // 0 disables automatic LOD
+  getLastLodLevel(): number;
+
+  // Linear blend skinning: 4 joint indices + weights per vertex, posed by
+  // render_geometry_buffer with the current palette (row-major 4x4 matrices,
+  // joint world * inverse bind, in the mesh's Z-up object space)
+  geometryBufferAllocSkin(
+    handle: number,
+    vertexCount: number
+  ): { joints: Uint16Array; weights: Float32Array } | null;
+  geometryBufferHasSkin(handle: number): boolean;
+  clearGeometrySkin(handle: number): void;
+  setJointPalette(matrices: Float32Array, count: number): void; // count 0 = bind pose
+
+  // Morph targets: sparse deltas (dx, dy, dz, dnx, dny, dnz per entry),
+  // accumulated in the module before skinning
+  addMorphTarget(
+    handle: number,
+    entryCount: number
+  ): { target: number; indices: Uint32Array; deltas: Float32Array } | null;
+  addMorphTargetDense(
+    handle: number,
+    deltas: Float32Array, // 6 floats per vertex
+    epsilon?: number
+  ): number; // Target index, -1 on error
+  getMorphTargetCount(handle: number): number;
+  setMorphWeight(handle: number, target: number, weight: number): void;
+  getMorphWeight(handle: number, target: number): number;
+  clearMorphTargets(handle: number): void;
+
+  // Scene lights besides the main light (LIGHT_FLOATS per light), culled
+  // per draw by bounds, and per-buffer static lighting bakes drawn without
+  // per-frame lighting
+  setLights(lights: Float32Array, count: number): void;
+  getLastLightCount(): number; // Lights reaching the last lit draw
+  setStaticLighting(handle: number, enable: boolean): boolean;
+  hasStaticLighting(handle: number): boolean;
+  bakeLighting(handle: number): boolean; // Bake now instead of on first draw
+
+  // Texture-space lighting / AO bake of a geometry buffer's UV layout into a
+  // texture buffer, stepped in row bands (see bakeLightmap)
+  lightmapBakeBegin(
+    geometryHandle: number,
+    targetTexture: number,
+    width: number,
+    height: number,
+    sourceTexture: number, // Multiplied in (0 = white)
+    flags: number, // LIGHTMAP_* bits
+    aoSamples: number,
+    aoRadius: number // Object units, <= 0 for the bounding radius
+  ): number; // Rows to step through, 0 on failure
+  lightmapBakeStep(rowCount: number): number; // Rows left, -1 if the session ended
+  lightmapBakeFinish(dilation: number): number; // Covered texels, -1 on failure
+
+  // AO occluders (buffers placed with the current model matrix) traced by
+  // both AO bakes, and AO baked into vertex colors (multiplied in place)
+  aoClearOccluders(): void;
+  aoAddOccluder(geometryHandle: number): number; // Index, -1 if full
+  bakeVertexAo(handle: number, samples: number, radius: number): number; // Vertices baked, -1 on failure
+  vertexAoBegin(handle: number, samples: number, radius: number): number; // Vertices, 0 on failure
+  vertexAoStep(count: number): number; // Vertices left, -1 if the session ended
+
+  // Per-triangle material ids into a per-draw table (MATERIAL_INTS per
+  // entry), so multi-material buffers draw in one call
+  allocGeometryMaterials(handle: number, triangleCount: number): Uint8Array | null;
+  geometryBufferHasMaterials(handle: number): boolean;
+  clearGeometryMaterials(handle: number): void;
+  setMaterials(table: Int32Array, count: number): void; // Next draw only; count 0 = ignore ids
 }
 
 interface WasmExports {
@@ -176,6 +509,10 @@ interface WasmExports {
   set_enable_vertex_snapping: (enable: number) => void;
   set_enable_smooth_shading: (enable: number) => void;
   set_snap_resolution: (x: number, y: number) => void;
+  // Optional: missing from rasterizer.wasm builds that predate them
+  set_texture_mapping?: (mode: number) => void;
+  set_enable_gte?: (enable: number) => void;
+  set_lighting_lut?: (bits: number) => void;
   render_point: (
     screenX: number,
     screenY: number,
@@ -189,6 +526,8 @@ interface WasmExports {
     mvpMatrix: number,
     pointSize: number
   ) => void;
+  sprite_get_input_ptr: (count: number) => number;
+  render_sprites: (count: number, flags: number) => number;
   malloc: (size: number) => number;
   free: (ptr: number) => void;
   _initialize: () => void;
@@ -228,6 +567,275 @@ interface WasmExports {
   texture_buffer_get_width: (handle: number) => number;
   texture_buffer_get_height: (handle: number) => number;
   bind_texture_buffer: (handle: number) => void;
+
+  // Frame sequence export exports
+  get_export_camera_keys_ptr: () => number;
+  set_export_camera_key_count: (count: number) => void;
+  set_export_turntable: (
+    cx: number,
+    cy: number,
+    cz: number,
+    radius: number,
+    height: number,
+    startAngle: number
+  ) => void;
+  set_export_camera_params: (
+    fovDegrees: number,
+    near: number,
+    far: number
+  ) => void;
+  set_export_clear_color: (r: number, g: number, b: number) => void;
+  export_clear_draws: () => void;
+  export_add_draw: (geometryHandle: number, textureHandle: number) => number;
+  export_begin: (
+    width: number,
+    height: number,
+    frameCount: number,
+    format: number,
+    fps: number
+  ) => number;
+  export_render_next_frame: () => number;
+  export_get_chunk_ptr: () => number;
+  export_end: () => void;
+
+  // Native OBJ / MTL parser exports
+  obj_parser_reset: () => void;
+  obj_parser_begin: (r: number, g: number, b: number) => void;
+  obj_parser_get_input_ptr: (size: number) => number;
+  obj_parser_feed: (size: number) => number;
+  obj_parser_finish: (recenter: number) => number;
+  obj_parser_get_mesh_handle: (index: number) => number;
+  obj_parser_get_mesh_name: (index: number) => number;
+  obj_parser_get_mesh_material: (index: number) => number;
+  obj_parser_get_mesh_smooth: (index: number) => number;
+  obj_parser_get_mesh_face_sizes: (index: number) => number;
+  obj_parser_get_mesh_face_count: (index: number) => number;
+  obj_parser_get_mtllib: () => number;
+  obj_parser_get_bounds: () => number;
+  mtl_parse: (data: number, size: number) => number;
+  mtl_get_material_name: (index: number) => number;
+  mtl_get_material_diffuse_map: (index: number) => number;
+  mtl_get_material_params: (index: number) => number;
+
+  // glTF / GLB ingestion exports
+  glb_get_input_ptr: (size: number) => number;
+  glb_parse: (size: number) => number;
+  glb_get_json_ptr: () => number;
+  glb_get_json_size: () => number;
+  glb_get_bin_ptr: () => number;
+  glb_get_bin_size: () => number;
+  glb_reset: () => void;
+  gltf_set_accessor: (
+    attribute: number,
+    byteOffset: number,
+    byteStride: number,
+    count: number,
+    componentType: number,
+    components: number,
+    normalized: number
+  ) => void;
+  gltf_clear_accessors: () => void;
+  gltf_set_material: (material: number) => void;
+  gltf_append_primitive: (
+    handle: number,
+    mode: number,
+    deindex: number
+  ) => number;
+  gltf_finish_mesh: (handle: number) => number;
+
+  // Compressed mesh codec exports
+  mesh_encode: (handle: number, positionBits: number, uvBits: number) => number;
+  mesh_codec_get_output_ptr: () => number;
+  mesh_codec_get_input_ptr: (size: number) => number;
+  mesh_decode: (handle: number, data: number, size: number) => number;
+
+  // Renderer state snapshot exports
+  snapshot_state: () => number;
+  get_snapshot_ptr: () => number;
+  get_snapshot_input_ptr: (size: number) => number;
+  free_snapshot: () => void;
+  restore_state: (image: number, size: number) => number;
+
+  // ID buffer picking exports
+  set_enable_id_buffer: (enable: number) => void;
+  set_object_id: (id: number) => void;
+  get_id_buffer_ptr: () => number;
+  get_face_id_buffer_ptr: () => number;
+  pick: (x: number, y: number) => number;
+  pick_get_face: () => number;
+  pick_rect: (x0: number, y0: number, x1: number, y1: number) => number;
+  pick_rect_faces: (
+    objectId: number,
+    x0: number,
+    y0: number,
+    x1: number,
+    y1: number
+  ) => number;
+  get_pick_results_ptr: () => number;
+  get_pick_view_projection_ptr: () => number;
+  unproject_depth: (x: number, y: number) => number;
+  get_pick_position_ptr: () => number;
+  geometry_buffer_build_bvh: (handle: number) => number;
+  geometry_buffer_refit_bvh: (
+    handle: number,
+    firstTriangle: number,
+    triangleCount: number
+  ) => number;
+  get_raycast_rays_ptr: () => number;
+  get_raycast_results_ptr: () => number;
+  raycast: (
+    handle: number,
+    raysPtr: number,
+    count: number,
+    resultsPtr: number
+  ) => number;
+  vertex_index_build: (handle: number) => number;
+  get_vertex_screen_ptr: () => number;
+  vertex_index_nearest: (
+    x: number,
+    y: number,
+    radius: number,
+    occlusion: number
+  ) => number;
+  vertex_index_get_nearest_distance: () => number;
+  vertex_index_select_rect: (
+    x0: number,
+    y0: number,
+    x1: number,
+    y1: number,
+    occlusion: number
+  ) => number;
+  get_lasso_points_ptr: () => number;
+  vertex_index_select_lasso: (pointCount: number, occlusion: number) => number;
+  get_vertex_select_bits_ptr: () => number;
+  vertex_index_get_count: () => number;
+  spatial_hash_build: (handle: number, epsilon: number) => number;
+  colocated_vertices: (handle: number, vertex: number) => number;
+  colocated_vertices_at: (
+    handle: number,
+    x: number,
+    y: number,
+    z: number
+  ) => number;
+  get_colocated_results_ptr: () => number;
+  spatial_hash_get_group_count: (handle: number) => number;
+  spatial_hash_get_groups_ptr: (handle: number) => number;
+  spatial_hash_get_group_starts_ptr: (handle: number) => number;
+  spatial_hash_get_group_members_ptr: (handle: number) => number;
+  weld_vertices: (handle: number, epsilon: number) => number;
+  edit_mesh_get_input_ptr: (count: number) => number;
+  edit_mesh_get_results_ptr: () => number;
+  edit_mesh_create: (geometryHandle: number) => number;
+  edit_mesh_delete: (handle: number) => void;
+  edit_mesh_set_faces: (handle: number, faceCount: number) => number;
+  edit_mesh_get_face_count: (handle: number) => number;
+  edit_mesh_get_faces: (handle: number) => number;
+  edit_mesh_write_back: (handle: number) => number;
+  geometry_buffer_compute_normals: (handle: number, mode: number) => number;
+  geometry_buffer_update_normals: (
+    handle: number,
+    firstVertex: number,
+    vertexCount: number,
+    mode: number
+  ) => number;
+  geometry_buffer_get_face_normals_ptr: (handle: number) => number;
+  subdiv_create: (editMeshHandle: number, levels: number) => number;
+  subdiv_delete: (handle: number) => void;
+  subdiv_update_topology: (handle: number) => number;
+  subdiv_evaluate: (handle: number, level: number) => number;
+  subdiv_get_level_count: (handle: number) => number;
+  subdiv_get_vertex_count: (handle: number, level: number) => number;
+  subdiv_get_triangle_count: (handle: number, level: number) => number;
+  modifier_stack_create: (baseHandle: number) => number;
+  modifier_stack_delete: (handle: number) => void;
+  modifier_stack_touch: (handle: number, topology: number) => void;
+  modifier_stack_add: (handle: number, type: number) => number;
+  modifier_stack_remove: (handle: number, index: number) => void;
+  modifier_stack_set_param: (
+    handle: number,
+    index: number,
+    param: number,
+    value: number
+  ) => void;
+  modifier_stack_get_count: (handle: number) => number;
+  modifier_stack_evaluate: (handle: number) => number;
+  modifier_stack_get_evaluation_count: (handle: number) => number;
+  modifier_stack_render: (handle: number) => number;
+  modifier_stack_materialize: (handle: number) => number;
+  // Optional: missing from rasterizer.wasm builds that predate LOD chains
+  geometry_buffer_build_lods?: (
+    handle: number,
+    levels: number,
+    ratio: number
+  ) => number;
+  geometry_buffer_clear_lods: (handle: number) => void;
+  geometry_buffer_get_lod_count: (handle: number) => number;
+  geometry_buffer_get_lod_index_count: (handle: number, level: number) => number;
+  geometry_buffer_get_lod_indices_ptr: (handle: number, level: number) => number;
+  geometry_buffer_get_lod_error: (handle: number, level: number) => number;
+  set_lod_pixel_error: (pixels: number) => void;
+  get_last_lod_level: () => number;
+  geometry_buffer_alloc_skin: (handle: number, vertexCount: number) => number;
+  geometry_buffer_get_skin_weights_ptr: (handle: number) => number;
+  geometry_buffer_has_skin: (handle: number) => number;
+  geometry_buffer_clear_skin: (handle: number) => void;
+  get_joint_palette_ptr: () => number;
+  set_joint_count: (count: number) => void;
+  get_max_joints: () => number;
+  geometry_buffer_add_morph_target: (handle: number, entryCount: number) => number;
+  morph_get_dense_input_ptr: (vertexCount: number) => number;
+  geometry_buffer_add_morph_target_dense: (handle: number, epsilon: number) => number;
+  geometry_buffer_get_morph_indices_ptr: (handle: number, target: number) => number;
+  geometry_buffer_get_morph_deltas_ptr: (handle: number, target: number) => number;
+  geometry_buffer_get_morph_entry_count: (handle: number, target: number) => number;
+  geometry_buffer_get_morph_target_count: (handle: number) => number;
+  geometry_buffer_set_morph_weight: (
+    handle: number,
+    target: number,
+    weight: number
+  ) => void;
+  geometry_buffer_get_morph_weight: (handle: number, target: number) => number;
+  geometry_buffer_clear_morph_targets: (handle: number) => void;
+  get_lights_ptr: () => number;
+  get_max_lights: () => number;
+  set_light_count: (count: number) => void;
+  get_last_light_count: () => number;
+  geometry_buffer_set_static_lighting: (handle: number, enable: number) => number;
+  geometry_buffer_has_static_lighting: (handle: number) => number;
+  geometry_buffer_bake_lighting: (handle: number) => number;
+  lightmap_bake_begin: (
+    geometry: number,
+    target: number,
+    width: number,
+    height: number,
+    source: number,
+    flags: number,
+    aoSamples: number,
+    aoRadius: number
+  ) => number;
+  lightmap_bake_step: (rowCount: number) => number;
+  lightmap_bake_finish: (dilation: number) => number;
+  ao_clear_occluders: () => void;
+  ao_add_occluder: (geometry: number) => number;
+  bake_vertex_ao: (handle: number, samples: number, radius: number) => number;
+  vertex_ao_begin: (handle: number, samples: number, radius: number) => number;
+  vertex_ao_step: (count: number) => number;
+  geometry_buffer_alloc_materials: (handle: number, triangleCount: number) => number;
+  geometry_buffer_has_materials: (handle: number) => number;
+  geometry_buffer_clear_materials: (handle: number) => void;
+  get_material_table_ptr: () => number;
+  set_material_count: (count: number) => void;
+  get_max_materials: () => number;
+}
+
+const textDecoder = new TextDecoder();
+
+/** Read a NUL-terminated UTF-8 string from WASM memory (null for ptr 0) */
+function readCString(memory: WebAssembly.Memory, ptr: number): string | null {
+  if (!ptr) return null;
+  const bytes = new Uint8Array(memory.buffer, ptr);
+  const end = bytes.indexOf(0);
+  return textDecoder.decode(bytes.subarray(0, end < 0 ? 0 : end));
 }
 
 /**
@@ -337,6 +945,39 @@ export async function loadWasmRasterizer(
   let currentWidth = exports.get_render_width();
   let currentHeight = exports.get_render_height();
 
+  // Copy the vertex selection bitset out of WASM memory
+  const readSelectBits = (): Uint32Array =>
+    new Uint32Array(
+      memory.buffer,
+      exports.get_vertex_select_bits_ptr(),
+      (exports.vertex_index_get_count() + 31) >> 5
+    ).slice();
+
+  const readColocatedResults = (count: number): Int32Array =>
+    count > 0
+      ? new Int32Array(
+          memory.buffer,
+          exports.get_colocated_results_ptr(),
+          count
+        ).slice()
+      : new Int32Array(0);
+
+  // Edit mesh list passing (input scratch in, results buffer out)
+  const writeEditInput = (values: ArrayLike<number>): boolean => {
+    const ptr = exports.edit_mesh_get_input_ptr(values.length);
+    if (!ptr) return false;
+    new Int32Array(memory.buffer, ptr, values.length).set(values);
+    return true;
+  };
+  const readEditResults = (count: number): Int32Array =>
+    count > 0
+      ? new Int32Array(
+          memory.buffer,
+          exports.edit_mesh_get_results_ptr(),
+          count
+        ).slice()
+      : new Int32Array(0);
+
   return {
     get renderWidth() {
       return currentWidth;
@@ -350,6 +991,7 @@ export async function loadWasmRasterizer(
     indices,
     mvpMatrix,
     modelMatrix,
+    supportsLods: typeof exports.geometry_buffer_build_lods === "function",
 
     setRenderResolution(width: number, height: number) {
       exports.set_render_resolution(width, height);
@@ -438,6 +1080,18 @@ export async function loadWasmRasterizer(
       exports.set_snap_resolution(x, y);
     },
 
+    setTextureMapping(mode: number) {
+      exports.set_texture_mapping?.(mode);
+    },
+
+    setEnableGte(enable: boolean) {
+      exports.set_enable_gte?.(enable ? 1 : 0);
+    },
+
+    setLightingLut(bits: number) {
+      exports.set_lighting_lut?.(bits);
+    },
+
     renderPoint(
       screenX: number,
       screenY: number,
@@ -468,6 +1122,16 @@ export async function loadWasmRasterizer(
       );
     },
 
+    renderSprites(sprites: Float32Array, count: number, flags: number): number {
+      count = Math.min(count, Math.floor(sprites.length / SPRITE_FLOATS));
+      const ptr = count > 0 ? exports.sprite_get_input_ptr(count) : 0;
+      if (!ptr) return 0;
+      new Float32Array(memory.buffer, ptr, count * SPRITE_FLOATS).set(
+        sprites.subarray(0, count * SPRITE_FLOATS)
+      );
+      return exports.render_sprites(count, flags);
+    },
+
     // Material baking methods
     getBakeProgramBuffer(): Uint8Array {
       return bakeProgramBuffer;
@@ -566,6 +1230,800 @@ export async function loadWasmRasterizer(
     bindTextureBuffer(handle: number): void {
       exports.bind_texture_buffer(handle);
     },
+
+    // Frame sequence export methods
+    getExportCameraKeysBuffer(): Float32Array {
+      return new Float32Array(
+        memory.buffer,
+        exports.get_export_camera_keys_ptr(),
+        MAX_EXPORT_CAMERA_KEYS * 6
+      );
+    },
+
+    setExportCameraKeyCount(count: number): void {
+      exports.set_export_camera_key_count(count);
+    },
+
+    setExportTurntable(
+      cx: number,
+      cy: number,
+      cz: number,
+      radius: number,
+      height: number,
+      startAngle: number
+    ): void {
+      exports.set_export_turntable(cx, cy, cz, radius, height, startAngle);
+    },
+
+    setExportCameraParams(fovDegrees: number, near: number, far: number) {
+      exports.set_export_camera_params(fovDegrees, near, far);
+    },
+
+    setExportClearColor(r: number, g: number, b: number): void {
+      exports.set_export_clear_color(r, g, b);
+    },
+
+    exportClearDraws(): void {
+      exports.export_clear_draws();
+    },
+
+    exportAddDraw(geometryHandle: number, textureHandle: number): number {
+      return exports.export_add_draw(geometryHandle, textureHandle);
+    },
+
+    exportBegin(
+      width: number,
+      height: number,
+      frameCount: number,
+      format: number,
+      fps: number
+    ): Uint8Array | null {
+      const size = exports.export_begin(width, height, frameCount, format, fps);
+      if (size < 0) return null;
+      return new Uint8Array(memory.buffer, exports.export_get_chunk_ptr(), size);
+    },
+
+    exportRenderNextFrame(): Uint8Array | null {
+      const size = exports.export_render_next_frame();
+      if (size <= 0) return null;
+      return new Uint8Array(memory.buffer, exports.export_get_chunk_ptr(), size);
+    },
+
+    exportEnd(): void {
+      exports.export_end();
+    },
+
+    // Native OBJ / MTL parser methods
+    objParserBegin(r: number, g: number, b: number): void {
+      exports.obj_parser_begin(r, g, b);
+    },
+
+    objParserFeed(chunk: Uint8Array): boolean {
+      const ptr = exports.obj_parser_get_input_ptr(chunk.length);
+      if (!ptr) return false;
+      new Uint8Array(memory.buffer, ptr, chunk.length).set(chunk);
+      return exports.obj_parser_feed(chunk.length) !== 0;
+    },
+
+    objParserFinish(recenter: boolean): WasmObjMesh[] {
+      const count = exports.obj_parser_finish(recenter ? 1 : 0);
+      const meshes: WasmObjMesh[] = [];
+      for (let i = 0; i < count; i++) {
+        const faceCount = exports.obj_parser_get_mesh_face_count(i);
+        const facePtr = exports.obj_parser_get_mesh_face_sizes(i);
+        meshes.push({
+          handle: exports.obj_parser_get_mesh_handle(i),
+          name:
+            readCString(memory, exports.obj_parser_get_mesh_name(i)) ??
+            "default",
+          material: readCString(
+            memory,
+            exports.obj_parser_get_mesh_material(i)
+          ),
+          smooth: exports.obj_parser_get_mesh_smooth(i) !== 0,
+          faceSizes: facePtr
+            ? new Uint32Array(memory.buffer, facePtr, faceCount).slice()
+            : new Uint32Array(0),
+        });
+      }
+      return meshes;
+    },
+
+    objParserGetMtllib(): string | null {
+      return readCString(memory, exports.obj_parser_get_mtllib());
+    },
+
+    objParserGetBounds(): Float32Array {
+      return new Float32Array(memory.buffer, exports.obj_parser_get_bounds(), 6);
+    },
+
+    objParserReset(): void {
+      exports.obj_parser_reset();
+    },
+
+    mtlParse(data: Uint8Array): WasmMtlMaterial[] {
+      const ptr = exports.malloc(data.length);
+      if (!ptr) return [];
+      new Uint8Array(memory.buffer, ptr, data.length).set(data);
+      const count = exports.mtl_parse(ptr, data.length);
+      exports.free(ptr);
+
+      const materials: WasmMtlMaterial[] = [];
+      for (let i = 0; i < count; i++) {
+        const p = new Float32Array(
+          memory.buffer,
+          exports.mtl_get_material_params(i),
+          11
+        );
+        materials.push({
+          name: readCString(memory, exports.mtl_get_material_name(i)) ?? "",
+          diffuse: [p[0], p[1], p[2]],
+          ambient: [p[3], p[4], p[5]],
+          specular: [p[6], p[7], p[8]],
+          shininess: p[9],
+          opacity: p[10],
+          diffuseMap: readCString(
+            memory,
+            exports.mtl_get_material_diffuse_map(i)
+          ),
+        });
+      }
+      return materials;
+    },
+
+    // glTF / GLB ingestion methods
+    glbLoad(data: Uint8Array): boolean {
+      const ptr = exports.glb_get_input_ptr(data.length);
+      if (!ptr) return false;
+      new Uint8Array(memory.buffer, ptr, data.length).set(data);
+      return exports.glb_parse(data.length) !== 0;
+    },
+
+    glbGetJSON(): string | null {
+      const ptr = exports.glb_get_json_ptr();
+      if (!ptr) return null;
+      return textDecoder.decode(
+        new Uint8Array(memory.buffer, ptr, exports.glb_get_json_size())
+      );
+    },
+
+    glbGetBinView(byteOffset: number, byteLength: number): Uint8Array | null {
+      const ptr = exports.glb_get_bin_ptr();
+      if (!ptr || byteOffset + byteLength > exports.glb_get_bin_size()) {
+        return null;
+      }
+      return new Uint8Array(memory.buffer, ptr + byteOffset, byteLength);
+    },
+
+    glbReset(): void {
+      exports.glb_reset();
+    },
+
+    gltfSetAccessor(
+      attribute: number,
+      byteOffset: number,
+      byteStride: number,
+      count: number,
+      componentType: number,
+      components: number,
+      normalized: boolean
+    ): void {
+      exports.gltf_set_accessor(
+        attribute,
+        byteOffset,
+        byteStride,
+        count,
+        componentType,
+        components,
+        normalized ? 1 : 0
+      );
+    },
+
+    gltfClearAccessors(): void {
+      exports.gltf_clear_accessors();
+    },
+
+    gltfSetMaterial(material: number): void {
+      exports.gltf_set_material(material);
+    },
+
+    gltfAppendPrimitive(handle: number, mode: number, deindex: boolean) {
+      return exports.gltf_append_primitive(handle, mode, deindex ? 1 : 0);
+    },
+
+    gltfFinishMesh(handle: number): boolean {
+      return exports.gltf_finish_mesh(handle) !== 0;
+    },
+
+    // Compressed mesh codec methods
+    meshEncode(
+      handle: number,
+      positionBits: number = 16,
+      uvBits: number = 12
+    ): Uint8Array | null {
+      const size = exports.mesh_encode(handle, positionBits, uvBits);
+      if (size <= 0) return null;
+      return new Uint8Array(
+        memory.buffer,
+        exports.mesh_codec_get_output_ptr(),
+        size
+      ).slice();
+    },
+
+    meshDecode(handle: number, data: Uint8Array): number {
+      const ptr = exports.mesh_codec_get_input_ptr(data.length);
+      if (!ptr) return -1;
+      new Uint8Array(memory.buffer, ptr, data.length).set(data);
+      return exports.mesh_decode(handle, ptr, data.length);
+    },
+
+    // Renderer state snapshot methods
+    snapshotState(): Uint8Array | null {
+      const size = exports.snapshot_state();
+      if (size <= 0) return null;
+      const image = new Uint8Array(
+        memory.buffer,
+        exports.get_snapshot_ptr(),
+        size
+      ).slice();
+      exports.free_snapshot();
+      return image;
+    },
+
+    restoreState(image: Uint8Array): boolean {
+      const ptr = exports.get_snapshot_input_ptr(image.length);
+      if (!ptr) return false;
+      new Uint8Array(memory.buffer, ptr, image.length).set(image);
+      const ok = exports.restore_state(ptr, image.length) !== 0;
+      exports.free_snapshot();
+      return ok;
+    },
+
+    // ID buffer picking methods
+    setEnableIdBuffer(enable: boolean): void {
+      exports.set_enable_id_buffer(enable ? 1 : 0);
+    },
+
+    setObjectId(id: number): void {
+      exports.set_object_id(id);
+    },
+
+    pick(x: number, y: number): { objectId: number; face: number } | null {
+      const objectId = exports.pick(x, y) >>> 0;
+      if (objectId === 0) return null;
+      return { objectId, face: exports.pick_get_face() >>> 0 };
+    },
+
+    pickRect(x0: number, y0: number, x1: number, y1: number): Uint32Array {
+      const count = exports.pick_rect(x0, y0, x1, y1);
+      return new Uint32Array(
+        memory.buffer,
+        exports.get_pick_results_ptr(),
+        count
+      ).slice();
+    },
+
+    pickRectFaces(
+      objectId: number,
+      x0: number,
+      y0: number,
+      x1: number,
+      y1: number
+    ): Uint32Array {
+      const count = exports.pick_rect_faces(objectId, x0, y0, x1, y1);
+      return new Uint32Array(
+        memory.buffer,
+        exports.get_pick_results_ptr(),
+        count
+      ).slice();
+    },
+
+    setPickViewProjection(matrix: Float32Array | number[]): void {
+      new Float32Array(
+        memory.buffer,
+        exports.get_pick_view_projection_ptr(),
+        16
+      ).set(matrix);
+    },
+
+    unprojectDepth(x: number, y: number): [number, number, number] | null {
+      if (!exports.unproject_depth(x, y)) return null;
+      const p = new Float32Array(
+        memory.buffer,
+        exports.get_pick_position_ptr(),
+        3
+      );
+      return [p[0], p[1], p[2]];
+    },
+
+    // Triangle BVH methods
+    buildBvh(handle: number): number {
+      return exports.geometry_buffer_build_bvh(handle);
+    },
+
+    refitBvh(
+      handle: number,
+      firstTriangle: number,
+      triangleCount: number
+    ): boolean {
+      return (
+        exports.geometry_buffer_refit_bvh(handle, firstTriangle, triangleCount) !==
+        0
+      );
+    },
+
+    raycast(handle: number, rays: Float32Array): WasmRayHits | null {
+      const count = Math.floor(rays.length / RAY_FLOATS);
+      const hits: WasmRayHits = {
+        triangle: new Int32Array(count),
+        t: new Float32Array(count),
+        u: new Float32Array(count),
+        v: new Float32Array(count),
+        hitCount: 0,
+      };
+      const raysPtr = exports.get_raycast_rays_ptr();
+      const resultsPtr = exports.get_raycast_results_ptr();
+
+      // Scratch buffers hold MAX_RAYCAST_RAYS rays, so trace in batches
+      for (let first = 0; first < count; first += MAX_RAYCAST_RAYS) {
+        const batch = Math.min(MAX_RAYCAST_RAYS, count - first);
+        new Float32Array(memory.buffer, raysPtr, batch * RAY_FLOATS).set(
+          rays.subarray(first * RAY_FLOATS, (first + batch) * RAY_FLOATS)
+        );
+        const n = exports.raycast(handle, raysPtr, batch, resultsPtr);
+        if (n < 0) return null;
+        hits.hitCount += n;
+
+        // RayHit is { int32 triangle; float t, u, v }
+        const ints = new Int32Array(memory.buffer, resultsPtr, batch * 4);
+        const floats = new Float32Array(memory.buffer, resultsPtr, batch * 4);
+        for (let i = 0; i < batch; i++) {
+          hits.triangle[first + i] = ints[i * 4];
+          hits.t[first + i] = floats[i * 4 + 1];
+          hits.u[first + i] = floats[i * 4 + 2];
+          hits.v[first + i] = floats[i * 4 + 3];
+        }
+      }
+      return hits;
+    },
+
+    // Screen-space vertex index methods
+    buildVertexIndex(handle: number): number {
+      return exports.vertex_index_build(handle);
+    },
+
+    nearestVertex(
+      x: number,
+      y: number,
+      radius: number,
+      occlusion = false
+    ): { index: number; distance: number } | null {
+      const index = exports.vertex_index_nearest(x, y, radius, occlusion ? 1 : 0);
+      if (index < 0) return null;
+      return { index, distance: exports.vertex_index_get_nearest_distance() };
+    },
+
+    selectVerticesRect(
+      x0: number,
+      y0: number,
+      x1: number,
+      y1: number,
+      occlusion = false
+    ): Uint32Array {
+      exports.vertex_index_select_rect(x0, y0, x1, y1, occlusion ? 1 : 0);
+      return readSelectBits();
+    },
+
+    selectVerticesLasso(
+      points: Float32Array | number[],
+      occlusion = false
+    ): Uint32Array {
+      const count = Math.min(Math.floor(points.length / 2), MAX_LASSO_POINTS);
+      new Float32Array(memory.buffer, exports.get_lasso_points_ptr(), count * 2).set(
+        Array.isArray(points) ? points.slice(0, count * 2) : points.subarray(0, count * 2)
+      );
+      exports.vertex_index_select_lasso(count, occlusion ? 1 : 0);
+      return readSelectBits();
+    },
+
+    // Vertex spatial hash methods
+    buildSpatialHash(handle: number, epsilon = 0.0001): number {
+      return exports.spatial_hash_build(handle, epsilon);
+    },
+
+    getColocatedVertices(handle: number, vertex: number): Int32Array {
+      const count = exports.colocated_vertices(handle, vertex);
+      return readColocatedResults(count);
+    },
+
+    getColocatedVerticesAt(
+      handle: number,
+      x: number,
+      y: number,
+      z: number
+    ): Int32Array {
+      const count = exports.colocated_vertices_at(handle, x, y, z);
+      return readColocatedResults(count);
+    },
+
+    getColocationGroups(
+      handle: number
+    ): { group: Int32Array; starts: Int32Array; members: Int32Array } | null {
+      const groupCount = exports.spatial_hash_get_group_count(handle);
+      const groupPtr = exports.spatial_hash_get_groups_ptr(handle);
+      if (!groupPtr) return null;
+      const vertexCount = exports.geometry_buffer_get_vertex_count(handle);
+      return {
+        group: new Int32Array(memory.buffer, groupPtr, vertexCount).slice(),
+        starts: new Int32Array(
+          memory.buffer,
+          exports.spatial_hash_get_group_starts_ptr(handle),
+          groupCount + 1
+        ).slice(),
+        members: new Int32Array(
+          memory.buffer,
+          exports.spatial_hash_get_group_members_ptr(handle),
+          vertexCount
+        ).slice(),
+      };
+    },
+
+    weldVertices(handle: number, epsilon = 0.0001): number {
+      return exports.weld_vertices(handle, epsilon);
+    },
+
+    // Half-edge edit mesh methods
+    createEditMesh(geometryHandle: number): number {
+      return exports.edit_mesh_create(geometryHandle);
+    },
+
+    deleteEditMesh(handle: number): void {
+      exports.edit_mesh_delete(handle);
+    },
+
+    setEditMeshFaces(handle: number, faces: number[][]): boolean {
+      const flat: number[] = faces.map((f) => f.length);
+      for (const f of faces) for (const v of f) flat.push(v);
+      if (!writeEditInput(flat)) return false;
+      return exports.edit_mesh_set_faces(handle, faces.length) >= 0;
+    },
+
+    getEditMeshFaces(handle: number): number[][] {
+      const faceCount = exports.edit_mesh_get_face_count(handle);
+      const flat = readEditResults(exports.edit_mesh_get_faces(handle));
+      const faces: number[][] = [];
+      let corner = faceCount;
+      for (let f = 0; f < faceCount; f++) {
+        faces.push(Array.from(flat.subarray(corner, corner + flat[f])));
+        corner += flat[f];
+      }
+      return faces;
+    },
+
+    editMeshWriteBack(handle: number): number {
+      return exports.edit_mesh_write_back(handle);
+    },
+
+    computeNormals(handle: number, mode = 0): number {
+      return exports.geometry_buffer_compute_normals(handle, mode);
+    },
+
+    updateNormals(
+      handle: number,
+      firstVertex: number,
+      vertexCount: number,
+      mode = 0
+    ): number {
+      return exports.geometry_buffer_update_normals(
+        handle,
+        firstVertex,
+        vertexCount,
+        mode
+      );
+    },
+
+    getFaceNormals(handle: number): Float32Array | null {
+      const ptr = exports.geometry_buffer_get_face_normals_ptr(handle);
+      if (!ptr) return null;
+      const triangles = exports.geometry_buffer_get_index_count(handle) / 3;
+      return new Float32Array(memory.buffer, ptr, Math.floor(triangles) * 3);
+    },
+
+    createSubdivision(editMeshHandle: number, levels: number): number {
+      return exports.subdiv_create(editMeshHandle, levels);
+    },
+
+    deleteSubdivision(handle: number): void {
+      exports.subdiv_delete(handle);
+    },
+
+    updateSubdivisionTopology(handle: number): number {
+      return exports.subdiv_update_topology(handle);
+    },
+
+    evaluateSubdivision(handle: number, level: number): number {
+      return exports.subdiv_evaluate(handle, level);
+    },
+
+    getSubdivisionLevelCount(handle: number): number {
+      return exports.subdiv_get_level_count(handle);
+    },
+
+    getSubdivisionVertexCount(handle: number, level: number): number {
+      return exports.subdiv_get_vertex_count(handle, level);
+    },
+
+    getSubdivisionTriangleCount(handle: number, level: number): number {
+      return exports.subdiv_get_triangle_count(handle, level);
+    },
+
+    createModifierStack(baseHandle: number): number {
+      return exports.modifier_stack_create(baseHandle);
+    },
+
+    deleteModifierStack(handle: number): void {
+      exports.modifier_stack_delete(handle);
+    },
+
+    touchModifierStack(handle: number, topologyChanged = false): void {
+      exports.modifier_stack_touch(handle, topologyChanged ? 1 : 0);
+    },
+
+    addModifier(handle: number, type: number): number {
+      return exports.modifier_stack_add(handle, type);
+    },
+
+    removeModifier(handle: number, index: number): void {
+      exports.modifier_stack_remove(handle, index);
+    },
+
+    setModifierParam(
+      handle: number,
+      index: number,
+      param: number,
+      value: number
+    ): void {
+      exports.modifier_stack_set_param(handle, index, param, value);
+    },
+
+    getModifierCount(handle: number): number {
+      return exports.modifier_stack_get_count(handle);
+    },
+
+    evaluateModifierStack(handle: number): number {
+      return exports.modifier_stack_evaluate(handle);
+    },
+
+    getModifierEvaluationCount(handle: number): number {
+      return exports.modifier_stack_get_evaluation_count(handle);
+    },
+
+    renderModifierStack(handle: number): number {
+      return exports.modifier_stack_render(handle);
+    },
+
+    materializeModifierStack(handle: number): number {
+      return exports.modifier_stack_materialize(handle);
+    },
+
+    buildGeometryLods(handle: number, levels: number, ratio: number): number {
+      return exports.geometry_buffer_build_lods?.(handle, levels, ratio) ?? -1;
+    },
+
+    clearGeometryLods(handle: number): void {
+      exports.geometry_buffer_clear_lods(handle);
+    },
+
+    getGeometryLodCount(handle: number): number {
+      return exports.geometry_buffer_get_lod_count(handle);
+    },
+
+    getGeometryLodIndices(handle: number, level: number): Uint32Array | null {
+      const ptr = exports.geometry_buffer_get_lod_indices_ptr(handle, level);
+      if (!ptr) return null;
+      const count = exports.geometry_buffer_get_lod_index_count(handle, level);
+      return new Uint32Array(memory.buffer, ptr, count);
+    },
+
+    getGeometryLodError(handle: number, level: number): number {
+      return exports.geometry_buffer_get_lod_error(handle, level);
+    },
+
+    setLodPixelError(pixels: number): void {
+      exports.set_lod_pixel_error(pixels);
+    },
+
+    getLastLodLevel(): number {
+      return exports.get_last_lod_level();
+    },
+
+    geometryBufferAllocSkin(
+      handle: number,
+      vertexCount: number
+    ): { joints: Uint16Array; weights: Float32Array } | null {
+      const jointsPtr = exports.geometry_buffer_alloc_skin(handle, vertexCount);
+      if (!jointsPtr) return null;
+      const weightsPtr = exports.geometry_buffer_get_skin_weights_ptr(handle);
+      return {
+        joints: new Uint16Array(memory.buffer, jointsPtr, vertexCount * 4),
+        weights: new Float32Array(memory.buffer, weightsPtr, vertexCount * 4),
+      };
+    },
+
+    geometryBufferHasSkin(handle: number): boolean {
+      return exports.geometry_buffer_has_skin(handle) !== 0;
+    },
+
+    clearGeometrySkin(handle: number): void {
+      exports.geometry_buffer_clear_skin(handle);
+    },
+
+    setJointPalette(matrices: Float32Array, count: number): void {
+      count = Math.max(0, Math.min(count, exports.get_max_joints()));
+      if (count > 0) {
+        new Float32Array(
+          memory.buffer,
+          exports.get_joint_palette_ptr(),
+          count * 16
+        ).set(matrices.subarray(0, count * 16));
+      }
+      exports.set_joint_count(count);
+    },
+
+    addMorphTarget(
+      handle: number,
+      entryCount: number
+    ): { target: number; indices: Uint32Array; deltas: Float32Array } | null {
+      const target = exports.geometry_buffer_add_morph_target(handle, entryCount);
+      if (target < 0) return null;
+      return {
+        target,
+        indices: new Uint32Array(
+          memory.buffer,
+          exports.geometry_buffer_get_morph_indices_ptr(handle, target),
+          entryCount
+        ),
+        deltas: new Float32Array(
+          memory.buffer,
+          exports.geometry_buffer_get_morph_deltas_ptr(handle, target),
+          entryCount * 6
+        ),
+      };
+    },
+
+    addMorphTargetDense(
+      handle: number,
+      deltas: Float32Array,
+      epsilon: number = 1e-6
+    ): number {
+      const vertexCount = exports.geometry_buffer_get_vertex_count(handle);
+      if (deltas.length < vertexCount * 6) return -1;
+      const ptr = exports.morph_get_dense_input_ptr(vertexCount);
+      if (!ptr) return -1;
+      new Float32Array(memory.buffer, ptr, vertexCount * 6).set(
+        deltas.subarray(0, vertexCount * 6)
+      );
+      return exports.geometry_buffer_add_morph_target_dense(handle, epsilon);
+    },
+
+    getMorphTargetCount(handle: number): number {
+      return exports.geometry_buffer_get_morph_target_count(handle);
+    },
+
+    setMorphWeight(handle: number, target: number, weight: number): void {
+      exports.geometry_buffer_set_morph_weight(handle, target, weight);
+    },
+
+    getMorphWeight(handle: number, target: number): number {
+      return exports.geometry_buffer_get_morph_weight(handle, target);
+    },
+
+    clearMorphTargets(handle: number): void {
+      exports.geometry_buffer_clear_morph_targets(handle);
+    },
+
+    setLights(lights: Float32Array, count: number): void {
+      count = Math.max(0, Math.min(count, exports.get_max_lights()));
+      if (count > 0) {
+        new Float32Array(
+          memory.buffer,
+          exports.get_lights_ptr(),
+          count * LIGHT_FLOATS
+        ).set(lights.subarray(0, count * LIGHT_FLOATS));
+      }
+      exports.set_light_count(count);
+    },
+
+    getLastLightCount(): number {
+      return exports.get_last_light_count();
+    },
+
+    setStaticLighting(handle: number, enable: boolean): boolean {
+      return exports.geometry_buffer_set_static_lighting(handle, enable ? 1 : 0) !== 0;
+    },
+
+    hasStaticLighting(handle: number): boolean {
+      return exports.geometry_buffer_has_static_lighting(handle) !== 0;
+    },
+
+    bakeLighting(handle: number): boolean {
+      return exports.geometry_buffer_bake_lighting(handle) !== 0;
+    },
+
+    lightmapBakeBegin(
+      geometryHandle: number,
+      targetTexture: number,
+      width: number,
+      height: number,
+      sourceTexture: number,
+      flags: number,
+      aoSamples: number,
+      aoRadius: number
+    ): number {
+      return exports.lightmap_bake_begin(
+        geometryHandle,
+        targetTexture,
+        width,
+        height,
+        sourceTexture,
+        flags,
+        aoSamples,
+        aoRadius
+      );
+    },
+
+    lightmapBakeStep(rowCount: number): number {
+      return exports.lightmap_bake_step(rowCount);
+    },
+
+    lightmapBakeFinish(dilation: number): number {
+      return exports.lightmap_bake_finish(dilation);
+    },
+
+    aoClearOccluders(): void {
+      exports.ao_clear_occluders();
+    },
+
+    aoAddOccluder(geometryHandle: number): number {
+      return exports.ao_add_occluder(geometryHandle);
+    },
+
+    bakeVertexAo(handle: number, samples: number, radius: number): number {
+      return exports.bake_vertex_ao(handle, samples, radius);
+    },
+
+    vertexAoBegin(handle: number, samples: number, radius: number): number {
+      return exports.vertex_ao_begin(handle, samples, radius);
+    },
+
+    vertexAoStep(count: number): number {
+      return exports.vertex_ao_step(count);
+    },
+
+    allocGeometryMaterials(handle: number, triangleCount: number): Uint8Array | null {
+      const ptr = exports.geometry_buffer_alloc_materials(handle, triangleCount);
+      return ptr ? new Uint8Array(memory.buffer, ptr, triangleCount) : null;
+    },
+
+    geometryBufferHasMaterials(handle: number): boolean {
+      return exports.geometry_buffer_has_materials(handle) !== 0;
+    },
+
+    clearGeometryMaterials(handle: number): void {
+      exports.geometry_buffer_clear_materials(handle);
+    },
+
+    setMaterials(table: Int32Array, count: number): void {
+      count = Math.max(0, Math.min(count, exports.get_max_materials()));
+      if (count > 0) {
+        new Int32Array(
+          memory.buffer,
+          exports.get_material_table_ptr(),
+          count * MATERIAL_INTS
+        ).set(table.subarray(0, count * MATERIAL_INTS));
+      }
+      exports.set_material_count(count);
+    },
   };
 }
 
@@ -706,3 +2164,352 @@ export function uploadMeshToBuffer(
   indexBuffer.set(indices);
   return true;
 }
+
+/**
+ * Render and stream a frame sequence (Y4M or raw RGBA) through a callback.
+ * The draw list and camera path must already be set up on the module.
+ *
+ * Each chunk is copied out of WASM memory before it is handed over, so the
+ * callback may keep it and return a promise that flushes it while the next
+ * frame renders. Fails (returns 0) while another export is running.
+ * Returns the number of frames written.
+ */
+export async function exportFrameSequence(
+  wasm: WasmRasterizerInstance,
+  width: number,
+  height: number,
+  frameCount: number,
+  format: number,
+  fps: number,
+  onChunk: (chunk: Uint8Array) => void | Promise<void>
+): Promise<number> {
+  const header = wasm.exportBegin(width, height, frameCount, format, fps);
+  if (!header) return 0;
+
+  let frames = 0;
+  try {
+    let pending: void | Promise<void> =
+      header.length > 0 ? onChunk(header.slice()) : undefined;
+    let chunk = wasm.exportRenderNextFrame();
+    while (chunk) {
+      const copy = chunk.slice();
+      await pending;
+      pending = onChunk(copy);
+      frames++;
+      chunk = wasm.exportRenderNextFrame();
+    }
+    await pending;
+  } finally {
+    wasm.exportEnd();
+  }
+  return frames;
+}
+
+/** Options for bakeLightmap */
+export interface LightmapBakeOptions {
+  width: number;
+  height: number;
+  sourceTexture?: number; // Texture buffer multiplied by the bake (0 = white)
+  flags?: number; // LIGHTMAP_* bits (default lighting + AO)
+  aoSamples?: number; // Rays per texel (default 32)
+  aoRadius?: number; // Object units (default: bounding radius)
+  dilation?: number; // Texel rings grown over UV seams (default 4)
+  rowsPerStep?: number; // Rows shaded between yields (default 16)
+}
+
+/**
+ * Bake lighting and/or AO of a geometry buffer into a texture buffer through
+ * its UV layout, yielding between row bands so the worker stays responsive.
+ * Uses the module's current lights, model matrix and shading mode.
+ * Returns the number of covered texels, -1 on failure.
+ */
+export async function bakeLightmap(
+  wasm: WasmRasterizerInstance,
+  geometryHandle: number,
+  targetTexture: number,
+  options: LightmapBakeOptions,
+  onProgress?: (done: number) => void // Fraction of rows shaded, 0-1
+): Promise<number> {
+  const rows = wasm.lightmapBakeBegin(
+    geometryHandle,
+    targetTexture,
+    options.width,
+    options.height,
+    options.sourceTexture ?? 0,
+    options.flags ?? (LIGHTMAP_LIGHTING | LIGHTMAP_AO),
+    options.aoSamples ?? 32,
+    options.aoRadius ?? 0
+  );
+  if (rows <= 0) return -1;
+
+  let left = rows;
+  while (left > 0) {
+    left = wasm.lightmapBakeStep(options.rowsPerStep ?? 16);
+    if (left < 0) return -1;
+    onProgress?.((rows - left) / rows);
+    await new Promise<void>((resolve) => setTimeout(resolve, 0));
+  }
+  return wasm.lightmapBakeFinish(options.dilation ?? 4);
+}
+
+/**
+ * Bake ambient occlusion into a geometry buffer's vertex colors, yielding
+ * every verticesPerStep vertices so the worker stays responsive. Occluders
+ * added with aoAddOccluder also block rays; the buffer is placed with the
+ * module's current model matrix.
+ * Returns the number of vertices baked, -1 on failure.
+ */
+export async function bakeVertexAmbientOcclusion(
+  wasm: WasmRasterizerInstance,
+  handle: number,
+  samples: number,
+  radius: number, // Object units, <= 0 for the bounding radius
+  onProgress?: (done: number) => void, // Fraction of vertices baked, 0-1
+  verticesPerStep: number = 2048
+): Promise<number> {
+  const total = wasm.vertexAoBegin(handle, samples, radius);
+  if (total <= 0) return -1;
+
+  let left = total;
+  while (left > 0) {
+    left = wasm.vertexAoStep(verticesPerStep);
+    if (left < 0) return -1;
+    onProgress?.((total - left) / total);
+    await new Promise<void>((resolve) => setTimeout(resolve, 0));
+  }
+  return total;
+}
+
+/**
+ * Parse OBJ file contents with the native parser, feeding it in chunks.
+ * String input is UTF-8 encoded one chunk at a time into a scratch buffer,
+ * so the whole file is never encoded at once.
+ * Each group/object becomes a geometry buffer; the caller owns the handles.
+ * The editor still imports through OBJLoader: its meshes are JS objects on the
+ * main thread, which has no module instance. Output matches OBJLoader.parse
+ * (see the shared fixture in obj-loader.test.ts and wasm/tests).
+ */
+export function parseOBJInWasm(
+  wasm: WasmRasterizerInstance,
+  data: string | Uint8Array,
+  recenter: boolean = true,
+  chunkSize: number = OBJ_INPUT_CHUNK_SIZE
+): WasmObjMesh[] {
+  wasm.objParserBegin(255, 255, 255);
+  let ok = true;
+  if (typeof data === "string") {
+    // A UTF-16 code unit encodes to at most 3 UTF-8 bytes
+    const encoder = new TextEncoder();
+    const scratch = new Uint8Array(Math.max(chunkSize, 6));
+    const units = Math.max(2, Math.floor(scratch.length / 3));
+    for (let offset = 0; ok && offset < data.length; ) {
+      let stop = Math.min(offset + units, data.length);
+      // Don't split a surrogate pair across chunks
+      const last = data.charCodeAt(stop - 1);
+      if (stop < data.length && last >= 0xd800 && last <= 0xdbff) stop--;
+      const written =
+        encoder.encodeInto(data.substring(offset, stop), scratch).written ?? 0;
+      ok = wasm.objParserFeed(scratch.subarray(0, written));
+      offset = stop;
+    }
+  } else {
+    for (let offset = 0; ok && offset < data.length; offset += chunkSize) {
+      ok = wasm.objParserFeed(data.subarray(offset, offset + chunkSize));
+    }
+  }
+  if (!ok) {
+    wasm.objParserReset();
+    return [];
+  }
+  const meshes = wasm.objParserFinish(recenter);
+  wasm.objParserReset();
+  return meshes;
+}
+
+/** Mesh loaded by loadGLBToWasm (one geometry buffer per glTF mesh) */
+export interface WasmGltfMesh {
+  name: string;
+  handle: number; // Geometry buffer handle
+  material: number | null; // First primitive's glTF material index
+  materials: (number | null)[]; // glTF material index per face material id
+  skinned: boolean; // JOINTS_0/WEIGHTS_0 were loaded (pose with setJointPalette)
+}
+
+/** Result of loadGLBToWasm; the caller owns all handles */
+export interface WasmGltfResult {
+  meshes: WasmGltfMesh[];
+  textures: Map<number, number>; // glTF texture index -> texture buffer handle
+  json: any; // Parsed glTF JSON (nodes, materials, ...)
+}
+
+const GLTF_TYPE_COMPONENTS: Record<string, number> = {
+  SCALAR: 1,
+  VEC2: 2,
+  VEC3: 3,
+  VEC4: 4,
+};
+
+/**
+ * Load a .glb through the native ingestion path: geometry is decoded from the
+ * BIN chunk into geometry buffers, and embedded images are decoded by the
+ * browser straight from WASM memory into texture buffers.
+ * Only the GLB's own BIN chunk (buffer 0) is supported; returns null otherwise.
+ * Meshes with more than MAX_FACE_MATERIALS materials are skipped with a warning.
+ * GLTFLoader still decodes accessors in JS for the editor's main-thread
+ * meshes; this path is for code that owns a module instance (the worker).
+ */
+export async function loadGLBToWasm(
+  wasm: WasmRasterizerInstance,
+  data: Uint8Array,
+  deindex: boolean = false
+): Promise<WasmGltfResult | null> {
+  if (!wasm.glbLoad(data)) return null;
+
+  try {
+    const jsonText = wasm.glbGetJSON();
+    if (!jsonText) return null;
+    const json = JSON.parse(jsonText);
+    const accessors: any[] = json.accessors || [];
+    const bufferViews: any[] = json.bufferViews || [];
+    const result: WasmGltfResult = { meshes: [], textures: new Map(), json };
+
+    const setAccessor = (attribute: number, index: number | undefined) => {
+      if (index === undefined) return true;
+      const accessor = accessors[index];
+      if (!accessor || accessor.bufferView === undefined) return false;
+      const view = bufferViews[accessor.bufferView];
+      if (!view || (view.buffer ?? 0) !== 0) return false;
+      wasm.gltfSetAccessor(
+        attribute,
+        (view.byteOffset || 0) + (accessor.byteOffset || 0),
+        view.byteStride || 0,
+        accessor.count,
+        accessor.componentType,
+        GLTF_TYPE_COMPONENTS[accessor.type] || 1,
+        accessor.normalized ?? false
+      );
+      return true;
+    };
+
+    const meshes: any[] = json.meshes || [];
+    for (let i = 0; i < meshes.length; i++) {
+      const handle = wasm.createGeometryBuffer();
+      if (!handle) break;
+
+      let material: number | null = null;
+      const materials: (number | null)[] = [];
+      let tooManyMaterials = false;
+      for (const primitive of meshes[i].primitives) {
+        wasm.gltfClearAccessors();
+        const attributes = primitive.attributes || {};
+        if (
+          !setAccessor(GLTF_ATTR_POSITION, attributes.POSITION) ||
+          !setAccessor(GLTF_ATTR_NORMAL, attributes.NORMAL) ||
+          !setAccessor(GLTF_ATTR_TEXCOORD, attributes.TEXCOORD_0) ||
+          !setAccessor(GLTF_ATTR_COLOR, attributes.COLOR_0) ||
+          !setAccessor(GLTF_ATTR_INDICES, primitive.indices) ||
+          !setAccessor(GLTF_ATTR_JOINTS, attributes.JOINTS_0) ||
+          !setAccessor(GLTF_ATTR_WEIGHTS, attributes.WEIGHTS_0)
+        ) {
+          continue;
+        }
+        // Primitives share the buffer; triangles carry a mesh-local material id
+        let local = materials.indexOf(primitive.material ?? null);
+        if (local < 0) {
+          if (materials.length >= MAX_FACE_MATERIALS) {
+            tooManyMaterials = true;
+            break;
+          }
+          local = materials.push(primitive.material ?? null) - 1;
+        }
+        wasm.gltfSetMaterial(local);
+        wasm.gltfAppendPrimitive(handle, primitive.mode ?? 4, deindex);
+        if (material === null && primitive.material !== undefined) {
+          material = primitive.material;
+        }
+      }
+      wasm.gltfSetMaterial(-1);
+
+      // Ids are 8-bit: rather than mis-shade extra materials, skip the mesh
+      if (tooManyMaterials) {
+        console.warn(
+          `Mesh ${meshes[i].name || i} uses more than ${MAX_FACE_MATERIALS} materials, skipped`
+        );
+        wasm.deleteGeometryBuffer(handle);
+        continue;
+      }
+      if (wasm.geometryBufferGetVertexCount(handle) === 0) {
+        wasm.deleteGeometryBuffer(handle);
+        continue;
+      }
+      wasm.gltfFinishMesh(handle);
+      result.meshes.push({
+        name: meshes[i].name || `Mesh_${i}`,
+        handle,
+        material,
+        materials,
+        skinned: wasm.geometryBufferHasSkin(handle),
+      });
+    }
+
+    // Embedded images: decode from a view into the BIN chunk
+    const textures: any[] = json.textures || [];
+    const images: any[] = json.images || [];
+    for (let i = 0; i < textures.length; i++) {
+      const image = images[textures[i].source];
+      if (!image || image.bufferView === undefined) continue;
+      const view = bufferViews[image.bufferView];
+      const bytes = wasm.glbGetBinView(view.byteOffset || 0, view.byteLength);
+      if (!bytes) continue;
+
+      const bitmap = await createImageBitmap(
+        new Blob([bytes.slice()], { type: image.mimeType || "image/png" })
+      );
+      const canvas = new OffscreenCanvas(bitmap.width, bitmap.height);
+      const ctx = canvas.getContext("2d");
+      if (!ctx) continue;
+      ctx.drawImage(bitmap, 0, 0);
+      const pixels = ctx.getImageData(0, 0, bitmap.width, bitmap.height).data;
+
+      const handle = wasm.createTextureBuffer();
+      const target = handle
+        ? wasm.textureBufferAlloc(handle, bitmap.width, bitmap.height)
+        : null;
+      if (!target) {
+        if (handle) wasm.deleteTextureBuffer(handle);
+        continue;
+      }
+      target.set(pixels);
+      result.textures.set(i, handle);
+    }
+
+    return result;
+  } finally {
+    wasm.glbReset();
+  }
+}
+
+/**
+ * Face material table for a mesh from loadGLBToWasm (pass to setMaterials
+ * with mesh.materials.length right before each draw of it; the table only
+ * applies to the next draw): each material's base color
+ * texture, and KHR_materials_unlit as MATERIAL_UNLIT.
+ */
+export function gltfMaterialTable(
+  result: WasmGltfResult,
+  mesh: WasmGltfMesh
+): Int32Array {
+  const table = new Int32Array(mesh.materials.length * MATERIAL_INTS);
+  const definitions: any[] = result.json.materials || [];
+  mesh.materials.forEach((index, id) => {
+    const definition = index === null ? undefined : definitions[index];
+    if (!definition) return;
+    const texture = definition.pbrMetallicRoughness?.baseColorTexture?.index;
+    table[id * MATERIAL_INTS] =
+      texture === undefined ? 0 : result.textures.get(texture) ?? 0;
+    table[id * MATERIAL_INTS + 1] = definition.extensions?.KHR_materials_unlit
+      ? MATERIAL_UNLIT
+      : 0;
+  });
+  return table;
+}
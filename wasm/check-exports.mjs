@@ -0,0 +1,74 @@
+// Verify that the shipped rasterizer.wasm binaries export every function
+// listed in the Makefile's EXPORTED_FUNCTIONS. A binary that was not rebuilt
+// after new exports were added loads fine but throws on the first call.
+//
+// Usage: node wasm/check-exports.mjs [file.wasm ...]
+// (defaults to wasm/rasterizer.wasm and public/rasterizer.wasm)
+
+import { readFileSync } from "fs";
+import { dirname, resolve } from "path";
+import { fileURLToPath } from "url";
+
+const here = dirname(fileURLToPath(import.meta.url));
+const makefile = readFileSync(resolve(here, "Makefile"), "utf8");
+const match = makefile.match(/EXPORTED_FUNCTIONS="\[([^\]]*)\]"/);
+if (!match) {
+  console.error("EXPORTED_FUNCTIONS not found in wasm/Makefile");
+  process.exit(2);
+}
+const expected = match[1]
+  .split(",")
+  .map((name) => name.trim().replace(/^'_?|'$/g, ""))
+  .filter((name) => name.length > 0);
+
+// Names in the export section, read directly so the binary does not have to
+// compile on this Node version (relaxed SIMD may be behind a flag)
+function exportNames(bytes) {
+  let pos = 8; // Magic + version
+  const leb = () => {
+    let value = 0;
+    let shift = 0;
+    let byte;
+    do {
+      byte = bytes[pos++];
+      value |= (byte & 0x7f) << shift;
+      shift += 7;
+    } while (byte & 0x80);
+    return value >>> 0;
+  };
+  const names = new Set();
+  while (pos < bytes.length) {
+    const id = bytes[pos++];
+    const size = leb();
+    const end = pos + size;
+    if (id === 7) {
+      for (let count = leb(); count > 0; count--) {
+        const length = leb();
+        names.add(new TextDecoder().decode(bytes.subarray(pos, pos + length)));
+        pos += length + 1; // Name, kind
+        leb(); // Index
+      }
+    }
+    pos = end;
+  }
+  return names;
+}
+
+const files = process.argv.slice(2);
+if (files.length === 0) {
+  files.push(resolve(here, "rasterizer.wasm"), resolve(here, "../public/rasterizer.wasm"));
+}
+
+let failed = false;
+for (const file of files) {
+  const exported = exportNames(readFileSync(file));
+  const missing = expected.filter((name) => !exported.has(name));
+  if (missing.length > 0) {
+    failed = true;
+    console.error(`${file}: ${missing.length} of ${expected.length} exports missing (rebuild with \`bun run build:wasm\`)`);
+    console.error(`  ${missing.join(" ")}`);
+  } else {
+    console.log(`${file}: all ${expected.length} exports present`);
+  }
+}
+process.exit(failed ? 1 : 0);
@@ -37,6 +37,18 @@ constexpr int MAX_TRIANGLES = 65536;
 constexpr int MAX_TEXTURES = 16;
 constexpr int MAX_TEXTURE_SIZE = 512 * 512 * 4;
 
+// Texture mapping modes for textured triangles (g_texture_mapping)
+constexpr int TEXTURE_MAPPING_PER_PIXEL = 0;  // Affine-factor correction at every pixel
+constexpr int TEXTURE_MAPPING_AFFINE = 1;     // PS1: screen-linear UVs stepped along spans
+constexpr int TEXTURE_MAPPING_SUBDIVIDED = 2; // Corrected every TEXTURE_SUBDIVISION pixels
+constexpr int TEXTURE_SUBDIVISION = 16;
+
+// Scene lights besides the main directional light (g_lights)
+constexpr int MAX_LIGHTS = 64;
+constexpr int LIGHT_FLOATS = 8;      // x, y, z, type, r, g, b, range
+constexpr int LIGHT_DIRECTIONAL = 0; // xyz: direction the light travels
+constexpr int LIGHT_POINT = 1;       // xyz: world position, range: falloff distance
+
 // ============================================================================
 // Memory Layout (Shared with JavaScript)
 // ============================================================================
@@ -70,18 +82,24 @@ extern "C"
     // Light data (written by JS)
     alignas(16) float g_light_dir[4];   // xyz, padding
     alignas(16) float g_light_color[4]; // rgb, intensity
+    alignas(16) float g_lights[MAX_LIGHTS * LIGHT_FLOATS]; // See set_light_count
 
     // Settings (written by JS)
     int32_t g_vertex_count = 0;
     int32_t g_index_count = 0;
     int32_t g_current_texture = -1;
     float g_ambient_light = 0.2f;
+    int32_t g_light_count = 0;
+    uint32_t g_lighting_version = 1; // Bumped whenever a light input changes
     int32_t g_enable_lighting = 1;
     int32_t g_enable_dithering = 1;
     int32_t g_enable_texturing = 1;
     int32_t g_enable_backface_culling = 1;
     int32_t g_enable_vertex_snapping = 1;
     int32_t g_enable_smooth_shading = 0;
+    int32_t g_texture_mapping = TEXTURE_MAPPING_PER_PIXEL;
+    int32_t g_enable_gte = 0; // Fixed-point vertex projection
+    int32_t g_lighting_lut_bits = 0; // Normal code size for table lighting (0 = off, 8 or 12)
     float g_snap_resolution_x = 320.0f;
     float g_snap_resolution_y = 240.0f;
 
@@ -108,6 +126,328 @@ constexpr int MAX_GEOMETRY_BUFFERS = 1024;
 static GeometryBuffer *g_geometry_buffers[MAX_GEOMETRY_BUFFERS] = {nullptr};
 static int32_t g_next_buffer_handle = 1; // Start at 1, 0 = invalid
 
+// Resolve a handle to its buffer (nullptr if invalid or deleted)
+static inline GeometryBuffer *lookup_geometry_buffer(int32_t handle)
+{
+    int slot = handle - 1;
+    if (slot < 0 || slot >= MAX_GEOMETRY_BUFFERS)
+        return nullptr;
+    return g_geometry_buffers[slot];
+}
+
+// 4-wide BVH node: child boxes in SoA layout for SIMD slab tests.
+// count > 0: leaf with prims [child, child + count); count == 0: inner node
+// index in child; count < 0: empty slot.
+struct BVHNode4
+{
+    float minX[4], minY[4], minZ[4];
+    float maxX[4], maxY[4], maxZ[4];
+    int32_t child[4];
+    int32_t count[4];
+};
+
+// Triangle BVH over a geometry buffer (built lazily by the raycast API)
+struct TriangleBVH
+{
+    BVHNode4 *nodes;
+    int32_t nodeCount;
+    uint32_t *primTriangles; // Source triangle per prim (leaf order)
+    float *primVertices;     // 9 floats per prim (v0, v1, v2)
+    int32_t *primSlot;       // node * 4 + slot of the leaf holding each prim
+    int32_t *trianglePrim;   // Source triangle -> prim
+    int32_t *parentSlot;     // node * 4 + slot in parent, -1 for the root
+    uint8_t *dirty;          // Per-node refit flags
+    int32_t triangleCount;
+    // Source state at build time (a mismatch forces a rebuild)
+    const float *vertices;
+    const uint32_t *indices;
+    int32_t vertexCount;
+    int32_t indexCount;
+};
+
+static TriangleBVH *g_geometry_bvhs[MAX_GEOMETRY_BUFFERS] = {nullptr};
+
+static void free_triangle_bvh(TriangleBVH *bvh)
+{
+    if (!bvh)
+        return;
+    free(bvh->nodes);
+    free(bvh->primTriangles);
+    free(bvh->primVertices);
+    free(bvh->primSlot);
+    free(bvh->trianglePrim);
+    free(bvh->parentSlot);
+    free(bvh->dirty);
+    free(bvh);
+}
+
+// Drop a buffer's BVH after its storage was reallocated or rewritten
+static inline void invalidate_geometry_bvh(int32_t handle)
+{
+    int slot = handle - 1;
+    if (slot < 0 || slot >= MAX_GEOMETRY_BUFFERS)
+        return;
+    free_triangle_bvh(g_geometry_bvhs[slot]);
+    g_geometry_bvhs[slot] = nullptr;
+}
+
+// Spatial hash over a geometry buffer's vertex positions (co-location queries)
+struct VertexSpatialHash
+{
+    float epsilon;
+    float invCell;
+    int32_t tableMask;   // Table size - 1 (power of two)
+    int32_t *cellKeys;   // 3 ints per table slot
+    int32_t *cellHead;   // First vertex in the slot's cell, -1 if empty
+    int32_t *next;       // Next vertex in the same cell, -1 at the end
+    int32_t *group;      // Co-location group per vertex
+    int32_t *groupStart; // groupCount + 1 run starts into groupMembers
+    int32_t *groupMembers;
+    int32_t groupCount;
+    // Source state at build time (a mismatch forces a rebuild)
+    const float *vertices;
+    int32_t vertexCount;
+};
+
+static VertexSpatialHash *g_geometry_spatial_hashes[MAX_GEOMETRY_BUFFERS] = {nullptr};
+
+static void free_vertex_spatial_hash(VertexSpatialHash *hash)
+{
+    if (!hash)
+        return;
+    free(hash->cellKeys);
+    free(hash->cellHead);
+    free(hash->next);
+    free(hash->group);
+    free(hash->groupStart);
+    free(hash->groupMembers);
+    free(hash);
+}
+
+// Cached object-space face normals (flat shading) plus the vertex -> triangle
+// adjacency used for incremental normal updates
+struct NormalCache
+{
+    float *faceNormals;      // 3 floats per triangle, unit length
+    float *faceAreas;        // Twice the triangle area (cross product length)
+    int32_t *vertexTriStart; // vertexCount + 1 run starts (nullptr until needed)
+    int32_t *vertexTris;     // Triangles around each vertex
+    uint8_t *marks;          // Scratch flags for incremental updates
+    int32_t triangleCount;
+    // Source state at build time (a mismatch forces a rebuild)
+    const float *vertices;
+    const uint32_t *indices;
+    int32_t vertexCount;
+    int32_t indexCount;
+};
+
+static NormalCache *g_geometry_normal_caches[MAX_GEOMETRY_BUFFERS] = {nullptr};
+
+static void free_normal_cache(NormalCache *cache)
+{
+    if (!cache)
+        return;
+    free(cache->faceNormals);
+    free(cache->faceAreas);
+    free(cache->vertexTriStart);
+    free(cache->vertexTris);
+    free(cache->marks);
+    free(cache);
+}
+
+// Simplified index lists sharing a buffer's vertices (level 0 is the
+// buffer's own index list), picked per draw by projected error
+constexpr int MAX_LOD_LEVELS = 8;
+
+struct LodChain
+{
+    int32_t levelCount; // Including level 0
+    uint32_t *indices[MAX_LOD_LEVELS];
+    int32_t indexCount[MAX_LOD_LEVELS];
+    float error[MAX_LOD_LEVELS]; // Object-space deviation from level 0
+    float center[3];             // Bounding sphere
+    float radius;
+    // Source state at build time (a mismatch drops the chain)
+    const float *vertices;
+    const uint32_t *sourceIndices;
+    int32_t vertexCount;
+    int32_t indexCount0;
+};
+
+static LodChain *g_geometry_lods[MAX_GEOMETRY_BUFFERS] = {nullptr};
+static float g_lod_pixel_error = 1.0f; // Allowed screen-space error, 0 = always level 0
+static int32_t g_last_lod_level = 0;   // Level picked by the last draw
+
+static void free_lod_chain(LodChain *lod)
+{
+    if (!lod)
+        return;
+    for (int i = 1; i < lod->levelCount; i++)
+        free(lod->indices[i]);
+    free(lod);
+}
+
+// Per-vertex skin weights for linear blend skinning: 4 joint indices into the
+// current joint palette and 4 weights (summing to 1) per vertex. Skin data is
+// uploaded alongside the vertices, so it survives cache invalidation; it is
+// ignored while its vertex count does not match the buffer's.
+constexpr int SKIN_INFLUENCES = 4;
+
+struct SkinData
+{
+    uint16_t *joints; // SKIN_INFLUENCES per vertex
+    float *weights;   // SKIN_INFLUENCES per vertex
+    int32_t vertexCount;
+    int32_t jointCapacity; // Elements
+    int32_t weightCapacity;
+};
+
+static SkinData *g_geometry_skins[MAX_GEOMETRY_BUFFERS] = {nullptr};
+
+static void free_skin_data(SkinData *skin)
+{
+    if (!skin)
+        return;
+    free(skin->joints);
+    free(skin->weights);
+    free(skin);
+}
+
+// Per-triangle material indices into the draw's material table (see
+// set_material_count). Like skin data they are uploaded alongside the
+// geometry, so they survive cache invalidation, and are ignored while their
+// triangle count does not match the buffer's. Simplified LOD levels take each
+// triangle's material from its corners (vertexIds, derived on first use).
+struct FaceMaterials
+{
+    uint8_t *ids; // Material per base triangle
+    int32_t idCapacity;
+    int32_t triangleCount;
+    uint8_t *vertexIds; // Material per vertex (last base triangle using it)
+    int32_t vertexCapacity;
+    int32_t vertexValid; // vertexIds matches the current ids and indices
+};
+
+static FaceMaterials *g_geometry_materials[MAX_GEOMETRY_BUFFERS] = {nullptr};
+
+static void free_face_materials(FaceMaterials *materials)
+{
+    if (!materials)
+        return;
+    free(materials->ids);
+    free(materials->vertexIds);
+    free(materials);
+}
+
+// Morph targets (blend shapes) stored as sparse position/normal deltas.
+// Entries of all targets live in one array, target t owning entries
+// [targetStart[t], targetStart[t + 1]). The weighted result is kept in a
+// morphed copy of the vertices; only vertices named by some target (the
+// affected list) are ever rewritten, and only when a weight changes.
+constexpr int MAX_MORPH_TARGETS = 64;
+
+struct MorphSet
+{
+    int32_t targetCount;
+    int32_t targetStart[MAX_MORPH_TARGETS + 1];
+    float weights[MAX_MORPH_TARGETS];
+    uint32_t *indices; // Vertex per entry
+    float *deltas;     // dx, dy, dz, dnx, dny, dnz per entry
+    int32_t indexCapacity;
+    int32_t deltaCapacity;
+    int32_t *affected; // Union of target vertices (nullptr until needed)
+    int32_t affectedCount;
+    float *vertices; // Morphed copy (12 floats per vertex)
+    int32_t vertexCapacity;
+    int32_t vertexCount; // Buffer vertex count the targets were made for
+    int32_t copyValid;   // Copy holds the current base vertices
+    int32_t dirty;       // Weights or targets changed since the last evaluation
+};
+
+static MorphSet *g_geometry_morphs[MAX_GEOMETRY_BUFFERS] = {nullptr};
+
+static void free_morph_set(MorphSet *morph)
+{
+    if (!morph)
+        return;
+    free(morph->indices);
+    free(morph->deltas);
+    free(morph->affected);
+    free(morph->vertices);
+    free(morph);
+}
+
+// The base vertices changed: the morphed copy must be refreshed
+static inline void touch_geometry_morphs(int32_t slot)
+{
+    if (g_geometry_morphs[slot])
+    {
+        g_geometry_morphs[slot]->copyValid = 0;
+        g_geometry_morphs[slot]->dirty = 1;
+    }
+}
+
+// Static lighting baked into a buffer: light color per vertex (smooth
+// shading) or per base triangle (flat shading), evaluated for both the front
+// and back side so double-sided faces need no per-draw lighting. It is
+// re-baked lazily when the lights, model matrix, shading mode or vertices
+// change.
+struct LightingBake
+{
+    float *light;     // 6 floats per entry: front rgb, back rgb
+    int32_t capacity; // Floats
+    int32_t smooth;   // Entries are vertices (1) or base triangles (0)
+    int32_t valid;
+    uint32_t version; // g_lighting_version when baked
+    float model[16];  // g_model_matrix when baked
+};
+
+static LightingBake *g_geometry_lighting[MAX_GEOMETRY_BUFFERS] = {nullptr};
+
+static void free_lighting_bake(LightingBake *bake)
+{
+    if (!bake)
+        return;
+    free(bake->light);
+    free(bake);
+}
+
+// Object-space bounding sphere per buffer (x, y, z, radius) for light culling
+static float g_geometry_spheres[MAX_GEOMETRY_BUFFERS][4];
+static uint8_t g_geometry_sphere_valid[MAX_GEOMETRY_BUFFERS] = {0};
+
+// Per-buffer vertex version, bumped on every upload or in-place vertex edit
+// so stepped sessions (lightmap and vertex AO bakes) notice their input moved
+static uint32_t g_geometry_vertex_versions[MAX_GEOMETRY_BUFFERS] = {0};
+
+// The vertices changed: the bake and bounds must be redone
+static inline void touch_geometry_lighting(int32_t slot)
+{
+    if (g_geometry_lighting[slot])
+        g_geometry_lighting[slot]->valid = 0;
+    g_geometry_sphere_valid[slot] = 0;
+    g_geometry_vertex_versions[slot]++;
+}
+
+// Drop every acceleration structure derived from a buffer's contents
+static inline void invalidate_geometry_caches(int32_t handle)
+{
+    int slot = handle - 1;
+    if (slot < 0 || slot >= MAX_GEOMETRY_BUFFERS)
+        return;
+    invalidate_geometry_bvh(handle);
+    free_vertex_spatial_hash(g_geometry_spatial_hashes[slot]);
+    g_geometry_spatial_hashes[slot] = nullptr;
+    free_normal_cache(g_geometry_normal_caches[slot]);
+    g_geometry_normal_caches[slot] = nullptr;
+    free_lod_chain(g_geometry_lods[slot]);
+    g_geometry_lods[slot] = nullptr;
+    if (g_geometry_materials[slot])
+        g_geometry_materials[slot]->vertexValid = 0;
+    touch_geometry_morphs(slot);
+    touch_geometry_lighting(slot);
+}
+
 // ============================================================================
 // Dynamic Texture Buffers (OpenGL-style API)
 // ============================================================================
@@ -128,6 +468,65 @@ static const uint8_t *g_active_texture_data = nullptr;
 static int32_t g_active_texture_width = 0;
 static int32_t g_active_texture_height = 0;
 
+// Texture used by the next draw: the active texture buffer if bound, else the
+// fixed slot g_current_texture. nullptr when texturing is off or none is set.
+static inline const uint8_t *bound_texture(int32_t &width, int32_t &height)
+{
+    width = height = 0;
+    if (!g_enable_texturing)
+        return nullptr;
+    if (g_active_texture_data)
+    {
+        width = g_active_texture_width;
+        height = g_active_texture_height;
+        return g_active_texture_data;
+    }
+    if (g_current_texture >= 0 && g_current_texture < MAX_TEXTURES)
+    {
+        width = g_texture_sizes[g_current_texture * 2];
+        height = g_texture_sizes[g_current_texture * 2 + 1];
+        return g_textures[g_current_texture];
+    }
+    return nullptr;
+}
+
+// Wrap a texel coordinate into [0, size); mask = size - 1 for power-of-two
+// sizes (0 otherwise)
+static inline int32_t wrap_texel(int32_t t, int32_t size, int32_t mask)
+{
+    if (mask)
+        return t & mask;
+    t %= size;
+    return t < 0 ? t + size : t;
+}
+
+// ============================================================================
+// ID Buffer (picking)
+// ============================================================================
+
+// Optional per-pixel object/face IDs written alongside g_depth.
+// Allocated only while enabled (nullptr = disabled, no cost in the rasterizer).
+static uint32_t *g_id_objects = nullptr; // Object ID per pixel (0 = background)
+static uint32_t *g_id_faces = nullptr;   // Triangle index within the draw
+static uint32_t g_id_current_object = 0;
+static uint32_t g_id_current_face = 0;
+
+static inline void id_buffer_write(int32_t idx)
+{
+    g_id_objects[idx] = g_id_current_object;
+    g_id_faces[idx] = g_id_current_face;
+}
+
+// Write IDs for the pixels of a 4-wide span selected by mask_bits
+static inline void id_buffer_write_mask(int32_t idx, uint32_t mask_bits)
+{
+    for (int32_t i = 0; i < 4; i++)
+    {
+        if (mask_bits & (1u << i))
+            id_buffer_write(idx + i);
+    }
+}
+
 // ============================================================================
 // 8x8 Bayer Dither Matrix
 // ============================================================================
@@ -213,6 +612,106 @@ inline Vec3 mat4_mul_dir(const float *m, const Vec3 &v)
         m[8] * v.x + m[9] * v.y + m[10] * v.z);
 }
 
+// 4x4 matrix multiply: out = a * b (row-major, out must not alias a or b)
+inline void mat4_mul(float *out, const float *a, const float *b)
+{
+    for (int row = 0; row < 4; row++)
+    {
+        for (int col = 0; col < 4; col++)
+        {
+            out[row * 4 + col] =
+                a[row * 4 + 0] * b[0 * 4 + col] +
+                a[row * 4 + 1] * b[1 * 4 + col] +
+                a[row * 4 + 2] * b[2 * 4 + col] +
+                a[row * 4 + 3] * b[3 * 4 + col];
+        }
+    }
+}
+
+// View matrix looking from eye to target (matches Matrix4.lookAt in math.ts)
+inline void mat4_look_at(float *m, const Vec3 &eye, const Vec3 &target, const Vec3 &up)
+{
+    Vec3 zAxis = (eye - target).normalize();
+    Vec3 xAxis = up.cross(zAxis).normalize();
+    Vec3 yAxis = zAxis.cross(xAxis);
+
+    m[0] = xAxis.x;
+    m[1] = xAxis.y;
+    m[2] = xAxis.z;
+    m[3] = -xAxis.dot(eye);
+    m[4] = yAxis.x;
+    m[5] = yAxis.y;
+    m[6] = yAxis.z;
+    m[7] = -yAxis.dot(eye);
+    m[8] = zAxis.x;
+    m[9] = zAxis.y;
+    m[10] = zAxis.z;
+    m[11] = -zAxis.dot(eye);
+    m[12] = 0.0f;
+    m[13] = 0.0f;
+    m[14] = 0.0f;
+    m[15] = 1.0f;
+}
+
+// Perspective projection (matches Matrix4.perspective in math.ts, fov in radians)
+inline void mat4_perspective(float *m, float fov, float aspect, float near, float far)
+{
+    float tanHalfFov = tanf(fov * 0.5f);
+    for (int i = 0; i < 16; i++)
+        m[i] = 0.0f;
+    m[0] = 1.0f / (aspect * tanHalfFov);
+    m[5] = 1.0f / tanHalfFov;
+    m[10] = -(far + near) / (far - near);
+    m[11] = -(2.0f * far * near) / (far - near);
+    m[14] = -1.0f;
+}
+
+// General 4x4 inverse (row-major). Returns false if the matrix is singular.
+inline bool mat4_invert(float *out, const float *m)
+{
+    float inv[16];
+    inv[0] = m[5] * m[10] * m[15] - m[5] * m[11] * m[14] - m[9] * m[6] * m[15] +
+             m[9] * m[7] * m[14] + m[13] * m[6] * m[11] - m[13] * m[7] * m[10];
+    inv[4] = -m[4] * m[10] * m[15] + m[4] * m[11] * m[14] + m[8] * m[6] * m[15] -
+             m[8] * m[7] * m[14] - m[12] * m[6] * m[11] + m[12] * m[7] * m[10];
+    inv[8] = m[4] * m[9] * m[15] - m[4] * m[11] * m[13] - m[8] * m[5] * m[15] +
+             m[8] * m[7] * m[13] + m[12] * m[5] * m[11] - m[12] * m[7] * m[9];
+    inv[12] = -m[4] * m[9] * m[14] + m[4] * m[10] * m[13] + m[8] * m[5] * m[14] -
+              m[8] * m[6] * m[13] - m[12] * m[5] * m[10] + m[12] * m[6] * m[9];
+    inv[1] = -m[1] * m[10] * m[15] + m[1] * m[11] * m[14] + m[9] * m[2] * m[15] -
+             m[9] * m[3] * m[14] - m[13] * m[2] * m[11] + m[13] * m[3] * m[10];
+    inv[5] = m[0] * m[10] * m[15] - m[0] * m[11] * m[14] - m[8] * m[2] * m[15] +
+             m[8] * m[3] * m[14] + m[12] * m[2] * m[11] - m[12] * m[3] * m[10];
+    inv[9] = -m[0] * m[9] * m[15] + m[0] * m[11] * m[13] + m[8] * m[1] * m[15] -
+             m[8] * m[3] * m[13] - m[12] * m[1] * m[11] + m[12] * m[3] * m[9];
+    inv[13] = m[0] * m[9] * m[14] - m[0] * m[10] * m[13] - m[8] * m[1] * m[14] +
+              m[8] * m[2] * m[13] + m[12] * m[1] * m[10] - m[12] * m[2] * m[9];
+    inv[2] = m[1] * m[6] * m[15] - m[1] * m[7] * m[14] - m[5] * m[2] * m[15] +
+             m[5] * m[3] * m[14] + m[13] * m[2] * m[7] - m[13] * m[3] * m[6];
+    inv[6] = -m[0] * m[6] * m[15] + m[0] * m[7] * m[14] + m[4] * m[2] * m[15] -
+             m[4] * m[3] * m[14] - m[12] * m[2] * m[7] + m[12] * m[3] * m[6];
+    inv[10] = m[0] * m[5] * m[15] - m[0] * m[7] * m[13] - m[4] * m[1] * m[15] +
+              m[4] * m[3] * m[13] + m[12] * m[1] * m[7] - m[12] * m[3] * m[5];
+    inv[14] = -m[0] * m[5] * m[14] + m[0] * m[6] * m[13] + m[4] * m[1] * m[14] -
+              m[4] * m[2] * m[13] - m[12] * m[1] * m[6] + m[12] * m[2] * m[5];
+    inv[3] = -m[1] * m[6] * m[11] + m[1] * m[7] * m[10] + m[5] * m[2] * m[11] -
+             m[5] * m[3] * m[10] - m[9] * m[2] * m[7] + m[9] * m[3] * m[6];
+    inv[7] = m[0] * m[6] * m[11] - m[0] * m[7] * m[10] - m[4] * m[2] * m[11] +
+             m[4] * m[3] * m[10] + m[8] * m[2] * m[7] - m[8] * m[3] * m[6];
+    inv[11] = -m[0] * m[5] * m[11] + m[0] * m[7] * m[9] + m[4] * m[1] * m[11] -
+              m[4] * m[3] * m[9] - m[8] * m[1] * m[7] + m[8] * m[3] * m[5];
+    inv[15] = m[0] * m[5] * m[10] - m[0] * m[6] * m[9] - m[4] * m[1] * m[10] +
+              m[4] * m[2] * m[9] + m[8] * m[1] * m[6] - m[8] * m[2] * m[5];
+
+    float det = m[0] * inv[0] + m[1] * inv[4] + m[2] * inv[8] + m[3] * inv[12];
+    if (fabsf(det) < 1e-12f)
+        return false;
+    float invDet = 1.0f / det;
+    for (int i = 0; i < 16; i++)
+        out[i] = inv[i] * invDet;
+    return true;
+}
+
 inline float clamp(float v, float lo, float hi)
 {
     return v < lo ? lo : (v > hi ? hi : v);
@@ -251,7 +750,8 @@ struct ProcessedVertex
     float u, v;    // Texture coordinates
     float r, g, b; // Vertex color (0-255)
     float affine;  // Affine texture factor
-    float light;   // Pre-computed lighting
+    float light;   // Scalar light multiplier (1 once lit colors are folded in)
+    float lit[6];  // Front and back lit rgb (vertex-stage Gouraud lighting)
 };
 
 // ============================================================================
@@ -272,6 +772,14 @@ inline float simd_hmin(v128_t v)
     return wasm_f32x4_extract_lane(min2, 0);
 }
 
+// Horizontal sum of 4 floats
+inline float simd_hsum(v128_t v)
+{
+    v128_t sum1 = wasm_f32x4_add(v, wasm_i32x4_shuffle(v, v, 2, 3, 0, 1));
+    v128_t sum2 = wasm_f32x4_add(sum1, wasm_i32x4_shuffle(sum1, sum1, 1, 0, 3, 2));
+    return wasm_f32x4_extract_lane(sum2, 0);
+}
+
 // Relaxed FMA: a * b + c (single instruction on supported hardware)
 inline v128_t simd_fma(v128_t a, v128_t b, v128_t c)
 {
@@ -293,2035 +801,11883 @@ inline v128_t simd_floor(v128_t v)
 }
 
 // ============================================================================
-// Core Rasterization
+// Heap Array Helpers
 // ============================================================================
 
-// Process a single vertex through MVP pipeline
-static ProcessedVertex process_vertex(int vertex_idx)
+// Grow a malloc'd array so it holds at least `needed` elements (doubling).
+// Existing contents are preserved; returns false if allocation failed.
+template <typename T>
+static bool grow_array(T *&data, int32_t &capacity, int32_t needed)
 {
-    const float *v = &g_vertices[vertex_idx * 12];
-
-    Vec4 pos(v[0], v[1], v[2], 1.0f);
-    Vec3 normal(v[3], v[4], v[5]);
-    float u = v[6], vt = v[7];
-    float r = v[8], g = v[9], b = v[10];
+    if (needed <= capacity)
+        return true;
+    int32_t newCapacity = capacity > 0 ? capacity : 256;
+    while (newCapacity < needed)
+        newCapacity *= 2;
+    T *grown = (T *)realloc(data, (size_t)newCapacity * sizeof(T));
+    if (!grown)
+        return false;
+    data = grown;
+    capacity = newCapacity;
+    return true;
+}
 
-    // Transform through MVP
-    Vec4 clip = mat4_mul_vec4(g_mvp_matrix, pos);
+// ============================================================================
+// Normal Computation Helpers
+// ============================================================================
 
-    // Perspective divide
-    Vec3 ndc = clip.perspectiveDivide();
+// Face normals (unit) and cross product lengths for triangles [first, end),
+// four at a time. Triangles with out-of-range indices get a zero normal.
+static void compute_face_normals(const GeometryBuffer *buf, float *normals, float *areas,
+                                 int32_t first, int32_t end)
+{
+    const float *vtx = buf->vertices;
+    const uint32_t *idx = buf->indices;
+    uint32_t limit = (uint32_t)buf->vertexCount;
+    v128_t tiny = wasm_f32x4_splat(1e-20f);
+    v128_t one = wasm_f32x4_splat(1.0f);
 
-    // PS1-style vertex snapping
-    if (g_enable_vertex_snapping)
+    for (int32_t t = first; t < end; t += 4)
     {
-        ndc.x = floorf(ndc.x * g_snap_resolution_x) / g_snap_resolution_x;
-        ndc.y = floorf(ndc.y * g_snap_resolution_y) / g_snap_resolution_y;
+        alignas(16) float p[9][4];
+        for (int k = 0; k < 4; k++)
+        {
+            int32_t tri = t + k;
+            for (int c = 0; c < 3; c++)
+            {
+                uint32_t i = tri < end ? idx[tri * 3 + c] : limit;
+                const float *v = i < limit ? &vtx[i * 12] : nullptr;
+                p[c * 3][k] = v ? v[0] : 0.0f;
+                p[c * 3 + 1][k] = v ? v[1] : 0.0f;
+                p[c * 3 + 2][k] = v ? v[2] : 0.0f;
+            }
+        }
+        v128_t ax = wasm_v128_load(p[0]), ay = wasm_v128_load(p[1]), az = wasm_v128_load(p[2]);
+        v128_t e1x = wasm_f32x4_sub(wasm_v128_load(p[3]), ax);
+        v128_t e1y = wasm_f32x4_sub(wasm_v128_load(p[4]), ay);
+        v128_t e1z = wasm_f32x4_sub(wasm_v128_load(p[5]), az);
+        v128_t e2x = wasm_f32x4_sub(wasm_v128_load(p[6]), ax);
+        v128_t e2y = wasm_f32x4_sub(wasm_v128_load(p[7]), ay);
+        v128_t e2z = wasm_f32x4_sub(wasm_v128_load(p[8]), az);
+
+        v128_t nx = wasm_f32x4_sub(wasm_f32x4_mul(e1y, e2z), wasm_f32x4_mul(e1z, e2y));
+        v128_t ny = wasm_f32x4_sub(wasm_f32x4_mul(e1z, e2x), wasm_f32x4_mul(e1x, e2z));
+        v128_t nz = wasm_f32x4_sub(wasm_f32x4_mul(e1x, e2y), wasm_f32x4_mul(e1y, e2x));
+        v128_t len = wasm_f32x4_sqrt(wasm_f32x4_add(wasm_f32x4_add(wasm_f32x4_mul(nx, nx), wasm_f32x4_mul(ny, ny)),
+                                                    wasm_f32x4_mul(nz, nz)));
+        // Degenerate triangles get a zero normal instead of NaNs
+        v128_t valid = wasm_f32x4_gt(len, tiny);
+        v128_t inv = wasm_v128_and(wasm_f32x4_div(one, wasm_v128_bitselect(len, one, valid)), valid);
+
+        alignas(16) float ox[4], oy[4], oz[4], ol[4];
+        wasm_v128_store(ox, wasm_f32x4_mul(nx, inv));
+        wasm_v128_store(oy, wasm_f32x4_mul(ny, inv));
+        wasm_v128_store(oz, wasm_f32x4_mul(nz, inv));
+        wasm_v128_store(ol, len);
+        for (int k = 0; k < 4 && t + k < end; k++)
+        {
+            normals[(t + k) * 3] = ox[k];
+            normals[(t + k) * 3 + 1] = oy[k];
+            normals[(t + k) * 3 + 2] = oz[k];
+            areas[t + k] = ol[k];
+        }
     }
+}
 
-    // Viewport transform (NDC to screen) - use runtime resolution
-    float screenX = (ndc.x + 1.0f) * 0.5f * (float)g_render_width;
-    float screenY = (1.0f - ndc.y) * 0.5f * (float)g_render_height;
-
-    // World-space normal for lighting
-    Vec3 worldNormal = mat4_mul_dir(g_model_matrix, normal).normalize();
-
-    // World-space position
-    Vec4 worldPos = mat4_mul_vec4(g_model_matrix, pos);
-
-    // PS1-style affine factor
-    float dist = fmaxf(0.001f, clip.w);
-    float affine = dist + (clip.w * 8.0f / dist) * 0.5f;
+// Interior angle of triangle t at corner c (0-2)
+static float triangle_corner_angle(const GeometryBuffer *buf, int32_t t, int c)
+{
+    const float *p = &buf->vertices[buf->indices[t * 3 + c] * 12];
+    const float *q = &buf->vertices[buf->indices[t * 3 + (c + 1) % 3] * 12];
+    const float *r = &buf->vertices[buf->indices[t * 3 + (c + 2) % 3] * 12];
+    Vec3 a = Vec3(q[0] - p[0], q[1] - p[1], q[2] - p[2]).normalize();
+    Vec3 b = Vec3(r[0] - p[0], r[1] - p[1], r[2] - p[2]).normalize();
+    float d = a.dot(b);
+    return acosf(d < -1.0f ? -1.0f : (d > 1.0f ? 1.0f : d));
+}
 
-    // Pre-compute lighting
-    float light = 1.0f;
-    if (g_enable_lighting)
+// Validated face normal cache for a buffer (rebuilt when stale), or nullptr
+static NormalCache *get_normal_cache(int32_t handle)
+{
+    GeometryBuffer *buf = lookup_geometry_buffer(handle);
+    if (!buf || !buf->vertices || !buf->indices || buf->indexCount < 3)
+        return nullptr;
+    NormalCache *cache = g_geometry_normal_caches[handle - 1];
+    if (cache && cache->vertices == buf->vertices && cache->indices == buf->indices &&
+        cache->vertexCount == buf->vertexCount && cache->indexCount == buf->indexCount)
+        return cache;
+
+    free_normal_cache(cache);
+    g_geometry_normal_caches[handle - 1] = nullptr;
+    cache = (NormalCache *)calloc(1, sizeof(NormalCache));
+    if (!cache)
+        return nullptr;
+    cache->triangleCount = buf->indexCount / 3;
+    cache->faceNormals = (float *)malloc((size_t)cache->triangleCount * 3 * sizeof(float));
+    cache->faceAreas = (float *)malloc((size_t)cache->triangleCount * sizeof(float));
+    if (!cache->faceNormals || !cache->faceAreas)
     {
-        Vec3 lightDir(g_light_dir[0], g_light_dir[1], g_light_dir[2]);
-        float ndotl = fmaxf(0.0f, -worldNormal.dot(lightDir));
-        light = fminf(1.0f, g_ambient_light + ndotl * g_light_color[3]);
+        free_normal_cache(cache);
+        return nullptr;
     }
-
-    ProcessedVertex pv;
-    pv.screen = Vec3(screenX, screenY, ndc.z);
-    pv.world = Vec3(worldPos.x, worldPos.y, worldPos.z);
-    pv.normal = worldNormal;
-    pv.depth = ndc.z;
-    pv.u = u * affine; // Pre-multiply for affine
-    pv.v = vt * affine;
-    pv.r = r;
-    pv.g = g;
-    pv.b = b;
-    pv.affine = affine;
-    pv.light = light;
-
-    return pv;
+    compute_face_normals(buf, cache->faceNormals, cache->faceAreas, 0, cache->triangleCount);
+    cache->vertices = buf->vertices;
+    cache->indices = buf->indices;
+    cache->vertexCount = buf->vertexCount;
+    cache->indexCount = buf->indexCount;
+    g_geometry_normal_caches[handle - 1] = cache;
+    return cache;
 }
 
-// Rasterize a single triangle with full SIMD acceleration
-static void rasterize_triangle(
-    const ProcessedVertex &v0,
-    const ProcessedVertex &v1,
-    const ProcessedVertex &v2)
+// Cofactor matrix of the model matrix's upper 3x3: maps object-space face
+// normals to world space exactly like crossing the transformed edges
+static void model_normal_matrix(const float *m, float *out)
 {
-    // Bounding box (integer) - use runtime resolution
-    int32_t minX = max3(0, (int32_t)min3f(v0.screen.x, v1.screen.x, v2.screen.x), 0);
-    int32_t maxX = min3((int32_t)max3f(v0.screen.x, v1.screen.x, v2.screen.x) + 1,
-                        g_render_width - 1, g_render_width - 1);
-    int32_t minY = max3(0, (int32_t)min3f(v0.screen.y, v1.screen.y, v2.screen.y), 0);
-    int32_t maxY = min3((int32_t)max3f(v0.screen.y, v1.screen.y, v2.screen.y) + 1,
-                        g_render_height - 1, g_render_height - 1);
-
-    // Early reject
-    if (minX > maxX || minY > maxY)
-        return;
-
-    // Cache screen positions
-    float x0 = v0.screen.x, y0 = v0.screen.y;
-    float x1 = v1.screen.x, y1 = v1.screen.y;
-    float x2 = v2.screen.x, y2 = v2.screen.y;
-
-    // Edge function coefficients
-    float A01 = y0 - y1, B01 = x1 - x0;
-    float A12 = y1 - y2, B12 = x2 - x1;
-    float A20 = y2 - y0, B20 = x0 - x2;
-
-    // Triangle area * 2
-    float area = A01 * (x2 - x0) + B01 * (y2 - y0);
-    if (fabsf(area) < 0.0001f)
-        return; // Degenerate
-    float invArea = 1.0f / area;
+    out[0] = m[5] * m[10] - m[6] * m[9];
+    out[1] = m[6] * m[8] - m[4] * m[10];
+    out[2] = m[4] * m[9] - m[5] * m[8];
+    out[3] = m[2] * m[9] - m[1] * m[10];
+    out[4] = m[0] * m[10] - m[2] * m[8];
+    out[5] = m[1] * m[8] - m[0] * m[9];
+    out[6] = m[1] * m[6] - m[2] * m[5];
+    out[7] = m[2] * m[4] - m[0] * m[6];
+    out[8] = m[0] * m[5] - m[1] * m[4];
+}
 
-    // Starting point
-    float px = minX + 0.5f;
-    float py = minY + 0.5f;
+// ============================================================================
+// Level of Detail Selection
+// ============================================================================
 
-    // Initial edge values
-    float w0_row = A12 * (px - x1) + B12 * (py - y1);
-    float w1_row = A20 * (px - x2) + B20 * (py - y2);
-    float w2_row = A01 * (px - x0) + B01 * (py - y0);
+// Coarsest LOD whose error projects to at most g_lod_pixel_error pixels
+// under the current MVP. Level 0 while picking (face IDs must match the
+// buffer's triangles) or when the camera is inside the bounding sphere.
+static int32_t select_geometry_lod(int32_t handle, const GeometryBuffer *buf)
+{
+    LodChain *lod = g_geometry_lods[handle - 1];
+    if (!lod || g_lod_pixel_error <= 0.0f || g_id_objects)
+        return 0;
+    if (lod->vertices != buf->vertices || lod->sourceIndices != buf->indices || lod->vertexCount != buf->vertexCount ||
+        lod->indexCount0 != buf->indexCount)
+    {
+        free_lod_chain(lod);
+        g_geometry_lods[handle - 1] = nullptr;
+        return 0;
+    }
 
-    // Pre-multiply colors with lighting
-    float r0 = v0.r * v0.light, g0 = v0.g * v0.light, b0 = v0.b * v0.light;
-    float r1 = v1.r * v1.light, g1 = v1.g * v1.light, b1 = v1.b * v1.light;
-    float r2 = v2.r * v2.light, g2 = v2.g * v2.light, b2 = v2.b * v2.light;
+    const float *m = g_mvp_matrix;
+    float w = m[12] * lod->center[0] + m[13] * lod->center[1] + m[14] * lod->center[2] + m[15];
+    if (w <= lod->radius)
+        return 0;
+    // Clip-space y scale of one object unit, in pixels at the sphere's depth
+    float scale = sqrtf(m[4] * m[4] + m[5] * m[5] + m[6] * m[6]);
+    float pixelsPerUnit = scale * 0.5f * (float)g_render_height / w;
+    int32_t level = 0;
+    for (int32_t l = 1; l < lod->levelCount; l++)
+        if (lod->error[l] * pixelsPerUnit <= g_lod_pixel_error)
+            level = l;
+    return level;
+}
 
-    // Texture info
-    int32_t texIdx = g_current_texture;
-    const uint8_t *texData = nullptr;
-    int32_t texW = 0, texH = 0;
-    float texWf = 0, texHf = 0;
+// ============================================================================
+// Morph Target Evaluation
+// ============================================================================
 
-    // Use active texture pointer if set (dynamic textures), otherwise fall back to fixed slots
-    if (g_enable_texturing && g_active_texture_data)
+// Collect the vertices touched by any target (each once). Entries naming
+// vertices past the buffer are neutralized so evaluation needs no checks.
+static bool build_morph_affected(MorphSet *morph)
+{
+    int32_t entryCount = morph->targetStart[morph->targetCount];
+    int32_t *affected = (int32_t *)malloc((size_t)entryCount * sizeof(int32_t) + 4);
+    uint8_t *seen = (uint8_t *)calloc((size_t)morph->vertexCount + 1, 1);
+    if (!affected || !seen)
     {
-        texData = g_active_texture_data;
-        texW = g_active_texture_width;
-        texH = g_active_texture_height;
-        texWf = (float)texW;
-        texHf = (float)texH;
+        free(affected);
+        free(seen);
+        return false;
     }
-    else if (g_enable_texturing && texIdx >= 0 && texIdx < MAX_TEXTURES)
+    int32_t count = 0;
+    for (int32_t e = 0; e < entryCount; e++)
     {
-        texData = g_textures[texIdx];
-        texW = g_texture_sizes[texIdx * 2];
-        texH = g_texture_sizes[texIdx * 2 + 1];
-        texWf = (float)texW;
-        texHf = (float)texH;
+        uint32_t v = morph->indices[e];
+        if (v >= (uint32_t)morph->vertexCount)
+        {
+            morph->indices[e] = 0;
+            __builtin_memset(&morph->deltas[e * 6], 0, 6 * sizeof(float));
+            continue;
+        }
+        if (!seen[v])
+        {
+            seen[v] = 1;
+            affected[count++] = (int32_t)v;
+        }
     }
+    free(seen);
+    free(morph->affected);
+    morph->affected = affected;
+    morph->affectedCount = count;
+    return true;
+}
 
-    // Check if this is a non-textured triangle (can use fast SIMD path)
-    bool useTexture = texData && texW > 0 && texH > 0;
+// Morph set to apply when drawing a buffer (nullptr if no weight is active)
+static inline MorphSet *active_geometry_morphs(int32_t slot, const GeometryBuffer *buf)
+{
+    MorphSet *morph = g_geometry_morphs[slot];
+    if (!morph || morph->vertexCount != buf->vertexCount)
+        return nullptr;
+    for (int32_t t = 0; t < morph->targetCount; t++)
+        if (morph->weights[t] != 0.0f)
+            return morph;
+    return nullptr;
+}
 
-    // SIMD constants
-    v128_t simd_zero = wasm_f32x4_splat(0.0f);
-    v128_t simd_one = wasm_f32x4_splat(1.0f);
-    v128_t simd_255 = wasm_f32x4_splat(255.0f);
-    v128_t simd_invArea = wasm_f32x4_splat(invArea);
-    v128_t simd_depth_scale = wasm_f32x4_splat(32767.5f);
-    v128_t simd_alpha = wasm_i32x4_splat(0xFF000000);
+// Bring the morphed copy up to date and return it (nullptr on allocation
+// failure). The full base is copied only when the base itself changed;
+// otherwise affected vertices are reset from the base and the weighted
+// deltas of every active target are accumulated over them.
+static const float *morph_geometry_vertices(MorphSet *morph, const GeometryBuffer *buf)
+{
+    if (!morph->copyValid)
+    {
+        if (!grow_array(morph->vertices, morph->vertexCapacity, buf->vertexCount * 12))
+            return nullptr;
+        __builtin_memcpy(morph->vertices, buf->vertices, (size_t)buf->vertexCount * 12 * sizeof(float));
+        morph->copyValid = 1;
+        morph->dirty = 1;
+    }
+    if (!morph->dirty)
+        return morph->vertices;
+    if (!morph->affected && !build_morph_affected(morph))
+        return nullptr;
+
+    float *out = morph->vertices;
+    const float *base = buf->vertices;
+    for (int32_t i = 0; i < morph->affectedCount; i++)
+    {
+        int32_t v = morph->affected[i];
+        wasm_v128_store(&out[v * 12], wasm_v128_load(&base[v * 12]));
+        out[v * 12 + 4] = base[v * 12 + 4];
+        out[v * 12 + 5] = base[v * 12 + 5];
+    }
+    for (int32_t t = 0; t < morph->targetCount; t++)
+    {
+        float weight = morph->weights[t];
+        if (weight == 0.0f)
+            continue;
+        v128_t w = wasm_f32x4_splat(weight);
+        for (int32_t e = morph->targetStart[t]; e < morph->targetStart[t + 1]; e++)
+        {
+            float *o = &out[morph->indices[e] * 12];
+            const float *d = &morph->deltas[e * 6];
+            wasm_v128_store(o, simd_fma(w, wasm_v128_load(d), wasm_v128_load(o)));
+            o[4] += weight * d[4];
+            o[5] += weight * d[5];
+        }
+    }
+    morph->dirty = 0;
+    return out;
+}
 
-    // Edge function step constants
-    v128_t simd_offset0 = wasm_f32x4_make(0.0f, A12, A12 * 2.0f, A12 * 3.0f);
-    v128_t simd_offset1 = wasm_f32x4_make(0.0f, A20, A20 * 2.0f, A20 * 3.0f);
-    v128_t simd_offset2 = wasm_f32x4_make(0.0f, A01, A01 * 2.0f, A01 * 3.0f);
+// ============================================================================
+// Linear Blend Skinning
+// ============================================================================
 
-    // Vertex attributes for interpolation
-    v128_t simd_depth0 = wasm_f32x4_splat(v0.depth);
-    v128_t simd_depth1 = wasm_f32x4_splat(v1.depth);
-    v128_t simd_depth2 = wasm_f32x4_splat(v2.depth);
+// Joint palette for the next draws: row-major 4x4 skinning matrices
+// (joint world * inverse bind, in the mesh's object space), written by JS
+constexpr int MAX_JOINTS = 256;
 
-    v128_t simd_r0 = wasm_f32x4_splat(r0);
-    v128_t simd_r1 = wasm_f32x4_splat(r1);
-    v128_t simd_r2 = wasm_f32x4_splat(r2);
-    v128_t simd_g0 = wasm_f32x4_splat(g0);
-    v128_t simd_g1 = wasm_f32x4_splat(g1);
-    v128_t simd_g2 = wasm_f32x4_splat(g2);
-    v128_t simd_b0 = wasm_f32x4_splat(b0);
-    v128_t simd_b1 = wasm_f32x4_splat(b1);
-    v128_t simd_b2 = wasm_f32x4_splat(b2);
+alignas(16) static float g_joint_palette[MAX_JOINTS * 16];
+static int32_t g_joint_count = 0; // 0 = draw skinned buffers in bind pose
 
-    // Scan rows
-    for (int32_t y = minY; y <= maxY; y++)
-    {
-        float w0 = w0_row;
-        float w1 = w1_row;
-        float w2 = w2_row;
-        int32_t yOffset = y * g_render_width;
-        uint32_t *rowPixels = &g_pixels[yOffset];
-        uint16_t *rowDepth = &g_depth[yOffset];
+// Palette columns for the SIMD blend, rebuilt per skinned draw
+alignas(16) static v128_t g_joint_columns[MAX_JOINTS * 4];
 
-        // Dither row lookup
-        int32_t ditherY = y & 7;
-        const int8_t *ditherRow = DITHER_MATRIX[ditherY];
+// Skinned copy of the current buffer's vertices (12 floats each)
+static float *g_skinned_vertices = nullptr;
+static int32_t g_skinned_capacity = 0;
 
-        int32_t x = minX;
+// Size a buffer's skin data for vertexCount vertices. Vertices added here are
+// bound rigidly to joint 0; existing entries are kept.
+static SkinData *ensure_skin_data(int32_t slot, int32_t vertexCount)
+{
+    SkinData *skin = g_geometry_skins[slot];
+    if (!skin)
+    {
+        skin = (SkinData *)calloc(1, sizeof(SkinData));
+        if (!skin)
+            return nullptr;
+        g_geometry_skins[slot] = skin;
+    }
+    if (!grow_array(skin->joints, skin->jointCapacity, vertexCount * SKIN_INFLUENCES) ||
+        !grow_array(skin->weights, skin->weightCapacity, vertexCount * SKIN_INFLUENCES))
+        return nullptr;
+    for (int32_t i = skin->vertexCount * SKIN_INFLUENCES; i < vertexCount * SKIN_INFLUENCES; i++)
+    {
+        skin->joints[i] = 0;
+        skin->weights[i] = (i % SKIN_INFLUENCES) == 0 ? 1.0f : 0.0f;
+    }
+    skin->vertexCount = vertexCount;
+    return skin;
+}
 
-        // =====================================================================
-        // FAST PATH: Non-textured triangles - full SIMD with batched writes
-        // =====================================================================
-        if (!useTexture)
-        {
-            for (; x + 3 <= maxX; x += 4)
-            {
-                // Edge values for 4 consecutive pixels
-                v128_t sw0 = wasm_f32x4_add(wasm_f32x4_splat(w0), simd_offset0);
-                v128_t sw1 = wasm_f32x4_add(wasm_f32x4_splat(w1), simd_offset1);
-                v128_t sw2 = wasm_f32x4_add(wasm_f32x4_splat(w2), simd_offset2);
+// Skin data to apply when drawing a buffer (nullptr = draw it rigidly)
+static inline const SkinData *active_geometry_skin(int32_t slot, const GeometryBuffer *buf)
+{
+    const SkinData *skin = g_geometry_skins[slot];
+    if (!skin || g_joint_count <= 0 || skin->vertexCount != buf->vertexCount)
+        return nullptr;
+    return skin;
+}
 
-                // Inside test
-                v128_t inside_pos = wasm_v128_and(wasm_v128_and(
-                                                      wasm_f32x4_ge(sw0, simd_zero),
-                                                      wasm_f32x4_ge(sw1, simd_zero)),
-                                                  wasm_f32x4_ge(sw2, simd_zero));
-                v128_t inside_neg = wasm_v128_and(wasm_v128_and(
-                                                      wasm_f32x4_le(sw0, simd_zero),
-                                                      wasm_f32x4_le(sw1, simd_zero)),
-                                                  wasm_f32x4_le(sw2, simd_zero));
-                v128_t inside_mask = wasm_v128_or(inside_pos, inside_neg);
+// Blend each vertex's 4 joint matrices and transform its position and normal.
+// Working on palette columns, the blended matrix is 4 columns C0..C3 built
+// with one FMA per influence each; then p' = C0*x + C1*y + C2*z + C3 and
+// n' = C0*nx + C1*ny + C2*nz (process_vertex renormalizes the normal).
+// Returns the skinned vertex array, or nullptr if it could not be allocated.
+static const float *skin_geometry_vertices(const float *src, const SkinData *skin, int32_t vertexCount)
+{
+    if (!grow_array(g_skinned_vertices, g_skinned_capacity, vertexCount * 12))
+        return nullptr;
 
-                if (!wasm_v128_any_true(inside_mask))
-                {
-                    w0 += A12 * 4.0f;
-                    w1 += A20 * 4.0f;
-                    w2 += A01 * 4.0f;
-                    continue;
-                }
+    for (int32_t j = 0; j < g_joint_count; j++)
+    {
+        const float *m = &g_joint_palette[j * 16];
+        for (int c = 0; c < 4; c++)
+            g_joint_columns[j * 4 + c] = wasm_f32x4_make(m[c], m[4 + c], m[8 + c], m[12 + c]);
+    }
 
-                // Barycentric weights
-                v128_t bw0 = wasm_f32x4_mul(sw0, simd_invArea);
-                v128_t bw1 = wasm_f32x4_mul(sw1, simd_invArea);
-                v128_t bw2 = wasm_f32x4_mul(sw2, simd_invArea);
+    const uint32_t jointCount = (uint32_t)g_joint_count;
+    const uint16_t *joints = skin->joints;
+    const float *weights = skin->weights;
+    float *dst = g_skinned_vertices;
+    for (int32_t i = 0; i < vertexCount; i++)
+    {
+        v128_t c0 = wasm_f32x4_splat(0.0f);
+        v128_t c1 = c0, c2 = c0, c3 = c0;
+        for (int k = 0; k < SKIN_INFLUENCES; k++)
+        {
+            uint32_t j = joints[k];
+            if (j >= jointCount)
+                j = 0; // Out-of-range joints fall back to the root
+            v128_t w = wasm_f32x4_splat(weights[k]);
+            const v128_t *col = &g_joint_columns[j * 4];
+            c0 = simd_fma(w, col[0], c0);
+            c1 = simd_fma(w, col[1], c1);
+            c2 = simd_fma(w, col[2], c2);
+            c3 = simd_fma(w, col[3], c3);
+        }
 
-                // Interpolate depth: (depth + 1) * 32767.5
-                v128_t depth_f = simd_fma(simd_depth2, bw2,
-                                          simd_fma(simd_depth1, bw1, wasm_f32x4_mul(simd_depth0, bw0)));
-                v128_t depth_u16 = wasm_f32x4_mul(wasm_f32x4_add(depth_f, simd_one), simd_depth_scale);
+        v128_t p = simd_fma(c0, wasm_f32x4_splat(src[0]), c3);
+        p = simd_fma(c1, wasm_f32x4_splat(src[1]), p);
+        p = simd_fma(c2, wasm_f32x4_splat(src[2]), p);
+        v128_t n = wasm_f32x4_mul(c0, wasm_f32x4_splat(src[3]));
+        n = simd_fma(c1, wasm_f32x4_splat(src[4]), n);
+        n = simd_fma(c2, wasm_f32x4_splat(src[5]), n);
+
+        // Stores overlap: p's w lane is overwritten by nx, n's by u
+        wasm_v128_store(dst, p);
+        wasm_v128_store(dst + 3, n);
+        dst[6] = src[6];
+        dst[7] = src[7];
+        wasm_v128_store(dst + 8, wasm_v128_load(src + 8));
+
+        src += 12;
+        dst += 12;
+        joints += SKIN_INFLUENCES;
+        weights += SKIN_INFLUENCES;
+    }
+    return g_skinned_vertices;
+}
 
-                // Load existing depth (4 x u16 -> need to expand)
-                // Load 8 u16s, we only use first 4
-                v128_t old_depth_i16 = wasm_v128_load64_zero(&rowDepth[x]);
-                v128_t old_depth_u32 = wasm_u32x4_extend_low_u16x8(old_depth_i16);
-                v128_t old_depth_f = wasm_f32x4_convert_i32x4(old_depth_u32);
+// ============================================================================
+// Scene Lights
+// ============================================================================
 
-                // Depth test: new_depth < old_depth
-                v128_t depth_pass = wasm_f32x4_lt(depth_u16, old_depth_f);
-                v128_t write_mask = wasm_v128_and(inside_mask, depth_pass);
+// Lights reaching the current draw, in SoA layout for 4-wide evaluation.
+// Directional lights store the direction towards the light with point = 0
+// and invRange = 0, so both kinds share one path: L = xyz - pos * point,
+// attenuation (1 - |L| * invRange)^2. Directional lights fill the groups
+// before pointGroup and point lights the rest; padding lanes are black.
+constexpr int MAX_DRAW_LIGHTS = MAX_LIGHTS + 8; // Scene lights + main light, padded twice
 
-                if (!wasm_v128_any_true(write_mask))
-                {
-                    w0 += A12 * 4.0f;
-                    w1 += A20 * 4.0f;
-                    w2 += A01 * 4.0f;
-                    continue;
-                }
+struct DrawLights
+{
+    alignas(16) float x[MAX_DRAW_LIGHTS];
+    alignas(16) float y[MAX_DRAW_LIGHTS];
+    alignas(16) float z[MAX_DRAW_LIGHTS];
+    alignas(16) float point[MAX_DRAW_LIGHTS];
+    alignas(16) float invRange[MAX_DRAW_LIGHTS];
+    alignas(16) float r[MAX_DRAW_LIGHTS];
+    alignas(16) float g[MAX_DRAW_LIGHTS];
+    alignas(16) float b[MAX_DRAW_LIGHTS];
+    int32_t count;      // Entries, including padding
+    int32_t groups;     // SIMD groups of 4
+    int32_t pointGroup; // First group holding point lights
+};
 
-                // Interpolate colors
-                v128_t cr = simd_fma(simd_r2, bw2, simd_fma(simd_r1, bw1, wasm_f32x4_mul(simd_r0, bw0)));
-                v128_t cg = simd_fma(simd_g2, bw2, simd_fma(simd_g1, bw1, wasm_f32x4_mul(simd_g0, bw0)));
-                v128_t cb = simd_fma(simd_b2, bw2, simd_fma(simd_b1, bw1, wasm_f32x4_mul(simd_b0, bw0)));
+static DrawLights g_draw_lights;
+static int32_t g_last_draw_light_count = 0; // Lights gathered by the last draw
+static bool g_vertex_lighting = false;      // Current draw lights in the vertex stage
 
-                // Clamp to [0, 255]
-                cr = wasm_f32x4_min(wasm_f32x4_max(cr, simd_zero), simd_255);
-                cg = wasm_f32x4_min(wasm_f32x4_max(cg, simd_zero), simd_255);
-                cb = wasm_f32x4_min(wasm_f32x4_max(cb, simd_zero), simd_255);
+// Object-space bounding sphere (x, y, z, radius) of count vertices
+static void vertex_bounding_sphere(const float *vertices, int32_t count, float *sphere)
+{
+    if (count <= 0)
+    {
+        sphere[0] = sphere[1] = sphere[2] = sphere[3] = 0.0f;
+        return;
+    }
+    v128_t lo = wasm_v128_load(vertices), hi = lo;
+    for (int32_t i = 1; i < count; i++)
+    {
+        v128_t p = wasm_v128_load(&vertices[i * 12]);
+        lo = wasm_f32x4_min(lo, p);
+        hi = wasm_f32x4_max(hi, p);
+    }
+    v128_t center = wasm_f32x4_mul(wasm_f32x4_add(lo, hi), wasm_f32x4_splat(0.5f));
+    v128_t half = wasm_f32x4_sub(hi, center);
+    float hx = wasm_f32x4_extract_lane(half, 0), hy = wasm_f32x4_extract_lane(half, 1);
+    float hz = wasm_f32x4_extract_lane(half, 2);
+    sphere[0] = wasm_f32x4_extract_lane(center, 0);
+    sphere[1] = wasm_f32x4_extract_lane(center, 1);
+    sphere[2] = wasm_f32x4_extract_lane(center, 2);
+    sphere[3] = sqrtf(hx * hx + hy * hy + hz * hz);
+}
 
-                // Convert to integers
-                v128_t ir = wasm_i32x4_trunc_sat_f32x4(cr);
-                v128_t ig = wasm_i32x4_trunc_sat_f32x4(cg);
-                v128_t ib = wasm_i32x4_trunc_sat_f32x4(cb);
+static const float *geometry_bounding_sphere(int32_t slot, const GeometryBuffer *buf)
+{
+    if (!g_geometry_sphere_valid[slot])
+    {
+        vertex_bounding_sphere(buf->vertices, buf->vertexCount, g_geometry_spheres[slot]);
+        g_geometry_sphere_valid[slot] = 1;
+    }
+    return g_geometry_spheres[slot];
+}
 
-                // Pack into ABGR: 0xFF000000 | (b << 16) | (g << 8) | r
-                v128_t pixels = wasm_v128_or(simd_alpha,
-                                             wasm_v128_or(wasm_i32x4_shl(ib, 16),
-                                                          wasm_v128_or(wasm_i32x4_shl(ig, 8), ir)));
+static inline void add_draw_light(float x, float y, float z, float point, float invRange,
+                                  float r, float g, float b)
+{
+    int32_t i = g_draw_lights.count++;
+    g_draw_lights.x[i] = x;
+    g_draw_lights.y[i] = y;
+    g_draw_lights.z[i] = z;
+    g_draw_lights.point[i] = point;
+    g_draw_lights.invRange[i] = invRange;
+    g_draw_lights.r[i] = r;
+    g_draw_lights.g[i] = g;
+    g_draw_lights.b[i] = b;
+}
 
-                // Convert depth to u16
-                v128_t new_depth_i32 = wasm_i32x4_trunc_sat_f32x4(depth_u16);
+static inline void pad_draw_lights()
+{
+    while (g_draw_lights.count & 3)
+        add_draw_light(0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f);
+}
 
-                // Selective write based on mask
-                uint32_t mask_bits = wasm_i32x4_bitmask(write_mask);
+// Gather the lights reaching an object whose object-space bounding sphere is
+// given (nullptr: no culling): the main light, every directional light and
+// the point lights whose range overlaps the sphere under g_model_matrix
+static void gather_draw_lights(const float *sphere)
+{
+    g_draw_lights.count = 0;
+    float intensity = g_light_color[3];
+    add_draw_light(-g_light_dir[0], -g_light_dir[1], -g_light_dir[2], 0.0f, 0.0f,
+                   g_light_color[0] * intensity, g_light_color[1] * intensity, g_light_color[2] * intensity);
+    int32_t lightCount = 1;
+    for (int32_t i = 0; i < g_light_count; i++)
+    {
+        const float *light = &g_lights[i * LIGHT_FLOATS];
+        if ((int32_t)light[3] != LIGHT_POINT)
+        {
+            add_draw_light(-light[0], -light[1], -light[2], 0.0f, 0.0f, light[4], light[5], light[6]);
+            lightCount++;
+        }
+    }
+    pad_draw_lights();
+    g_draw_lights.pointGroup = g_draw_lights.count / 4;
 
-                // Manual unroll for pixel/depth writes (faster than extract)
-                if (mask_bits & 1)
-                {
-                    rowPixels[x] = wasm_i32x4_extract_lane(pixels, 0);
-                    rowDepth[x] = (uint16_t)wasm_i32x4_extract_lane(new_depth_i32, 0);
-                }
-                if (mask_bits & 2)
-                {
-                    rowPixels[x + 1] = wasm_i32x4_extract_lane(pixels, 1);
-                    rowDepth[x + 1] = (uint16_t)wasm_i32x4_extract_lane(new_depth_i32, 1);
-                }
-                if (mask_bits & 4)
-                {
-                    rowPixels[x + 2] = wasm_i32x4_extract_lane(pixels, 2);
-                    rowDepth[x + 2] = (uint16_t)wasm_i32x4_extract_lane(new_depth_i32, 2);
-                }
-                if (mask_bits & 8)
-                {
-                    rowPixels[x + 3] = wasm_i32x4_extract_lane(pixels, 3);
-                    rowDepth[x + 3] = (uint16_t)wasm_i32x4_extract_lane(new_depth_i32, 3);
-                }
+    Vec3 center;
+    float radius = 0.0f;
+    if (sphere)
+    {
+        const float *m = g_model_matrix;
+        Vec4 c = mat4_mul_vec4(m, Vec4(sphere[0], sphere[1], sphere[2], 1.0f));
+        center = Vec3(c.x, c.y, c.z);
+        float sx = m[0] * m[0] + m[4] * m[4] + m[8] * m[8];
+        float sy = m[1] * m[1] + m[5] * m[5] + m[9] * m[9];
+        float sz = m[2] * m[2] + m[6] * m[6] + m[10] * m[10];
+        radius = sphere[3] * sqrtf(fmaxf(sx, fmaxf(sy, sz)));
+    }
 
-                w0 += A12 * 4.0f;
-                w1 += A20 * 4.0f;
-                w2 += A01 * 4.0f;
-            }
+    for (int32_t i = 0; i < g_light_count; i++)
+    {
+        const float *light = &g_lights[i * LIGHT_FLOATS];
+        float range = light[7];
+        if ((int32_t)light[3] != LIGHT_POINT || !(range > 0.0f))
+            continue;
+        if (sphere)
+        {
+            Vec3 d(light[0] - center.x, light[1] - center.y, light[2] - center.z);
+            float reach = range + radius;
+            if (d.dot(d) >= reach * reach)
+                continue;
+        }
+        add_draw_light(light[0], light[1], light[2], 1.0f, 1.0f / range, light[4], light[5], light[6]);
+        lightCount++;
+    }
+    pad_draw_lights();
 
-            // Scalar tail
-            for (; x <= maxX; x++)
-            {
-                if ((w0 >= 0 && w1 >= 0 && w2 >= 0) || (w0 <= 0 && w1 <= 0 && w2 <= 0))
-                {
-                    float bw0 = w0 * invArea;
-                    float bw1 = w1 * invArea;
-                    float bw2 = w2 * invArea;
+    g_last_draw_light_count = lightCount;
+    g_draw_lights.groups = g_draw_lights.count / 4;
+}
 
-                    float depthF = v0.depth * bw0 + v1.depth * bw1 + v2.depth * bw2;
-                    uint16_t depth = (uint16_t)((depthF + 1.0f) * 32767.5f);
+// Add gathered light groups [firstGroup, endGroup) at world position pos
+// with normal n: front accumulates lighting for n, back (optional) for -n,
+// which double-sided faces use when seen from behind. Sums are not clamped.
+static inline void accumulate_draw_lights(int32_t firstGroup, int32_t endGroup, const Vec3 &pos,
+                                          const Vec3 &n, float *front, float *back)
+{
+    if (firstGroup >= endGroup)
+        return;
+    v128_t px = wasm_f32x4_splat(pos.x), py = wasm_f32x4_splat(pos.y), pz = wasm_f32x4_splat(pos.z);
+    v128_t nx = wasm_f32x4_splat(n.x), ny = wasm_f32x4_splat(n.y), nz = wasm_f32x4_splat(n.z);
+    v128_t zero = wasm_f32x4_splat(0.0f), one = wasm_f32x4_splat(1.0f);
+    v128_t frontR = zero, frontG = zero, frontB = zero;
+    v128_t backR = zero, backG = zero, backB = zero;
+    const DrawLights &lights = g_draw_lights;
+    for (int32_t group = firstGroup; group < endGroup; group++)
+    {
+        int32_t o = group * 4;
+        v128_t point = wasm_v128_load(&lights.point[o]);
+        v128_t lx = wasm_f32x4_sub(wasm_v128_load(&lights.x[o]), wasm_f32x4_mul(px, point));
+        v128_t ly = wasm_f32x4_sub(wasm_v128_load(&lights.y[o]), wasm_f32x4_mul(py, point));
+        v128_t lz = wasm_f32x4_sub(wasm_v128_load(&lights.z[o]), wasm_f32x4_mul(pz, point));
+        v128_t dist2 = simd_fma(lx, lx, simd_fma(ly, ly, wasm_f32x4_mul(lz, lz)));
+        v128_t dist = wasm_f32x4_sqrt(wasm_f32x4_max(dist2, wasm_f32x4_splat(1e-12f)));
+        v128_t ndotl = wasm_f32x4_div(simd_fma(nx, lx, simd_fma(ny, ly, wasm_f32x4_mul(nz, lz))), dist);
+        v128_t falloff = wasm_f32x4_max(zero, wasm_f32x4_sub(one, wasm_f32x4_mul(dist, wasm_v128_load(&lights.invRange[o]))));
+        v128_t atten = wasm_f32x4_mul(falloff, falloff);
+        v128_t r = wasm_v128_load(&lights.r[o]), g = wasm_v128_load(&lights.g[o]), b = wasm_v128_load(&lights.b[o]);
+        v128_t lit = wasm_f32x4_mul(wasm_f32x4_max(ndotl, zero), atten);
+        frontR = simd_fma(lit, r, frontR);
+        frontG = simd_fma(lit, g, frontG);
+        frontB = simd_fma(lit, b, frontB);
+        if (back)
+        {
+            v128_t litBack = wasm_f32x4_mul(wasm_f32x4_max(wasm_f32x4_neg(ndotl), zero), atten);
+            backR = simd_fma(litBack, r, backR);
+            backG = simd_fma(litBack, g, backG);
+            backB = simd_fma(litBack, b, backB);
+        }
+    }
+    front[0] += simd_hsum(frontR);
+    front[1] += simd_hsum(frontG);
+    front[2] += simd_hsum(frontB);
+    if (back)
+    {
+        back[0] += simd_hsum(backR);
+        back[1] += simd_hsum(backG);
+        back[2] += simd_hsum(backB);
+    }
+}
 
-                    if (depth < rowDepth[x])
-                    {
-                        float cr = r0 * bw0 + r1 * bw1 + r2 * bw2;
-                        float cg = g0 * bw0 + g1 * bw1 + g2 * bw2;
-                        float cb = b0 * bw0 + b1 * bw1 + b2 * bw2;
+static inline void clamp_light(float *light)
+{
+    light[0] = fminf(1.0f, light[0]);
+    light[1] = fminf(1.0f, light[1]);
+    light[2] = fminf(1.0f, light[2]);
+}
 
-                        cr = fminf(255.0f, fmaxf(0.0f, cr));
-                        cg = fminf(255.0f, fmaxf(0.0f, cg));
-                        cb = fminf(255.0f, fmaxf(0.0f, cb));
+// Ambient plus all gathered lights, clamped to 1 per channel (back optional)
+static inline void evaluate_draw_lights(const Vec3 &pos, const Vec3 &n, float *front, float *back)
+{
+    front[0] = front[1] = front[2] = g_ambient_light;
+    if (back)
+        back[0] = back[1] = back[2] = g_ambient_light;
+    accumulate_draw_lights(0, g_draw_lights.groups, pos, n, front, back);
+    clamp_light(front);
+    if (back)
+        clamp_light(back);
+}
 
-                        rowDepth[x] = depth;
-                        rowPixels[x] = 0xFF000000 | ((uint32_t)cb << 16) | ((uint32_t)cg << 8) | (uint32_t)cr;
-                    }
-                }
-                w0 += A12;
-                w1 += A20;
-                w2 += A01;
-            }
-        }
-        // =====================================================================
-        // TEXTURED PATH: Scalar inner loop (texture sampling can't be SIMD)
-        // =====================================================================
-        else
-        {
-            for (; x <= maxX; x++)
-            {
-                if ((w0 >= 0 && w1 >= 0 && w2 >= 0) || (w0 <= 0 && w1 <= 0 && w2 <= 0))
-                {
-                    float bw0 = w0 * invArea;
-                    float bw1 = w1 * invArea;
-                    float bw2 = w2 * invArea;
+// ============================================================================
+// Lighting Lookup Tables
+// ============================================================================
 
-                    float depthF = v0.depth * bw0 + v1.depth * bw1 + v2.depth * bw2;
-                    uint16_t depth = (uint16_t)((depthF + 1.0f) * 32767.5f);
+// Octahedral normal codes: the unit sphere folded onto a res x res grid of
+// cells (16 x 16 for 8-bit codes, 64 x 64 for 12-bit). Code res * res
+// stands for a zero normal.
+static inline int32_t octahedral_resolution(int32_t bits)
+{
+    return bits >= 12 ? 64 : 16;
+}
 
-                    if (depth < rowDepth[x])
-                    {
-                        // Affine texture correction
-                        float uAffine = v0.u * bw0 + v1.u * bw1 + v2.u * bw2;
-                        float vAffine = v0.v * bw0 + v1.v * bw1 + v2.v * bw2;
-                        float affine = v0.affine * bw0 + v1.affine * bw1 + v2.affine * bw2;
-
-                        float tu = uAffine / affine;
-                        float tv = vAffine / affine;
-                        tu = tu - floorf(tu);
-                        tv = tv - floorf(tv);
-
-                        int32_t tx = (int32_t)(tu * texWf);
-                        int32_t ty = (int32_t)((1.0f - tv) * texHf);
-                        tx = ((tx % texW) + texW) % texW;
-                        ty = ((ty % texH) + texH) % texH;
-
-                        int32_t texOffset = (ty * texW + tx) * 4;
-                        float texR = texData[texOffset];
-                        float texG = texData[texOffset + 1];
-                        float texB = texData[texOffset + 2];
-
-                        float litR = r0 * bw0 + r1 * bw1 + r2 * bw2;
-                        float litG = g0 * bw0 + g1 * bw1 + g2 * bw2;
-                        float litB = b0 * bw0 + b1 * bw1 + b2 * bw2;
-
-                        float cr = texR * litR / 255.0f;
-                        float cg = texG * litG / 255.0f;
-                        float cb = texB * litB / 255.0f;
-
-                        cr = fminf(255.0f, fmaxf(0.0f, cr));
-                        cg = fminf(255.0f, fmaxf(0.0f, cg));
-                        cb = fminf(255.0f, fmaxf(0.0f, cb));
-
-                        rowDepth[x] = depth;
-                        rowPixels[x] = 0xFF000000 | ((uint32_t)cb << 16) | ((uint32_t)cg << 8) | (uint32_t)cr;
-                    }
-                }
-                w0 += A12;
-                w1 += A20;
-                w2 += A01;
-            }
-        }
+static inline uint16_t encode_octahedral(float x, float y, float z, int32_t res)
+{
+    float sum = fabsf(x) + fabsf(y) + fabsf(z);
+    if (!(sum > 1e-20f))
+        return (uint16_t)(res * res);
+    float ox = x / sum, oy = y / sum;
+    if (z < 0.0f)
+    {
+        float fx = (1.0f - fabsf(oy)) * (ox >= 0.0f ? 1.0f : -1.0f);
+        float fy = (1.0f - fabsf(ox)) * (oy >= 0.0f ? 1.0f : -1.0f);
+        ox = fx;
+        oy = fy;
+    }
+    int32_t ix = (int32_t)((ox + 1.0f) * 0.5f * (float)res);
+    int32_t iy = (int32_t)((oy + 1.0f) * 0.5f * (float)res);
+    ix = ix < 0 ? 0 : (ix >= res ? res - 1 : ix);
+    iy = iy < 0 ? 0 : (iy >= res ? res - 1 : iy);
+    return (uint16_t)(iy * res + ix);
+}
 
-        w0_row += B12;
-        w1_row += B20;
-        w2_row += B01;
+// Unit normal at the center of a code's cell
+static inline Vec3 decode_octahedral(int32_t code, int32_t res)
+{
+    float ox = ((float)(code % res) + 0.5f) * 2.0f / (float)res - 1.0f;
+    float oy = ((float)(code / res) + 0.5f) * 2.0f / (float)res - 1.0f;
+    float z = 1.0f - fabsf(ox) - fabsf(oy);
+    if (z < 0.0f)
+    {
+        float fx = (1.0f - fabsf(oy)) * (ox >= 0.0f ? 1.0f : -1.0f);
+        float fy = (1.0f - fabsf(ox)) * (oy >= 0.0f ? 1.0f : -1.0f);
+        ox = fx;
+        oy = fy;
     }
+    return Vec3(ox, oy, z).normalize();
 }
 
-// ============================================================================
-// Exported API
-// ============================================================================
+// Ambient plus directional lighting (front rgb, back rgb, unclamped) for
+// every world-space normal code. Directional lights are the same for every
+// draw, so one table serves all objects whatever their rotation; it is
+// rebuilt only when the lights or the code size change. Draws index it by
+// encoding their world normals (see light_processed_vertex).
+constexpr int LIGHT_LUT_MAX_CODES = 64 * 64 + 1;
 
-extern "C"
+struct LightLut
 {
+    float *light; // 6 floats per code
+    int32_t bits;
+    uint32_t version; // g_lighting_version when built
+};
 
-    // Set render resolution (must be called before rendering)
-    EMSCRIPTEN_KEEPALIVE
-    void set_render_resolution(int32_t width, int32_t height)
-    {
-        // Clamp to max supported resolution
-        if (width > MAX_RENDER_WIDTH)
-            width = MAX_RENDER_WIDTH;
-        if (height > MAX_RENDER_HEIGHT)
-            height = MAX_RENDER_HEIGHT;
-        if (width < 1)
-            width = 1;
-        if (height < 1)
-            height = 1;
+static LightLut g_light_lut = {nullptr, 0, 0};
 
-        g_render_width = width;
-        g_render_height = height;
-        g_pixel_count = width * height;
-    }
+// Table for the directional lights of the current gather_draw_lights,
+// building it if needed
+static const float *current_light_lut(int32_t bits)
+{
+    LightLut *lut = &g_light_lut;
+    if (lut->light && lut->bits == bits && lut->version == g_lighting_version)
+        return lut->light;
 
-    // Get current render width
-    EMSCRIPTEN_KEEPALIVE
-    int32_t get_render_width()
+    if (!lut->light)
     {
-        return g_render_width;
+        lut->light = (float *)malloc((size_t)LIGHT_LUT_MAX_CODES * 6 * sizeof(float));
+        if (!lut->light)
+            return nullptr;
     }
-
-    // Get current render height
-    EMSCRIPTEN_KEEPALIVE
-    int32_t get_render_height()
+    int32_t res = octahedral_resolution(bits);
+    Vec3 origin; // Directional lights do not depend on position
+    for (int32_t code = 0; code < res * res; code++)
     {
-        return g_render_height;
+        Vec3 n = decode_octahedral(code, res);
+        float *entry = &lut->light[code * 6];
+        entry[0] = entry[1] = entry[2] = entry[3] = entry[4] = entry[5] = g_ambient_light;
+        accumulate_draw_lights(0, g_draw_lights.pointGroup, origin, n, entry, entry + 3);
     }
+    float *zero = &lut->light[res * res * 6];
+    zero[0] = zero[1] = zero[2] = zero[3] = zero[4] = zero[5] = g_ambient_light;
 
-    // Get current pixel count
-    EMSCRIPTEN_KEEPALIVE
-    int32_t get_pixel_count()
-    {
-        return g_pixel_count;
-    }
+    lut->bits = bits;
+    lut->version = g_lighting_version;
+    return lut->light;
+}
 
-    // Clear framebuffer and depth buffer using bulk memory operations
-    EMSCRIPTEN_KEEPALIVE
-    void clear(uint8_t r, uint8_t g, uint8_t b)
-    {
-        // Use alpha=0 for background so shader can distinguish from geometry
-        uint32_t color = 0x00000000 | ((uint32_t)b << 16) | ((uint32_t)g << 8) | r;
-        int32_t pixel_count = g_pixel_count;
+// Table-lit draw state for the vertex stage (nullptr: evaluate the lights)
+static const float *g_vertex_lut = nullptr;
+static int32_t g_vertex_lut_res = 0;
 
-        // Fast depth buffer clear with bulk memory (all 0xFFFF)
-        // Using memset with 0xFF fills each byte, giving us 0xFFFF for 16-bit depth
-        __builtin_memset(g_depth, 0xFF, pixel_count * sizeof(uint16_t));
+// Vertex-stage Gouraud lighting for both sides: a table lookup plus the
+// draw's point lights when table-lit, otherwise every gathered light
+static inline void light_processed_vertex(ProcessedVertex &pv)
+{
+    if (g_vertex_lut)
+    {
+        uint16_t code = encode_octahedral(pv.normal.x, pv.normal.y, pv.normal.z, g_vertex_lut_res);
+        memcpy(pv.lit, &g_vertex_lut[code * 6], sizeof(pv.lit));
+        accumulate_draw_lights(g_draw_lights.pointGroup, g_draw_lights.groups, pv.world, pv.normal, pv.lit, pv.lit + 3);
+        clamp_light(pv.lit);
+        clamp_light(pv.lit + 3);
+        return;
+    }
+    evaluate_draw_lights(pv.world, pv.normal, pv.lit, pv.lit + 3);
+}
 
-        // For pixel buffer, we need to set each pixel to the same color
-        // SIMD is still faster than memset for 32-bit pattern fills
-        v128_t simd_color = wasm_i32x4_splat(color);
-        uint32_t *pixels = g_pixels;
+// ============================================================================
+// Static Lighting Bake
+// ============================================================================
 
-        // Unrolled SIMD loop (16 pixels = 64 bytes at a time)
-        int32_t i = 0;
-        int32_t simd_end = pixel_count - 15;
-        for (; i < simd_end; i += 16)
-        {
-            wasm_v128_store(pixels + i, simd_color);
-            wasm_v128_store(pixels + i + 4, simd_color);
-            wasm_v128_store(pixels + i + 8, simd_color);
-            wasm_v128_store(pixels + i + 12, simd_color);
-        }
-        // Handle remaining pixels
-        for (; i < pixel_count; i++)
+// The buffer's baked light for the current lights, model matrix and shading
+// mode, re-baking first if any of them changed (from the lights gathered for
+// this buffer, see gather_draw_lights). Smooth shading bakes per vertex from
+// vertex normals, flat shading per base triangle from the cached face
+// normals. Returns nullptr if the buffer has no bake or it failed.
+static const float *current_lighting_bake(int32_t handle, const GeometryBuffer *buf)
+{
+    LightingBake *bake = g_geometry_lighting[handle - 1];
+    if (!bake)
+        return nullptr;
+    int32_t smooth = g_enable_smooth_shading ? 1 : 0;
+    if (bake->valid && bake->smooth == smooth && bake->version == g_lighting_version &&
+        memcmp(bake->model, g_model_matrix, sizeof(bake->model)) == 0)
+        return bake->light;
+
+    int32_t entries = smooth ? buf->vertexCount : buf->indexCount / 3;
+    bake->valid = 0;
+    if (!grow_array(bake->light, bake->capacity, entries * 6))
+        return nullptr;
+
+    if (smooth)
+    {
+        for (int32_t i = 0; i < entries; i++)
         {
-            pixels[i] = color;
+            const float *v = &buf->vertices[i * 12];
+            Vec3 normal = mat4_mul_dir(g_model_matrix, Vec3(v[3], v[4], v[5])).normalize();
+            Vec4 world = mat4_mul_vec4(g_model_matrix, Vec4(v[0], v[1], v[2], 1.0f));
+            Vec3 pos(world.x, world.y, world.z);
+            evaluate_draw_lights(pos, normal, &bake->light[i * 6], &bake->light[i * 6 + 3]);
         }
     }
-
-    // Vertex cache for processed vertices (avoids redundant MVP transforms)
-    alignas(16) static ProcessedVertex g_vertex_cache[MAX_VERTICES];
-    alignas(16) static uint8_t g_vertex_processed[MAX_VERTICES]; // 0 = not processed, 1 = processed
-
-    // Get or compute processed vertex (with caching)
-    static inline ProcessedVertex &get_processed_vertex(uint32_t idx)
+    else
     {
-        if (!g_vertex_processed[idx])
+        NormalCache *normals = get_normal_cache(handle);
+        if (!normals)
+            return nullptr;
+        float normalMatrix[9];
+        model_normal_matrix(g_model_matrix, normalMatrix);
+        for (int32_t t = 0; t < entries; t++)
         {
-            g_vertex_cache[idx] = process_vertex(idx);
-            g_vertex_processed[idx] = 1;
+            const float *n = &normals->faceNormals[t * 3];
+            Vec3 normal = Vec3(normalMatrix[0] * n[0] + normalMatrix[1] * n[1] + normalMatrix[2] * n[2],
+                               normalMatrix[3] * n[0] + normalMatrix[4] * n[1] + normalMatrix[5] * n[2],
+                               normalMatrix[6] * n[0] + normalMatrix[7] * n[1] + normalMatrix[8] * n[2])
+                              .normalize();
+            // Point lights are sampled at the centroid
+            const float *p0 = &buf->vertices[buf->indices[t * 3] * 12];
+            const float *p1 = &buf->vertices[buf->indices[t * 3 + 1] * 12];
+            const float *p2 = &buf->vertices[buf->indices[t * 3 + 2] * 12];
+            Vec4 world = mat4_mul_vec4(g_model_matrix, Vec4((p0[0] + p1[0] + p2[0]) * (1.0f / 3.0f),
+                                                            (p0[1] + p1[1] + p2[1]) * (1.0f / 3.0f),
+                                                            (p0[2] + p1[2] + p2[2]) * (1.0f / 3.0f), 1.0f));
+            Vec3 pos(world.x, world.y, world.z);
+            evaluate_draw_lights(pos, normal, &bake->light[t * 6], &bake->light[t * 6 + 3]);
         }
-        return g_vertex_cache[idx];
     }
 
-    // Render all triangles
-    EMSCRIPTEN_KEEPALIVE
-    void render_triangles()
-    {
-        int32_t numTriangles = g_index_count / 3;
+    bake->smooth = smooth;
+    bake->version = g_lighting_version;
+    memcpy(bake->model, g_model_matrix, sizeof(bake->model));
+    bake->valid = 1;
+    return bake->light;
+}
 
-        // Clear vertex cache flags with bulk memory operation
-        __builtin_memset(g_vertex_processed, 0, g_vertex_count);
+// Fold an rgb light (baked or from the vertex stage) into the vertex color,
+// so the rasterizer's color * light multiply becomes a no-op
+static inline void apply_light_color(ProcessedVertex &pv, const float *light)
+{
+    pv.r *= light[0];
+    pv.g *= light[1];
+    pv.b *= light[2];
+    pv.light = 1.0f;
+}
 
-        for (int32_t t = 0; t < numTriangles; t++)
-        {
-            uint32_t i0 = g_indices[t * 3];
-            uint32_t i1 = g_indices[t * 3 + 1];
-            uint32_t i2 = g_indices[t * 3 + 2];
+// ============================================================================
+// Face Materials
+// ============================================================================
 
-            // Get cached or compute vertices
-            ProcessedVertex v0 = get_processed_vertex(i0);
-            ProcessedVertex v1 = get_processed_vertex(i1);
-            ProcessedVertex v2 = get_processed_vertex(i2);
+// Per-draw material table indexed by a buffer's face material ids: texture
+// buffer handle (0 = untextured) and MATERIAL_* flags per entry, written by
+// JS. Ids past the table's count draw with the texture bound for the draw.
+constexpr int MAX_MATERIALS = 256; // Material ids are bytes
+constexpr int MATERIAL_INTS = 2;   // texture handle, flags
 
-            // Near-plane clipping (PS1 style - reject if any vertex behind camera)
-            if (v0.depth < -1.0f || v1.depth < -1.0f || v2.depth < -1.0f)
-                continue;
-            if (v0.depth > 1.0f || v1.depth > 1.0f || v2.depth > 1.0f)
-                continue;
+enum MaterialFlags : int32_t
+{
+    MATERIAL_UNLIT = 1,  // Keep vertex colors (no lighting)
+    MATERIAL_HIDDEN = 2, // Skip the material's triangles
+};
 
-            // Check if backfacing
-            Vec3 edge1 = v1.screen - v0.screen;
-            Vec3 edge2 = v2.screen - v0.screen;
-            float cross_z = edge1.x * edge2.y - edge1.y * edge2.x;
-            bool isBackfacing = cross_z >= 0;
+static int32_t g_material_table[MAX_MATERIALS * MATERIAL_INTS];
+static int32_t g_material_count = 0; // 0 = ignore face materials
 
-            // Lighting calculation
-            if (g_enable_lighting)
-            {
-                if (g_enable_smooth_shading)
-                {
-                    // Smooth (Gouraud) shading: use per-vertex normals
-                    // Flip normals for backfaces (double-sided rendering)
-                    if (isBackfacing)
-                    {
-                        v0.normal = v0.normal * -1.0f;
-                        v1.normal = v1.normal * -1.0f;
-                        v2.normal = v2.normal * -1.0f;
-                    }
+// Texture state a draw started with, restored after per-face switches
+struct TextureBinding
+{
+    const uint8_t *data;
+    int32_t width, height;
+    int32_t texturing;
+};
 
-                    // Recalculate per-vertex lighting
-                    Vec3 lightDir(g_light_dir[0], g_light_dir[1], g_light_dir[2]);
-                    float ndotl0 = fmaxf(0.0f, -v0.normal.dot(lightDir));
-                    float ndotl1 = fmaxf(0.0f, -v1.normal.dot(lightDir));
-                    float ndotl2 = fmaxf(0.0f, -v2.normal.dot(lightDir));
-                    v0.light = fminf(1.0f, g_ambient_light + ndotl0 * g_light_color[3]);
-                    v1.light = fminf(1.0f, g_ambient_light + ndotl1 * g_light_color[3]);
-                    v2.light = fminf(1.0f, g_ambient_light + ndotl2 * g_light_color[3]);
-                }
-                else
-                {
-                    // Flat shading: compute face normal from world positions
-                    Vec3 worldEdge1 = v1.world - v0.world;
-                    Vec3 worldEdge2 = v2.world - v0.world;
-                    Vec3 faceNormal = worldEdge1.cross(worldEdge2).normalize();
+static inline void save_texture_binding(TextureBinding &binding)
+{
+    binding.data = g_active_texture_data;
+    binding.width = g_active_texture_width;
+    binding.height = g_active_texture_height;
+    binding.texturing = g_enable_texturing;
+}
 
-                    // Flip normal for backfaces (double-sided rendering)
-                    if (isBackfacing)
-                    {
-                        faceNormal = faceNormal * -1.0f;
-                    }
+static inline void restore_texture_binding(const TextureBinding &binding)
+{
+    g_active_texture_data = binding.data;
+    g_active_texture_width = binding.width;
+    g_active_texture_height = binding.height;
+    g_enable_texturing = binding.texturing;
+}
 
-                    // Calculate single light value for entire face
-                    Vec3 lightDir(g_light_dir[0], g_light_dir[1], g_light_dir[2]);
-                    float ndotl = fmaxf(0.0f, -faceNormal.dot(lightDir));
-                    float faceLight = fminf(1.0f, g_ambient_light + ndotl * g_light_color[3]);
+// Size a buffer's material ids for triangleCount triangles. Triangles added
+// here get material 0; existing entries are kept.
+static FaceMaterials *ensure_face_materials(int32_t slot, int32_t triangleCount)
+{
+    FaceMaterials *materials = g_geometry_materials[slot];
+    if (!materials)
+    {
+        materials = (FaceMaterials *)calloc(1, sizeof(FaceMaterials));
+        if (!materials)
+            return nullptr;
+        g_geometry_materials[slot] = materials;
+    }
+    if (!grow_array(materials->ids, materials->idCapacity, triangleCount))
+        return nullptr;
+    if (triangleCount > materials->triangleCount)
+        memset(&materials->ids[materials->triangleCount], 0, (size_t)(triangleCount - materials->triangleCount));
+    materials->triangleCount = triangleCount;
+    materials->vertexValid = 0;
+    return materials;
+}
 
-                    // Apply same light to all vertices (flat shading)
-                    v0.light = faceLight;
-                    v1.light = faceLight;
-                    v2.light = faceLight;
-                }
-            }
+// Material ids to apply when drawing a buffer (nullptr = single material)
+static inline FaceMaterials *active_face_materials(int32_t slot, const GeometryBuffer *buf)
+{
+    FaceMaterials *materials = g_geometry_materials[slot];
+    if (!materials || g_material_count <= 0 || materials->triangleCount != buf->indexCount / 3)
+        return nullptr;
+    return materials;
+}
 
-            // Rasterize
-            rasterize_triangle(v0, v1, v2);
+// Per-vertex materials for LOD levels. Vertices on a boundary between
+// materials take the last triangle's (see lod_face_material).
+static const uint8_t *face_material_vertex_ids(FaceMaterials *materials, const GeometryBuffer *buf)
+{
+    if (materials->vertexValid)
+        return materials->vertexIds;
+    if (!grow_array(materials->vertexIds, materials->vertexCapacity, buf->vertexCount))
+        return nullptr;
+    memset(materials->vertexIds, 0, (size_t)buf->vertexCount);
+    for (int32_t t = 0; t < materials->triangleCount; t++)
+    {
+        for (int c = 0; c < 3; c++)
+        {
+            uint32_t v = buf->indices[t * 3 + c];
+            if (v < (uint32_t)buf->vertexCount)
+                materials->vertexIds[v] = materials->ids[t];
         }
     }
+    materials->vertexValid = 1;
+    return materials->vertexIds;
+}
 
-    // Draw a single line (for wireframe/overlays)
-    EMSCRIPTEN_KEEPALIVE
-    void draw_line(float x0, float y0, float x1, float y1,
-                   uint8_t r, uint8_t g, uint8_t b, uint16_t depth_value)
+// Material of a simplified triangle: the one shared by two of its corners,
+// else its first corner's. Seam vertices (and so material boundaries with
+// split vertices) are never collapsed, so this is exact for those.
+static inline int32_t lod_face_material(const uint8_t *vertexIds, uint32_t i0, uint32_t i1, uint32_t i2)
+{
+    uint8_t a = vertexIds[i0], b = vertexIds[i1], c = vertexIds[i2];
+    return (a != b && a != c && b == c) ? b : a;
+}
+
+// Bind material m's texture for the following triangles (texturing stays
+// off if the draw started with it off). Returns the material's flags.
+static inline int32_t bind_face_material(int32_t m, const TextureBinding &saved)
+{
+    if (m >= g_material_count)
     {
-        uint32_t color = 0xFF000000 | ((uint32_t)b << 16) | ((uint32_t)g << 8) | r;
+        restore_texture_binding(saved);
+        return 0;
+    }
+    int32_t handle = g_material_table[m * MATERIAL_INTS];
+    const TextureBuffer *tex = handle > 0 && handle <= MAX_TEXTURE_BUFFERS ? g_texture_buffers[handle - 1] : nullptr;
+    if (saved.texturing && tex && tex->data && tex->width > 0 && tex->height > 0)
+    {
+        g_active_texture_data = tex->data;
+        g_active_texture_width = tex->width;
+        g_active_texture_height = tex->height;
+        g_enable_texturing = 1;
+    }
+    else
+    {
+        g_enable_texturing = 0;
+    }
+    return g_material_table[m * MATERIAL_INTS + 1];
+}
 
-        int32_t ix0 = (int32_t)x0;
-        int32_t iy0 = (int32_t)y0;
-        int32_t ix1 = (int32_t)x1;
-        int32_t iy1 = (int32_t)y1;
+// ============================================================================
+// Core Rasterization
+// ============================================================================
 
-        int32_t dx = ix1 > ix0 ? ix1 - ix0 : ix0 - ix1;
-        int32_t dy = iy1 > iy0 ? iy0 - iy1 : iy1 - iy0;
-        int32_t sx = ix0 < ix1 ? 1 : -1;
-        int32_t sy = iy0 < iy1 ? 1 : -1;
-        int32_t err = dx + dy;
+// Fill in everything but the projection: world position and normal,
+// colors and affine-premultiplied UVs. clipW is the vertex's clip-space w
+// (drives the affine texture factor). Smooth-shaded draws are lit right
+// after, in get_processed_vertex (see light_processed_vertex).
+static inline void shade_processed_vertex(ProcessedVertex &pv, const float *v, float clipW)
+{
+    Vec4 pos(v[0], v[1], v[2], 1.0f);
+    Vec3 normal(v[3], v[4], v[5]);
+    float u = v[6], vt = v[7];
+    float r = v[8], g = v[9], b = v[10];
 
-        while (true)
-        {
-            if (ix0 >= 0 && ix0 < g_render_width && iy0 >= 0 && iy0 < g_render_height)
-            {
-                int32_t idx = iy0 * g_render_width + ix0;
-                if (depth_value <= g_depth[idx])
-                {
-                    g_pixels[idx] = color;
-                    g_depth[idx] = depth_value;
-                }
-            }
+    // World-space normal for lighting
+    Vec3 worldNormal = mat4_mul_dir(g_model_matrix, normal).normalize();
 
-            if (ix0 == ix1 && iy0 == iy1)
-                break;
+    // World-space position
+    Vec4 worldPos = mat4_mul_vec4(g_model_matrix, pos);
 
-            int32_t e2 = 2 * err;
-            if (e2 >= dy)
-            {
-                err += dy;
-                ix0 += sx;
-            }
-            if (e2 <= dx)
-            {
-                err += dx;
-                iy0 += sy;
-            }
-        }
-    }
+    // PS1-style affine factor
+    float dist = fmaxf(0.001f, clipW);
+    float affine = dist + (clipW * 8.0f / dist) * 0.5f;
 
-    // Get pointer to pixel buffer (for JS to read)
-    EMSCRIPTEN_KEEPALIVE
-    uint32_t *get_pixels()
-    {
-        return g_pixels;
-    }
+    pv.world = Vec3(worldPos.x, worldPos.y, worldPos.z);
+    pv.normal = worldNormal;
+    pv.u = u * affine; // Pre-multiply for affine
+    pv.v = vt * affine;
+    pv.r = r;
+    pv.g = g;
+    pv.b = b;
+    pv.affine = affine;
+    pv.light = 1.0f;
+}
 
-    // Get pointer to depth buffer
-    EMSCRIPTEN_KEEPALIVE
-    uint16_t *get_depth()
-    {
-        return g_depth;
-    }
+// Process a single vertex through MVP pipeline
+// v points at one 12-float vertex (g_vertices or a geometry buffer)
+static ProcessedVertex process_vertex(const float *v)
+{
+    // Transform through MVP
+    Vec4 clip = mat4_mul_vec4(g_mvp_matrix, Vec4(v[0], v[1], v[2], 1.0f));
 
-    // Get pointer to vertex buffer (for JS to write)
-    EMSCRIPTEN_KEEPALIVE
-    float *get_vertices()
-    {
-        return g_vertices;
-    }
+    // Perspective divide
+    Vec3 ndc = clip.perspectiveDivide();
 
-    // Get pointer to index buffer
-    EMSCRIPTEN_KEEPALIVE
-    uint32_t *get_indices()
+    // PS1-style vertex snapping
+    if (g_enable_vertex_snapping)
     {
-        return g_indices;
+        ndc.x = floorf(ndc.x * g_snap_resolution_x) / g_snap_resolution_x;
+        ndc.y = floorf(ndc.y * g_snap_resolution_y) / g_snap_resolution_y;
     }
 
-    // Get pointer to MVP matrix
-    EMSCRIPTEN_KEEPALIVE
-    float *get_mvp_matrix()
-    {
-        return g_mvp_matrix;
-    }
+    // Viewport transform (NDC to screen) - use runtime resolution
+    float screenX = (ndc.x + 1.0f) * 0.5f * (float)g_render_width;
+    float screenY = (1.0f - ndc.y) * 0.5f * (float)g_render_height;
 
-    // Get pointer to model matrix
-    EMSCRIPTEN_KEEPALIVE
-    float *get_model_matrix()
-    {
-        return g_model_matrix;
-    }
+    ProcessedVertex pv;
+    pv.screen = Vec3(screenX, screenY, ndc.z);
+    pv.depth = ndc.z;
+    shade_processed_vertex(pv, v, clip.w);
+    return pv;
+}
 
-    // Get pointer to texture data for a specific slot
-    EMSCRIPTEN_KEEPALIVE
-    uint8_t *get_texture(int32_t slot)
-    {
-        if (slot < 0 || slot >= MAX_TEXTURES)
-            return nullptr;
-        return g_textures[slot];
-    }
+// Rasterize a single triangle with full SIMD acceleration
+static void rasterize_triangle(
+    const ProcessedVertex &v0,
+    const ProcessedVertex &v1,
+    const ProcessedVertex &v2)
+{
+    // Bounding box (integer) - use runtime resolution
+    int32_t minX = max3(0, (int32_t)min3f(v0.screen.x, v1.screen.x, v2.screen.x), 0);
+    int32_t maxX = min3((int32_t)max3f(v0.screen.x, v1.screen.x, v2.screen.x) + 1,
+                        g_render_width - 1, g_render_width - 1);
+    int32_t minY = max3(0, (int32_t)min3f(v0.screen.y, v1.screen.y, v2.screen.y), 0);
+    int32_t maxY = min3((int32_t)max3f(v0.screen.y, v1.screen.y, v2.screen.y) + 1,
+                        g_render_height - 1, g_render_height - 1);
 
-    // Get pointer to texture sizes array
-    EMSCRIPTEN_KEEPALIVE
-    int32_t *get_texture_sizes()
-    {
-        return g_texture_sizes;
-    }
+    // Early reject
+    if (minX > maxX || minY > maxY)
+        return;
 
-    // Set texture for slot
-    EMSCRIPTEN_KEEPALIVE
-    void set_texture_size(int32_t slot, int32_t width, int32_t height)
-    {
-        if (slot < 0 || slot >= MAX_TEXTURES)
-            return;
-        g_texture_sizes[slot * 2] = width;
-        g_texture_sizes[slot * 2 + 1] = height;
-    }
+    // Cache screen positions
+    float x0 = v0.screen.x, y0 = v0.screen.y;
+    float x1 = v1.screen.x, y1 = v1.screen.y;
+    float x2 = v2.screen.x, y2 = v2.screen.y;
 
-    // Set active texture
-    EMSCRIPTEN_KEEPALIVE
-    void set_current_texture(int32_t slot)
-    {
-        g_current_texture = slot;
-    }
+    // Edge function coefficients
+    float A01 = y0 - y1, B01 = x1 - x0;
+    float A12 = y1 - y2, B12 = x2 - x1;
+    float A20 = y2 - y0, B20 = x0 - x2;
 
-    // Set light direction
-    EMSCRIPTEN_KEEPALIVE
-    void set_light_direction(float x, float y, float z)
-    {
-        float len = sqrtf(x * x + y * y + z * z);
-        if (len > 0.0001f)
-        {
-            g_light_dir[0] = x / len;
-            g_light_dir[1] = y / len;
-            g_light_dir[2] = z / len;
-        }
-    }
+    // Triangle area * 2
+    float area = A01 * (x2 - x0) + B01 * (y2 - y0);
+    if (fabsf(area) < 0.0001f)
+        return; // Degenerate
+    float invArea = 1.0f / area;
 
-    // Set light color and intensity
-    EMSCRIPTEN_KEEPALIVE
-    void set_light_color(float r, float g, float b, float intensity)
-    {
-        g_light_color[0] = r;
-        g_light_color[1] = g;
-        g_light_color[2] = b;
-        g_light_color[3] = intensity;
-    }
+    // Starting point
+    float px = minX + 0.5f;
+    float py = minY + 0.5f;
 
-    // Set counts
-    EMSCRIPTEN_KEEPALIVE
-    void set_vertex_count(int32_t count)
-    {
-        g_vertex_count = count;
-    }
+    // Initial edge values
+    float w0_row = A12 * (px - x1) + B12 * (py - y1);
+    float w1_row = A20 * (px - x2) + B20 * (py - y2);
+    float w2_row = A01 * (px - x0) + B01 * (py - y0);
 
-    EMSCRIPTEN_KEEPALIVE
-    void set_index_count(int32_t count)
-    {
-        g_index_count = count;
-    }
+    // Pre-multiply colors with lighting
+    float r0 = v0.r * v0.light, g0 = v0.g * v0.light, b0 = v0.b * v0.light;
+    float r1 = v1.r * v1.light, g1 = v1.g * v1.light, b1 = v1.b * v1.light;
+    float r2 = v2.r * v2.light, g2 = v2.g * v2.light, b2 = v2.b * v2.light;
 
-    // Settings setters
-    EMSCRIPTEN_KEEPALIVE
-    void set_ambient_light(float ambient)
-    {
-        g_ambient_light = ambient;
-    }
+    // Texture info (active texture buffer, otherwise the fixed slot)
+    int32_t texW, texH;
+    const uint8_t *texData = bound_texture(texW, texH);
+    float texWf = (float)texW, texHf = (float)texH;
 
-    EMSCRIPTEN_KEEPALIVE
-    void set_enable_lighting(int32_t enable)
-    {
-        g_enable_lighting = enable;
-    }
+    // Check if this is a non-textured triangle (can use fast SIMD path)
+    bool useTexture = texData && texW > 0 && texH > 0;
 
-    EMSCRIPTEN_KEEPALIVE
-    void set_enable_dithering(int32_t enable)
+    // Span texture mapping: every interpolant is stepped along x with
+    // constant per-triangle increments (no per-pixel barycentrics)
+    bool useSpans = useTexture && g_texture_mapping != TEXTURE_MAPPING_PER_PIXEL;
+    bool affineSpans = g_texture_mapping == TEXTURE_MAPPING_AFFINE;
+    float stepB0 = A12 * invArea, stepB1 = A20 * invArea, stepB2 = A01 * invArea;
+    float stepDepth = 0, stepR = 0, stepG = 0, stepB = 0;
+    float stepU = 0, stepV = 0, stepA = 0; // Corrected numerators / denominator
+    float su0 = 0, su1 = 0, su2 = 0, sv0 = 0, sv1 = 0, sv2 = 0, stepSU = 0, stepSV = 0;
+    int32_t maskU = 0, maskV = 0;
+    if (useSpans)
     {
-        g_enable_dithering = enable;
+        stepDepth = v0.depth * stepB0 + v1.depth * stepB1 + v2.depth * stepB2;
+        stepR = r0 * stepB0 + r1 * stepB1 + r2 * stepB2;
+        stepG = g0 * stepB0 + g1 * stepB1 + g2 * stepB2;
+        stepB = b0 * stepB0 + b1 * stepB1 + b2 * stepB2;
+        stepU = v0.u * stepB0 + v1.u * stepB1 + v2.u * stepB2;
+        stepV = v0.v * stepB0 + v1.v * stepB1 + v2.v * stepB2;
+        stepA = v0.affine * stepB0 + v1.affine * stepB1 + v2.affine * stepB2;
+        // Affine mode interpolates texel coordinates linearly in screen space
+        su0 = v0.u / v0.affine * texWf;
+        su1 = v1.u / v1.affine * texWf;
+        su2 = v2.u / v2.affine * texWf;
+        sv0 = (1.0f - v0.v / v0.affine) * texHf;
+        sv1 = (1.0f - v1.v / v1.affine) * texHf;
+        sv2 = (1.0f - v2.v / v2.affine) * texHf;
+        stepSU = fminf(fmaxf(su0 * stepB0 + su1 * stepB1 + su2 * stepB2, -32767.0f), 32767.0f);
+        stepSV = fminf(fmaxf(sv0 * stepB0 + sv1 * stepB1 + sv2 * stepB2, -32767.0f), 32767.0f);
+        maskU = (texW & (texW - 1)) == 0 ? texW - 1 : 0;
+        maskV = (texH & (texH - 1)) == 0 ? texH - 1 : 0;
     }
 
-    EMSCRIPTEN_KEEPALIVE
-    void set_enable_texturing(int32_t enable)
-    {
-        g_enable_texturing = enable;
-    }
+    // SIMD constants
+    v128_t simd_zero = wasm_f32x4_splat(0.0f);
+    v128_t simd_one = wasm_f32x4_splat(1.0f);
+    v128_t simd_255 = wasm_f32x4_splat(255.0f);
+    v128_t simd_invArea = wasm_f32x4_splat(invArea);
+    v128_t simd_depth_scale = wasm_f32x4_splat(32767.5f);
+    v128_t simd_alpha = wasm_i32x4_splat(0xFF000000);
 
-    EMSCRIPTEN_KEEPALIVE
-    void set_enable_backface_culling(int32_t enable)
-    {
-        g_enable_backface_culling = enable;
-    }
+    // Edge function step constants
+    v128_t simd_offset0 = wasm_f32x4_make(0.0f, A12, A12 * 2.0f, A12 * 3.0f);
+    v128_t simd_offset1 = wasm_f32x4_make(0.0f, A20, A20 * 2.0f, A20 * 3.0f);
+    v128_t simd_offset2 = wasm_f32x4_make(0.0f, A01, A01 * 2.0f, A01 * 3.0f);
 
-    EMSCRIPTEN_KEEPALIVE
-    void set_enable_vertex_snapping(int32_t enable)
-    {
-        g_enable_vertex_snapping = enable;
-    }
+    // Vertex attributes for interpolation
+    v128_t simd_depth0 = wasm_f32x4_splat(v0.depth);
+    v128_t simd_depth1 = wasm_f32x4_splat(v1.depth);
+    v128_t simd_depth2 = wasm_f32x4_splat(v2.depth);
 
-    EMSCRIPTEN_KEEPALIVE
-    void set_snap_resolution(float x, float y)
-    {
-        g_snap_resolution_x = x;
-        g_snap_resolution_y = y;
-    }
+    v128_t simd_r0 = wasm_f32x4_splat(r0);
+    v128_t simd_r1 = wasm_f32x4_splat(r1);
+    v128_t simd_r2 = wasm_f32x4_splat(r2);
+    v128_t simd_g0 = wasm_f32x4_splat(g0);
+    v128_t simd_g1 = wasm_f32x4_splat(g1);
+    v128_t simd_g2 = wasm_f32x4_splat(g2);
+    v128_t simd_b0 = wasm_f32x4_splat(b0);
+    v128_t simd_b1 = wasm_f32x4_splat(b1);
+    v128_t simd_b2 = wasm_f32x4_splat(b2);
 
-    EMSCRIPTEN_KEEPALIVE
-    void set_enable_smooth_shading(int32_t enable)
+    // Scan rows
+    for (int32_t y = minY; y <= maxY; y++)
     {
-        g_enable_smooth_shading = enable;
-    }
+        float w0 = w0_row;
+        float w1 = w1_row;
+        float w2 = w2_row;
+        int32_t yOffset = y * g_render_width;
+        uint32_t *rowPixels = &g_pixels[yOffset];
+        uint16_t *rowDepth = &g_depth[yOffset];
 
-    // ========================================================================
-    // Geometry Buffer API (OpenGL-style dynamic buffers)
-    // ========================================================================
+        // Dither row lookup
+        int32_t ditherY = y & 7;
+        const int8_t *ditherRow = DITHER_MATRIX[ditherY];
 
-    // Create a new geometry buffer, returns handle (0 = failure)
-    EMSCRIPTEN_KEEPALIVE
-    int32_t create_geometry_buffer()
-    {
-        // Find an empty slot
-        int slot = -1;
-        for (int i = 0; i < MAX_GEOMETRY_BUFFERS; i++)
+        int32_t x = minX;
+
+        // =====================================================================
+        // FAST PATH: Non-textured triangles - full SIMD with batched writes
+        // =====================================================================
+        if (!useTexture)
         {
-            if (g_geometry_buffers[i] == nullptr)
+            for (; x + 3 <= maxX; x += 4)
             {
-                slot = i;
-                break;
-            }
-        }
-        if (slot < 0)
-            return 0; // No slots available
+                // Edge values for 4 consecutive pixels
+                v128_t sw0 = wasm_f32x4_add(wasm_f32x4_splat(w0), simd_offset0);
+                v128_t sw1 = wasm_f32x4_add(wasm_f32x4_splat(w1), simd_offset1);
+                v128_t sw2 = wasm_f32x4_add(wasm_f32x4_splat(w2), simd_offset2);
 
-        // Allocate buffer struct
-        GeometryBuffer *buf = (GeometryBuffer *)malloc(sizeof(GeometryBuffer));
-        if (!buf)
-            return 0;
+                // Inside test
+                v128_t inside_pos = wasm_v128_and(wasm_v128_and(
+                                                      wasm_f32x4_ge(sw0, simd_zero),
+                                                      wasm_f32x4_ge(sw1, simd_zero)),
+                                                  wasm_f32x4_ge(sw2, simd_zero));
+                v128_t inside_neg = wasm_v128_and(wasm_v128_and(
+                                                      wasm_f32x4_le(sw0, simd_zero),
+                                                      wasm_f32x4_le(sw1, simd_zero)),
+                                                  wasm_f32x4_le(sw2, simd_zero));
+                v128_t inside_mask = wasm_v128_or(inside_pos, inside_neg);
 
-        buf->vertices = nullptr;
-        buf->indices = nullptr;
-        buf->vertexCount = 0;
-        buf->indexCount = 0;
-        buf->vertexCapacity = 0;
-        buf->indexCapacity = 0;
+                if (!wasm_v128_any_true(inside_mask))
+                {
+                    w0 += A12 * 4.0f;
+                    w1 += A20 * 4.0f;
+                    w2 += A01 * 4.0f;
+                    continue;
+                }
 
-        g_geometry_buffers[slot] = buf;
+                // Barycentric weights
+                v128_t bw0 = wasm_f32x4_mul(sw0, simd_invArea);
+                v128_t bw1 = wasm_f32x4_mul(sw1, simd_invArea);
+                v128_t bw2 = wasm_f32x4_mul(sw2, simd_invArea);
 
-        // Return handle (slot + 1 so 0 is invalid)
-        return slot + 1;
-    }
+                // Interpolate depth: (depth + 1) * 32767.5
+                v128_t depth_f = simd_fma(simd_depth2, bw2,
+                                          simd_fma(simd_depth1, bw1, wasm_f32x4_mul(simd_depth0, bw0)));
+                v128_t depth_u16 = wasm_f32x4_mul(wasm_f32x4_add(depth_f, simd_one), simd_depth_scale);
 
-    // Delete a geometry buffer
-    EMSCRIPTEN_KEEPALIVE
-    void delete_geometry_buffer(int32_t handle)
-    {
-        int slot = handle - 1;
-        if (slot < 0 || slot >= MAX_GEOMETRY_BUFFERS)
-            return;
+                // Load existing depth (4 x u16 -> need to expand)
+                // Load 8 u16s, we only use first 4
+                v128_t old_depth_i16 = wasm_v128_load64_zero(&rowDepth[x]);
+                v128_t old_depth_u32 = wasm_u32x4_extend_low_u16x8(old_depth_i16);
+                v128_t old_depth_f = wasm_f32x4_convert_i32x4(old_depth_u32);
 
-        GeometryBuffer *buf = g_geometry_buffers[slot];
-        if (!buf)
-            return;
+                // Depth test: new_depth < old_depth
+                v128_t depth_pass = wasm_f32x4_lt(depth_u16, old_depth_f);
+                v128_t write_mask = wasm_v128_and(inside_mask, depth_pass);
 
-        if (buf->vertices)
-            free(buf->vertices);
-        if (buf->indices)
-            free(buf->indices);
-        free(buf);
+                if (!wasm_v128_any_true(write_mask))
+                {
+                    w0 += A12 * 4.0f;
+                    w1 += A20 * 4.0f;
+                    w2 += A01 * 4.0f;
+                    continue;
+                }
 
-        g_geometry_buffers[slot] = nullptr;
-    }
+                // Interpolate colors
+                v128_t cr = simd_fma(simd_r2, bw2, simd_fma(simd_r1, bw1, wasm_f32x4_mul(simd_r0, bw0)));
+                v128_t cg = simd_fma(simd_g2, bw2, simd_fma(simd_g1, bw1, wasm_f32x4_mul(simd_g0, bw0)));
+                v128_t cb = simd_fma(simd_b2, bw2, simd_fma(simd_b1, bw1, wasm_f32x4_mul(simd_b0, bw0)));
 
-    // Upload vertex data to a geometry buffer
-    // Returns pointer to vertex buffer for JS to write to, or nullptr on failure
-    EMSCRIPTEN_KEEPALIVE
-    float *geometry_buffer_alloc_vertices(int32_t handle, int32_t vertexCount)
-    {
-        int slot = handle - 1;
-        if (slot < 0 || slot >= MAX_GEOMETRY_BUFFERS)
-            return nullptr;
+                // Clamp to [0, 255]
+                cr = wasm_f32x4_min(wasm_f32x4_max(cr, simd_zero), simd_255);
+                cg = wasm_f32x4_min(wasm_f32x4_max(cg, simd_zero), simd_255);
+                cb = wasm_f32x4_min(wasm_f32x4_max(cb, simd_zero), simd_255);
 
-        GeometryBuffer *buf = g_geometry_buffers[slot];
-        if (!buf)
-            return nullptr;
+                // Convert to integers
+                v128_t ir = wasm_i32x4_trunc_sat_f32x4(cr);
+                v128_t ig = wasm_i32x4_trunc_sat_f32x4(cg);
+                v128_t ib = wasm_i32x4_trunc_sat_f32x4(cb);
 
-        // Reallocate if needed
-        int32_t requiredSize = vertexCount * 12; // 12 floats per vertex
-        if (buf->vertexCapacity < requiredSize)
-        {
-            if (buf->vertices)
-                free(buf->vertices);
-            buf->vertices = (float *)malloc(requiredSize * sizeof(float));
-            if (!buf->vertices)
-            {
-                buf->vertexCapacity = 0;
-                buf->vertexCount = 0;
-                return nullptr;
+                // Pack into ABGR: 0xFF000000 | (b << 16) | (g << 8) | r
+                v128_t pixels = wasm_v128_or(simd_alpha,
+                                             wasm_v128_or(wasm_i32x4_shl(ib, 16),
+                                                          wasm_v128_or(wasm_i32x4_shl(ig, 8), ir)));
+
+                // Convert depth to u16
+                v128_t new_depth_i32 = wasm_i32x4_trunc_sat_f32x4(depth_u16);
+
+                // Selective write based on mask
+                uint32_t mask_bits = wasm_i32x4_bitmask(write_mask);
+
+                // Manual unroll for pixel/depth writes (faster than extract)
+                if (mask_bits & 1)
+                {
+                    rowPixels[x] = wasm_i32x4_extract_lane(pixels, 0);
+                    rowDepth[x] = (uint16_t)wasm_i32x4_extract_lane(new_depth_i32, 0);
+                }
+                if (mask_bits & 2)
+                {
+                    rowPixels[x + 1] = wasm_i32x4_extract_lane(pixels, 1);
+                    rowDepth[x + 1] = (uint16_t)wasm_i32x4_extract_lane(new_depth_i32, 1);
+                }
+                if (mask_bits & 4)
+                {
+                    rowPixels[x + 2] = wasm_i32x4_extract_lane(pixels, 2);
+                    rowDepth[x + 2] = (uint16_t)wasm_i32x4_extract_lane(new_depth_i32, 2);
+                }
+                if (mask_bits & 8)
+                {
+                    rowPixels[x + 3] = wasm_i32x4_extract_lane(pixels, 3);
+                    rowDepth[x + 3] = (uint16_t)wasm_i32x4_extract_lane(new_depth_i32, 3);
+                }
+                if (g_id_objects)
+                    id_buffer_write_mask(yOffset + x, mask_bits);
+
+                w0 += A12 * 4.0f;
+                w1 += A20 * 4.0f;
+                w2 += A01 * 4.0f;
             }
-            buf->vertexCapacity = requiredSize;
-        }
 
-        buf->vertexCount = vertexCount;
-        return buf->vertices;
-    }
+            // Scalar tail
+            for (; x <= maxX; x++)
+            {
+                if ((w0 >= 0 && w1 >= 0 && w2 >= 0) || (w0 <= 0 && w1 <= 0 && w2 <= 0))
+                {
+                    float bw0 = w0 * invArea;
+                    float bw1 = w1 * invArea;
+                    float bw2 = w2 * invArea;
 
-    // Upload index data to a geometry buffer
-    // Returns pointer to index buffer for JS to write to, or nullptr on failure
-    EMSCRIPTEN_KEEPALIVE
-    uint32_t *geometry_buffer_alloc_indices(int32_t handle, int32_t indexCount)
-    {
-        int slot = handle - 1;
-        if (slot < 0 || slot >= MAX_GEOMETRY_BUFFERS)
-            return nullptr;
+                    float depthF = v0.depth * bw0 + v1.depth * bw1 + v2.depth * bw2;
+                    uint16_t depth = (uint16_t)((depthF + 1.0f) * 32767.5f);
 
-        GeometryBuffer *buf = g_geometry_buffers[slot];
-        if (!buf)
-            return nullptr;
+                    if (depth < rowDepth[x])
+                    {
+                        float cr = r0 * bw0 + r1 * bw1 + r2 * bw2;
+                        float cg = g0 * bw0 + g1 * bw1 + g2 * bw2;
+                        float cb = b0 * bw0 + b1 * bw1 + b2 * bw2;
 
-        // Reallocate if needed
-        if (buf->indexCapacity < indexCount)
+                        cr = fminf(255.0f, fmaxf(0.0f, cr));
+                        cg = fminf(255.0f, fmaxf(0.0f, cg));
+                        cb = fminf(255.0f, fmaxf(0.0f, cb));
+
+                        rowDepth[x] = depth;
+                        rowPixels[x] = 0xFF000000 | ((uint32_t)cb << 16) | ((uint32_t)cg << 8) | (uint32_t)cr;
+                        if (g_id_objects)
+                            id_buffer_write(yOffset + x);
+                    }
+                }
+                w0 += A12;
+                w1 += A20;
+                w2 += A01;
+            }
+        }
+        // =====================================================================
+        // TEXTURED SPANS: start values once per span (affine) or per
+        // TEXTURE_SUBDIVISION pixels (subdivided), then incremental adds
+        // =====================================================================
+        else if (useSpans)
         {
-            if (buf->indices)
-                free(buf->indices);
-            buf->indices = (uint32_t *)malloc(indexCount * sizeof(uint32_t));
-            if (!buf->indices)
+            // Covered pixels form one run per row: find [x, xEnd)
+            while (x <= maxX && !((w0 >= 0 && w1 >= 0 && w2 >= 0) || (w0 <= 0 && w1 <= 0 && w2 <= 0)))
             {
-                buf->indexCapacity = 0;
-                buf->indexCount = 0;
-                return nullptr;
+                x++;
+                w0 += A12;
+                w1 += A20;
+                w2 += A01;
+            }
+            float bw0 = w0 * invArea;
+            float bw1 = w1 * invArea;
+            float bw2 = w2 * invArea;
+            int32_t xEnd = x;
+            while (xEnd <= maxX && ((w0 >= 0 && w1 >= 0 && w2 >= 0) || (w0 <= 0 && w1 <= 0 && w2 <= 0)))
+            {
+                xEnd++;
+                w0 += A12;
+                w1 += A20;
+                w2 += A01;
             }
-            buf->indexCapacity = indexCount;
-        }
 
-        buf->indexCount = indexCount;
-        return buf->indices;
-    }
+            float depthF = v0.depth * bw0 + v1.depth * bw1 + v2.depth * bw2;
+            float litR = r0 * bw0 + r1 * bw1 + r2 * bw2;
+            float litG = g0 * bw0 + g1 * bw1 + g2 * bw2;
+            float litB = b0 * bw0 + b1 * bw1 + b2 * bw2;
+            float uNum = v0.u * bw0 + v1.u * bw1 + v2.u * bw2;
+            float vNum = v0.v * bw0 + v1.v * bw1 + v2.v * bw2;
+            float aDen = v0.affine * bw0 + v1.affine * bw1 + v2.affine * bw2;
+            float su = su0 * bw0 + su1 * bw1 + su2 * bw2;
+            float sv = sv0 * bw0 + sv1 * bw1 + sv2 * bw2;
+
+            while (x < xEnd)
+            {
+                int32_t len = xEnd - x;
+                float segU, segV, segDU, segDV; // Texel coords and steps (floats)
+                if (affineSpans)
+                {
+                    segU = su;
+                    segV = sv;
+                    segDU = stepSU;
+                    segDV = stepSV;
+                }
+                else
+                {
+                    // Corrected coordinates at both ends, linear in between
+                    len = len < TEXTURE_SUBDIVISION ? len : TEXTURE_SUBDIVISION;
+                    float aEnd = aDen + stepA * len;
+                    float tu0 = uNum / aDen, tv0 = vNum / aDen;
+                    float tu1 = (uNum + stepU * len) / aEnd, tv1 = (vNum + stepV * len) / aEnd;
+                    segU = tu0 * texWf;
+                    segV = (1.0f - tv0) * texHf;
+                    segDU = fminf(fmaxf((tu1 - tu0) * texWf / len, -32767.0f), 32767.0f);
+                    segDV = fminf(fmaxf((tv0 - tv1) * texHf / len, -32767.0f), 32767.0f);
+                    uNum += stepU * len;
+                    vNum += stepV * len;
+                    aDen = aEnd;
+                }
 
-    // Get geometry buffer info
-    EMSCRIPTEN_KEEPALIVE
-    int32_t geometry_buffer_get_vertex_count(int32_t handle)
-    {
-        int slot = handle - 1;
-        if (slot < 0 || slot >= MAX_GEOMETRY_BUFFERS)
-            return 0;
-        GeometryBuffer *buf = g_geometry_buffers[slot];
-        return buf ? buf->vertexCount : 0;
-    }
+                // 16.16 texel coordinates, start wrapped into the texture
+                uint32_t fu = (uint32_t)(int32_t)((segU - floorf(segU / texWf) * texWf) * 65536.0f);
+                uint32_t fv = (uint32_t)(int32_t)((segV - floorf(segV / texHf) * texHf) * 65536.0f);
+                uint32_t fdu = (uint32_t)(int32_t)(segDU * 65536.0f);
+                uint32_t fdv = (uint32_t)(int32_t)(segDV * 65536.0f);
 
-    EMSCRIPTEN_KEEPALIVE
-    int32_t geometry_buffer_get_index_count(int32_t handle)
-    {
-        int slot = handle - 1;
-        if (slot < 0 || slot >= MAX_GEOMETRY_BUFFERS)
-            return 0;
-        GeometryBuffer *buf = g_geometry_buffers[slot];
-        return buf ? buf->indexCount : 0;
-    }
+                for (int32_t end = x + len; x < end; x++)
+                {
+                    uint16_t depth = (uint16_t)((depthF + 1.0f) * 32767.5f);
+                    if (depth < rowDepth[x])
+                    {
+                        int32_t tx = wrap_texel((int32_t)fu >> 16, texW, maskU);
+                        int32_t ty = wrap_texel((int32_t)fv >> 16, texH, maskV);
+                        int32_t texOffset = (ty * texW + tx) * 4;
 
-    // Render a geometry buffer with current MVP/model matrices
-    EMSCRIPTEN_KEEPALIVE
-    void render_geometry_buffer(int32_t handle)
-    {
-        int slot = handle - 1;
-        if (slot < 0 || slot >= MAX_GEOMETRY_BUFFERS)
-            return;
+                        float cr = fminf(255.0f, fmaxf(0.0f, texData[texOffset] * litR / 255.0f));
+                        float cg = fminf(255.0f, fmaxf(0.0f, texData[texOffset + 1] * litG / 255.0f));
+                        float cb = fminf(255.0f, fmaxf(0.0f, texData[texOffset + 2] * litB / 255.0f));
 
-        GeometryBuffer *buf = g_geometry_buffers[slot];
-        if (!buf || !buf->vertices || !buf->indices)
-            return;
-        if (buf->vertexCount == 0 || buf->indexCount == 0)
-            return;
+                        rowDepth[x] = depth;
+                        rowPixels[x] = 0xFF000000 | ((uint32_t)cb << 16) | ((uint32_t)cg << 8) | (uint32_t)cr;
+                        if (g_id_objects)
+                            id_buffer_write(yOffset + x);
+                    }
+                    depthF += stepDepth;
+                    litR += stepR;
+                    litG += stepG;
+                    litB += stepB;
+                    fu += fdu;
+                    fv += fdv;
+                }
+                su += stepSU * len;
+                sv += stepSV * len;
+            }
+        }
+        // =====================================================================
+        // TEXTURED PATH: Scalar inner loop (texture sampling can't be SIMD)
+        // =====================================================================
+        else
+        {
+            for (; x <= maxX; x++)
+            {
+                if ((w0 >= 0 && w1 >= 0 && w2 >= 0) || (w0 <= 0 && w1 <= 0 && w2 <= 0))
+                {
+                    float bw0 = w0 * invArea;
+                    float bw1 = w1 * invArea;
+                    float bw2 = w2 * invArea;
 
-        int32_t numTriangles = buf->indexCount / 3;
+                    float depthF = v0.depth * bw0 + v1.depth * bw1 + v2.depth * bw2;
+                    uint16_t depth = (uint16_t)((depthF + 1.0f) * 32767.5f);
 
-        // Clear vertex cache for this render
-        __builtin_memset(g_vertex_processed, 0, buf->vertexCount);
+                    if (depth < rowDepth[x])
+                    {
+                        // Affine texture correction
+                        float uAffine = v0.u * bw0 + v1.u * bw1 + v2.u * bw2;
+                        float vAffine = v0.v * bw0 + v1.v * bw1 + v2.v * bw2;
+                        float affine = v0.affine * bw0 + v1.affine * bw1 + v2.affine * bw2;
 
-        for (int32_t t = 0; t < numTriangles; t++)
-        {
-            uint32_t i0 = buf->indices[t * 3];
-            uint32_t i1 = buf->indices[t * 3 + 1];
-            uint32_t i2 = buf->indices[t * 3 + 2];
+                        float tu = uAffine / affine;
+                        float tv = vAffine / affine;
+                        tu = tu - floorf(tu);
+                        tv = tv - floorf(tv);
 
-            // Copy vertex data to g_vertices for process_vertex to work
-            __builtin_memcpy(&g_vertices[i0 * 12], &buf->vertices[i0 * 12], 12 * sizeof(float));
-            __builtin_memcpy(&g_vertices[i1 * 12], &buf->vertices[i1 * 12], 12 * sizeof(float));
-            __builtin_memcpy(&g_vertices[i2 * 12], &buf->vertices[i2 * 12], 12 * sizeof(float));
+                        int32_t tx = (int32_t)(tu * texWf);
+                        int32_t ty = (int32_t)((1.0f - tv) * texHf);
+                        tx = ((tx % texW) + texW) % texW;
+                        ty = ((ty % texH) + texH) % texH;
 
-            // Get cached or compute vertices
-            ProcessedVertex v0 = get_processed_vertex(i0);
-            ProcessedVertex v1 = get_processed_vertex(i1);
-            ProcessedVertex v2 = get_processed_vertex(i2);
+                        int32_t texOffset = (ty * texW + tx) * 4;
+                        float texR = texData[texOffset];
+                        float texG = texData[texOffset + 1];
+                        float texB = texData[texOffset + 2];
 
-            // Near-plane clipping (PS1 style - reject if any vertex behind camera)
-            if (v0.depth < -1.0f || v1.depth < -1.0f || v2.depth < -1.0f)
-                continue;
-            if (v0.depth > 1.0f || v1.depth > 1.0f || v2.depth > 1.0f)
-                continue;
+                        float litR = r0 * bw0 + r1 * bw1 + r2 * bw2;
+                        float litG = g0 * bw0 + g1 * bw1 + g2 * bw2;
+                        float litB = b0 * bw0 + b1 * bw1 + b2 * bw2;
 
-            // Check if backfacing
-            Vec3 edge1 = v1.screen - v0.screen;
-            Vec3 edge2 = v2.screen - v0.screen;
-            float cross_z = edge1.x * edge2.y - edge1.y * edge2.x;
-            bool isBackfacing = cross_z >= 0;
+                        float cr = texR * litR / 255.0f;
+                        float cg = texG * litG / 255.0f;
+                        float cb = texB * litB / 255.0f;
 
-            // Lighting calculation
-            if (g_enable_lighting)
-            {
-                if (g_enable_smooth_shading)
-                {
-                    if (isBackfacing)
-                    {
-                        v0.normal = v0.normal * -1.0f;
-                        v1.normal = v1.normal * -1.0f;
-                        v2.normal = v2.normal * -1.0f;
+                        cr = fminf(255.0f, fmaxf(0.0f, cr));
+                        cg = fminf(255.0f, fmaxf(0.0f, cg));
+                        cb = fminf(255.0f, fmaxf(0.0f, cb));
+
+                        rowDepth[x] = depth;
+                        rowPixels[x] = 0xFF000000 | ((uint32_t)cb << 16) | ((uint32_t)cg << 8) | (uint32_t)cr;
+                        if (g_id_objects)
+                            id_buffer_write(yOffset + x);
                     }
-                    Vec3 lightDir(g_light_dir[0], g_light_dir[1], g_light_dir[2]);
-                    float ndotl0 = fmaxf(0.0f, -v0.normal.dot(lightDir));
-                    float ndotl1 = fmaxf(0.0f, -v1.normal.dot(lightDir));
-                    float ndotl2 = fmaxf(0.0f, -v2.normal.dot(lightDir));
-                    v0.light = fminf(1.0f, g_ambient_light + ndotl0 * g_light_color[3]);
-                    v1.light = fminf(1.0f, g_ambient_light + ndotl1 * g_light_color[3]);
-                    v2.light = fminf(1.0f, g_ambient_light + ndotl2 * g_light_color[3]);
-                }
-                else
-                {
-                    Vec3 worldEdge1 = v1.world - v0.world;
-                    Vec3 worldEdge2 = v2.world - v0.world;
-                    Vec3 faceNormal = worldEdge1.cross(worldEdge2).normalize();
-                    if (isBackfacing)
-                        faceNormal = faceNormal * -1.0f;
-                    Vec3 lightDir(g_light_dir[0], g_light_dir[1], g_light_dir[2]);
-                    float ndotl = fmaxf(0.0f, -faceNormal.dot(lightDir));
-                    float faceLight = fminf(1.0f, g_ambient_light + ndotl * g_light_color[3]);
-                    v0.light = faceLight;
-                    v1.light = faceLight;
-                    v2.light = faceLight;
                 }
+                w0 += A12;
+                w1 += A20;
+                w2 += A01;
             }
-
-            rasterize_triangle(v0, v1, v2);
         }
+
+        w0_row += B12;
+        w1_row += B20;
+        w2_row += B01;
     }
+}
 
-    // ========================================================================
-    // Texture Buffer API (OpenGL-style dynamic textures)
-    // ========================================================================
+// ============================================================================
+// Sprite Spans (SPRT-style axis-aligned rectangles)
+// ============================================================================
 
-    // Create a new texture buffer, returns handle (0 = failure)
-    EMSCRIPTEN_KEEPALIVE
-    int32_t create_texture_buffer()
+// Depth handling for rectangle fills
+constexpr int32_t SPRITE_DEPTH_TEST = 1;  // Only where nearer than g_depth
+constexpr int32_t SPRITE_DEPTH_WRITE = 2; // Store the sprite's depth
+constexpr int32_t SPRITE_ID_WRITE = 32;   // Tag pixels in the ID buffer (points and overlays skip it)
+
+// Fill pixels [x0, x1) x [y0, y1) (already clipped to the viewport) with one
+// color. Spans are written 4 pixels at a time; depth-tested spans compare 8
+// depths per step and blend the passing lanes in with bitselect.
+static void fill_rect_spans(int32_t x0, int32_t y0, int32_t x1, int32_t y1,
+                            uint32_t color, uint16_t depth, int32_t depthMode)
+{
+    v128_t color4 = wasm_i32x4_splat((int32_t)color);
+    v128_t depth8 = wasm_i16x8_splat((int16_t)depth);
+    bool test = (depthMode & SPRITE_DEPTH_TEST) != 0;
+    bool write = (depthMode & SPRITE_DEPTH_WRITE) != 0;
+    bool ids = g_id_objects && (depthMode & SPRITE_ID_WRITE) != 0;
+
+    for (int32_t y = y0; y < y1; y++)
     {
-        // Find an empty slot
-        int slot = -1;
-        for (int i = 0; i < MAX_TEXTURE_BUFFERS; i++)
+        int32_t yOffset = y * g_render_width;
+        uint32_t *rowPixels = &g_pixels[yOffset];
+        uint16_t *rowDepth = &g_depth[yOffset];
+        int32_t x = x0;
+
+        if (!test)
         {
-            if (g_texture_buffers[i] == nullptr)
+            for (; x + 4 <= x1; x += 4)
+                wasm_v128_store(&rowPixels[x], color4);
+            for (; x < x1; x++)
+                rowPixels[x] = color;
+            if (write)
             {
-                slot = i;
-                break;
+                for (x = x0; x + 8 <= x1; x += 8)
+                    wasm_v128_store(&rowDepth[x], depth8);
+                for (; x < x1; x++)
+                    rowDepth[x] = depth;
             }
+            if (ids)
+            {
+                for (x = x0; x < x1; x++)
+                    id_buffer_write(yOffset + x);
+            }
+            continue;
         }
-        if (slot < 0)
-            return 0; // No slots available
-
-        // Allocate buffer struct
-        TextureBuffer *buf = (TextureBuffer *)malloc(sizeof(TextureBuffer));
-        if (!buf)
-            return 0;
-
-        buf->data = nullptr;
-        buf->width = 0;
-        buf->height = 0;
-        buf->capacity = 0;
-
-        g_texture_buffers[slot] = buf;
 
-        // Return handle (slot + 1 so 0 is invalid)
-        return slot + 1;
+        for (; x + 8 <= x1; x += 8)
+        {
+            v128_t oldDepth = wasm_v128_load(&rowDepth[x]);
+            v128_t pass = wasm_u16x8_lt(depth8, oldDepth);
+            uint32_t bits = wasm_i16x8_bitmask(pass);
+            if (!bits)
+                continue;
+            if (bits == 0xFF)
+            {
+                wasm_v128_store(&rowPixels[x], color4);
+                wasm_v128_store(&rowPixels[x + 4], color4);
+            }
+            else
+            {
+                v128_t maskLo = wasm_i32x4_extend_low_i16x8(pass);
+                v128_t maskHi = wasm_i32x4_extend_high_i16x8(pass);
+                wasm_v128_store(&rowPixels[x], wasm_v128_bitselect(color4, wasm_v128_load(&rowPixels[x]), maskLo));
+                wasm_v128_store(&rowPixels[x + 4], wasm_v128_bitselect(color4, wasm_v128_load(&rowPixels[x + 4]), maskHi));
+            }
+            if (write)
+                wasm_v128_store(&rowDepth[x], wasm_v128_bitselect(depth8, oldDepth, pass));
+            if (ids)
+            {
+                id_buffer_write_mask(yOffset + x, bits & 15);
+                id_buffer_write_mask(yOffset + x + 4, bits >> 4);
+            }
+        }
+        for (; x < x1; x++)
+        {
+            if (depth >= rowDepth[x])
+                continue;
+            rowPixels[x] = color;
+            if (write)
+                rowDepth[x] = depth;
+            if (ids)
+                id_buffer_write(yOffset + x);
+        }
     }
+}
 
-    // Delete a texture buffer
-    EMSCRIPTEN_KEEPALIVE
-    void delete_texture_buffer(int32_t handle)
+// Textured sprite over pixels [x0, x1) x [y0, y1). Texel coordinates step in
+// 16.16 fixed point from (u, v) at pixel (x0, y0) by (du, dv) per pixel:
+// no per-pixel divide or interpolation. Texels with alpha < 128 are
+// transparent (cutout); colors modulate the texture (255 = unchanged).
+static void fill_textured_rect_spans(int32_t x0, int32_t y0, int32_t x1, int32_t y1,
+                                     const uint8_t *tex, int32_t texW, int32_t texH,
+                                     float u, float v, float du, float dv,
+                                     int32_t r, int32_t g, int32_t b, uint16_t depth, int32_t depthMode)
+{
+    int32_t maskU = (texW & (texW - 1)) == 0 ? texW - 1 : 0;
+    int32_t maskV = (texH & (texH - 1)) == 0 ? texH - 1 : 0;
+    int32_t fu0 = (int32_t)floorf(u * 65536.0f);
+    int32_t fv = (int32_t)floorf(v * 65536.0f);
+    int32_t fdu = (int32_t)(du * 65536.0f);
+    int32_t fdv = (int32_t)(dv * 65536.0f);
+    bool modulate = r != 255 || g != 255 || b != 255;
+    bool test = (depthMode & SPRITE_DEPTH_TEST) != 0;
+    bool write = (depthMode & SPRITE_DEPTH_WRITE) != 0;
+    bool ids = g_id_objects && (depthMode & SPRITE_ID_WRITE) != 0;
+
+    for (int32_t y = y0; y < y1; y++, fv += fdv)
     {
-        int slot = handle - 1;
-        if (slot < 0 || slot >= MAX_TEXTURE_BUFFERS)
-            return;
-
-        TextureBuffer *buf = g_texture_buffers[slot];
-        if (!buf)
-            return;
-
-        if (buf->data)
-            free(buf->data);
-        free(buf);
-
-        g_texture_buffers[slot] = nullptr;
-
-        // Clear active texture if it was pointing to this buffer
-        // (Can't check directly, just clear if any dynamic texture was active)
+        int32_t yOffset = y * g_render_width;
+        uint32_t *rowPixels = &g_pixels[yOffset];
+        uint16_t *rowDepth = &g_depth[yOffset];
+        const uint8_t *texRow = &tex[wrap_texel(fv >> 16, texH, maskV) * texW * 4];
+        int32_t fu = fu0;
+        for (int32_t x = x0; x < x1; x++, fu += fdu)
+        {
+            if (test && depth >= rowDepth[x])
+                continue;
+            const uint8_t *texel = &texRow[wrap_texel(fu >> 16, texW, maskU) * 4];
+            if (texel[3] < 128)
+                continue;
+            uint32_t cr = texel[0], cg = texel[1], cb = texel[2];
+            if (modulate)
+            {
+                cr = cr * r / 255;
+                cg = cg * g / 255;
+                cb = cb * b / 255;
+            }
+            rowPixels[x] = 0xFF000000 | (cb << 16) | (cg << 8) | cr;
+            if (write)
+                rowDepth[x] = depth;
+            if (ids)
+                id_buffer_write(yOffset + x);
+        }
     }
+}
 
-    // Allocate texture data, returns pointer for JS to write RGBA data
-    EMSCRIPTEN_KEEPALIVE
-    uint8_t *texture_buffer_alloc(int32_t handle, int32_t width, int32_t height)
-    {
-        int slot = handle - 1;
-        if (slot < 0 || slot >= MAX_TEXTURE_BUFFERS)
-            return nullptr;
+// ============================================================================
+// GTE Fixed-Point Vertex Pipeline
+// ============================================================================
+//
+// Optional integer projection in the style of the PS1 geometry engine
+// (g_enable_gte). Per draw, gte_begin_draw quantizes the MVP rows used for
+// x, y, w and depth to 1.3.12 and picks a power-of-two vertex scale so that
+// positions fit 16 bits. Per vertex (RTPS-like):
+//   MAC = R * V (i16x8 dot products) ; IR = (MAC >> 12) + TR
+//   1/SZ via the GTE's UNR table plus one refinement step
+//   SX, SY = (OF + IR * H / SZ) >> 16 as integers on the snapping grid
+// The result only depends on integer math, so it is identical on every
+// platform. SZ is kept at 32 bits (the GTE saturates it to 16) so distant
+// geometry still projects. Lighting and UVs still use the float path.
+
+struct GteState
+{
+    v128_t rowsXY;      // i16x8: x row (3 + pad), y row (3 + pad), 1.3.12
+    v128_t rowsWZ;      // i16x8: w row, depth row
+    v128_t translation; // i32x4: TR for x, y, w, depth (IR units)
+    v128_t vertexScale; // f32x4: 2^s, 2^s, 2^s, 0
+    int32_t halfX, halfY;          // H: half the grid size in each axis
+    float gridToScreenX, gridToScreenY; // Grid units -> render pixels
+    float invK;                    // IR units -> clip units
+};
 
-        TextureBuffer *buf = g_texture_buffers[slot];
-        if (!buf)
-            return nullptr;
+static GteState g_gte;
+static uint8_t g_gte_unr_table[257];
+static bool g_gte_unr_ready = false;
 
-        int32_t requiredSize = width * height * 4; // RGBA
+// 1/d for d > 0: returns r and sets shift so that r / 2^(32 - shift) ~ 1/d
+// (r is 17 bits, 0x10000..0x20000), using the GTE's UNR reciprocal steps on
+// d normalized to 16 bits.
+static inline uint32_t gte_reciprocal(uint32_t d, int32_t &shift)
+{
+    int32_t bits = 32 - __builtin_clz(d);
+    shift = 16 - bits;
+    uint32_t n = shift >= 0 ? d << shift : d >> -shift; // 0x8000..0xFFFF
+    uint32_t u = g_gte_unr_table[(n - 0x7FC0) >> 7] + 0x101;
+    uint32_t r = (0x2000080 - n * u) >> 8;
+    return (0x80 + r * u) >> 8;
+}
 
-        // Reallocate if needed
-        if (buf->capacity < requiredSize)
+// Quantize the MVP for a draw over count vertices (12 floats each)
+static void gte_begin_draw(const float *vertices, int32_t count)
+{
+    if (!g_gte_unr_ready)
+    {
+        for (int32_t i = 0; i < 257; i++)
         {
-            if (buf->data)
-                free(buf->data);
-            buf->data = (uint8_t *)malloc(requiredSize);
-            if (!buf->data)
-            {
-                buf->capacity = 0;
-                buf->width = 0;
-                buf->height = 0;
-                return nullptr;
-            }
-            buf->capacity = requiredSize;
+            int32_t t = (0x40000 / (i + 0x100) + 1) / 2 - 0x101;
+            g_gte_unr_table[i] = (uint8_t)(t > 0 ? t : 0);
         }
-
-        buf->width = width;
-        buf->height = height;
-        return buf->data;
+        g_gte_unr_ready = true;
     }
 
-    // Get texture buffer dimensions
-    EMSCRIPTEN_KEEPALIVE
-    int32_t texture_buffer_get_width(int32_t handle)
+    // Vertex scale: largest |coordinate| * 2^s stays below 2^14
+    v128_t xyzMask = wasm_i32x4_make(-1, -1, -1, 0);
+    v128_t maxAbs = wasm_f32x4_splat(0.0f);
+    for (int32_t i = 0; i < count; i++)
+        maxAbs = wasm_f32x4_max(maxAbs, wasm_v128_and(wasm_f32x4_abs(wasm_v128_load(&vertices[i * 12])), xyzMask));
+    float largest = fmaxf(fmaxf(wasm_f32x4_extract_lane(maxAbs, 0), wasm_f32x4_extract_lane(maxAbs, 1)),
+                          wasm_f32x4_extract_lane(maxAbs, 2));
+    int32_t exponent = 0;
+    frexpf(largest > 0.0f ? largest : 1.0f, &exponent); // largest < 2^exponent
+    int32_t vertexShift = 14 - exponent;
+    vertexShift = vertexShift < -16 ? -16 : (vertexShift > 24 ? 24 : vertexShift);
+    float vertexScale = ldexpf(1.0f, vertexShift);
+    g_gte.vertexScale = wasm_f32x4_make(vertexScale, vertexScale, vertexScale, 0.0f);
+
+    // Rows x, y, w, depth; R = P * 2^(14 - e) keeps |R| <= 2^14 (4.0 in 1.3.12)
+    const float *m = g_mvp_matrix;
+    const float *rows[4] = {&m[0], &m[4], &m[12], &m[8]};
+    float largestP = 0.0f;
+    for (int r = 0; r < 4; r++)
+        for (int c = 0; c < 3; c++)
+            largestP = fmaxf(largestP, fabsf(rows[r][c]));
+    int32_t rowExponent = 0;
+    frexpf(largestP > 0.0f ? largestP : 1.0f, &rowExponent);
+    float rowScale = ldexpf(1.0f, 14 - rowExponent);
+    float k = ldexpf(1.0f, 2 - rowExponent + vertexShift); // IR = k * clip
+    int16_t R[4][4];
+    int32_t TR[4];
+    for (int r = 0; r < 4; r++)
     {
-        int slot = handle - 1;
-        if (slot < 0 || slot >= MAX_TEXTURE_BUFFERS)
-            return 0;
-        TextureBuffer *buf = g_texture_buffers[slot];
-        return buf ? buf->width : 0;
+        for (int c = 0; c < 3; c++)
+            R[r][c] = (int16_t)lrintf(rows[r][c] * rowScale);
+        R[r][3] = 0;
+        float t = rows[r][3] * k;
+        TR[r] = t >= 2147483520.0f ? INT32_MAX : (t <= -2147483520.0f ? INT32_MIN : (int32_t)lrintf(t));
     }
+    g_gte.rowsXY = wasm_i16x8_make(R[0][0], R[0][1], R[0][2], 0, R[1][0], R[1][1], R[1][2], 0);
+    g_gte.rowsWZ = wasm_i16x8_make(R[2][0], R[2][1], R[2][2], 0, R[3][0], R[3][1], R[3][2], 0);
+    g_gte.translation = wasm_i32x4_make(TR[0], TR[1], TR[2], TR[3]);
+    g_gte.invK = 1.0f / k;
+
+    // Same grid as float snapping (2 * snap resolution cells across the
+    // screen), or whole render pixels without snapping
+    g_gte.halfX = g_enable_vertex_snapping ? (int32_t)g_snap_resolution_x : g_render_width / 2;
+    g_gte.halfY = g_enable_vertex_snapping ? (int32_t)g_snap_resolution_y : g_render_height / 2;
+    g_gte.halfX = g_gte.halfX > 0 ? g_gte.halfX : 1;
+    g_gte.halfY = g_gte.halfY > 0 ? g_gte.halfY : 1;
+    g_gte.gridToScreenX = (float)g_render_width / (float)(2 * g_gte.halfX);
+    g_gte.gridToScreenY = (float)g_render_height / (float)(2 * g_gte.halfY);
+}
 
-    EMSCRIPTEN_KEEPALIVE
-    int32_t texture_buffer_get_height(int32_t handle)
+// Integer projection of one vertex (after gte_begin_draw)
+static ProcessedVertex process_vertex_gte(const float *v)
+{
+    ProcessedVertex pv;
+
+    // V: 16-bit (x, y, z, 0) twice, for two rows per dot product
+    v128_t q = wasm_i32x4_trunc_sat_f32x4(wasm_f32x4_nearest(wasm_f32x4_mul(wasm_v128_load(v), g_gte.vertexScale)));
+    v128_t v16 = wasm_i16x8_narrow_i32x4(q, q);
+    v128_t dotXY = wasm_i32x4_dot_i16x8(v16, g_gte.rowsXY);
+    v128_t dotWZ = wasm_i32x4_dot_i16x8(v16, g_gte.rowsWZ);
+    dotXY = wasm_i32x4_add(dotXY, wasm_i32x4_shuffle(dotXY, dotXY, 1, 0, 3, 2));
+    dotWZ = wasm_i32x4_add(dotWZ, wasm_i32x4_shuffle(dotWZ, dotWZ, 1, 0, 3, 2));
+    v128_t mac = wasm_i32x4_shuffle(dotXY, dotWZ, 0, 2, 4, 6);
+    v128_t ir = wasm_i32x4_add(wasm_i32x4_shr(mac, 12), g_gte.translation);
+
+    int32_t irX = wasm_i32x4_extract_lane(ir, 0);
+    int32_t irY = wasm_i32x4_extract_lane(ir, 1);
+    int32_t sz = wasm_i32x4_extract_lane(ir, 2);
+    int32_t irZ = wasm_i32x4_extract_lane(ir, 3);
+
+    if (sz <= 0)
     {
-        int slot = handle - 1;
-        if (slot < 0 || slot >= MAX_TEXTURE_BUFFERS)
-            return 0;
-        TextureBuffer *buf = g_texture_buffers[slot];
-        return buf ? buf->height : 0;
+        // Behind the eye: outside the depth range, so the triangle is dropped
+        pv.screen = Vec3(0.0f, 0.0f, -2.0f);
+        pv.depth = -2.0f;
+        shade_processed_vertex(pv, v, 0.0f);
+        return pv;
     }
 
-    // Bind a texture buffer as the active texture for rendering
-    EMSCRIPTEN_KEEPALIVE
-    void bind_texture_buffer(int32_t handle)
-    {
-        if (handle == 0)
-        {
-            // Unbind - clear active texture, fall back to fixed slots
-            g_active_texture_data = nullptr;
-            g_active_texture_width = 0;
-            g_active_texture_height = 0;
-            return;
-        }
+    // IR / SZ in 16.16, then the grid position
+    int32_t shift;
+    int64_t recip = gte_reciprocal((uint32_t)sz, shift);
+    int32_t down = 16 - shift;
+    int64_t ratioX = ((int64_t)irX * recip) >> down;
+    int64_t ratioY = ((int64_t)irY * recip) >> down;
+    int64_t ratioZ = ((int64_t)irZ * recip) >> down;
+    int64_t sx = g_gte.halfX + ((ratioX * g_gte.halfX) >> 16);
+    int64_t sy = g_gte.halfY - ((ratioY * g_gte.halfY) >> 16);
+    sx = sx < -32768 ? -32768 : (sx > 32767 ? 32767 : sx);
+    sy = sy < -32768 ? -32768 : (sy > 32767 ? 32767 : sy);
+
+    float depth = (float)ratioZ * (1.0f / 65536.0f);
+    pv.screen = Vec3((float)sx * g_gte.gridToScreenX, (float)sy * g_gte.gridToScreenY, depth);
+    pv.depth = depth;
+    shade_processed_vertex(pv, v, (float)sz * g_gte.invK);
+    return pv;
+}
 
-        int slot = handle - 1;
-        if (slot < 0 || slot >= MAX_TEXTURE_BUFFERS)
-            return;
+// ============================================================================
+// Exported API
+// ============================================================================
 
-        TextureBuffer *buf = g_texture_buffers[slot];
-        if (!buf || !buf->data)
-            return;
+extern "C"
+{
 
-        g_active_texture_data = buf->data;
-        g_active_texture_width = buf->width;
-        g_active_texture_height = buf->height;
+    // Set render resolution (must be called before rendering)
+    EMSCRIPTEN_KEEPALIVE
+    void set_render_resolution(int32_t width, int32_t height)
+    {
+        // Clamp to max supported resolution
+        if (width > MAX_RENDER_WIDTH)
+            width = MAX_RENDER_WIDTH;
+        if (height > MAX_RENDER_HEIGHT)
+            height = MAX_RENDER_HEIGHT;
+        if (width < 1)
+            width = 1;
+        if (height < 1)
+            height = 1;
+
+        g_render_width = width;
+        g_render_height = height;
+        g_pixel_count = width * height;
     }
 
-    // Render a point (square) at screen coordinates with given color
-    // Points are always rendered on top (depth = 0)
+    // Get current render width
     EMSCRIPTEN_KEEPALIVE
-    void render_point(float screenX, float screenY, uint32_t color, int32_t pointSize)
+    int32_t get_render_width()
     {
-        int cx = (int)screenX;
-        int cy = (int)screenY;
-        int halfSize = pointSize / 2;
+        return g_render_width;
+    }
+
+    // Get current render height
+    EMSCRIPTEN_KEEPALIVE
+    int32_t get_render_height()
+    {
+        return g_render_height;
+    }
+
+    // Get current pixel count
+    EMSCRIPTEN_KEEPALIVE
+    int32_t get_pixel_count()
+    {
+        return g_pixel_count;
+    }
+
+    // Clear framebuffer and depth buffer using bulk memory operations
+    EMSCRIPTEN_KEEPALIVE
+    void clear(uint8_t r, uint8_t g, uint8_t b)
+    {
+        // Use alpha=0 for background so shader can distinguish from geometry
+        uint32_t color = 0x00000000 | ((uint32_t)b << 16) | ((uint32_t)g << 8) | r;
+        int32_t pixel_count = g_pixel_count;
 
-        for (int py = -halfSize; py <= halfSize; py++)
+        // Fast depth buffer clear with bulk memory (all 0xFFFF)
+        // Using memset with 0xFF fills each byte, giving us 0xFFFF for 16-bit depth
+        __builtin_memset(g_depth, 0xFF, pixel_count * sizeof(uint16_t));
+        if (g_id_objects)
         {
-            for (int px = -halfSize; px <= halfSize; px++)
-            {
-                int sx = cx + px;
-                int sy = cy + py;
-                if (sx >= 0 && sx < g_render_width && sy >= 0 && sy < g_render_height)
-                {
-                    int idx = sy * g_render_width + sx;
-                    g_pixels[idx] = color;
-                    g_depth[idx] = 0; // Always on top
-                }
-            }
+            __builtin_memset(g_id_objects, 0, pixel_count * sizeof(uint32_t));
+            __builtin_memset(g_id_faces, 0, pixel_count * sizeof(uint32_t));
+        }
+
+        // For pixel buffer, we need to set each pixel to the same color
+        // SIMD is still faster than memset for 32-bit pattern fills
+        v128_t simd_color = wasm_i32x4_splat(color);
+        uint32_t *pixels = g_pixels;
+
+        // Unrolled SIMD loop (16 pixels = 64 bytes at a time)
+        int32_t i = 0;
+        int32_t simd_end = pixel_count - 15;
+        for (; i < simd_end; i += 16)
+        {
+            wasm_v128_store(pixels + i, simd_color);
+            wasm_v128_store(pixels + i + 4, simd_color);
+            wasm_v128_store(pixels + i + 8, simd_color);
+            wasm_v128_store(pixels + i + 12, simd_color);
+        }
+        // Handle remaining pixels
+        for (; i < pixel_count; i++)
+        {
+            pixels[i] = color;
         }
     }
 
-    // Render multiple points from vertex data
-    // vertexData format: [x, y, z, r, g, b, ...] (6 floats per vertex, xyz in world space)
-    // The function transforms vertices through MVP internally
-    EMSCRIPTEN_KEEPALIVE
-    void render_points_batch(
-        float *vertexData,
-        int32_t *indices,
-        int32_t indexCount,
-        float *mvpMatrix,
-        int32_t pointSize)
+    // Vertex cache for processed vertices (avoids redundant MVP transforms)
+    // Starts with static storage for MAX_VERTICES; geometry buffers larger than
+    // that grow it on the heap.
+    alignas(16) static ProcessedVertex g_vertex_cache_static[MAX_VERTICES];
+    alignas(16) static uint8_t g_vertex_processed_static[MAX_VERTICES];
+    static ProcessedVertex *g_vertex_cache = g_vertex_cache_static;
+    static uint8_t *g_vertex_processed = g_vertex_processed_static; // 0 = not processed, 1 = processed
+    static int32_t g_vertex_cache_capacity = MAX_VERTICES;
+
+    // Vertex data read by get_processed_vertex (g_vertices or a geometry buffer)
+    static const float *g_vertex_source = g_vertices;
+
+    // Make sure the vertex cache can hold count vertices
+    static bool ensure_vertex_cache(int32_t count)
     {
-        int halfSize = pointSize / 2;
+        if (count <= g_vertex_cache_capacity)
+            return true;
 
-        for (int i = 0; i < indexCount; i++)
+        ProcessedVertex *cache = (ProcessedVertex *)malloc((size_t)count * sizeof(ProcessedVertex));
+        uint8_t *processed = (uint8_t *)malloc((size_t)count);
+        if (!cache || !processed)
         {
-            int idx = indices[i];
-            float *v = &vertexData[idx * 6];
+            if (cache)
+                free(cache);
+            if (processed)
+                free(processed);
+            return false;
+        }
 
-            // Get world position
-            Vec4 worldPos = {v[0], v[1], v[2], 1.0f};
+        if (g_vertex_cache != g_vertex_cache_static)
+        {
+            free(g_vertex_cache);
+            free(g_vertex_processed);
+        }
+        g_vertex_cache = cache;
+        g_vertex_processed = processed;
+        g_vertex_cache_capacity = count;
+        return true;
+    }
 
-            // Transform through MVP (mvpMatrix is a float*)
-            Vec4 clip = mat4_mul_vec4(mvpMatrix, worldPos);
+    // Get or compute processed vertex (with caching)
+    static inline ProcessedVertex &get_processed_vertex(uint32_t idx)
+    {
+        if (!g_vertex_processed[idx])
+        {
+            g_vertex_cache[idx] = g_enable_gte ? process_vertex_gte(&g_vertex_source[idx * 12])
+                                               : process_vertex(&g_vertex_source[idx * 12]);
+            if (g_vertex_lighting)
+                light_processed_vertex(g_vertex_cache[idx]);
+            g_vertex_processed[idx] = 1;
+        }
+        return g_vertex_cache[idx];
+    }
 
-            // Skip if behind camera
-            if (clip.w < 0.1f)
-                continue;
+    // Render all triangles
+    EMSCRIPTEN_KEEPALIVE
+    void render_triangles()
+    {
+        int32_t numTriangles = g_index_count / 3;
 
-            // Perspective divide
-            Vec3 ndc = {clip.x / clip.w, clip.y / clip.w, clip.z / clip.w};
+        // Clear vertex cache flags with bulk memory operation
+        g_vertex_source = g_vertices;
+        __builtin_memset(g_vertex_processed, 0, g_vertex_count);
+        if (g_enable_gte)
+            gte_begin_draw(g_vertices, g_vertex_count);
 
-            // Skip if outside NDC bounds
-            if (ndc.x < -1.0f || ndc.x > 1.0f || ndc.y < -1.0f || ndc.y > 1.0f)
-                continue;
+        // Lights reaching this draw (point lights culled by its bounds)
+        if (g_enable_lighting)
+        {
+            float sphere[4];
+            if (g_light_count > 0)
+                vertex_bounding_sphere(g_vertices, g_vertex_count, sphere);
+            gather_draw_lights(g_light_count > 0 ? sphere : nullptr);
+            g_vertex_lighting = g_enable_smooth_shading != 0;
+        }
 
-            // Viewport transform
-            int screenX = (int)((ndc.x + 1.0f) * 0.5f * g_render_width);
-            int screenY = (int)((1.0f - ndc.y) * 0.5f * g_render_height);
+        for (int32_t t = 0; t < numTriangles; t++)
+        {
+            uint32_t i0 = g_indices[t * 3];
+            uint32_t i1 = g_indices[t * 3 + 1];
+            uint32_t i2 = g_indices[t * 3 + 2];
 
-            // Compute depth value (16-bit, PS1 style)
-            // NDC z is in [-1, 1], map to [0, 65535]
-            uint16_t depthVal = (uint16_t)((ndc.z + 1.0f) * 0.5f * 65534.0f);
-            // Apply small bias to render dots slightly in front of geometry
-            // Use small bias (1) to avoid z-fighting but not jump over other geometry
-            depthVal = depthVal > 1 ? depthVal - 1 : 0;
+            // Get cached or compute vertices
+            ProcessedVertex v0 = get_processed_vertex(i0);
+            ProcessedVertex v1 = get_processed_vertex(i1);
+            ProcessedVertex v2 = get_processed_vertex(i2);
 
-            // Get color (RGB floats 0-255)
-            uint8_t r = (uint8_t)v[3];
-            uint8_t g = (uint8_t)v[4];
-            uint8_t b = (uint8_t)v[5];
-            uint32_t color = 0xFF000000 | ((uint32_t)b << 16) | ((uint32_t)g << 8) | r;
+            // Near-plane clipping (PS1 style - reject if any vertex behind camera)
+            if (v0.depth < -1.0f || v1.depth < -1.0f || v2.depth < -1.0f)
+                continue;
+            if (v0.depth > 1.0f || v1.depth > 1.0f || v2.depth > 1.0f)
+                continue;
+
+            // Check if backfacing
+            Vec3 edge1 = v1.screen - v0.screen;
+            Vec3 edge2 = v2.screen - v0.screen;
+            float cross_z = edge1.x * edge2.y - edge1.y * edge2.x;
+            bool isBackfacing = cross_z >= 0;
 
-            // Draw point with depth testing
-            for (int py = -halfSize; py <= halfSize; py++)
+            // Lighting calculation
+            if (g_enable_lighting)
             {
-                for (int px = -halfSize; px <= halfSize; px++)
+                if (g_enable_smooth_shading)
                 {
-                    int sx = screenX + px;
-                    int sy = screenY + py;
-                    if (sx >= 0 && sx < g_render_width && sy >= 0 && sy < g_render_height)
+                    // Smooth (Gouraud) shading: lit in the vertex stage for
+                    // both sides; backfaces use the back (double-sided)
+                    int side = isBackfacing ? 3 : 0;
+                    apply_light_color(v0, &v0.lit[side]);
+                    apply_light_color(v1, &v1.lit[side]);
+                    apply_light_color(v2, &v2.lit[side]);
+                }
+                else
+                {
+                    // Flat shading: compute face normal from world positions
+                    Vec3 worldEdge1 = v1.world - v0.world;
+                    Vec3 worldEdge2 = v2.world - v0.world;
+                    Vec3 faceNormal = worldEdge1.cross(worldEdge2).normalize();
+
+                    // Flip normal for backfaces (double-sided rendering)
+                    if (isBackfacing)
                     {
-                        int pidx = sy * g_render_width + sx;
-                        // Depth test: only render if point is in front
-                        if (depthVal < g_depth[pidx])
-                        {
-                            g_pixels[pidx] = color;
-                            g_depth[pidx] = depthVal;
-                        }
+                        faceNormal = faceNormal * -1.0f;
                     }
+
+                    // Light the whole face once, at its centroid
+                    float faceLight[3];
+                    Vec3 centroid = (v0.world + v1.world + v2.world) * (1.0f / 3.0f);
+                    evaluate_draw_lights(centroid, faceNormal, faceLight, nullptr);
+                    apply_light_color(v0, faceLight);
+                    apply_light_color(v1, faceLight);
+                    apply_light_color(v2, faceLight);
                 }
             }
+
+            // Rasterize
+            g_id_current_face = (uint32_t)t;
+            rasterize_triangle(v0, v1, v2);
         }
+        g_vertex_lighting = false;
     }
 
-    // Memory allocation helper for larger buffers
+    // Draw a single line (for wireframe/overlays)
     EMSCRIPTEN_KEEPALIVE
-    void *allocate(int32_t size)
+    void draw_line(float x0, float y0, float x1, float y1,
+                   uint8_t r, uint8_t g, uint8_t b, uint16_t depth_value)
     {
-        // Simple bump allocator (WASM memory grows as needed)
-        static uint8_t *heap_ptr = nullptr;
-        if (!heap_ptr)
+        uint32_t color = 0xFF000000 | ((uint32_t)b << 16) | ((uint32_t)g << 8) | r;
+
+        int32_t ix0 = (int32_t)x0;
+        int32_t iy0 = (int32_t)y0;
+        int32_t ix1 = (int32_t)x1;
+        int32_t iy1 = (int32_t)y1;
+
+        int32_t dx = ix1 > ix0 ? ix1 - ix0 : ix0 - ix1;
+        int32_t dy = iy1 > iy0 ? iy0 - iy1 : iy1 - iy0;
+        int32_t sx = ix0 < ix1 ? 1 : -1;
+        int32_t sy = iy0 < iy1 ? 1 : -1;
+        int32_t err = dx + dy;
+
+        while (true)
         {
-            // Start after static allocations
-            heap_ptr = (uint8_t *)(((uintptr_t)&g_texture_sizes + sizeof(g_texture_sizes) + 15) & ~15);
+            if (ix0 >= 0 && ix0 < g_render_width && iy0 >= 0 && iy0 < g_render_height)
+            {
+                int32_t idx = iy0 * g_render_width + ix0;
+                if (depth_value <= g_depth[idx])
+                {
+                    g_pixels[idx] = color;
+                    g_depth[idx] = depth_value;
+                }
+            }
+
+            if (ix0 == ix1 && iy0 == iy1)
+                break;
+
+            int32_t e2 = 2 * err;
+            if (e2 >= dy)
+            {
+                err += dy;
+                ix0 += sx;
+            }
+            if (e2 <= dx)
+            {
+                err += dx;
+                iy0 += sy;
+            }
         }
-        void *result = heap_ptr;
-        heap_ptr += (size + 15) & ~15; // Align to 16 bytes
-        return result;
     }
 
-    // ============================================================================
-    // Material Baking System
-    // ============================================================================
-
-    // Instruction types for compiled material graph
-    enum BakeOpcode : uint8_t
+    // Get pointer to pixel buffer (for JS to read)
+    EMSCRIPTEN_KEEPALIVE
+    uint32_t *get_pixels()
     {
-        BAKE_OP_FLAT_COLOR = 0,     // Push flat color (RGBA stored in data)
-        BAKE_OP_SAMPLE_TEXTURE = 1, // Sample texture at current UV
-        BAKE_OP_MIX_MULTIPLY = 2,   // Pop 2 colors, push result (multiply blend)
-        BAKE_OP_MIX_ADD = 3,        // Pop 2 colors, push result (additive blend)
-        BAKE_OP_MIX_LERP = 4,       // Pop 2 colors, push result (linear interp)
-        BAKE_OP_COLOR_RAMP = 5,     // Evaluate color ramp with factor
-        BAKE_OP_VORONOI = 6,        // Generate Voronoi texture (scale in data)
-        BAKE_OP_ALPHA_CUTOFF = 7,   // Binary alpha cutoff (threshold in data)
-        BAKE_OP_NOISE = 8,          // Procedural noise (scale, octaves, mode in data)
-        BAKE_OP_END = 255           // End of program
-    };
-
-    // Material baking buffers
-    constexpr int MAX_BAKE_SIZE = 512 * 512;
-    constexpr int MAX_BAKE_INSTRUCTIONS = 256;
-    constexpr int MAX_COLOR_RAMP_STOPS = 16;
+        return g_pixels;
+    }
 
-    alignas(16) uint8_t g_bake_output[MAX_BAKE_SIZE * 4];           // Output RGBA texture
-    alignas(16) uint8_t g_bake_program[MAX_BAKE_INSTRUCTIONS * 16]; // Compiled instructions
-    int32_t g_bake_width = 256;
-    int32_t g_bake_height = 256;
-    int32_t g_bake_source_texture = -1; // Source texture slot for sampling
+    // Get pointer to depth buffer
+    EMSCRIPTEN_KEEPALIVE
+    uint16_t *get_depth()
+    {
+        return g_depth;
+    }
 
-    // Color ramp data (position as 0-255, then RGBA)
-    alignas(16) uint8_t g_color_ramp_data[MAX_COLOR_RAMP_STOPS * 5]; // [pos, r, g, b, a] per stop
-    int32_t g_color_ramp_count = 0;
+    // Get pointer to vertex buffer (for JS to write)
+    EMSCRIPTEN_KEEPALIVE
+    float *get_vertices()
+    {
+        return g_vertices;
+    }
 
-    // Get pointers for JS to write to
+    // Get pointer to index buffer
     EMSCRIPTEN_KEEPALIVE
-    uint8_t *get_bake_output_ptr() { return g_bake_output; }
+    uint32_t *get_indices()
+    {
+        return g_indices;
+    }
 
+    // Get pointer to MVP matrix
     EMSCRIPTEN_KEEPALIVE
-    uint8_t *get_bake_program_ptr() { return g_bake_program; }
+    float *get_mvp_matrix()
+    {
+        return g_mvp_matrix;
+    }
 
+    // Get pointer to model matrix
     EMSCRIPTEN_KEEPALIVE
-    uint8_t *get_color_ramp_ptr() { return g_color_ramp_data; }
+    float *get_model_matrix()
+    {
+        return g_model_matrix;
+    }
 
+    // Get pointer to texture data for a specific slot
     EMSCRIPTEN_KEEPALIVE
-    void set_bake_params(int32_t width, int32_t height, int32_t sourceTexture)
+    uint8_t *get_texture(int32_t slot)
     {
-        g_bake_width = width;
-        g_bake_height = height;
-        g_bake_source_texture = sourceTexture;
+        if (slot < 0 || slot >= MAX_TEXTURES)
+            return nullptr;
+        return g_textures[slot];
     }
 
+    // Get pointer to texture sizes array
     EMSCRIPTEN_KEEPALIVE
-    void set_color_ramp_count(int32_t count)
+    int32_t *get_texture_sizes()
     {
-        g_color_ramp_count = count > MAX_COLOR_RAMP_STOPS ? MAX_COLOR_RAMP_STOPS : count;
+        return g_texture_sizes;
     }
 
-    // Evaluate color ramp at position (0-255)
-    static inline void eval_color_ramp(int32_t pos, uint8_t &r, uint8_t &g, uint8_t &b, uint8_t &a)
+    // Set texture for slot
+    EMSCRIPTEN_KEEPALIVE
+    void set_texture_size(int32_t slot, int32_t width, int32_t height)
     {
-        if (g_color_ramp_count == 0)
-        {
-            r = g = b = 0;
-            a = 255;
+        if (slot < 0 || slot >= MAX_TEXTURES)
             return;
-        }
+        g_texture_sizes[slot * 2] = width;
+        g_texture_sizes[slot * 2 + 1] = height;
+    }
 
-        // Find surrounding stops
-        int lowIdx = 0;
-        int highIdx = g_color_ramp_count - 1;
+    // Set active texture
+    EMSCRIPTEN_KEEPALIVE
+    void set_current_texture(int32_t slot)
+    {
+        g_current_texture = slot;
+    }
 
-        for (int i = 0; i < g_color_ramp_count - 1; i++)
+    // Set light direction
+    EMSCRIPTEN_KEEPALIVE
+    void set_light_direction(float x, float y, float z)
+    {
+        float len = sqrtf(x * x + y * y + z * z);
+        if (len > 0.0001f)
         {
-            int stopPos = g_color_ramp_data[i * 5];
-            int nextPos = g_color_ramp_data[(i + 1) * 5];
-            if (pos >= stopPos && pos <= nextPos)
-            {
-                lowIdx = i;
-                highIdx = i + 1;
-                break;
-            }
+            if (x / len != g_light_dir[0] || y / len != g_light_dir[1] || z / len != g_light_dir[2])
+                g_lighting_version++;
+            g_light_dir[0] = x / len;
+            g_light_dir[1] = y / len;
+            g_light_dir[2] = z / len;
         }
+    }
 
-        uint8_t *low = &g_color_ramp_data[lowIdx * 5];
-        uint8_t *high = &g_color_ramp_data[highIdx * 5];
-
-        int lowPos = low[0];
-        int highPos = high[0];
+    // Set light color and intensity
+    EMSCRIPTEN_KEEPALIVE
+    void set_light_color(float r, float g, float b, float intensity)
+    {
+        if (r != g_light_color[0] || g != g_light_color[1] || b != g_light_color[2] || intensity != g_light_color[3])
+            g_lighting_version++;
+        g_light_color[0] = r;
+        g_light_color[1] = g;
+        g_light_color[2] = b;
+        g_light_color[3] = intensity;
+    }
 
-        if (pos <= lowPos)
-        {
-            r = low[1];
-            g = low[2];
-            b = low[3];
-            a = low[4];
-            return;
-        }
-        if (pos >= highPos)
-        {
-            r = high[1];
-            g = high[2];
-            b = high[3];
-            a = high[4];
-            return;
-        }
+    // Set counts
+    EMSCRIPTEN_KEEPALIVE
+    void set_vertex_count(int32_t count)
+    {
+        g_vertex_count = count;
+    }
 
-        // Interpolate
-        int range = highPos - lowPos;
-        if (range <= 0)
-        {
-            r = low[1];
-            g = low[2];
-            b = low[3];
-            a = low[4];
-            return;
-        }
+    EMSCRIPTEN_KEEPALIVE
+    void set_index_count(int32_t count)
+    {
+        g_index_count = count;
+    }
 
-        int t = ((pos - lowPos) * 255) / range; // 0-255 interpolation factor
-        r = (low[1] * (255 - t) + high[1] * t) / 255;
-        g = (low[2] * (255 - t) + high[2] * t) / 255;
-        b = (low[3] * (255 - t) + high[3] * t) / 255;
-        a = (low[4] * (255 - t) + high[4] * t) / 255;
+    // Settings setters
+    EMSCRIPTEN_KEEPALIVE
+    void set_ambient_light(float ambient)
+    {
+        if (ambient != g_ambient_light)
+            g_lighting_version++;
+        g_ambient_light = ambient;
     }
 
-    // SIMD color ramp evaluation for 4 positions at once
-    // positions: 4 factor values (0-255), output: 4 RGBA values packed
-    static inline void eval_color_ramp_simd4(const int32_t pos[4],
-                                             uint8_t out_r[4], uint8_t out_g[4],
-                                             uint8_t out_b[4], uint8_t out_a[4])
+    EMSCRIPTEN_KEEPALIVE
+    void set_enable_lighting(int32_t enable)
     {
-        for (int i = 0; i < 4; i++)
-        {
-            eval_color_ramp(pos[i], out_r[i], out_g[i], out_b[i], out_a[i]);
-        }
+        g_enable_lighting = enable;
     }
 
-    // Execute bake program - SIMD optimized for 4 pixels at a time
     EMSCRIPTEN_KEEPALIVE
-    void bake_material()
+    void set_enable_dithering(int32_t enable)
     {
-        int width = g_bake_width;
-        int height = g_bake_height;
-        int texSlot = g_bake_source_texture;
+        g_enable_dithering = enable;
+    }
 
-        // Get source texture info if available
-        int srcWidth = 0, srcHeight = 0;
-        uint8_t *srcTex = nullptr;
-        if (texSlot >= 0 && texSlot < MAX_TEXTURES)
-        {
-            srcWidth = g_texture_sizes[texSlot * 2];
-            srcHeight = g_texture_sizes[texSlot * 2 + 1];
-            if (srcWidth > 0 && srcHeight > 0)
-            {
-                srcTex = g_textures[texSlot];
-            }
-        }
+    EMSCRIPTEN_KEEPALIVE
+    void set_enable_texturing(int32_t enable)
+    {
+        g_enable_texturing = enable;
+    }
 
-        // SIMD color stack for 4 pixels at a time
-        // Each stack entry holds 4 pixels worth of RGBA data
-        // Layout: r[4], g[4], b[4], a[4] as i32x4 vectors
-        constexpr int MAX_STACK = 8;
-        alignas(16) v128_t stack_r[MAX_STACK];
-        alignas(16) v128_t stack_g[MAX_STACK];
-        alignas(16) v128_t stack_b[MAX_STACK];
-        alignas(16) v128_t stack_a[MAX_STACK];
+    EMSCRIPTEN_KEEPALIVE
+    void set_enable_backface_culling(int32_t enable)
+    {
+        g_enable_backface_culling = enable;
+    }
 
-        const v128_t v_zero = wasm_i32x4_splat(0);
-        const v128_t v_255 = wasm_i32x4_splat(255);
-        const v128_t v_srcWidth = wasm_f32x4_splat((float)srcWidth);
-        const v128_t v_srcHeight = wasm_f32x4_splat((float)srcHeight);
-        const v128_t v_invWidth = wasm_f32x4_splat(1.0f / (float)width);
-        const v128_t v_invHeight = wasm_f32x4_splat(1.0f / (float)height);
-        const v128_t v_half = wasm_f32x4_splat(0.5f);
-        const v128_t v_one = wasm_f32x4_splat(1.0f);
-        const v128_t v_eight = wasm_f32x4_splat(8.0f);
+    EMSCRIPTEN_KEEPALIVE
+    void set_enable_vertex_snapping(int32_t enable)
+    {
+        g_enable_vertex_snapping = enable;
+    }
 
-        // Process pixels in groups of 4 (horizontally)
-        for (int y = 0; y < height; y++)
-        {
-            // V coordinate (1 at top, 0 at bottom - OpenGL convention)
-            float v = 1.0f - ((float)y + 0.5f) / (float)height;
-            v128_t v_v = wasm_f32x4_splat(v);
+    EMSCRIPTEN_KEEPALIVE
+    void set_snap_resolution(float x, float y)
+    {
+        g_snap_resolution_x = x;
+        g_snap_resolution_y = y;
+    }
 
-            for (int x = 0; x < width; x += 4)
+    EMSCRIPTEN_KEEPALIVE
+    void set_enable_smooth_shading(int32_t enable)
+    {
+        g_enable_smooth_shading = enable;
+    }
+
+    // Project vertices with the fixed-point GTE-style pipeline
+    EMSCRIPTEN_KEEPALIVE
+    void set_enable_gte(int32_t enable)
+    {
+        g_enable_gte = enable;
+    }
+
+    // Table lighting for geometry buffers: normals are quantized to 8- or
+    // 12-bit octahedral codes and lit by lookup (0 disables)
+    EMSCRIPTEN_KEEPALIVE
+    void set_lighting_lut(int32_t bits)
+    {
+        g_lighting_lut_bits = bits <= 0 ? 0 : (bits >= 12 ? 12 : 8);
+    }
+
+    // TEXTURE_MAPPING_PER_PIXEL, _AFFINE or _SUBDIVIDED
+    EMSCRIPTEN_KEEPALIVE
+    void set_texture_mapping(int32_t mode)
+    {
+        g_texture_mapping = mode >= TEXTURE_MAPPING_PER_PIXEL && mode <= TEXTURE_MAPPING_SUBDIVIDED
+                                ? mode
+                                : TEXTURE_MAPPING_PER_PIXEL;
+    }
+
+    // ========================================================================
+    // Geometry Buffer API (OpenGL-style dynamic buffers)
+    // ========================================================================
+
+    // Create a new geometry buffer, returns handle (0 = failure)
+    EMSCRIPTEN_KEEPALIVE
+    int32_t create_geometry_buffer()
+    {
+        // Find an empty slot
+        int slot = -1;
+        for (int i = 0; i < MAX_GEOMETRY_BUFFERS; i++)
+        {
+            if (g_geometry_buffers[i] == nullptr)
+            {
+                slot = i;
+                break;
+            }
+        }
+        if (slot < 0)
+            return 0; // No slots available
+
+        // Allocate buffer struct
+        GeometryBuffer *buf = (GeometryBuffer *)malloc(sizeof(GeometryBuffer));
+        if (!buf)
+            return 0;
+
+        buf->vertices = nullptr;
+        buf->indices = nullptr;
+        buf->vertexCount = 0;
+        buf->indexCount = 0;
+        buf->vertexCapacity = 0;
+        buf->indexCapacity = 0;
+
+        g_geometry_buffers[slot] = buf;
+
+        // Return handle (slot + 1 so 0 is invalid)
+        return slot + 1;
+    }
+
+    // Delete a geometry buffer
+    EMSCRIPTEN_KEEPALIVE
+    void delete_geometry_buffer(int32_t handle)
+    {
+        int slot = handle - 1;
+        if (slot < 0 || slot >= MAX_GEOMETRY_BUFFERS)
+            return;
+
+        GeometryBuffer *buf = g_geometry_buffers[slot];
+        if (!buf)
+            return;
+
+        if (buf->vertices)
+            free(buf->vertices);
+        if (buf->indices)
+            free(buf->indices);
+        free(buf);
+
+        g_geometry_buffers[slot] = nullptr;
+        invalidate_geometry_caches(handle);
+        free_skin_data(g_geometry_skins[slot]);
+        g_geometry_skins[slot] = nullptr;
+        free_morph_set(g_geometry_morphs[slot]);
+        g_geometry_morphs[slot] = nullptr;
+        free_lighting_bake(g_geometry_lighting[slot]);
+        g_geometry_lighting[slot] = nullptr;
+        free_face_materials(g_geometry_materials[slot]);
+        g_geometry_materials[slot] = nullptr;
+    }
+
+    // Upload vertex data to a geometry buffer
+    // Returns pointer to vertex buffer for JS to write to, or nullptr on failure
+    EMSCRIPTEN_KEEPALIVE
+    float *geometry_buffer_alloc_vertices(int32_t handle, int32_t vertexCount)
+    {
+        int slot = handle - 1;
+        if (slot < 0 || slot >= MAX_GEOMETRY_BUFFERS)
+            return nullptr;
+
+        GeometryBuffer *buf = g_geometry_buffers[slot];
+        if (!buf)
+            return nullptr;
+        invalidate_geometry_caches(handle); // JS is about to upload new data
+
+        // Reallocate if needed
+        int32_t requiredSize = vertexCount * 12; // 12 floats per vertex
+        if (buf->vertexCapacity < requiredSize)
+        {
+            if (buf->vertices)
+                free(buf->vertices);
+            buf->vertices = (float *)malloc(requiredSize * sizeof(float));
+            if (!buf->vertices)
+            {
+                buf->vertexCapacity = 0;
+                buf->vertexCount = 0;
+                return nullptr;
+            }
+            buf->vertexCapacity = requiredSize;
+        }
+
+        buf->vertexCount = vertexCount;
+        return buf->vertices;
+    }
+
+    // Upload index data to a geometry buffer
+    // Returns pointer to index buffer for JS to write to, or nullptr on failure
+    EMSCRIPTEN_KEEPALIVE
+    uint32_t *geometry_buffer_alloc_indices(int32_t handle, int32_t indexCount)
+    {
+        int slot = handle - 1;
+        if (slot < 0 || slot >= MAX_GEOMETRY_BUFFERS)
+            return nullptr;
+
+        GeometryBuffer *buf = g_geometry_buffers[slot];
+        if (!buf)
+            return nullptr;
+        invalidate_geometry_caches(handle); // JS is about to upload new data
+
+        // Reallocate if needed
+        if (buf->indexCapacity < indexCount)
+        {
+            if (buf->indices)
+                free(buf->indices);
+            buf->indices = (uint32_t *)malloc(indexCount * sizeof(uint32_t));
+            if (!buf->indices)
+            {
+                buf->indexCapacity = 0;
+                buf->indexCount = 0;
+                return nullptr;
+            }
+            buf->indexCapacity = indexCount;
+        }
+
+        buf->indexCount = indexCount;
+        return buf->indices;
+    }
+
+    // Get geometry buffer info
+    EMSCRIPTEN_KEEPALIVE
+    int32_t geometry_buffer_get_vertex_count(int32_t handle)
+    {
+        int slot = handle - 1;
+        if (slot < 0 || slot >= MAX_GEOMETRY_BUFFERS)
+            return 0;
+        GeometryBuffer *buf = g_geometry_buffers[slot];
+        return buf ? buf->vertexCount : 0;
+    }
+
+    EMSCRIPTEN_KEEPALIVE
+    int32_t geometry_buffer_get_index_count(int32_t handle)
+    {
+        int slot = handle - 1;
+        if (slot < 0 || slot >= MAX_GEOMETRY_BUFFERS)
+            return 0;
+        GeometryBuffer *buf = g_geometry_buffers[slot];
+        return buf ? buf->indexCount : 0;
+    }
+
+    // Draw a geometry buffer with current MVP/model matrices and material table
+    static void draw_geometry_buffer(int32_t handle)
+    {
+        int slot = handle - 1;
+        if (slot < 0 || slot >= MAX_GEOMETRY_BUFFERS)
+            return;
+
+        GeometryBuffer *buf = g_geometry_buffers[slot];
+        if (!buf || !buf->vertices || !buf->indices)
+            return;
+        if (buf->vertexCount == 0 || buf->indexCount == 0)
+            return;
+
+        // Distant meshes draw a simplified index list over the same vertices
+        int32_t level = select_geometry_lod(handle, buf);
+        const uint32_t *indices = level ? g_geometry_lods[slot]->indices[level] : buf->indices;
+        int32_t numTriangles = (level ? g_geometry_lods[slot]->indexCount[level] : buf->indexCount) / 3;
+        g_last_lod_level = level;
+
+        // Read vertices straight from the buffer (no copy into g_vertices);
+        // morph targets are applied to a persistent copy, then skinned
+        // buffers are posed into a scratch copy
+        if (!ensure_vertex_cache(buf->vertexCount))
+            return;
+        MorphSet *morph = active_geometry_morphs(slot, buf);
+        const float *vertices = morph ? morph_geometry_vertices(morph, buf) : buf->vertices;
+        const SkinData *skin = active_geometry_skin(slot, buf);
+        g_vertex_source = skin && vertices ? skin_geometry_vertices(vertices, skin, buf->vertexCount) : vertices;
+        if (!g_vertex_source)
+        {
+            g_vertex_source = g_vertices;
+            return;
+        }
+
+        // Lights reaching this buffer (posed draws are culled against their
+        // current vertices). Static buffers with baked lighting skip lighting
+        // entirely (flat bakes are per base triangle, so level 0 only).
+        const float *baked = nullptr;
+        if (g_enable_lighting)
+        {
+            float posedSphere[4];
+            const float *sphere = nullptr;
+            if (g_light_count > 0 && (skin || morph))
+            {
+                vertex_bounding_sphere(g_vertex_source, buf->vertexCount, posedSphere);
+                sphere = posedSphere;
+            }
+            else if (g_light_count > 0)
+            {
+                sphere = geometry_bounding_sphere(slot, buf);
+            }
+            gather_draw_lights(sphere);
+            if (!skin && !morph && (g_enable_smooth_shading || level == 0))
+                baked = current_lighting_bake(handle, buf);
+            g_vertex_lighting = g_enable_smooth_shading && !baked;
+        }
+
+        // Table lighting: directional light comes from the world-space LUT,
+        // indexed by each vertex's or face's encoded world normal. Flat faces
+        // use it only when no point light reaches the draw.
+        const float *faceLut = nullptr;
+        int32_t lutRes = octahedral_resolution(g_lighting_lut_bits);
+        if (g_enable_lighting && g_lighting_lut_bits && !baked)
+        {
+            if (g_enable_smooth_shading)
+            {
+                g_vertex_lut = current_light_lut(g_lighting_lut_bits);
+                g_vertex_lut_res = lutRes;
+            }
+            else if (g_draw_lights.pointGroup == g_draw_lights.groups)
+            {
+                faceLut = current_light_lut(g_lighting_lut_bits);
+            }
+        }
+
+        // Flat shading reuses the buffer's cached object-space face normals
+        // (base pose only, so not for skinned or morphed draws)
+        const float *faceNormals = nullptr;
+        float normalMatrix[9];
+        if (g_enable_lighting && !g_enable_smooth_shading && level == 0 && !skin && !morph && !baked)
+        {
+            NormalCache *normals = get_normal_cache(handle);
+            if (normals)
+            {
+                faceNormals = normals->faceNormals;
+                model_normal_matrix(g_model_matrix, normalMatrix);
+            }
+        }
+
+        // Per-face materials switch the texture per triangle (LOD levels
+        // derive ids from their corners); the draw's binding is restored after
+        FaceMaterials *materials = active_face_materials(slot, buf);
+        const uint8_t *vertexMaterials = materials && level ? face_material_vertex_ids(materials, buf) : nullptr;
+        if (level && !vertexMaterials)
+            materials = nullptr;
+        TextureBinding binding;
+        save_texture_binding(binding);
+        int32_t boundMaterial = -1, materialFlags = 0;
+
+        // Clear vertex cache for this render
+        __builtin_memset(g_vertex_processed, 0, buf->vertexCount);
+        if (g_enable_gte)
+            gte_begin_draw(g_vertex_source, buf->vertexCount);
+
+        for (int32_t t = 0; t < numTriangles; t++)
+        {
+            uint32_t i0 = indices[t * 3];
+            uint32_t i1 = indices[t * 3 + 1];
+            uint32_t i2 = indices[t * 3 + 2];
+
+            if (materials)
+            {
+                int32_t m = level ? lod_face_material(vertexMaterials, i0, i1, i2) : materials->ids[t];
+                if (m != boundMaterial)
+                {
+                    materialFlags = bind_face_material(m, binding);
+                    boundMaterial = m;
+                }
+                if (materialFlags & MATERIAL_HIDDEN)
+                    continue;
+            }
+
+            // Get cached or compute vertices
+            ProcessedVertex v0 = get_processed_vertex(i0);
+            ProcessedVertex v1 = get_processed_vertex(i1);
+            ProcessedVertex v2 = get_processed_vertex(i2);
+
+            // Near-plane clipping (PS1 style - reject if any vertex behind camera)
+            if (v0.depth < -1.0f || v1.depth < -1.0f || v2.depth < -1.0f)
+                continue;
+            if (v0.depth > 1.0f || v1.depth > 1.0f || v2.depth > 1.0f)
+                continue;
+
+            // Check if backfacing
+            Vec3 edge1 = v1.screen - v0.screen;
+            Vec3 edge2 = v2.screen - v0.screen;
+            float cross_z = edge1.x * edge2.y - edge1.y * edge2.x;
+            bool isBackfacing = cross_z >= 0;
+
+            // Lighting calculation (unlit materials keep their vertex colors)
+            bool unlit = (materialFlags & MATERIAL_UNLIT) != 0;
+            if (baked && !unlit)
+            {
+                int side = isBackfacing ? 3 : 0;
+                if (g_enable_smooth_shading)
+                {
+                    apply_light_color(v0, &baked[i0 * 6 + side]);
+                    apply_light_color(v1, &baked[i1 * 6 + side]);
+                    apply_light_color(v2, &baked[i2 * 6 + side]);
+                }
+                else
+                {
+                    const float *faceLight = &baked[t * 6 + side];
+                    apply_light_color(v0, faceLight);
+                    apply_light_color(v1, faceLight);
+                    apply_light_color(v2, faceLight);
+                }
+            }
+            else if (g_enable_lighting && !unlit)
+            {
+                if (g_enable_smooth_shading)
+                {
+                    int side = isBackfacing ? 3 : 0;
+                    apply_light_color(v0, &v0.lit[side]);
+                    apply_light_color(v1, &v1.lit[side]);
+                    apply_light_color(v2, &v2.lit[side]);
+                }
+                else
+                {
+                    Vec3 faceNormal;
+                    if (faceNormals)
+                    {
+                        const float *n = &faceNormals[t * 3];
+                        faceNormal = Vec3(normalMatrix[0] * n[0] + normalMatrix[1] * n[1] + normalMatrix[2] * n[2],
+                                          normalMatrix[3] * n[0] + normalMatrix[4] * n[1] + normalMatrix[5] * n[2],
+                                          normalMatrix[6] * n[0] + normalMatrix[7] * n[1] + normalMatrix[8] * n[2])
+                                         .normalize();
+                    }
+                    else
+                    {
+                        Vec3 worldEdge1 = v1.world - v0.world;
+                        Vec3 worldEdge2 = v2.world - v0.world;
+                        faceNormal = worldEdge1.cross(worldEdge2).normalize();
+                    }
+                    if (isBackfacing)
+                        faceNormal = faceNormal * -1.0f;
+                    float faceLight[3];
+                    if (faceLut)
+                    {
+                        uint16_t code = encode_octahedral(faceNormal.x, faceNormal.y, faceNormal.z, lutRes);
+                        memcpy(faceLight, &faceLut[code * 6], sizeof(faceLight));
+                        clamp_light(faceLight);
+                    }
+                    else
+                    {
+                        Vec3 centroid = (v0.world + v1.world + v2.world) * (1.0f / 3.0f);
+                        evaluate_draw_lights(centroid, faceNormal, faceLight, nullptr);
+                    }
+                    apply_light_color(v0, faceLight);
+                    apply_light_color(v1, faceLight);
+                    apply_light_color(v2, faceLight);
+                }
+            }
+
+            g_id_current_face = (uint32_t)t;
+            rasterize_triangle(v0, v1, v2);
+        }
+        if (materials)
+            restore_texture_binding(binding);
+        g_vertex_lighting = false;
+        g_vertex_lut = nullptr;
+    }
+
+    // Render a geometry buffer with current MVP/model matrices. The material
+    // table applies to this one draw: set_material_count is reset after it.
+    EMSCRIPTEN_KEEPALIVE
+    void render_geometry_buffer(int32_t handle)
+    {
+        draw_geometry_buffer(handle);
+        g_material_count = 0;
+    }
+
+    // ========================================================================
+    // Texture Buffer API (OpenGL-style dynamic textures)
+    // ========================================================================
+
+    // Create a new texture buffer, returns handle (0 = failure)
+    EMSCRIPTEN_KEEPALIVE
+    int32_t create_texture_buffer()
+    {
+        // Find an empty slot
+        int slot = -1;
+        for (int i = 0; i < MAX_TEXTURE_BUFFERS; i++)
+        {
+            if (g_texture_buffers[i] == nullptr)
+            {
+                slot = i;
+                break;
+            }
+        }
+        if (slot < 0)
+            return 0; // No slots available
+
+        // Allocate buffer struct
+        TextureBuffer *buf = (TextureBuffer *)malloc(sizeof(TextureBuffer));
+        if (!buf)
+            return 0;
+
+        buf->data = nullptr;
+        buf->width = 0;
+        buf->height = 0;
+        buf->capacity = 0;
+
+        g_texture_buffers[slot] = buf;
+
+        // Return handle (slot + 1 so 0 is invalid)
+        return slot + 1;
+    }
+
+    // Delete a texture buffer
+    EMSCRIPTEN_KEEPALIVE
+    void delete_texture_buffer(int32_t handle)
+    {
+        int slot = handle - 1;
+        if (slot < 0 || slot >= MAX_TEXTURE_BUFFERS)
+            return;
+
+        TextureBuffer *buf = g_texture_buffers[slot];
+        if (!buf)
+            return;
+
+        if (buf->data)
+            free(buf->data);
+        free(buf);
+
+        g_texture_buffers[slot] = nullptr;
+
+        // Clear active texture if it was pointing to this buffer
+        // (Can't check directly, just clear if any dynamic texture was active)
+    }
+
+    // Allocate texture data, returns pointer for JS to write RGBA data
+    EMSCRIPTEN_KEEPALIVE
+    uint8_t *texture_buffer_alloc(int32_t handle, int32_t width, int32_t height)
+    {
+        int slot = handle - 1;
+        if (slot < 0 || slot >= MAX_TEXTURE_BUFFERS)
+            return nullptr;
+
+        TextureBuffer *buf = g_texture_buffers[slot];
+        if (!buf)
+            return nullptr;
+
+        int32_t requiredSize = width * height * 4; // RGBA
+
+        // Reallocate if needed
+        if (buf->capacity < requiredSize)
+        {
+            if (buf->data)
+                free(buf->data);
+            buf->data = (uint8_t *)malloc(requiredSize);
+            if (!buf->data)
+            {
+                buf->capacity = 0;
+                buf->width = 0;
+                buf->height = 0;
+                return nullptr;
+            }
+            buf->capacity = requiredSize;
+        }
+
+        buf->width = width;
+        buf->height = height;
+        return buf->data;
+    }
+
+    // Get texture buffer dimensions
+    EMSCRIPTEN_KEEPALIVE
+    int32_t texture_buffer_get_width(int32_t handle)
+    {
+        int slot = handle - 1;
+        if (slot < 0 || slot >= MAX_TEXTURE_BUFFERS)
+            return 0;
+        TextureBuffer *buf = g_texture_buffers[slot];
+        return buf ? buf->width : 0;
+    }
+
+    EMSCRIPTEN_KEEPALIVE
+    int32_t texture_buffer_get_height(int32_t handle)
+    {
+        int slot = handle - 1;
+        if (slot < 0 || slot >= MAX_TEXTURE_BUFFERS)
+            return 0;
+        TextureBuffer *buf = g_texture_buffers[slot];
+        return buf ? buf->height : 0;
+    }
+
+    // Bind a texture buffer as the active texture for rendering
+    EMSCRIPTEN_KEEPALIVE
+    void bind_texture_buffer(int32_t handle)
+    {
+        if (handle == 0)
+        {
+            // Unbind - clear active texture, fall back to fixed slots
+            g_active_texture_data = nullptr;
+            g_active_texture_width = 0;
+            g_active_texture_height = 0;
+            return;
+        }
+
+        int slot = handle - 1;
+        if (slot < 0 || slot >= MAX_TEXTURE_BUFFERS)
+            return;
+
+        TextureBuffer *buf = g_texture_buffers[slot];
+        if (!buf || !buf->data)
+            return;
+
+        g_active_texture_data = buf->data;
+        g_active_texture_width = buf->width;
+        g_active_texture_height = buf->height;
+    }
+
+    // Render a point (square) at screen coordinates with given color
+    // Points are always rendered on top (depth = 0)
+    EMSCRIPTEN_KEEPALIVE
+    void render_point(float screenX, float screenY, uint32_t color, int32_t pointSize)
+    {
+        int cx = (int)screenX;
+        int cy = (int)screenY;
+        int halfSize = pointSize / 2;
+
+        // Clip the square once, then fill whole spans
+        int x0 = cx - halfSize > 0 ? cx - halfSize : 0;
+        int y0 = cy - halfSize > 0 ? cy - halfSize : 0;
+        int x1 = cx + halfSize + 1 < g_render_width ? cx + halfSize + 1 : g_render_width;
+        int y1 = cy + halfSize + 1 < g_render_height ? cy + halfSize + 1 : g_render_height;
+        if (x0 < x1 && y0 < y1)
+            fill_rect_spans(x0, y0, x1, y1, color, 0, SPRITE_DEPTH_WRITE); // Always on top
+    }
+
+    // Render multiple points from vertex data
+    // vertexData format: [x, y, z, r, g, b, ...] (6 floats per vertex, xyz in world space)
+    // The function transforms vertices through MVP internally
+    EMSCRIPTEN_KEEPALIVE
+    void render_points_batch(
+        float *vertexData,
+        int32_t *indices,
+        int32_t indexCount,
+        float *mvpMatrix,
+        int32_t pointSize)
+    {
+        int halfSize = pointSize / 2;
+
+        for (int i = 0; i < indexCount; i++)
+        {
+            int idx = indices[i];
+            float *v = &vertexData[idx * 6];
+
+            // Get world position
+            Vec4 worldPos = {v[0], v[1], v[2], 1.0f};
+
+            // Transform through MVP (mvpMatrix is a float*)
+            Vec4 clip = mat4_mul_vec4(mvpMatrix, worldPos);
+
+            // Skip if behind camera
+            if (clip.w < 0.1f)
+                continue;
+
+            // Perspective divide
+            Vec3 ndc = {clip.x / clip.w, clip.y / clip.w, clip.z / clip.w};
+
+            // Skip if outside NDC bounds
+            if (ndc.x < -1.0f || ndc.x > 1.0f || ndc.y < -1.0f || ndc.y > 1.0f)
+                continue;
+
+            // Viewport transform
+            int screenX = (int)((ndc.x + 1.0f) * 0.5f * g_render_width);
+            int screenY = (int)((1.0f - ndc.y) * 0.5f * g_render_height);
+
+            // Compute depth value (16-bit, PS1 style)
+            // NDC z is in [-1, 1], map to [0, 65535]
+            uint16_t depthVal = (uint16_t)((ndc.z + 1.0f) * 0.5f * 65534.0f);
+            // Apply small bias to render dots slightly in front of geometry
+            // Use small bias (1) to avoid z-fighting but not jump over other geometry
+            depthVal = depthVal > 1 ? depthVal - 1 : 0;
+
+            // Get color (RGB floats 0-255)
+            uint8_t r = (uint8_t)v[3];
+            uint8_t g = (uint8_t)v[4];
+            uint8_t b = (uint8_t)v[5];
+            uint32_t color = 0xFF000000 | ((uint32_t)b << 16) | ((uint32_t)g << 8) | r;
+
+            // Draw point with depth testing (clipped once, span fills)
+            int x0 = screenX - halfSize > 0 ? screenX - halfSize : 0;
+            int y0 = screenY - halfSize > 0 ? screenY - halfSize : 0;
+            int x1 = screenX + halfSize + 1 < g_render_width ? screenX + halfSize + 1 : g_render_width;
+            int y1 = screenY + halfSize + 1 < g_render_height ? screenY + halfSize + 1 : g_render_height;
+            if (x0 < x1 && y0 < y1)
+                fill_rect_spans(x0, y0, x1, y1, color, depthVal, SPRITE_DEPTH_TEST | SPRITE_DEPTH_WRITE);
+        }
+    }
+
+    // Memory allocation helper for larger buffers
+    EMSCRIPTEN_KEEPALIVE
+    void *allocate(int32_t size)
+    {
+        // Simple bump allocator (WASM memory grows as needed)
+        static uint8_t *heap_ptr = nullptr;
+        if (!heap_ptr)
+        {
+            // Start after static allocations
+            heap_ptr = (uint8_t *)(((uintptr_t)&g_texture_sizes + sizeof(g_texture_sizes) + 15) & ~15);
+        }
+        void *result = heap_ptr;
+        heap_ptr += (size + 15) & ~15; // Align to 16 bytes
+        return result;
+    }
+
+    // ============================================================================
+    // Material Baking System
+    // ============================================================================
+
+    // Instruction types for compiled material graph
+    enum BakeOpcode : uint8_t
+    {
+        BAKE_OP_FLAT_COLOR = 0,     // Push flat color (RGBA stored in data)
+        BAKE_OP_SAMPLE_TEXTURE = 1, // Sample texture at current UV
+        BAKE_OP_MIX_MULTIPLY = 2,   // Pop 2 colors, push result (multiply blend)
+        BAKE_OP_MIX_ADD = 3,        // Pop 2 colors, push result (additive blend)
+        BAKE_OP_MIX_LERP = 4,       // Pop 2 colors, push result (linear interp)
+        BAKE_OP_COLOR_RAMP = 5,     // Evaluate color ramp with factor
+        BAKE_OP_VORONOI = 6,        // Generate Voronoi texture (scale in data)
+        BAKE_OP_ALPHA_CUTOFF = 7,   // Binary alpha cutoff (threshold in data)
+        BAKE_OP_NOISE = 8,          // Procedural noise (scale, octaves, mode in data)
+        BAKE_OP_END = 255           // End of program
+    };
+
+    // Material baking buffers
+    constexpr int MAX_BAKE_SIZE = 512 * 512;
+    constexpr int MAX_BAKE_INSTRUCTIONS = 256;
+    constexpr int MAX_COLOR_RAMP_STOPS = 16;
+
+    alignas(16) uint8_t g_bake_output[MAX_BAKE_SIZE * 4];           // Output RGBA texture
+    alignas(16) uint8_t g_bake_program[MAX_BAKE_INSTRUCTIONS * 16]; // Compiled instructions
+    int32_t g_bake_width = 256;
+    int32_t g_bake_height = 256;
+    int32_t g_bake_source_texture = -1; // Source texture slot for sampling
+
+    // Color ramp data (position as 0-255, then RGBA)
+    alignas(16) uint8_t g_color_ramp_data[MAX_COLOR_RAMP_STOPS * 5]; // [pos, r, g, b, a] per stop
+    int32_t g_color_ramp_count = 0;
+
+    // Get pointers for JS to write to
+    EMSCRIPTEN_KEEPALIVE
+    uint8_t *get_bake_output_ptr() { return g_bake_output; }
+
+    EMSCRIPTEN_KEEPALIVE
+    uint8_t *get_bake_program_ptr() { return g_bake_program; }
+
+    EMSCRIPTEN_KEEPALIVE
+    uint8_t *get_color_ramp_ptr() { return g_color_ramp_data; }
+
+    EMSCRIPTEN_KEEPALIVE
+    void set_bake_params(int32_t width, int32_t height, int32_t sourceTexture)
+    {
+        g_bake_width = width;
+        g_bake_height = height;
+        g_bake_source_texture = sourceTexture;
+    }
+
+    EMSCRIPTEN_KEEPALIVE
+    void set_color_ramp_count(int32_t count)
+    {
+        g_color_ramp_count = count > MAX_COLOR_RAMP_STOPS ? MAX_COLOR_RAMP_STOPS : count;
+    }
+
+    // Evaluate color ramp at position (0-255)
+    static inline void eval_color_ramp(int32_t pos, uint8_t &r, uint8_t &g, uint8_t &b, uint8_t &a)
+    {
+        if (g_color_ramp_count == 0)
+        {
+            r = g = b = 0;
+            a = 255;
+            return;
+        }
+
+        // Find surrounding stops
+        int lowIdx = 0;
+        int highIdx = g_color_ramp_count - 1;
+
+        for (int i = 0; i < g_color_ramp_count - 1; i++)
+        {
+            int stopPos = g_color_ramp_data[i * 5];
+            int nextPos = g_color_ramp_data[(i + 1) * 5];
+            if (pos >= stopPos && pos <= nextPos)
+            {
+                lowIdx = i;
+                highIdx = i + 1;
+                break;
+            }
+        }
+
+        uint8_t *low = &g_color_ramp_data[lowIdx * 5];
+        uint8_t *high = &g_color_ramp_data[highIdx * 5];
+
+        int lowPos = low[0];
+        int highPos = high[0];
+
+        if (pos <= lowPos)
+        {
+            r = low[1];
+            g = low[2];
+            b = low[3];
+            a = low[4];
+            return;
+        }
+        if (pos >= highPos)
+        {
+            r = high[1];
+            g = high[2];
+            b = high[3];
+            a = high[4];
+            return;
+        }
+
+        // Interpolate
+        int range = highPos - lowPos;
+        if (range <= 0)
+        {
+            r = low[1];
+            g = low[2];
+            b = low[3];
+            a = low[4];
+            return;
+        }
+
+        int t = ((pos - lowPos) * 255) / range; // 0-255 interpolation factor
+        r = (low[1] * (255 - t) + high[1] * t) / 255;
+        g = (low[2] * (255 - t) + high[2] * t) / 255;
+        b = (low[3] * (255 - t) + high[3] * t) / 255;
+        a = (low[4] * (255 - t) + high[4] * t) / 255;
+    }
+
+    // SIMD color ramp evaluation for 4 positions at once
+    // positions: 4 factor values (0-255), output: 4 RGBA values packed
+    static inline void eval_color_ramp_simd4(const int32_t pos[4],
+                                             uint8_t out_r[4], uint8_t out_g[4],
+                                             uint8_t out_b[4], uint8_t out_a[4])
+    {
+        for (int i = 0; i < 4; i++)
+        {
+            eval_color_ramp(pos[i], out_r[i], out_g[i], out_b[i], out_a[i]);
+        }
+    }
+
+    // Execute bake program - SIMD optimized for 4 pixels at a time
+    EMSCRIPTEN_KEEPALIVE
+    void bake_material()
+    {
+        int width = g_bake_width;
+        int height = g_bake_height;
+        int texSlot = g_bake_source_texture;
+
+        // Get source texture info if available
+        int srcWidth = 0, srcHeight = 0;
+        uint8_t *srcTex = nullptr;
+        if (texSlot >= 0 && texSlot < MAX_TEXTURES)
+        {
+            srcWidth = g_texture_sizes[texSlot * 2];
+            srcHeight = g_texture_sizes[texSlot * 2 + 1];
+            if (srcWidth > 0 && srcHeight > 0)
+            {
+                srcTex = g_textures[texSlot];
+            }
+        }
+
+        // SIMD color stack for 4 pixels at a time
+        // Each stack entry holds 4 pixels worth of RGBA data
+        // Layout: r[4], g[4], b[4], a[4] as i32x4 vectors
+        constexpr int MAX_STACK = 8;
+        alignas(16) v128_t stack_r[MAX_STACK];
+        alignas(16) v128_t stack_g[MAX_STACK];
+        alignas(16) v128_t stack_b[MAX_STACK];
+        alignas(16) v128_t stack_a[MAX_STACK];
+
+        const v128_t v_zero = wasm_i32x4_splat(0);
+        const v128_t v_255 = wasm_i32x4_splat(255);
+        const v128_t v_srcWidth = wasm_f32x4_splat((float)srcWidth);
+        const v128_t v_srcHeight = wasm_f32x4_splat((float)srcHeight);
+        const v128_t v_invWidth = wasm_f32x4_splat(1.0f / (float)width);
+        const v128_t v_invHeight = wasm_f32x4_splat(1.0f / (float)height);
+        const v128_t v_half = wasm_f32x4_splat(0.5f);
+        const v128_t v_one = wasm_f32x4_splat(1.0f);
+        const v128_t v_eight = wasm_f32x4_splat(8.0f);
+
+        // Process pixels in groups of 4 (horizontally)
+        for (int y = 0; y < height; y++)
+        {
+            // V coordinate (1 at top, 0 at bottom - OpenGL convention)
+            float v = 1.0f - ((float)y + 0.5f) / (float)height;
+            v128_t v_v = wasm_f32x4_splat(v);
+
+            for (int x = 0; x < width; x += 4)
+            {
+                int stackPtr = 0;
+
+                // Handle edge case where we don't have full 4 pixels
+                int pixelCount = (x + 4 <= width) ? 4 : (width - x);
+
+                // U coordinates for 4 pixels
+                v128_t v_x = wasm_f32x4_add(
+                    wasm_f32x4_make((float)x, (float)(x + 1), (float)(x + 2), (float)(x + 3)),
+                    v_half);
+                v128_t v_u = wasm_f32x4_mul(v_x, v_invWidth);
+
+                // Execute program for all 4 pixels
+                uint8_t *pc = g_bake_program;
+                bool done = false;
+
+                while (!done)
+                {
+                    BakeOpcode op = (BakeOpcode)*pc++;
+
+                    switch (op)
+                    {
+                    case BAKE_OP_FLAT_COLOR:
+                    {
+                        // Same color for all 4 pixels
+                        int r = *pc++;
+                        int g = *pc++;
+                        int b = *pc++;
+                        int a = *pc++;
+                        stack_r[stackPtr] = wasm_i32x4_splat(r);
+                        stack_g[stackPtr] = wasm_i32x4_splat(g);
+                        stack_b[stackPtr] = wasm_i32x4_splat(b);
+                        stack_a[stackPtr] = wasm_i32x4_splat(a);
+                        stackPtr++;
+                        break;
+                    }
+
+                    case BAKE_OP_SAMPLE_TEXTURE:
+                    {
+                        if (srcTex && srcWidth > 0 && srcHeight > 0)
+                        {
+                            // Calculate texture coordinates for 4 pixels
+                            // Note: Invert V for texture sampling (1-v) to match image coordinate system
+                            // where row 0 is at top of image but V=1 is at top in OpenGL/UV space
+                            v128_t v_tx_f = wasm_f32x4_mul(v_u, v_srcWidth);
+                            v128_t v_ty_f = wasm_f32x4_mul(wasm_f32x4_sub(v_one, v_v), v_srcHeight);
+
+                            // Convert to int and wrap
+                            v128_t v_tx = wasm_i32x4_trunc_sat_f32x4(v_tx_f);
+                            v128_t v_ty = wasm_i32x4_trunc_sat_f32x4(v_ty_f);
+
+                            // Modulo wrap (simplified - assumes positive)
+                            v128_t v_srcW_i = wasm_i32x4_splat(srcWidth);
+                            v128_t v_srcH_i = wasm_i32x4_splat(srcHeight);
+
+                            // tx = tx % srcWidth (using mask for power-of-2 or fallback)
+                            // For simplicity, extract and sample individually
+                            alignas(16) int32_t tx[4], ty[4];
+                            wasm_v128_store(tx, v_tx);
+                            wasm_v128_store(ty, v_ty);
+
+                            alignas(16) int32_t r[4], g[4], b[4], a[4];
+                            for (int i = 0; i < 4; i++)
+                            {
+                                int txi = tx[i] % srcWidth;
+                                int tyi = ty[i] % srcHeight;
+                                if (txi < 0)
+                                    txi += srcWidth;
+                                if (tyi < 0)
+                                    tyi += srcHeight;
+                                int tidx = (tyi * srcWidth + txi) * 4;
+                                r[i] = srcTex[tidx];
+                                g[i] = srcTex[tidx + 1];
+                                b[i] = srcTex[tidx + 2];
+                                a[i] = srcTex[tidx + 3];
+                            }
+
+                            stack_r[stackPtr] = wasm_v128_load(r);
+                            stack_g[stackPtr] = wasm_v128_load(g);
+                            stack_b[stackPtr] = wasm_v128_load(b);
+                            stack_a[stackPtr] = wasm_v128_load(a);
+                        }
+                        else
+                        {
+                            // Checkerboard pattern
+                            v128_t v_cu = wasm_f32x4_mul(v_u, v_eight);
+                            v128_t v_cv = wasm_f32x4_mul(v_v, v_eight);
+                            v128_t v_cui = wasm_i32x4_trunc_sat_f32x4(v_cu);
+                            v128_t v_cvi = wasm_i32x4_trunc_sat_f32x4(v_cv);
+                            v128_t v_sum = wasm_i32x4_add(v_cui, v_cvi);
+                            v128_t v_checker = wasm_v128_and(v_sum, wasm_i32x4_splat(1));
+
+                            // checker ? 255 : 0 for R and B, 0 for G
+                            v128_t v_mask = wasm_i32x4_eq(v_checker, wasm_i32x4_splat(1));
+                            stack_r[stackPtr] = wasm_v128_and(v_mask, v_255);
+                            stack_g[stackPtr] = v_zero;
+                            stack_b[stackPtr] = wasm_v128_and(v_mask, v_255);
+                            stack_a[stackPtr] = v_255;
+                        }
+                        stackPtr++;
+                        break;
+                    }
+
+                    case BAKE_OP_MIX_MULTIPLY:
+                    {
+                        pc++; // skip factor byte
+                        if (stackPtr >= 2)
+                        {
+                            stackPtr--;
+                            // c1 * c2 / 255 using SIMD
+                            v128_t r1 = stack_r[stackPtr - 1];
+                            v128_t g1 = stack_g[stackPtr - 1];
+                            v128_t b1 = stack_b[stackPtr - 1];
+                            v128_t a1 = stack_a[stackPtr - 1];
+                            v128_t r2 = stack_r[stackPtr];
+                            v128_t g2 = stack_g[stackPtr];
+                            v128_t b2 = stack_b[stackPtr];
+                            v128_t a2 = stack_a[stackPtr];
+
+                            // Multiply and divide by 255
+                            stack_r[stackPtr - 1] = wasm_i32x4_shr(wasm_i32x4_mul(r1, r2), 8);
+                            stack_g[stackPtr - 1] = wasm_i32x4_shr(wasm_i32x4_mul(g1, g2), 8);
+                            stack_b[stackPtr - 1] = wasm_i32x4_shr(wasm_i32x4_mul(b1, b2), 8);
+                            stack_a[stackPtr - 1] = wasm_i32x4_shr(wasm_i32x4_mul(a1, a2), 8);
+                        }
+                        break;
+                    }
+
+                    case BAKE_OP_MIX_ADD:
+                    {
+                        int factor = *pc++;
+                        if (stackPtr >= 2)
+                        {
+                            stackPtr--;
+                            v128_t v_factor = wasm_i32x4_splat(factor);
+
+                            v128_t r1 = stack_r[stackPtr - 1];
+                            v128_t g1 = stack_g[stackPtr - 1];
+                            v128_t b1 = stack_b[stackPtr - 1];
+                            v128_t r2 = stack_r[stackPtr];
+                            v128_t g2 = stack_g[stackPtr];
+                            v128_t b2 = stack_b[stackPtr];
+
+                            // c1 + (c2 * factor) / 255, clamped to 255
+                            v128_t add_r = wasm_i32x4_add(r1, wasm_i32x4_shr(wasm_i32x4_mul(r2, v_factor), 8));
+                            v128_t add_g = wasm_i32x4_add(g1, wasm_i32x4_shr(wasm_i32x4_mul(g2, v_factor), 8));
+                            v128_t add_b = wasm_i32x4_add(b1, wasm_i32x4_shr(wasm_i32x4_mul(b2, v_factor), 8));
+
+                            stack_r[stackPtr - 1] = wasm_i32x4_min(add_r, v_255);
+                            stack_g[stackPtr - 1] = wasm_i32x4_min(add_g, v_255);
+                            stack_b[stackPtr - 1] = wasm_i32x4_min(add_b, v_255);
+                        }
+                        break;
+                    }
+
+                    case BAKE_OP_MIX_LERP:
+                    {
+                        int factor = *pc++;
+                        if (stackPtr >= 2)
+                        {
+                            stackPtr--;
+                            v128_t v_factor = wasm_i32x4_splat(factor);
+                            v128_t v_inv_factor = wasm_i32x4_splat(255 - factor);
+
+                            v128_t r1 = stack_r[stackPtr - 1];
+                            v128_t g1 = stack_g[stackPtr - 1];
+                            v128_t b1 = stack_b[stackPtr - 1];
+                            v128_t a1 = stack_a[stackPtr - 1];
+                            v128_t r2 = stack_r[stackPtr];
+                            v128_t g2 = stack_g[stackPtr];
+                            v128_t b2 = stack_b[stackPtr];
+                            v128_t a2 = stack_a[stackPtr];
+
+                            // (c1 * invF + c2 * factor) / 255
+                            stack_r[stackPtr - 1] = wasm_i32x4_shr(
+                                wasm_i32x4_add(wasm_i32x4_mul(r1, v_inv_factor), wasm_i32x4_mul(r2, v_factor)), 8);
+                            stack_g[stackPtr - 1] = wasm_i32x4_shr(
+                                wasm_i32x4_add(wasm_i32x4_mul(g1, v_inv_factor), wasm_i32x4_mul(g2, v_factor)), 8);
+                            stack_b[stackPtr - 1] = wasm_i32x4_shr(
+                                wasm_i32x4_add(wasm_i32x4_mul(b1, v_inv_factor), wasm_i32x4_mul(b2, v_factor)), 8);
+                            stack_a[stackPtr - 1] = wasm_i32x4_shr(
+                                wasm_i32x4_add(wasm_i32x4_mul(a1, v_inv_factor), wasm_i32x4_mul(a2, v_factor)), 8);
+                        }
+                        break;
+                    }
+
+                    case BAKE_OP_COLOR_RAMP:
+                    {
+                        // Read inline color ramp data from bytecode
+                        // Format: [stopCount, ...stops(pos, r, g, b, a)]
+                        int stopCount = *pc++;
+                        if (stopCount > 16)
+                            stopCount = 16;
+
+                        // Read stop data into local array
+                        uint8_t rampData[16 * 5];
+                        for (int s = 0; s < stopCount; s++)
+                        {
+                            rampData[s * 5] = *pc++;     // position
+                            rampData[s * 5 + 1] = *pc++; // r
+                            rampData[s * 5 + 2] = *pc++; // g
+                            rampData[s * 5 + 3] = *pc++; // b
+                            rampData[s * 5 + 4] = *pc++; // a
+                        }
+
+                        if (stackPtr >= 1 && stopCount > 0)
+                        {
+                            // Extract red channel as factor for each pixel
+                            alignas(16) int32_t fac[4];
+                            wasm_v128_store(fac, stack_r[stackPtr - 1]);
+
+                            alignas(16) int32_t r[4], g[4], b[4], a[4];
+                            for (int i = 0; i < 4; i++)
+                            {
+                                int pos = fac[i];
+
+                                // Find surrounding stops
+                                int lowIdx = 0;
+                                int highIdx = stopCount - 1;
+                                for (int s = 0; s < stopCount - 1; s++)
+                                {
+                                    int stopPos = rampData[s * 5];
+                                    int nextPos = rampData[(s + 1) * 5];
+                                    if (pos >= stopPos && pos <= nextPos)
+                                    {
+                                        lowIdx = s;
+                                        highIdx = s + 1;
+                                        break;
+                                    }
+                                }
+
+                                uint8_t *low = &rampData[lowIdx * 5];
+                                uint8_t *high = &rampData[highIdx * 5];
+                                int lowPos = low[0];
+                                int highPos = high[0];
+
+                                if (pos <= lowPos)
+                                {
+                                    r[i] = low[1];
+                                    g[i] = low[2];
+                                    b[i] = low[3];
+                                    a[i] = low[4];
+                                }
+                                else if (pos >= highPos)
+                                {
+                                    r[i] = high[1];
+                                    g[i] = high[2];
+                                    b[i] = high[3];
+                                    a[i] = high[4];
+                                }
+                                else
+                                {
+                                    // Interpolate
+                                    int range = highPos - lowPos;
+                                    int t = ((pos - lowPos) * 255) / range;
+                                    int invT = 255 - t;
+                                    r[i] = (low[1] * invT + high[1] * t) >> 8;
+                                    g[i] = (low[2] * invT + high[2] * t) >> 8;
+                                    b[i] = (low[3] * invT + high[3] * t) >> 8;
+                                    a[i] = (low[4] * invT + high[4] * t) >> 8;
+                                }
+                            }
+
+                            stack_r[stackPtr - 1] = wasm_v128_load(r);
+                            stack_g[stackPtr - 1] = wasm_v128_load(g);
+                            stack_b[stackPtr - 1] = wasm_v128_load(b);
+                            stack_a[stackPtr - 1] = wasm_v128_load(a);
+                        }
+                        break;
+                    }
+
+                    case BAKE_OP_VORONOI:
+                    {
+                        // Voronoi texture - scale is next byte (1-255), mode is next byte (0=F1, 1=edge)
+                        float scale = (float)*pc++;
+                        if (scale < 1.0f)
+                            scale = 1.0f;
+                        uint8_t mode = *pc++; // 0 = distance to point (F1), 1 = distance to edge (F2-F1)
+
+                        // Process 4 pixels - extract UV coordinates
+                        alignas(16) float u_arr[4], v_arr[4];
+                        wasm_v128_store(u_arr, v_u);
+                        // v_v is a splat, so all 4 values are the same
+                        float v_val = 1.0f - ((float)y + 0.5f) / (float)height;
+
+                        alignas(16) int32_t dist[4];
+                        for (int i = 0; i < 4; i++)
+                        {
+                            float pu = u_arr[i] * scale;
+                            float pv = v_val * scale;
+
+                            // Cell coordinates
+                            int cellX = (int)floorf(pu);
+                            int cellY = (int)floorf(pv);
+
+                            // Find F1 (nearest) and F2 (second nearest) distances
+                            float f1 = 1e10f;
+                            float f2 = 1e10f;
+
+                            // Check 3x3 neighborhood of cells
+                            for (int dy = -1; dy <= 1; dy++)
+                            {
+                                for (int dx = -1; dx <= 1; dx++)
+                                {
+                                    int cx = cellX + dx;
+                                    int cy = cellY + dy;
+
+                                    // Hash function for pseudo-random point in cell
+                                    // Simple but effective hash
+                                    uint32_t h = (uint32_t)(cx * 374761393 + cy * 668265263);
+                                    h = (h ^ (h >> 13)) * 1274126177;
+
+                                    // Random point in cell (0-1 range)
+                                    float rx = (float)(h & 0xFFFF) / 65535.0f;
+                                    h = h * 1103515245 + 12345;
+                                    float ry = (float)(h & 0xFFFF) / 65535.0f;
+
+                                    // Point position in world space
+                                    float px = (float)cx + rx;
+                                    float py = (float)cy + ry;
+
+                                    // Distance to this point
+                                    float ddx = pu - px;
+                                    float ddy = pv - py;
+                                    float d = sqrtf(ddx * ddx + ddy * ddy);
+
+                                    // Track F1 and F2
+                                    if (d < f1)
+                                    {
+                                        f2 = f1;
+                                        f1 = d;
+                                    }
+                                    else if (d < f2)
+                                    {
+                                        f2 = d;
+                                    }
+                                }
+                            }
+
+                            // Calculate output based on mode
+                            float outVal;
+                            if (mode == 1)
+                            {
+                                // Distance to edge: F2 - F1 (smaller = closer to edge)
+                                // Invert so edges are white
+                                outVal = 1.0f - (f2 - f1) * 2.0f;
+                                if (outVal < 0.0f)
+                                    outVal = 0.0f;
+                                if (outVal > 1.0f)
+                                    outVal = 1.0f;
+                            }
+                            else
+                            {
+                                // Distance to point (F1)
+                                outVal = f1 * 1.4f;
+                                if (outVal > 1.0f)
+                                    outVal = 1.0f;
+                            }
+
+                            int val = (int)(outVal * 255.0f);
+                            if (val > 255)
+                                val = 255;
+                            if (val < 0)
+                                val = 0;
+                            dist[i] = val;
+                        }
+
+                        // Push grayscale result (distance in all channels)
+                        stack_r[stackPtr] = wasm_v128_load(dist);
+                        stack_g[stackPtr] = wasm_v128_load(dist);
+                        stack_b[stackPtr] = wasm_v128_load(dist);
+                        stack_a[stackPtr] = v_255;
+                        stackPtr++;
+                        break;
+                    }
+
+                    case BAKE_OP_ALPHA_CUTOFF:
+                    {
+                        // Alpha cutoff - threshold is next byte (0-255)
+                        uint8_t threshold = *pc++;
+
+                        if (stackPtr > 0)
+                        {
+                            // Pop color and apply alpha cutoff
+                            stackPtr--;
+                            alignas(16) int32_t a_arr[4];
+                            wasm_v128_store(a_arr, stack_a[stackPtr]);
+
+                            // Binary cutoff: alpha >= threshold -> 255, else 0
+                            for (int i = 0; i < 4; i++)
+                            {
+                                a_arr[i] = (a_arr[i] >= threshold) ? 255 : 0;
+                            }
+
+                            // Push back with modified alpha
+                            stack_r[stackPtr] = stack_r[stackPtr]; // unchanged
+                            stack_g[stackPtr] = stack_g[stackPtr]; // unchanged
+                            stack_b[stackPtr] = stack_b[stackPtr]; // unchanged
+                            stack_a[stackPtr] = wasm_v128_load(a_arr);
+                            stackPtr++;
+                        }
+                        break;
+                    }
+
+                    case BAKE_OP_NOISE:
+                    {
+                        // Noise texture - scale (1-255), octaves (1-8), mode (0=value, 1=simplex)
+                        float scale = (float)*pc++;
+                        if (scale < 1.0f)
+                            scale = 1.0f;
+                        int octaves = *pc++;
+                        if (octaves < 1)
+                            octaves = 1;
+                        if (octaves > 8)
+                            octaves = 8;
+                        uint8_t mode = *pc++; // 0 = value noise, 1 = simplex
+
+                        // Process 4 pixels
+                        alignas(16) float u_arr[4];
+                        wasm_v128_store(u_arr, v_u);
+                        float v_val = 1.0f - ((float)y + 0.5f) / (float)height;
+
+                        alignas(16) int32_t noise_out[4];
+                        for (int i = 0; i < 4; i++)
+                        {
+                            float px = u_arr[i] * scale;
+                            float py = v_val * scale;
+
+                            float noiseVal = 0.0f;
+                            float amplitude = 1.0f;
+                            float frequency = 1.0f;
+                            float maxValue = 0.0f;
+
+                            // Fractal noise with octaves
+                            for (int o = 0; o < octaves; o++)
+                            {
+                                float nx = px * frequency;
+                                float ny = py * frequency;
+
+                                if (mode == 1)
+                                {
+                                    // Simplex-like noise using gradient method
+                                    int ix = (int)floorf(nx);
+                                    int iy = (int)floorf(ny);
+                                    float fx = nx - (float)ix;
+                                    float fy = ny - (float)iy;
+
+                                    // Smooth interpolation
+                                    float u_interp = fx * fx * (3.0f - 2.0f * fx);
+                                    float v_interp = fy * fy * (3.0f - 2.0f * fy);
+
+                                    // Gradient hash at corners
+                                    auto grad = [](int hash, float x, float y) -> float
+                                    {
+                                        int h = hash & 7;
+                                        float u_g = h < 4 ? x : y;
+                                        float v_g = h < 4 ? y : x;
+                                        return ((h & 1) ? -u_g : u_g) + ((h & 2) ? -2.0f * v_g : 2.0f * v_g);
+                                    };
+
+                                    auto hash2 = [](int x, int y) -> int
+                                    {
+                                        uint32_t h = (uint32_t)(x * 374761393 + y * 668265263);
+                                        h = (h ^ (h >> 13)) * 1274126177;
+                                        return (int)(h & 0xFF);
+                                    };
+
+                                    float n00 = grad(hash2(ix, iy), fx, fy);
+                                    float n10 = grad(hash2(ix + 1, iy), fx - 1.0f, fy);
+                                    float n01 = grad(hash2(ix, iy + 1), fx, fy - 1.0f);
+                                    float n11 = grad(hash2(ix + 1, iy + 1), fx - 1.0f, fy - 1.0f);
+
+                                    float nx0 = n00 + u_interp * (n10 - n00);
+                                    float nx1 = n01 + u_interp * (n11 - n01);
+                                    float octaveNoise = nx0 + v_interp * (nx1 - nx0);
+
+                                    noiseVal += (octaveNoise * 0.5f + 0.5f) * amplitude;
+                                }
+                                else
+                                {
+                                    // Value noise
+                                    int ix = (int)floorf(nx);
+                                    int iy = (int)floorf(ny);
+                                    float fx = nx - (float)ix;
+                                    float fy = ny - (float)iy;
+
+                                    // Smooth interpolation
+                                    float u_interp = fx * fx * (3.0f - 2.0f * fx);
+                                    float v_interp = fy * fy * (3.0f - 2.0f * fy);
+
+                                    // Hash at corners
+                                    auto hash2 = [](int x, int y) -> float
+                                    {
+                                        uint32_t h = (uint32_t)(x * 374761393 + y * 668265263);
+                                        h = (h ^ (h >> 13)) * 1274126177;
+                                        return (float)(h & 0xFFFF) / 65535.0f;
+                                    };
+
+                                    float n00 = hash2(ix, iy);
+                                    float n10 = hash2(ix + 1, iy);
+                                    float n01 = hash2(ix, iy + 1);
+                                    float n11 = hash2(ix + 1, iy + 1);
+
+                                    float nx0 = n00 + u_interp * (n10 - n00);
+                                    float nx1 = n01 + u_interp * (n11 - n01);
+                                    float octaveNoise = nx0 + v_interp * (nx1 - nx0);
+
+                                    noiseVal += octaveNoise * amplitude;
+                                }
+
+                                maxValue += amplitude;
+                                amplitude *= 0.5f;
+                                frequency *= 2.0f;
+                            }
+
+                            // Normalize
+                            noiseVal /= maxValue;
+
+                            int val = (int)(noiseVal * 255.0f);
+                            if (val > 255)
+                                val = 255;
+                            if (val < 0)
+                                val = 0;
+                            noise_out[i] = val;
+                        }
+
+                        // Push grayscale result
+                        stack_r[stackPtr] = wasm_v128_load(noise_out);
+                        stack_g[stackPtr] = wasm_v128_load(noise_out);
+                        stack_b[stackPtr] = wasm_v128_load(noise_out);
+                        stack_a[stackPtr] = v_255;
+                        stackPtr++;
+                        break;
+                    }
+
+                    case BAKE_OP_END:
+                    default:
+                        done = true;
+                        break;
+                    }
+                }
+
+                // Write output for 4 pixels
+                alignas(16) int32_t out_r[4], out_g[4], out_b[4], out_a[4];
+                if (stackPtr > 0)
+                {
+                    wasm_v128_store(out_r, stack_r[0]);
+                    wasm_v128_store(out_g, stack_g[0]);
+                    wasm_v128_store(out_b, stack_b[0]);
+                    wasm_v128_store(out_a, stack_a[0]);
+                }
+                else
+                {
+                    // Error - magenta
+                    for (int i = 0; i < 4; i++)
+                    {
+                        out_r[i] = 255;
+                        out_g[i] = 0;
+                        out_b[i] = 255;
+                        out_a[i] = 255;
+                    }
+                }
+
+                // Write to output buffer
+                for (int i = 0; i < pixelCount; i++)
+                {
+                    int outIdx = (y * width + x + i) * 4;
+                    g_bake_output[outIdx] = (uint8_t)out_r[i];
+                    g_bake_output[outIdx + 1] = (uint8_t)out_g[i];
+                    g_bake_output[outIdx + 2] = (uint8_t)out_b[i];
+                    g_bake_output[outIdx + 3] = (uint8_t)out_a[i];
+                }
+            }
+        }
+    }
+
+    // ============================================================================
+    // Frame Sequence Export (turntables / camera paths)
+    // ============================================================================
+    //
+    // Renders a draw list along a camera path entirely inside the module and
+    // encodes each frame as a Y4M (YUV420, BT.601 full range) or raw RGBA chunk.
+    // JS pulls chunks with export_render_next_frame() and hands them to a writer.
+    //
+    // Memory is bounded: two frame-sized chunk buffers are reused for the whole
+    // sequence. The chunk returned by one call stays valid until the call after
+    // next, so JS can flush it asynchronously while the next frame renders.
+
+    enum ExportFormat : int32_t
+    {
+        EXPORT_FORMAT_Y4M = 0,  // YUV4MPEG2 stream, C420jpeg
+        EXPORT_FORMAT_RGBA = 1, // Raw RGBA frames (R, G, B, A bytes per pixel)
+    };
+
+    constexpr int MAX_EXPORT_DRAWS = 1024;
+    constexpr int MAX_EXPORT_CAMERA_KEYS = 256;
+    constexpr int EXPORT_HEADER_CAPACITY = 128;
+
+    struct ExportDraw
+    {
+        int32_t geometry; // Geometry buffer handle
+        int32_t texture;  // Texture buffer handle (0 = untextured)
+        float model[16];  // Model matrix (row-major)
+    };
+
+    static ExportDraw g_export_draws[MAX_EXPORT_DRAWS];
+    static int32_t g_export_draw_count = 0;
+
+    // Camera keyframes: eye xyz, target xyz (6 floats per key, written by JS)
+    alignas(16) float g_export_camera_keys[MAX_EXPORT_CAMERA_KEYS * 6];
+    static int32_t g_export_camera_key_count = 0;
+
+    // Turntable orbit (used when no camera keys are set)
+    static float g_export_orbit_center[3] = {0.0f, 0.0f, 0.0f};
+    static float g_export_orbit_radius = 5.0f;
+    static float g_export_orbit_height = 2.0f;
+    static float g_export_orbit_start = 0.0f;
+
+    static float g_export_fov = 60.0f; // Degrees
+    static float g_export_near = 0.1f;
+    static float g_export_far = 100.0f;
+    static uint8_t g_export_clear_color[3] = {0, 0, 0};
+
+    // Session state
+    static bool g_export_active = false; // Between export_begin and export_end
+    static int32_t g_export_format = EXPORT_FORMAT_Y4M;
+    static int32_t g_export_frame_count = 0;
+    static int32_t g_export_frame_index = 0;
+    static int32_t g_export_saved_width = 0;
+    static int32_t g_export_saved_height = 0;
+    static uint8_t *g_export_chunks[2] = {nullptr, nullptr};
+    static int32_t g_export_chunk_capacity = 0;
+    static int32_t g_export_front = 0; // Index of the chunk last handed to JS
+    static uint8_t g_export_header[EXPORT_HEADER_CAPACITY];
+    static int32_t g_export_header_size = 0;
+    static const uint8_t *g_export_current_chunk = nullptr;
+
+    // Append a decimal integer to a byte buffer, returns new length
+    static int32_t append_decimal(uint8_t *out, int32_t len, int32_t value)
+    {
+        char digits[12];
+        int32_t n = 0;
+        if (value < 0)
+            value = 0;
+        do
+        {
+            digits[n++] = (char)('0' + value % 10);
+            value /= 10;
+        } while (value > 0);
+        while (n > 0)
+            out[len++] = (uint8_t)digits[--n];
+        return len;
+    }
+
+    static int32_t append_text(uint8_t *out, int32_t len, const char *text)
+    {
+        while (*text)
+            out[len++] = (uint8_t)*text++;
+        return len;
+    }
+
+    // Scalar RGBA -> YUV for one 2x2 block (clamped at the right/bottom edge)
+    static inline void yuv420_block_scalar(const uint32_t *row0, const uint32_t *row1,
+                                           int32_t x0, int32_t x1,
+                                           uint8_t &outU, uint8_t &outV)
+    {
+        uint32_t p[4] = {row0[x0], row0[x1], row1[x0], row1[x1]};
+        int32_t sr = 0, sg = 0, sb = 0;
+        for (int i = 0; i < 4; i++)
+        {
+            sr += p[i] & 0xFF;
+            sg += (p[i] >> 8) & 0xFF;
+            sb += (p[i] >> 16) & 0xFF;
+        }
+        int32_t u = ((-43 * sr - 85 * sg + 128 * sb + 512) >> 10) + 128;
+        int32_t v = ((128 * sr - 107 * sg - 21 * sb + 512) >> 10) + 128;
+        outU = (uint8_t)(u < 0 ? 0 : (u > 255 ? 255 : u));
+        outV = (uint8_t)(v < 0 ? 0 : (v > 255 ? 255 : v));
+    }
+
+    static inline uint8_t luma_scalar(uint32_t p)
+    {
+        int32_t r = p & 0xFF, g = (p >> 8) & 0xFF, b = (p >> 16) & 0xFF;
+        return (uint8_t)((77 * r + 150 * g + 29 * b + 128) >> 8);
+    }
+
+    // SIMD luma for 4 ABGR pixels, returns i32x4 in [0, 255]
+    static inline v128_t luma_simd4(v128_t p, v128_t mask)
+    {
+        v128_t r = wasm_v128_and(p, mask);
+        v128_t g = wasm_v128_and(wasm_u32x4_shr(p, 8), mask);
+        v128_t b = wasm_v128_and(wasm_u32x4_shr(p, 16), mask);
+        v128_t y = wasm_i32x4_add(wasm_i32x4_mul(r, wasm_i32x4_splat(77)),
+                                  wasm_i32x4_add(wasm_i32x4_mul(g, wasm_i32x4_splat(150)),
+                                                 wasm_i32x4_mul(b, wasm_i32x4_splat(29))));
+        return wasm_i32x4_shr(wasm_i32x4_add(y, wasm_i32x4_splat(128)), 8);
+    }
+
+    // Store the low byte of each i32x4 lane (values already in [0, 255] or saturated)
+    static inline void store_u8x4(uint8_t *dst, v128_t v)
+    {
+        v128_t w = wasm_u16x8_narrow_i32x4(v, v);
+        v128_t b = wasm_u8x16_narrow_i16x8(w, w);
+        wasm_v128_store32_lane(dst, b, 0);
+    }
+
+    // Convert the framebuffer to planar YUV420 (BT.601 full range, 2x2 averaged chroma)
+    // 8 pixels x 2 rows per SIMD step: 16 luma samples, 4 U and 4 V samples
+    static void convert_frame_to_yuv420(const uint32_t *src, int32_t width, int32_t height,
+                                        uint8_t *yPlane, uint8_t *uPlane, uint8_t *vPlane)
+    {
+        int32_t chromaW = (width + 1) / 2;
+        int32_t chromaH = (height + 1) / 2;
+        const v128_t mask = wasm_i32x4_splat(0xFF);
+        const v128_t round = wasm_i32x4_splat(512);
+        const v128_t bias = wasm_i32x4_splat(128);
+
+        for (int32_t cy = 0; cy < chromaH; cy++)
+        {
+            int32_t y0 = cy * 2;
+            int32_t y1 = y0 + 1 < height ? y0 + 1 : y0;
+            const uint32_t *row0 = src + y0 * width;
+            const uint32_t *row1 = src + y1 * width;
+            uint8_t *lum0 = yPlane + y0 * width;
+            uint8_t *lum1 = yPlane + y1 * width;
+            uint8_t *uRow = uPlane + cy * chromaW;
+            uint8_t *vRow = vPlane + cy * chromaW;
+
+            int32_t x = 0;
+            for (; x + 8 <= width; x += 8)
+            {
+                v128_t p0a = wasm_v128_load(row0 + x);
+                v128_t p0b = wasm_v128_load(row0 + x + 4);
+                v128_t p1a = wasm_v128_load(row1 + x);
+                v128_t p1b = wasm_v128_load(row1 + x + 4);
+
+                store_u8x4(lum0 + x, luma_simd4(p0a, mask));
+                store_u8x4(lum0 + x + 4, luma_simd4(p0b, mask));
+                if (y1 != y0)
+                {
+                    store_u8x4(lum1 + x, luma_simd4(p1a, mask));
+                    store_u8x4(lum1 + x + 4, luma_simd4(p1b, mask));
+                }
+
+                // Vertical sums per channel
+                v128_t ra = wasm_i32x4_add(wasm_v128_and(p0a, mask), wasm_v128_and(p1a, mask));
+                v128_t rb = wasm_i32x4_add(wasm_v128_and(p0b, mask), wasm_v128_and(p1b, mask));
+                v128_t ga = wasm_i32x4_add(wasm_v128_and(wasm_u32x4_shr(p0a, 8), mask),
+                                           wasm_v128_and(wasm_u32x4_shr(p1a, 8), mask));
+                v128_t gb = wasm_i32x4_add(wasm_v128_and(wasm_u32x4_shr(p0b, 8), mask),
+                                           wasm_v128_and(wasm_u32x4_shr(p1b, 8), mask));
+                v128_t ba = wasm_i32x4_add(wasm_v128_and(wasm_u32x4_shr(p0a, 16), mask),
+                                           wasm_v128_and(wasm_u32x4_shr(p1a, 16), mask));
+                v128_t bb = wasm_i32x4_add(wasm_v128_and(wasm_u32x4_shr(p0b, 16), mask),
+                                           wasm_v128_and(wasm_u32x4_shr(p1b, 16), mask));
+
+                // Horizontal pair sums -> 4 chroma samples
+                v128_t sr = wasm_i32x4_add(wasm_i32x4_shuffle(ra, rb, 0, 2, 4, 6),
+                                           wasm_i32x4_shuffle(ra, rb, 1, 3, 5, 7));
+                v128_t sg = wasm_i32x4_add(wasm_i32x4_shuffle(ga, gb, 0, 2, 4, 6),
+                                           wasm_i32x4_shuffle(ga, gb, 1, 3, 5, 7));
+                v128_t sb = wasm_i32x4_add(wasm_i32x4_shuffle(ba, bb, 0, 2, 4, 6),
+                                           wasm_i32x4_shuffle(ba, bb, 1, 3, 5, 7));
+
+                v128_t u = wasm_i32x4_add(wasm_i32x4_mul(sr, wasm_i32x4_splat(-43)),
+                                          wasm_i32x4_add(wasm_i32x4_mul(sg, wasm_i32x4_splat(-85)),
+                                                         wasm_i32x4_mul(sb, wasm_i32x4_splat(128))));
+                v128_t v = wasm_i32x4_add(wasm_i32x4_mul(sr, wasm_i32x4_splat(128)),
+                                          wasm_i32x4_add(wasm_i32x4_mul(sg, wasm_i32x4_splat(-107)),
+                                                         wasm_i32x4_mul(sb, wasm_i32x4_splat(-21))));
+                u = wasm_i32x4_add(wasm_i32x4_shr(wasm_i32x4_add(u, round), 10), bias);
+                v = wasm_i32x4_add(wasm_i32x4_shr(wasm_i32x4_add(v, round), 10), bias);
+
+                store_u8x4(uRow + x / 2, u);
+                store_u8x4(vRow + x / 2, v);
+            }
+
+            // Scalar tail (and odd widths)
+            for (int32_t tx = x; tx < width; tx++)
+            {
+                lum0[tx] = luma_scalar(row0[tx]);
+                if (y1 != y0)
+                    lum1[tx] = luma_scalar(row1[tx]);
+            }
+            for (int32_t cx = x / 2; cx < chromaW; cx++)
+            {
+                int32_t x0 = cx * 2;
+                int32_t x1 = x0 + 1 < width ? x0 + 1 : x0;
+                yuv420_block_scalar(row0, row1, x0, x1, uRow[cx], vRow[cx]);
+            }
+        }
+    }
+
+    // Catmull-Rom interpolation of one camera key component
+    static inline float catmull_rom(float p0, float p1, float p2, float p3, float t)
+    {
+        float t2 = t * t;
+        float t3 = t2 * t;
+        return 0.5f * ((2.0f * p1) + (-p0 + p2) * t +
+                       (2.0f * p0 - 5.0f * p1 + 4.0f * p2 - p3) * t2 +
+                       (-p0 + 3.0f * p1 - 3.0f * p2 + p3) * t3);
+    }
+
+    // Evaluate camera eye/target for a frame
+    static void export_eval_camera(int32_t frame, Vec3 &eye, Vec3 &target)
+    {
+        int32_t keyCount = g_export_camera_key_count;
+        if (keyCount <= 0)
+        {
+            // Turntable: full revolution without repeating the first frame
+            float angle = g_export_orbit_start +
+                          6.2831853f * (float)frame / (float)g_export_frame_count;
+            target = Vec3(g_export_orbit_center[0], g_export_orbit_center[1], g_export_orbit_center[2]);
+            eye = Vec3(target.x + cosf(angle) * g_export_orbit_radius,
+                       target.y + sinf(angle) * g_export_orbit_radius,
+                       target.z + g_export_orbit_height);
+            return;
+        }
+
+        if (keyCount == 1 || g_export_frame_count <= 1)
+        {
+            const float *k = g_export_camera_keys;
+            eye = Vec3(k[0], k[1], k[2]);
+            target = Vec3(k[3], k[4], k[5]);
+            return;
+        }
+
+        // Map frame to [0, keyCount - 1] and interpolate through the keys
+        float pos = (float)frame * (float)(keyCount - 1) / (float)(g_export_frame_count - 1);
+        int32_t seg = (int32_t)pos;
+        if (seg >= keyCount - 1)
+            seg = keyCount - 2;
+        float t = pos - (float)seg;
+
+        int32_t i0 = seg > 0 ? seg - 1 : 0;
+        int32_t i1 = seg;
+        int32_t i2 = seg + 1;
+        int32_t i3 = seg + 2 < keyCount ? seg + 2 : keyCount - 1;
+        const float *k0 = &g_export_camera_keys[i0 * 6];
+        const float *k1 = &g_export_camera_keys[i1 * 6];
+        const float *k2 = &g_export_camera_keys[i2 * 6];
+        const float *k3 = &g_export_camera_keys[i3 * 6];
+
+        float out[6];
+        for (int c = 0; c < 6; c++)
+            out[c] = catmull_rom(k0[c], k1[c], k2[c], k3[c], t);
+        eye = Vec3(out[0], out[1], out[2]);
+        target = Vec3(out[3], out[4], out[5]);
+    }
+
+    // Size in bytes of one encoded frame for the current session
+    static int32_t export_frame_size()
+    {
+        int32_t w = g_render_width, h = g_render_height;
+        if (g_export_format == EXPORT_FORMAT_RGBA)
+            return w * h * 4;
+        int32_t chroma = ((w + 1) / 2) * ((h + 1) / 2);
+        return 6 + w * h + chroma * 2; // "FRAME\n" + Y + U + V
+    }
+
+    // Get pointer to camera keyframe array (eye xyz, target xyz per key)
+    EMSCRIPTEN_KEEPALIVE
+    float *get_export_camera_keys_ptr() { return g_export_camera_keys; }
+
+    EMSCRIPTEN_KEEPALIVE
+    void set_export_camera_key_count(int32_t count)
+    {
+        if (count < 0)
+            count = 0;
+        g_export_camera_key_count = count > MAX_EXPORT_CAMERA_KEYS ? MAX_EXPORT_CAMERA_KEYS : count;
+    }
+
+    // Use a turntable orbit (clears camera keys). Z-up, angle in radians.
+    EMSCRIPTEN_KEEPALIVE
+    void set_export_turntable(float cx, float cy, float cz, float radius, float height, float startAngle)
+    {
+        g_export_orbit_center[0] = cx;
+        g_export_orbit_center[1] = cy;
+        g_export_orbit_center[2] = cz;
+        g_export_orbit_radius = radius;
+        g_export_orbit_height = height;
+        g_export_orbit_start = startAngle;
+        g_export_camera_key_count = 0;
+    }
+
+    EMSCRIPTEN_KEEPALIVE
+    void set_export_camera_params(float fovDegrees, float nearPlane, float farPlane)
+    {
+        g_export_fov = fovDegrees;
+        g_export_near = nearPlane;
+        g_export_far = farPlane;
+    }
+
+    EMSCRIPTEN_KEEPALIVE
+    void set_export_clear_color(uint8_t r, uint8_t g, uint8_t b)
+    {
+        g_export_clear_color[0] = r;
+        g_export_clear_color[1] = g;
+        g_export_clear_color[2] = b;
+    }
+
+    EMSCRIPTEN_KEEPALIVE
+    void export_clear_draws()
+    {
+        g_export_draw_count = 0;
+    }
+
+    // Add a draw to the export list using the current g_model_matrix
+    // Returns draw index, or -1 if the list is full
+    EMSCRIPTEN_KEEPALIVE
+    int32_t export_add_draw(int32_t geometryHandle, int32_t textureHandle)
+    {
+        if (g_export_draw_count >= MAX_EXPORT_DRAWS)
+            return -1;
+        ExportDraw &d = g_export_draws[g_export_draw_count];
+        d.geometry = geometryHandle;
+        d.texture = textureHandle;
+        __builtin_memcpy(d.model, g_model_matrix, sizeof(d.model));
+        return g_export_draw_count++;
+    }
+
+    // Start an export session. Switches render resolution (restored by export_end)
+    // and prepares the stream header. Returns header size in bytes (0 for raw RGBA,
+    // -1 on failure or while another session is still active); the header is
+    // available via export_get_chunk_ptr().
+    EMSCRIPTEN_KEEPALIVE
+    int32_t export_begin(int32_t width, int32_t height, int32_t frameCount, int32_t format, int32_t fps)
+    {
+        if (frameCount < 1 || g_export_active)
+            return -1;
+
+        g_export_saved_width = g_render_width;
+        g_export_saved_height = g_render_height;
+        set_render_resolution(width, height);
+
+        g_export_format = format == EXPORT_FORMAT_RGBA ? EXPORT_FORMAT_RGBA : EXPORT_FORMAT_Y4M;
+        g_export_frame_count = frameCount;
+        g_export_frame_index = 0;
+        g_export_front = 1;
+
+        // (Re)allocate the two chunk buffers only when they need to grow
+        int32_t required = export_frame_size();
+        if (g_export_chunk_capacity < required)
+        {
+            for (int i = 0; i < 2; i++)
+            {
+                if (g_export_chunks[i])
+                    free(g_export_chunks[i]);
+                g_export_chunks[i] = (uint8_t *)malloc(required);
+            }
+            if (!g_export_chunks[0] || !g_export_chunks[1])
+            {
+                for (int i = 0; i < 2; i++)
+                {
+                    if (g_export_chunks[i])
+                        free(g_export_chunks[i]);
+                    g_export_chunks[i] = nullptr;
+                }
+                g_export_chunk_capacity = 0;
+                set_render_resolution(g_export_saved_width, g_export_saved_height);
+                return -1;
+            }
+            g_export_chunk_capacity = required;
+        }
+
+        g_export_header_size = 0;
+        if (g_export_format == EXPORT_FORMAT_Y4M)
+        {
+            int32_t len = append_text(g_export_header, 0, "YUV4MPEG2 W");
+            len = append_decimal(g_export_header, len, g_render_width);
+            len = append_text(g_export_header, len, " H");
+            len = append_decimal(g_export_header, len, g_render_height);
+            len = append_text(g_export_header, len, " F");
+            len = append_decimal(g_export_header, len, fps > 0 ? fps : 24);
+            len = append_text(g_export_header, len, ":1 Ip A1:1 C420jpeg\n");
+            g_export_header_size = len;
+        }
+        g_export_current_chunk = g_export_header;
+        g_export_active = true;
+        return g_export_header_size;
+    }
+
+    // Render and encode the next frame. Returns chunk size in bytes, 0 when the
+    // sequence is complete. The chunk is available via export_get_chunk_ptr().
+    EMSCRIPTEN_KEEPALIVE
+    int32_t export_render_next_frame()
+    {
+        if (g_export_frame_index >= g_export_frame_count || !g_export_chunks[0])
+            return 0;
+
+        int32_t frame = g_export_frame_index++;
+        int32_t w = g_render_width, h = g_render_height;
+
+        // Camera for this frame
+        Vec3 eye, target;
+        export_eval_camera(frame, eye, target);
+        alignas(16) float view[16], proj[16], viewProj[16];
+        mat4_look_at(view, eye, target, Vec3(0.0f, 0.0f, 1.0f));
+        mat4_perspective(proj, g_export_fov * 0.017453293f, (float)w / (float)h,
+                         g_export_near, g_export_far);
+        mat4_mul(viewProj, proj, view);
+
+        clear(g_export_clear_color[0], g_export_clear_color[1], g_export_clear_color[2]);
+        g_material_count = 0; // Recorded draws carry no material table
+        for (int32_t i = 0; i < g_export_draw_count; i++)
+        {
+            const ExportDraw &d = g_export_draws[i];
+            mat4_mul(g_mvp_matrix, viewProj, d.model);
+            __builtin_memcpy(g_model_matrix, d.model, sizeof(d.model));
+            bind_texture_buffer(d.texture);
+            draw_geometry_buffer(d.geometry);
+        }
+        bind_texture_buffer(0);
+
+        // Encode into the back buffer, then flip
+        int32_t back = g_export_front ^ 1;
+        uint8_t *out = g_export_chunks[back];
+        int32_t size = export_frame_size();
+        if (g_export_format == EXPORT_FORMAT_RGBA)
+        {
+            __builtin_memcpy(out, g_pixels, (size_t)w * h * 4);
+        }
+        else
+        {
+            append_text(out, 0, "FRAME\n");
+            uint8_t *yPlane = out + 6;
+            uint8_t *uPlane = yPlane + w * h;
+            uint8_t *vPlane = uPlane + ((w + 1) / 2) * ((h + 1) / 2);
+            convert_frame_to_yuv420(g_pixels, w, h, yPlane, uPlane, vPlane);
+        }
+
+        g_export_front = back;
+        g_export_current_chunk = out;
+        return size;
+    }
+
+    // Pointer to the most recent chunk (header after export_begin, then frames)
+    EMSCRIPTEN_KEEPALIVE
+    const uint8_t *export_get_chunk_ptr()
+    {
+        return g_export_current_chunk;
+    }
+
+    EMSCRIPTEN_KEEPALIVE
+    int32_t export_get_frame_index()
+    {
+        return g_export_frame_index;
+    }
+
+    // End the session: free chunk buffers and restore the previous resolution
+    EMSCRIPTEN_KEEPALIVE
+    void export_end()
+    {
+        if (!g_export_active)
+            return;
+        g_export_active = false;
+        for (int i = 0; i < 2; i++)
+        {
+            if (g_export_chunks[i])
+                free(g_export_chunks[i]);
+            g_export_chunks[i] = nullptr;
+        }
+        g_export_chunk_capacity = 0;
+        g_export_current_chunk = nullptr;
+        g_export_frame_count = 0;
+        g_export_frame_index = 0;
+        if (g_export_saved_width > 0 && g_export_saved_height > 0)
+            set_render_resolution(g_export_saved_width, g_export_saved_height);
+    }
+
+
+    // ============================================================================
+    // Native OBJ / MTL Parser
+    // ============================================================================
+    //
+    // Streaming OBJ parser: JS copies the file into the module chunk by chunk
+    // (obj_parser_get_input_ptr + obj_parser_feed) and lines are parsed in place.
+    // Each group's interleaved vertices and indices are built in heap arrays that
+    // are handed to a geometry buffer on finish, without a copy.
+    //
+    // Mirrors OBJLoader.parse in src/obj-loader.ts: groups/objects become separate
+    // meshes, faces are fan-triangulated, v/vt/vn triples are deduplicated per
+    // group and groups without normals get flat face normals. Also accepts
+    // per-vertex colors ("v x y z r g b", 0-1 floats) written by scanning tools.
+
+    struct ObjGroup
+    {
+        char *name;
+        char *material;        // usemtl name (nullptr if none)
+        float *vertices;       // 12 floats per vertex
+        uint32_t *indices;     // Fan-triangulated indices
+        uint32_t *faceSizes;   // Vertex count per source polygon (quads/n-gons)
+        int32_t vertexCount;   // Vertices
+        int32_t vertexCapacity; // Floats
+        int32_t indexCount;
+        int32_t indexCapacity;
+        int32_t faceCount;
+        int32_t faceCapacity;
+        int32_t smooth;     // 1 if any face was in a smoothing group
+        int32_t hasNormals; // 1 if any vertex referenced a vn
+        int32_t handle;     // Geometry buffer handle after finish (0 = none)
+    };
+
+    constexpr int MAX_OBJ_GROUPS = 1024;
+
+    static ObjGroup g_obj_groups[MAX_OBJ_GROUPS];
+    static int32_t g_obj_group_count = 0;
+    static int32_t g_obj_current_group = 0;
+    static char *g_obj_current_material = nullptr;
+    static int32_t g_obj_smooth_group = 0;
+    static char *g_obj_mtllib = nullptr;
+    static float g_obj_default_color[3] = {255.0f, 255.0f, 255.0f};
+
+    // Global attribute pools (OBJ indices are file-global)
+    static float *g_obj_positions = nullptr; // xyz
+    static float *g_obj_colors = nullptr;    // rgb 0-1, allocated on first colored vertex
+    static float *g_obj_texcoords = nullptr; // uv
+    static float *g_obj_normals = nullptr;   // xyz, normalized
+    static int32_t g_obj_position_count = 0, g_obj_position_capacity = 0;
+    static int32_t g_obj_color_capacity = 0;
+    static int32_t g_obj_texcoord_count = 0, g_obj_texcoord_capacity = 0;
+    static int32_t g_obj_normal_count = 0, g_obj_normal_capacity = 0;
+
+    // v/vt/vn -> vertex index dedup table (open addressing, generation-stamped
+    // so switching groups invalidates it without clearing memory)
+    static int32_t *g_obj_hash_keys = nullptr; // 3 per slot
+    static int32_t *g_obj_hash_values = nullptr;
+    static uint32_t *g_obj_hash_stamps = nullptr;
+    static int32_t g_obj_hash_capacity = 0; // Power of two
+    static int32_t g_obj_hash_count = 0;
+    static uint32_t g_obj_hash_stamp = 1;
+
+    // Input chunk and the partial line carried between chunks
+    static char *g_obj_input = nullptr;
+    static int32_t g_obj_input_capacity = 0;
+    static char *g_obj_carry = nullptr;
+    static int32_t g_obj_carry_size = 0, g_obj_carry_capacity = 0;
+
+    // Output (non-empty groups, in file order)
+    static int32_t g_obj_output[MAX_OBJ_GROUPS];
+    static int32_t g_obj_output_count = 0;
+    alignas(16) static float g_obj_bounds[6];
+
+    static const double OBJ_POW10[23] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+    static inline bool obj_is_digit(char c)
+    {
+        return (uint8_t)(c - '0') < 10;
+    }
+
+    static inline const char *obj_skip_space(const char *p, const char *end)
+    {
+        while (p < end && (*p == ' ' || *p == '\t' || *p == '\r'))
+            p++;
+        return p;
+    }
+
+    // Fast decimal float parser (sign, digits, fraction, exponent).
+    // Returns the position after the number; out is 0 if there were no digits.
+    static const char *obj_parse_float(const char *p, const char *end, float &out)
+    {
+        p = obj_skip_space(p, end);
+        bool negative = false;
+        if (p < end && (*p == '-' || *p == '+'))
+        {
+            negative = *p == '-';
+            p++;
+        }
+
+        uint64_t mantissa = 0;
+        int32_t significant = 0;
+        int32_t exponent = 0;
+        for (; p < end && obj_is_digit(*p); p++)
+        {
+            uint32_t d = (uint32_t)(*p - '0');
+            if (significant < 19)
+            {
+                if (mantissa != 0 || d != 0)
+                    significant++;
+                mantissa = mantissa * 10 + d;
+            }
+            else
+                exponent++;
+        }
+        if (p < end && *p == '.')
+        {
+            for (p++; p < end && obj_is_digit(*p); p++)
+            {
+                uint32_t d = (uint32_t)(*p - '0');
+                if (significant < 19)
+                {
+                    if (mantissa != 0 || d != 0)
+                        significant++;
+                    mantissa = mantissa * 10 + d;
+                    exponent--;
+                }
+            }
+        }
+        if (p < end && (*p == 'e' || *p == 'E'))
+        {
+            const char *q = p + 1;
+            bool expNegative = false;
+            if (q < end && (*q == '-' || *q == '+'))
+            {
+                expNegative = *q == '-';
+                q++;
+            }
+            if (q < end && obj_is_digit(*q))
+            {
+                int32_t e = 0;
+                for (; q < end && obj_is_digit(*q); q++)
+                    e = e < 10000 ? e * 10 + (*q - '0') : e;
+                exponent += expNegative ? -e : e;
+                p = q;
+            }
+        }
+
+        double value = (double)mantissa;
+        if (mantissa != 0)
+        {
+            if (exponent < -400)
+                exponent = -400;
+            if (exponent > 400)
+                exponent = 400;
+            while (exponent < -22)
+            {
+                value /= 1e22;
+                exponent += 22;
+            }
+            while (exponent > 22)
+            {
+                value *= 1e22;
+                exponent -= 22;
+            }
+            value = exponent < 0 ? value / OBJ_POW10[-exponent] : value * OBJ_POW10[exponent];
+        }
+        out = (float)(negative ? -value : value);
+        return p;
+    }
+
+    // Signed integer parser; found is false if there were no digits. Values
+    // beyond int32 saturate to +-INT32_MAX, which no index resolves to.
+    static const char *obj_parse_int(const char *p, const char *end, int32_t &out, bool &found)
+    {
+        bool negative = false;
+        if (p < end && (*p == '-' || *p == '+'))
+        {
+            negative = *p == '-';
+            p++;
+        }
+        int32_t value = 0;
+        found = false;
+        for (; p < end && obj_is_digit(*p); p++)
+        {
+            int32_t digit = *p - '0';
+            value = value > (INT32_MAX - digit) / 10 ? INT32_MAX : value * 10 + digit;
+            found = true;
+        }
+        out = negative ? -value : value;
+        return p;
+    }
+
+    // Copy [p, end) trimmed into a new NUL-terminated string
+    static char *obj_copy_string(const char *p, const char *end)
+    {
+        p = obj_skip_space(p, end);
+        while (end > p && (end[-1] == ' ' || end[-1] == '\t' || end[-1] == '\r'))
+            end--;
+        int32_t len = (int32_t)(end - p);
+        char *str = (char *)malloc(len + 1);
+        if (!str)
+            return nullptr;
+        __builtin_memcpy(str, p, len);
+        str[len] = 0;
+        return str;
+    }
+
+    static bool obj_string_equals(const char *str, const char *p, const char *end)
+    {
+        int32_t len = (int32_t)(end - p);
+        for (int32_t i = 0; i < len; i++)
+        {
+            if (str[i] != p[i])
+                return false;
+        }
+        return str[len] == 0;
+    }
+
+    // Does [p, end) start with keyword followed by whitespace or end of line?
+    static inline bool obj_keyword(const char *p, const char *end, const char *keyword, int32_t len)
+    {
+        if (end - p < len)
+            return false;
+        for (int32_t i = 0; i < len; i++)
+        {
+            if (p[i] != keyword[i])
+                return false;
+        }
+        return end - p == len || p[len] == ' ' || p[len] == '\t' || p[len] == '\r';
+    }
+
+    static void obj_free_group(ObjGroup &g)
+    {
+        if (g.name)
+            free(g.name);
+        if (g.material)
+            free(g.material);
+        if (g.vertices)
+            free(g.vertices);
+        if (g.indices)
+            free(g.indices);
+        if (g.faceSizes)
+            free(g.faceSizes);
+        __builtin_memset(&g, 0, sizeof(ObjGroup));
+    }
+
+    // Switch to (or create) the named group; -1 if the group table is full
+    static int32_t obj_select_group(const char *p, const char *end)
+    {
+        for (int32_t i = 0; i < g_obj_group_count; i++)
+        {
+            if (obj_string_equals(g_obj_groups[i].name, p, end))
+                return i;
+        }
+        if (g_obj_group_count >= MAX_OBJ_GROUPS)
+            return -1;
+
+        ObjGroup &g = g_obj_groups[g_obj_group_count];
+        __builtin_memset(&g, 0, sizeof(ObjGroup));
+        g.name = obj_copy_string(p, end);
+        if (g_obj_current_material)
+            g.material = obj_copy_string(g_obj_current_material,
+                                         g_obj_current_material + strlen(g_obj_current_material));
+        return g_obj_group_count++;
+    }
+
+    static inline uint32_t obj_hash_key(int32_t p, int32_t t, int32_t n)
+    {
+        uint32_t h = (uint32_t)p * 0x9E3779B1u;
+        h ^= (uint32_t)t * 0x85EBCA77u + (h >> 15);
+        h ^= (uint32_t)n * 0xC2B2AE3Du + (h >> 13);
+        return h ^ (h >> 16);
+    }
+
+    static bool obj_hash_grow()
+    {
+        int32_t newCapacity = g_obj_hash_capacity > 0 ? g_obj_hash_capacity * 2 : 4096;
+        int32_t *keys = (int32_t *)malloc((size_t)newCapacity * 3 * sizeof(int32_t));
+        int32_t *values = (int32_t *)malloc((size_t)newCapacity * sizeof(int32_t));
+        uint32_t *stamps = (uint32_t *)calloc((size_t)newCapacity, sizeof(uint32_t));
+        if (!keys || !values || !stamps)
+        {
+            free(keys);
+            free(values);
+            free(stamps);
+            return false;
+        }
+
+        // Reinsert live entries
+        uint32_t mask = (uint32_t)newCapacity - 1;
+        for (int32_t i = 0; i < g_obj_hash_capacity; i++)
+        {
+            if (g_obj_hash_stamps[i] != g_obj_hash_stamp)
+                continue;
+            const int32_t *k = &g_obj_hash_keys[i * 3];
+            uint32_t slot = obj_hash_key(k[0], k[1], k[2]) & mask;
+            while (stamps[slot] == g_obj_hash_stamp)
+                slot = (slot + 1) & mask;
+            keys[slot * 3] = k[0];
+            keys[slot * 3 + 1] = k[1];
+            keys[slot * 3 + 2] = k[2];
+            values[slot] = g_obj_hash_values[i];
+            stamps[slot] = g_obj_hash_stamp;
+        }
+
+        free(g_obj_hash_keys);
+        free(g_obj_hash_values);
+        free(g_obj_hash_stamps);
+        g_obj_hash_keys = keys;
+        g_obj_hash_values = values;
+        g_obj_hash_stamps = stamps;
+        g_obj_hash_capacity = newCapacity;
+        return true;
+    }
+
+    // Resolve a 1-based (or negative, relative) OBJ index; -1 if missing/out of range
+    static inline int32_t obj_resolve_index(int32_t idx, bool found, int32_t count)
+    {
+        if (!found || idx == 0)
+            return -1;
+        int32_t resolved = idx > 0 ? idx - 1 : count + idx;
+        return (resolved >= 0 && resolved < count) ? resolved : -1;
+    }
+
+    // Get or create the group vertex for a v/vt/vn triple; -1 on allocation failure
+    static int32_t obj_emit_vertex(ObjGroup &g, int32_t p, int32_t t, int32_t n)
+    {
+        if ((g_obj_hash_count + 1) * 2 > g_obj_hash_capacity && !obj_hash_grow())
+            return -1;
+
+        uint32_t mask = (uint32_t)g_obj_hash_capacity - 1;
+        uint32_t slot = obj_hash_key(p, t, n) & mask;
+        while (g_obj_hash_stamps[slot] == g_obj_hash_stamp)
+        {
+            const int32_t *k = &g_obj_hash_keys[slot * 3];
+            if (k[0] == p && k[1] == t && k[2] == n)
+                return g_obj_hash_values[slot];
+            slot = (slot + 1) & mask;
+        }
+
+        if (!grow_array(g.vertices, g.vertexCapacity, (g.vertexCount + 1) * 12))
+            return -1;
+
+        float *v = &g.vertices[g.vertexCount * 12];
+        if (p >= 0)
+        {
+            v[0] = g_obj_positions[p * 3];
+            v[1] = g_obj_positions[p * 3 + 1];
+            v[2] = g_obj_positions[p * 3 + 2];
+        }
+        else
+        {
+            v[0] = v[1] = v[2] = 0.0f;
+        }
+        if (n >= 0)
+        {
+            v[3] = g_obj_normals[n * 3];
+            v[4] = g_obj_normals[n * 3 + 1];
+            v[5] = g_obj_normals[n * 3 + 2];
+            g.hasNormals = 1;
+        }
+        else
+        {
+            v[3] = v[4] = v[5] = 0.0f;
+        }
+        v[6] = t >= 0 ? g_obj_texcoords[t * 2] : 0.0f;
+        v[7] = t >= 0 ? g_obj_texcoords[t * 2 + 1] : 0.0f;
+        if (p >= 0 && g_obj_colors)
+        {
+            v[8] = g_obj_colors[p * 3] * 255.0f;
+            v[9] = g_obj_colors[p * 3 + 1] * 255.0f;
+            v[10] = g_obj_colors[p * 3 + 2] * 255.0f;
+        }
+        else
+        {
+            v[8] = g_obj_default_color[0];
+            v[9] = g_obj_default_color[1];
+            v[10] = g_obj_default_color[2];
+        }
+        v[11] = 255.0f;
+
+        int32_t *k = &g_obj_hash_keys[slot * 3];
+        k[0] = p;
+        k[1] = t;
+        k[2] = n;
+        g_obj_hash_values[slot] = g.vertexCount;
+        g_obj_hash_stamps[slot] = g_obj_hash_stamp;
+        g_obj_hash_count++;
+        return g.vertexCount++;
+    }
+
+    static void obj_parse_face(const char *p, const char *end)
+    {
+        if (g_obj_current_group < 0)
+            return;
+        ObjGroup &g = g_obj_groups[g_obj_current_group];
+
+        int32_t first = -1, prev = -1, count = 0;
+        while (true)
+        {
+            p = obj_skip_space(p, end);
+            if (p >= end)
+                break;
+
+            int32_t vi = 0, ti = 0, ni = 0;
+            bool hasV = false, hasT = false, hasN = false;
+            p = obj_parse_int(p, end, vi, hasV);
+            if (p < end && *p == '/')
+            {
+                p = obj_parse_int(p + 1, end, ti, hasT);
+                if (p < end && *p == '/')
+                    p = obj_parse_int(p + 1, end, ni, hasN);
+            }
+            // Skip anything unexpected up to the next separator
+            while (p < end && *p != ' ' && *p != '\t' && *p != '\r')
+                p++;
+            if (!hasV)
+                continue;
+
+            int32_t idx = obj_emit_vertex(g,
+                                          obj_resolve_index(vi, hasV, g_obj_position_count),
+                                          obj_resolve_index(ti, hasT, g_obj_texcoord_count),
+                                          obj_resolve_index(ni, hasN, g_obj_normal_count));
+            if (idx < 0)
+                return;
+
+            if (count == 0)
+                first = idx;
+            else if (count >= 2)
+            {
+                // Fan triangulation (convex polygons)
+                if (!grow_array(g.indices, g.indexCapacity, g.indexCount + 3))
+                    return;
+                g.indices[g.indexCount++] = (uint32_t)first;
+                g.indices[g.indexCount++] = (uint32_t)prev;
+                g.indices[g.indexCount++] = (uint32_t)idx;
+            }
+            prev = idx;
+            count++;
+        }
+
+        if (count >= 3 && grow_array(g.faceSizes, g.faceCapacity, g.faceCount + 1))
+            g.faceSizes[g.faceCount++] = (uint32_t)count;
+        if (g_obj_smooth_group > 0)
+            g.smooth = 1;
+    }
+
+    static void obj_parse_line(const char *p, const char *end)
+    {
+        p = obj_skip_space(p, end);
+        if (p >= end || *p == '#')
+            return;
+
+        if (p[0] == 'v')
+        {
+            if (obj_keyword(p, end, "v", 1))
+            {
+                float x, y, z;
+                p = obj_parse_float(p + 1, end, x);
+                p = obj_parse_float(p, end, y);
+                p = obj_parse_float(p, end, z);
+                int32_t i = g_obj_position_count;
+                if (!grow_array(g_obj_positions, g_obj_position_capacity, (i + 1) * 3))
+                    return;
+                g_obj_positions[i * 3] = x;
+                g_obj_positions[i * 3 + 1] = y;
+                g_obj_positions[i * 3 + 2] = z;
+
+                // Optional trailing components: a single one is the homogeneous
+                // w (ignored), three or four are the vertex color extension
+                // (r g b [a], alpha ignored)
+                float extra[4];
+                int32_t extraCount = 0;
+                while (extraCount < 4)
+                {
+                    p = obj_skip_space(p, end);
+                    if (p >= end || *p == '#')
+                        break;
+                    const char *next = obj_parse_float(p, end, extra[extraCount]);
+                    if (next == p)
+                        break;
+                    p = next;
+                    extraCount++;
+                }
+                bool colored = extraCount >= 3;
+                if (g_obj_colors || colored)
+                {
+                    float r = 1.0f, gr = 1.0f, b = 1.0f;
+                    if (colored)
+                    {
+                        r = extra[0];
+                        gr = extra[1];
+                        b = extra[2];
+                    }
+                    if (!g_obj_colors)
+                    {
+                        // First colored vertex: backfill earlier vertices with white
+                        int32_t cap = 0;
+                        if (!grow_array(g_obj_colors, cap, g_obj_position_capacity))
+                            return;
+                        g_obj_color_capacity = cap;
+                        for (int32_t c = 0; c < i * 3; c++)
+                            g_obj_colors[c] = 1.0f;
+                    }
+                    if (!grow_array(g_obj_colors, g_obj_color_capacity, (i + 1) * 3))
+                        return;
+                    g_obj_colors[i * 3] = r;
+                    g_obj_colors[i * 3 + 1] = gr;
+                    g_obj_colors[i * 3 + 2] = b;
+                }
+                g_obj_position_count++;
+            }
+            else if (obj_keyword(p, end, "vt", 2))
+            {
+                float u, v;
+                p = obj_parse_float(p + 2, end, u);
+                p = obj_parse_float(p, end, v);
+                int32_t i = g_obj_texcoord_count;
+                if (!grow_array(g_obj_texcoords, g_obj_texcoord_capacity, (i + 1) * 2))
+                    return;
+                g_obj_texcoords[i * 2] = u;
+                g_obj_texcoords[i * 2 + 1] = v;
+                g_obj_texcoord_count++;
+            }
+            else if (obj_keyword(p, end, "vn", 2))
+            {
+                float x, y, z;
+                p = obj_parse_float(p + 2, end, x);
+                p = obj_parse_float(p, end, y);
+                p = obj_parse_float(p, end, z);
+                Vec3 n = Vec3(x, y, z).normalize();
+                int32_t i = g_obj_normal_count;
+                if (!grow_array(g_obj_normals, g_obj_normal_capacity, (i + 1) * 3))
+                    return;
+                g_obj_normals[i * 3] = n.x;
+                g_obj_normals[i * 3 + 1] = n.y;
+                g_obj_normals[i * 3 + 2] = n.z;
+                g_obj_normal_count++;
+            }
+        }
+        else if (obj_keyword(p, end, "f", 1))
+        {
+            obj_parse_face(p + 1, end);
+        }
+        else if (obj_keyword(p, end, "g", 1) || obj_keyword(p, end, "o", 1))
+        {
+            // Group name is the first token (matches OBJLoader)
+            const char *name = obj_skip_space(p + 1, end);
+            const char *nameEnd = name;
+            while (nameEnd < end && *nameEnd != ' ' && *nameEnd != '\t' && *nameEnd != '\r')
+                nameEnd++;
+            if (nameEnd == name)
+            {
+                name = "default";
+                nameEnd = name + 7;
+            }
+            g_obj_current_group = obj_select_group(name, nameEnd);
+
+            // Each group has independent vertex indices
+            g_obj_hash_stamp++;
+            g_obj_hash_count = 0;
+        }
+        else if (obj_keyword(p, end, "usemtl", 6))
+        {
+            if (g_obj_current_material)
+                free(g_obj_current_material);
+            g_obj_current_material = obj_copy_string(p + 6, end);
+            if (g_obj_current_group >= 0 && !g_obj_groups[g_obj_current_group].material &&
+                g_obj_current_material)
+            {
+                g_obj_groups[g_obj_current_group].material =
+                    obj_copy_string(g_obj_current_material,
+                                    g_obj_current_material + strlen(g_obj_current_material));
+            }
+        }
+        else if (obj_keyword(p, end, "mtllib", 6))
+        {
+            if (g_obj_mtllib)
+                free(g_obj_mtllib);
+            g_obj_mtllib = obj_copy_string(p + 6, end);
+        }
+        else if (obj_keyword(p, end, "s", 1))
+        {
+            const char *q = obj_skip_space(p + 1, end);
+            if (end - q >= 3 && q[0] == 'o' && q[1] == 'f' && q[2] == 'f')
+            {
+                g_obj_smooth_group = 0;
+            }
+            else
+            {
+                int32_t value = 0;
+                bool found = false;
+                obj_parse_int(q, end, value, found);
+                g_obj_smooth_group = found ? value : 1;
+            }
+        }
+    }
+
+    // Parse all complete lines in [p, end); returns start of the trailing partial line
+    static const char *obj_parse_lines(const char *p, const char *end)
+    {
+        while (p < end)
+        {
+            const char *nl = (const char *)memchr(p, '\n', end - p);
+            if (!nl)
+                return p;
+            obj_parse_line(p, nl);
+            p = nl + 1;
+        }
+        return p;
+    }
+
+    // Free all parser state (results already adopted by geometry buffers stay alive)
+    EMSCRIPTEN_KEEPALIVE
+    void obj_parser_reset()
+    {
+        for (int32_t i = 0; i < g_obj_group_count; i++)
+            obj_free_group(g_obj_groups[i]);
+        g_obj_group_count = 0;
+        g_obj_output_count = 0;
+
+        free(g_obj_current_material);
+        free(g_obj_mtllib);
+        free(g_obj_positions);
+        free(g_obj_colors);
+        free(g_obj_texcoords);
+        free(g_obj_normals);
+        free(g_obj_hash_keys);
+        free(g_obj_hash_values);
+        free(g_obj_hash_stamps);
+        free(g_obj_input);
+        free(g_obj_carry);
+        g_obj_current_material = nullptr;
+        g_obj_mtllib = nullptr;
+        g_obj_positions = g_obj_colors = g_obj_texcoords = g_obj_normals = nullptr;
+        g_obj_position_count = g_obj_position_capacity = g_obj_color_capacity = 0;
+        g_obj_texcoord_count = g_obj_texcoord_capacity = 0;
+        g_obj_normal_count = g_obj_normal_capacity = 0;
+        g_obj_hash_keys = nullptr;
+        g_obj_hash_values = nullptr;
+        g_obj_hash_stamps = nullptr;
+        g_obj_hash_capacity = g_obj_hash_count = 0;
+        g_obj_input = nullptr;
+        g_obj_input_capacity = 0;
+        g_obj_carry = nullptr;
+        g_obj_carry_size = g_obj_carry_capacity = 0;
+    }
+
+    // Start parsing a new OBJ file. Color is the default vertex color (0-255).
+    EMSCRIPTEN_KEEPALIVE
+    void obj_parser_begin(float r, float g, float b)
+    {
+        obj_parser_reset();
+        g_obj_default_color[0] = r;
+        g_obj_default_color[1] = g;
+        g_obj_default_color[2] = b;
+        g_obj_smooth_group = 0;
+        g_obj_current_group = obj_select_group("default", "default" + 7);
+    }
+
+    // Get a buffer for JS to copy the next chunk into (valid until the next call)
+    EMSCRIPTEN_KEEPALIVE
+    uint8_t *obj_parser_get_input_ptr(int32_t size)
+    {
+        if (size > g_obj_input_capacity)
+        {
+            free(g_obj_input);
+            g_obj_input = (char *)malloc(size);
+            g_obj_input_capacity = g_obj_input ? size : 0;
+        }
+        return (uint8_t *)g_obj_input;
+    }
+
+    // Parse the next size bytes from the input buffer. Returns 0 on failure.
+    EMSCRIPTEN_KEEPALIVE
+    int32_t obj_parser_feed(int32_t size)
+    {
+        if (!g_obj_input || size > g_obj_input_capacity)
+            return 0;
+        const char *p = g_obj_input;
+        const char *end = g_obj_input + size;
+
+        // Complete the line carried over from the previous chunk
+        if (g_obj_carry_size > 0)
+        {
+            const char *nl = (const char *)memchr(p, '\n', size);
+            const char *take = nl ? nl : end;
+            int32_t len = (int32_t)(take - p);
+            if (!grow_array(g_obj_carry, g_obj_carry_capacity, g_obj_carry_size + len))
+                return 0;
+            __builtin_memcpy(g_obj_carry + g_obj_carry_size, p, len);
+            g_obj_carry_size += len;
+            if (!nl)
+                return 1;
+            obj_parse_line(g_obj_carry, g_obj_carry + g_obj_carry_size);
+            g_obj_carry_size = 0;
+            p = nl + 1;
+        }
+
+        const char *rest = obj_parse_lines(p, end);
+        int32_t len = (int32_t)(end - rest);
+        if (len > 0)
+        {
+            if (!grow_array(g_obj_carry, g_obj_carry_capacity, len))
+                return 0;
+            __builtin_memcpy(g_obj_carry, rest, len);
+            g_obj_carry_size = len;
+        }
+        return 1;
+    }
+
+    // Finish parsing: compute missing normals, optionally recenter all meshes on
+    // the combined bounds and move each non-empty group into a geometry buffer.
+    // Returns the number of meshes produced.
+    EMSCRIPTEN_KEEPALIVE
+    int32_t obj_parser_finish(int32_t recenter)
+    {
+        if (g_obj_carry_size > 0)
+        {
+            obj_parse_line(g_obj_carry, g_obj_carry + g_obj_carry_size);
+            g_obj_carry_size = 0;
+        }
+
+        g_obj_output_count = 0;
+        float minX = 1e30f, minY = 1e30f, minZ = 1e30f;
+        float maxX = -1e30f, maxY = -1e30f, maxZ = -1e30f;
+
+        for (int32_t gi = 0; gi < g_obj_group_count; gi++)
+        {
+            ObjGroup &g = g_obj_groups[gi];
+            if (g.vertexCount == 0 || g.indexCount == 0)
+                continue;
+            g_obj_output[g_obj_output_count++] = gi;
+
+            // Flat face normals when the file has none (last triangle wins, as in JS)
+            if (!g.hasNormals)
+            {
+                for (int32_t t = 0; t + 2 < g.indexCount; t += 3)
+                {
+                    float *a = &g.vertices[g.indices[t] * 12];
+                    float *b = &g.vertices[g.indices[t + 1] * 12];
+                    float *c = &g.vertices[g.indices[t + 2] * 12];
+                    Vec3 e1(b[0] - a[0], b[1] - a[1], b[2] - a[2]);
+                    Vec3 e2(c[0] - a[0], c[1] - a[1], c[2] - a[2]);
+                    Vec3 n = e1.cross(e2).normalize();
+                    float *corners[3] = {a, b, c};
+                    for (int k = 0; k < 3; k++)
+                    {
+                        corners[k][3] = n.x;
+                        corners[k][4] = n.y;
+                        corners[k][5] = n.z;
+                    }
+                }
+            }
+
+            for (int32_t i = 0; i < g.vertexCount; i++)
+            {
+                const float *v = &g.vertices[i * 12];
+                minX = fminf(minX, v[0]);
+                minY = fminf(minY, v[1]);
+                minZ = fminf(minZ, v[2]);
+                maxX = fmaxf(maxX, v[0]);
+                maxY = fmaxf(maxY, v[1]);
+                maxZ = fmaxf(maxZ, v[2]);
+            }
+        }
+
+        if (g_obj_output_count == 0)
+        {
+            minX = minY = minZ = maxX = maxY = maxZ = 0.0f;
+        }
+        g_obj_bounds[0] = minX;
+        g_obj_bounds[1] = minY;
+        g_obj_bounds[2] = minZ;
+        g_obj_bounds[3] = maxX;
+        g_obj_bounds[4] = maxY;
+        g_obj_bounds[5] = maxZ;
+
+        float cx = (minX + maxX) * 0.5f;
+        float cy = (minY + maxY) * 0.5f;
+        float cz = (minZ + maxZ) * 0.5f;
+
+        for (int32_t o = 0; o < g_obj_output_count; o++)
+        {
+            ObjGroup &g = g_obj_groups[g_obj_output[o]];
+            if (recenter)
+            {
+                for (int32_t i = 0; i < g.vertexCount; i++)
+                {
+                    float *v = &g.vertices[i * 12];
+                    v[0] -= cx;
+                    v[1] -= cy;
+                    v[2] -= cz;
+                }
+            }
+
+            // Hand the arrays to a geometry buffer (ownership moves, no copy)
+            g.handle = create_geometry_buffer();
+            GeometryBuffer *buf = lookup_geometry_buffer(g.handle);
+            if (!buf)
+            {
+                g.handle = 0;
+                continue;
+            }
+            buf->vertices = g.vertices;
+            buf->vertexCount = g.vertexCount;
+            buf->vertexCapacity = g.vertexCapacity;
+            buf->indices = g.indices;
+            buf->indexCount = g.indexCount;
+            buf->indexCapacity = g.indexCapacity;
+            g.vertices = nullptr;
+            g.indices = nullptr;
+            g.vertexCapacity = 0;
+            g.indexCapacity = 0;
+        }
+
+        // Attribute pools and dedup table are no longer needed
+        free(g_obj_positions);
+        free(g_obj_colors);
+        free(g_obj_texcoords);
+        free(g_obj_normals);
+        free(g_obj_hash_keys);
+        free(g_obj_hash_values);
+        free(g_obj_hash_stamps);
+        g_obj_positions = g_obj_colors = g_obj_texcoords = g_obj_normals = nullptr;
+        g_obj_position_count = g_obj_position_capacity = g_obj_color_capacity = 0;
+        g_obj_texcoord_count = g_obj_texcoord_capacity = 0;
+        g_obj_normal_count = g_obj_normal_capacity = 0;
+        g_obj_hash_keys = nullptr;
+        g_obj_hash_values = nullptr;
+        g_obj_hash_stamps = nullptr;
+        g_obj_hash_capacity = g_obj_hash_count = 0;
+
+        return g_obj_output_count;
+    }
+
+    static inline ObjGroup *obj_output_group(int32_t index)
+    {
+        if (index < 0 || index >= g_obj_output_count)
+            return nullptr;
+        return &g_obj_groups[g_obj_output[index]];
+    }
+
+    EMSCRIPTEN_KEEPALIVE
+    int32_t obj_parser_get_mesh_handle(int32_t index)
+    {
+        ObjGroup *g = obj_output_group(index);
+        return g ? g->handle : 0;
+    }
+
+    // Mesh name (NUL-terminated)
+    EMSCRIPTEN_KEEPALIVE
+    const char *obj_parser_get_mesh_name(int32_t index)
+    {
+        ObjGroup *g = obj_output_group(index);
+        return g ? g->name : nullptr;
+    }
+
+    // usemtl material name (NUL-terminated, nullptr if none)
+    EMSCRIPTEN_KEEPALIVE
+    const char *obj_parser_get_mesh_material(int32_t index)
+    {
+        ObjGroup *g = obj_output_group(index);
+        return g ? g->material : nullptr;
+    }
+
+    EMSCRIPTEN_KEEPALIVE
+    int32_t obj_parser_get_mesh_smooth(int32_t index)
+    {
+        ObjGroup *g = obj_output_group(index);
+        return g ? g->smooth : 0;
+    }
+
+    // Source polygon sizes (for rebuilding quads/n-gons from the fan indices)
+    EMSCRIPTEN_KEEPALIVE
+    uint32_t *obj_parser_get_mesh_face_sizes(int32_t index)
+    {
+        ObjGroup *g = obj_output_group(index);
+        return g ? g->faceSizes : nullptr;
+    }
+
+    EMSCRIPTEN_KEEPALIVE
+    int32_t obj_parser_get_mesh_face_count(int32_t index)
+    {
+        ObjGroup *g = obj_output_group(index);
+        return g ? g->faceCount : 0;
+    }
+
+    // mtllib file name (NUL-terminated, nullptr if none)
+    EMSCRIPTEN_KEEPALIVE
+    const char *obj_parser_get_mtllib()
+    {
+        return g_obj_mtllib;
+    }
+
+    // Bounds of all meshes before recentering: min xyz, max xyz
+    EMSCRIPTEN_KEEPALIVE
+    float *obj_parser_get_bounds()
+    {
+        return g_obj_bounds;
+    }
+
+    // ----------------------------------------------------------------------------
+    // MTL
+    // ----------------------------------------------------------------------------
+
+    constexpr int MAX_MTL_MATERIALS = 256;
+
+    // Per material: Kd rgb, Ka rgb, Ks rgb, Ns, opacity (0-1 floats as in the file)
+    constexpr int MTL_MATERIAL_FLOATS = 11;
+
+    struct MtlMaterial
+    {
+        char *name;
+        char *diffuseMap; // map_Kd path (nullptr if none)
+        float params[MTL_MATERIAL_FLOATS];
+    };
+
+    static MtlMaterial g_mtl_materials[MAX_MTL_MATERIALS];
+    static int32_t g_mtl_material_count = 0;
+
+    static void mtl_parse_color(const char *p, const char *end, float *out)
+    {
+        p = obj_parse_float(p, end, out[0]);
+        p = obj_parse_float(p, end, out[1]);
+        obj_parse_float(p, end, out[2]);
+    }
+
+    static void mtl_parse_line(const char *p, const char *end)
+    {
+        p = obj_skip_space(p, end);
+        if (p >= end || *p == '#')
+            return;
+
+        if (obj_keyword(p, end, "newmtl", 6))
+        {
+            if (g_mtl_material_count >= MAX_MTL_MATERIALS)
+                return;
+            MtlMaterial &m = g_mtl_materials[g_mtl_material_count++];
+            const char *name = obj_skip_space(p + 6, end);
+            const char *nameEnd = name;
+            while (nameEnd < end && *nameEnd != ' ' && *nameEnd != '\t' && *nameEnd != '\r')
+                nameEnd++;
+            m.name = nameEnd > name ? obj_copy_string(name, nameEnd)
+                                    : obj_copy_string("unnamed", "unnamed" + 7);
+            m.diffuseMap = nullptr;
+            // Defaults match Material in src/texture.ts
+            const float defaults[MTL_MATERIAL_FLOATS] = {
+                1.0f, 1.0f, 1.0f, 50.0f / 255.0f, 50.0f / 255.0f, 50.0f / 255.0f,
+                1.0f, 1.0f, 1.0f, 32.0f, 1.0f};
+            __builtin_memcpy(m.params, defaults, sizeof(defaults));
+            return;
+        }
+        if (g_mtl_material_count == 0)
+            return;
+
+        MtlMaterial &m = g_mtl_materials[g_mtl_material_count - 1];
+        if (obj_keyword(p, end, "Kd", 2))
+            mtl_parse_color(p + 2, end, &m.params[0]);
+        else if (obj_keyword(p, end, "Ka", 2))
+            mtl_parse_color(p + 2, end, &m.params[3]);
+        else if (obj_keyword(p, end, "Ks", 2))
+            mtl_parse_color(p + 2, end, &m.params[6]);
+        else if (obj_keyword(p, end, "Ns", 2))
+        {
+            float ns = 0.0f;
+            obj_parse_float(p + 2, end, ns);
+            m.params[9] = ns != 0.0f ? ns : 32.0f;
+        }
+        else if (obj_keyword(p, end, "d", 1) || obj_keyword(p, end, "Tr", 2))
+        {
+            bool inverted = p[0] == 'T';
+            float value = 0.0f;
+            obj_parse_float(p + (inverted ? 2 : 1), end, value);
+            if (value == 0.0f)
+                value = 1.0f;
+            m.params[10] = inverted ? 1.0f - value : value;
+        }
+        else if (obj_keyword(p, end, "map_Kd", 6))
+        {
+            if (m.diffuseMap)
+                free(m.diffuseMap);
+            m.diffuseMap = obj_copy_string(p + 6, end);
+        }
+    }
+
+    // Parse a complete MTL file from module memory. Returns the material count.
+    EMSCRIPTEN_KEEPALIVE
+    int32_t mtl_parse(const uint8_t *data, int32_t size)
+    {
+        for (int32_t i = 0; i < g_mtl_material_count; i++)
+        {
+            free(g_mtl_materials[i].name);
+            free(g_mtl_materials[i].diffuseMap);
+        }
+        g_mtl_material_count = 0;
+
+        const char *p = (const char *)data;
+        const char *end = p + size;
+        while (p < end)
+        {
+            const char *nl = (const char *)memchr(p, '\n', end - p);
+            const char *lineEnd = nl ? nl : end;
+            mtl_parse_line(p, lineEnd);
+            p = lineEnd + 1;
+        }
+        return g_mtl_material_count;
+    }
+
+    EMSCRIPTEN_KEEPALIVE
+    const char *mtl_get_material_name(int32_t index)
+    {
+        if (index < 0 || index >= g_mtl_material_count)
+            return nullptr;
+        return g_mtl_materials[index].name;
+    }
+
+    EMSCRIPTEN_KEEPALIVE
+    const char *mtl_get_material_diffuse_map(int32_t index)
+    {
+        if (index < 0 || index >= g_mtl_material_count)
+            return nullptr;
+        return g_mtl_materials[index].diffuseMap;
+    }
+
+    // Kd rgb, Ka rgb, Ks rgb, Ns, opacity
+    EMSCRIPTEN_KEEPALIVE
+    float *mtl_get_material_params(int32_t index)
+    {
+        if (index < 0 || index >= g_mtl_material_count)
+            return nullptr;
+        return g_mtl_materials[index].params;
+    }
+
+
+    // ============================================================================
+    // glTF / GLB Ingestion
+    // ============================================================================
+    //
+    // The whole .glb is copied into the module once. The container header and
+    // chunk table are parsed here; JS only JSON.parses the (small) JSON chunk and
+    // describes each primitive's accessors, which are then decoded straight from
+    // the BIN chunk into geometry buffer storage. Image bufferViews are exposed
+    // as views into the same memory so the browser decoder reads them in place.
+    //
+    // Vertex conversion matches GLTFLoader.parsePrimitive in src/gltf-loader.ts:
+    // Y-up -> Z-up (x, -z, y), V flipped, COLOR_0 scaled to 0-255.
+    // JOINTS_0/WEIGHTS_0 fill the buffer's skin data (weights renormalized).
+
+    enum GltfAttribute
+    {
+        GLTF_ATTR_POSITION = 0,
+        GLTF_ATTR_NORMAL = 1,
+        GLTF_ATTR_TEXCOORD = 2,
+        GLTF_ATTR_COLOR = 3,
+        GLTF_ATTR_INDICES = 4,
+        GLTF_ATTR_JOINTS = 5,  // JOINTS_0
+        GLTF_ATTR_WEIGHTS = 6, // WEIGHTS_0
+        GLTF_ATTR_COUNT = 7
+    };
+
+    enum GltfComponentType
+    {
+        GLTF_BYTE = 5120,
+        GLTF_UNSIGNED_BYTE = 5121,
+        GLTF_SHORT = 5122,
+        GLTF_UNSIGNED_SHORT = 5123,
+        GLTF_UNSIGNED_INT = 5125,
+        GLTF_FLOAT = 5126
+    };
+
+    enum GltfPrimitiveMode
+    {
+        GLTF_MODE_TRIANGLES = 4,
+        GLTF_MODE_TRIANGLE_STRIP = 5,
+        GLTF_MODE_TRIANGLE_FAN = 6
+    };
+
+    constexpr uint32_t GLB_MAGIC = 0x46546c67;      // "glTF"
+    constexpr uint32_t GLB_CHUNK_JSON = 0x4e4f534a; // "JSON"
+    constexpr uint32_t GLB_CHUNK_BIN = 0x004e4942;  // "BIN\0"
+
+    struct GltfAccessor
+    {
+        int32_t byteOffset; // Into the BIN chunk (bufferView + accessor offsets)
+        int32_t byteStride; // 0 = tightly packed
+        int32_t count;      // Elements
+        int32_t componentType;
+        int32_t components; // 1-4
+        int32_t normalized;
+        int32_t present;
+    };
+
+    static uint8_t *g_glb_data = nullptr;
+    static int32_t g_glb_capacity = 0;
+    static const uint8_t *g_glb_json = nullptr;
+    static const uint8_t *g_glb_bin = nullptr;
+    static int32_t g_glb_json_size = 0;
+    static int32_t g_glb_bin_size = 0;
+
+    static GltfAccessor g_gltf_accessors[GLTF_ATTR_COUNT];
+    static int32_t g_gltf_material = -1; // Face material id for appended primitives (-1 = none)
+
+    static inline uint32_t glb_read_u32(const uint8_t *p)
+    {
+        uint32_t v;
+        __builtin_memcpy(&v, p, 4);
+        return v;
+    }
+
+    static inline int32_t gltf_component_size(int32_t componentType)
+    {
+        switch (componentType)
+        {
+        case GLTF_BYTE:
+        case GLTF_UNSIGNED_BYTE:
+            return 1;
+        case GLTF_SHORT:
+        case GLTF_UNSIGNED_SHORT:
+            return 2;
+        case GLTF_UNSIGNED_INT:
+        case GLTF_FLOAT:
+            return 4;
+        default:
+            return 0;
+        }
+    }
+
+    // Validate an accessor against the BIN chunk; returns element stride or 0
+    static int32_t gltf_accessor_stride(const GltfAccessor &a)
+    {
+        int32_t componentSize = gltf_component_size(a.componentType);
+        if (!a.present || componentSize == 0 || a.components < 1 || a.components > 4 ||
+            a.count <= 0 || a.byteOffset < 0 || !g_glb_bin)
+            return 0;
+        int32_t elementSize = componentSize * a.components;
+        int32_t stride = a.byteStride > 0 ? a.byteStride : elementSize;
+        if (stride < elementSize)
+            return 0;
+        int64_t last = (int64_t)a.byteOffset + (int64_t)(a.count - 1) * stride + elementSize;
+        return last <= g_glb_bin_size ? stride : 0;
+    }
+
+    // Decode one component to float (normalized integers map to [0,1] / [-1,1])
+    static inline float gltf_read_component(const uint8_t *p, int32_t componentType, int32_t normalized)
+    {
+        switch (componentType)
+        {
+        case GLTF_BYTE:
+        {
+            float v = (float)(int8_t)p[0];
+            return normalized ? fmaxf(v * (1.0f / 127.0f), -1.0f) : v;
+        }
+        case GLTF_UNSIGNED_BYTE:
+            return normalized ? p[0] * (1.0f / 255.0f) : (float)p[0];
+        case GLTF_SHORT:
+        {
+            int16_t s;
+            __builtin_memcpy(&s, p, 2);
+            return normalized ? fmaxf(s * (1.0f / 32767.0f), -1.0f) : (float)s;
+        }
+        case GLTF_UNSIGNED_SHORT:
+        {
+            uint16_t s;
+            __builtin_memcpy(&s, p, 2);
+            return normalized ? s * (1.0f / 65535.0f) : (float)s;
+        }
+        case GLTF_UNSIGNED_INT:
+            return (float)glb_read_u32(p);
+        case GLTF_FLOAT:
+        {
+            float f;
+            __builtin_memcpy(&f, p, 4);
+            return f;
+        }
+        default:
+            return 0.0f;
+        }
+    }
+
+    // Decode element i of an accessor into out[0..3] (missing components: 0, alpha 1)
+    static inline void gltf_read_element(const GltfAccessor &a, int32_t stride, int32_t i, float *out)
+    {
+        const uint8_t *p = g_glb_bin + a.byteOffset + (size_t)i * stride;
+        out[0] = out[1] = out[2] = 0.0f;
+        out[3] = 1.0f;
+        if (a.componentType == GLTF_FLOAT)
+        {
+            __builtin_memcpy(out, p, (size_t)a.components * 4);
+            return;
+        }
+        int32_t componentSize = gltf_component_size(a.componentType);
+        for (int32_t c = 0; c < a.components; c++)
+            out[c] = gltf_read_component(p + c * componentSize, a.componentType, a.normalized);
+    }
+
+    static inline uint32_t gltf_read_index(const GltfAccessor &a, int32_t stride, int32_t i)
+    {
+        const uint8_t *p = g_glb_bin + a.byteOffset + (size_t)i * stride;
+        switch (a.componentType)
+        {
+        case GLTF_UNSIGNED_BYTE:
+            return p[0];
+        case GLTF_UNSIGNED_SHORT:
+        {
+            uint16_t s;
+            __builtin_memcpy(&s, p, 2);
+            return s;
+        }
+        default:
+            return glb_read_u32(p);
+        }
+    }
+
+    // Decode source vertex i of the current accessors into the interleaved layout.
+    // strides[] holds POSITION/NORMAL/TEXCOORD/COLOR strides (0 = attribute absent).
+    static void gltf_write_vertex(float *v, int32_t i, const int32_t *strides, float colorScale)
+    {
+        float e[4];
+        gltf_read_element(g_gltf_accessors[GLTF_ATTR_POSITION], strides[0], i, e);
+        v[0] = e[0];
+        v[1] = -e[2];
+        v[2] = e[1];
+        if (strides[1])
+        {
+            gltf_read_element(g_gltf_accessors[GLTF_ATTR_NORMAL], strides[1], i, e);
+            v[3] = e[0];
+            v[4] = -e[2];
+            v[5] = e[1];
+        }
+        else
+        {
+            v[3] = v[4] = v[5] = 0.0f;
+        }
+        if (strides[2])
+        {
+            gltf_read_element(g_gltf_accessors[GLTF_ATTR_TEXCOORD], strides[2], i, e);
+            v[6] = e[0];
+            v[7] = 1.0f - e[1];
+        }
+        else
+        {
+            v[6] = v[7] = 0.0f;
+        }
+        if (strides[3])
+        {
+            const GltfAccessor &col = g_gltf_accessors[GLTF_ATTR_COLOR];
+            gltf_read_element(col, strides[3], i, e);
+            v[8] = floorf(e[0] * colorScale);
+            v[9] = floorf(e[1] * colorScale);
+            v[10] = floorf(e[2] * colorScale);
+            v[11] = col.components >= 4 ? floorf(e[3] * colorScale) : 255.0f;
+        }
+        else
+        {
+            v[8] = v[9] = v[10] = v[11] = 255.0f;
+        }
+    }
+
+    // Decode the joints and weights of source vertex i into skin entry v.
+    // Weights are renormalized (quantized weights rarely sum to exactly 1).
+    static void gltf_write_skin(SkinData *skin, int32_t v, int32_t i, int32_t jointStride, int32_t weightStride)
+    {
+        float joints[4], weights[4];
+        gltf_read_element(g_gltf_accessors[GLTF_ATTR_JOINTS], jointStride, i, joints);
+        gltf_read_element(g_gltf_accessors[GLTF_ATTR_WEIGHTS], weightStride, i, weights);
+        float sum = 0.0f;
+        for (int k = 0; k < SKIN_INFLUENCES; k++)
+            sum += weights[k] = fmaxf(weights[k], 0.0f);
+        float scale = sum > 0.0f ? 1.0f / sum : 0.0f;
+        uint16_t *outJoints = &skin->joints[v * SKIN_INFLUENCES];
+        float *outWeights = &skin->weights[v * SKIN_INFLUENCES];
+        for (int k = 0; k < SKIN_INFLUENCES; k++)
+        {
+            outJoints[k] = (uint16_t)joints[k];
+            outWeights[k] = weights[k] * scale;
+        }
+        if (sum <= 0.0f)
+            outWeights[0] = 1.0f;
+    }
+
+    // Index k of the primitive (identity for non-indexed primitives)
+    static inline uint32_t gltf_source_index(int32_t idxStride, int32_t k)
+    {
+        const GltfAccessor &idx = g_gltf_accessors[GLTF_ATTR_INDICES];
+        return idx.present ? gltf_read_index(idx, idxStride, k) : (uint32_t)k;
+    }
+
+    // Get a buffer for JS to copy the .glb file into (valid until glb_reset)
+    EMSCRIPTEN_KEEPALIVE
+    uint8_t *glb_get_input_ptr(int32_t size)
+    {
+        if (size > g_glb_capacity)
+        {
+            free(g_glb_data);
+            g_glb_data = (uint8_t *)malloc(size);
+            g_glb_capacity = g_glb_data ? size : 0;
+        }
+        g_glb_json = g_glb_bin = nullptr;
+        g_glb_json_size = g_glb_bin_size = 0;
+        return g_glb_data;
+    }
+
+    // Parse the GLB header and chunk table. Returns 1 if a JSON chunk was found.
+    EMSCRIPTEN_KEEPALIVE
+    int32_t glb_parse(int32_t size)
+    {
+        g_glb_json = g_glb_bin = nullptr;
+        g_glb_json_size = g_glb_bin_size = 0;
+        for (int i = 0; i < GLTF_ATTR_COUNT; i++)
+            g_gltf_accessors[i].present = 0;
+
+        if (!g_glb_data || size < 12 || size > g_glb_capacity)
+            return 0;
+        if (glb_read_u32(g_glb_data) != GLB_MAGIC || glb_read_u32(g_glb_data + 4) != 2)
+            return 0;
+        uint32_t length = glb_read_u32(g_glb_data + 8);
+        if (length > (uint32_t)size)
+            return 0;
+
+        uint32_t offset = 12;
+        while (offset + 8 <= length)
+        {
+            uint32_t chunkLength = glb_read_u32(g_glb_data + offset);
+            uint32_t chunkType = glb_read_u32(g_glb_data + offset + 4);
+            if (chunkLength > length - offset - 8)
+                return 0;
+            const uint8_t *chunk = g_glb_data + offset + 8;
+            if (chunkType == GLB_CHUNK_JSON && !g_glb_json)
+            {
+                g_glb_json = chunk;
+                g_glb_json_size = (int32_t)chunkLength;
+            }
+            else if (chunkType == GLB_CHUNK_BIN && !g_glb_bin)
+            {
+                g_glb_bin = chunk;
+                g_glb_bin_size = (int32_t)chunkLength;
+            }
+            // Chunks are 4-byte aligned
+            offset = (offset + 8 + chunkLength + 3) & ~3u;
+        }
+        return g_glb_json ? 1 : 0;
+    }
+
+    EMSCRIPTEN_KEEPALIVE
+    const uint8_t *glb_get_json_ptr()
+    {
+        return g_glb_json;
+    }
+
+    EMSCRIPTEN_KEEPALIVE
+    int32_t glb_get_json_size()
+    {
+        return g_glb_json_size;
+    }
+
+    // BIN chunk (bufferViews of buffer 0 are offsets into this)
+    EMSCRIPTEN_KEEPALIVE
+    const uint8_t *glb_get_bin_ptr()
+    {
+        return g_glb_bin;
+    }
+
+    EMSCRIPTEN_KEEPALIVE
+    int32_t glb_get_bin_size()
+    {
+        return g_glb_bin_size;
+    }
+
+    EMSCRIPTEN_KEEPALIVE
+    void glb_reset()
+    {
+        free(g_glb_data);
+        g_glb_data = nullptr;
+        g_glb_capacity = 0;
+        g_glb_json = g_glb_bin = nullptr;
+        g_glb_json_size = g_glb_bin_size = 0;
+        for (int i = 0; i < GLTF_ATTR_COUNT; i++)
+            g_gltf_accessors[i].present = 0;
+    }
+
+    // Describe an accessor for the next gltf_append_primitive call.
+    // byteOffset = bufferView.byteOffset + accessor.byteOffset (within BIN).
+    EMSCRIPTEN_KEEPALIVE
+    void gltf_set_accessor(int32_t attribute, int32_t byteOffset, int32_t byteStride,
+                           int32_t count, int32_t componentType, int32_t components,
+                           int32_t normalized)
+    {
+        if (attribute < 0 || attribute >= GLTF_ATTR_COUNT)
+            return;
+        GltfAccessor &a = g_gltf_accessors[attribute];
+        a.byteOffset = byteOffset;
+        a.byteStride = byteStride;
+        a.count = count;
+        a.componentType = componentType;
+        a.components = components;
+        a.normalized = normalized;
+        a.present = 1;
+    }
+
+    EMSCRIPTEN_KEEPALIVE
+    void gltf_clear_accessors()
+    {
+        for (int i = 0; i < GLTF_ATTR_COUNT; i++)
+            g_gltf_accessors[i].present = 0;
+    }
+
+    // Face material id (0-255, the mesh's own numbering) for the triangles of
+    // following primitives, -1 to stop tagging. Earlier untagged triangles of
+    // a buffer get material 0 once any primitive is tagged. Ids past 255 make
+    // gltf_append_primitive fail rather than alias another material.
+    EMSCRIPTEN_KEEPALIVE
+    void gltf_set_material(int32_t material)
+    {
+        g_gltf_material = material < 0 ? -1 : material;
+    }
+
+    // Decode the described primitive and append it to a geometry buffer
+    // (primitives of one glTF mesh share a buffer, as in GLTFLoader).
+    // deindex = 1 expands to one vertex per triangle corner.
+    // Returns the number of triangles appended, -1 on failure.
+    EMSCRIPTEN_KEEPALIVE
+    int32_t gltf_append_primitive(int32_t handle, int32_t mode, int32_t deindex)
+    {
+        if (g_gltf_material >= MAX_MATERIALS)
+            return -1;
+        GeometryBuffer *buf = lookup_geometry_buffer(handle);
+        const GltfAccessor &pos = g_gltf_accessors[GLTF_ATTR_POSITION];
+        invalidate_geometry_caches(handle);
+        int32_t posStride = gltf_accessor_stride(pos);
+        if (!buf || !posStride)
+            return -1;
+
+        const GltfAccessor &nrm = g_gltf_accessors[GLTF_ATTR_NORMAL];
+        const GltfAccessor &tex = g_gltf_accessors[GLTF_ATTR_TEXCOORD];
+        const GltfAccessor &col = g_gltf_accessors[GLTF_ATTR_COLOR];
+        const GltfAccessor &idx = g_gltf_accessors[GLTF_ATTR_INDICES];
+        // Optional attributes are ignored (stride 0) if they are shorter than POSITION
+        int32_t strides[4] = {
+            posStride,
+            nrm.count >= pos.count ? gltf_accessor_stride(nrm) : 0,
+            tex.count >= pos.count ? gltf_accessor_stride(tex) : 0,
+            col.count >= pos.count ? gltf_accessor_stride(col) : 0};
+        int32_t idxStride = idx.present ? gltf_accessor_stride(idx) : 0;
+        // Skinning needs both JOINTS_0 (unsigned integers) and WEIGHTS_0
+        const GltfAccessor &jnt = g_gltf_accessors[GLTF_ATTR_JOINTS];
+        const GltfAccessor &wgt = g_gltf_accessors[GLTF_ATTR_WEIGHTS];
+        int32_t jointStride = jnt.count >= pos.count && !jnt.normalized &&
+                                      (jnt.componentType == GLTF_UNSIGNED_BYTE ||
+                                       jnt.componentType == GLTF_UNSIGNED_SHORT)
+                                  ? gltf_accessor_stride(jnt)
+                                  : 0;
+        int32_t weightStride = wgt.count >= pos.count ? gltf_accessor_stride(wgt) : 0;
+        if (!weightStride)
+            jointStride = 0;
+        if (idx.present && (!idxStride || idx.components != 1 ||
+                            (idx.componentType != GLTF_UNSIGNED_BYTE &&
+                             idx.componentType != GLTF_UNSIGNED_SHORT &&
+                             idx.componentType != GLTF_UNSIGNED_INT)))
+            return -1;
+
+        // Colors: normalized/float are 0-1, other integer types scale by their max
+        float colorScale = 255.0f;
+        if (!col.normalized && col.componentType == GLTF_UNSIGNED_BYTE)
+            colorScale = 1.0f;
+        else if (!col.normalized && col.componentType == GLTF_UNSIGNED_SHORT)
+            colorScale = 255.0f / 65535.0f;
+
+        // Triangle list over the primitive's vertex range
+        int32_t sourceCount = idx.present ? idx.count : pos.count;
+        int32_t triCount = 0;
+        if (mode == GLTF_MODE_TRIANGLES)
+            triCount = sourceCount / 3;
+        else if (mode == GLTF_MODE_TRIANGLE_STRIP || mode == GLTF_MODE_TRIANGLE_FAN)
+            triCount = sourceCount > 2 ? sourceCount - 2 : 0;
+        else
+            return -1;
+        if (triCount == 0)
+            return 0;
+
+        int32_t baseVertex = buf->vertexCount;
+        int32_t baseIndex = buf->indexCount;
+        int32_t newVertices = deindex ? triCount * 3 : pos.count;
+        if (!grow_array(buf->vertices, buf->vertexCapacity, (baseVertex + newVertices) * 12) ||
+            !grow_array(buf->indices, buf->indexCapacity, baseIndex + triCount * 3))
+            return -1;
+
+        // Skin data covers the whole buffer once any primitive is skinned
+        SkinData *skin = nullptr;
+        if (jointStride || g_geometry_skins[handle - 1])
+        {
+            skin = ensure_skin_data(handle - 1, baseVertex + newVertices);
+            if (!skin)
+                return -1;
+            if (!jointStride)
+                skin = nullptr; // Unskinned primitive: stays bound to joint 0
+        }
+
+        if (!deindex)
+        {
+            for (int32_t i = 0; i < pos.count; i++)
+            {
+                gltf_write_vertex(&buf->vertices[(baseVertex + i) * 12], i, strides, colorScale);
+                if (skin)
+                    gltf_write_skin(skin, baseVertex + i, i, jointStride, weightStride);
+            }
+        }
+
+        uint32_t *out = &buf->indices[baseIndex];
+        int32_t written = 0;
+        for (int32_t t = 0; t < triCount; t++)
+        {
+            uint32_t tri[3];
+            if (mode == GLTF_MODE_TRIANGLES)
+            {
+                tri[0] = gltf_source_index(idxStride, t * 3);
+                tri[1] = gltf_source_index(idxStride, t * 3 + 1);
+                tri[2] = gltf_source_index(idxStride, t * 3 + 2);
+            }
+            else if (mode == GLTF_MODE_TRIANGLE_STRIP)
+            {
+                // Keep winding consistent on odd triangles
+                tri[0] = gltf_source_index(idxStride, t);
+                tri[1] = gltf_source_index(idxStride, t + ((t & 1) ? 2 : 1));
+                tri[2] = gltf_source_index(idxStride, t + ((t & 1) ? 1 : 2));
+            }
+            else
+            {
+                tri[0] = gltf_source_index(idxStride, 0);
+                tri[1] = gltf_source_index(idxStride, t + 1);
+                tri[2] = gltf_source_index(idxStride, t + 2);
+            }
+            if (tri[0] >= (uint32_t)pos.count || tri[1] >= (uint32_t)pos.count ||
+                tri[2] >= (uint32_t)pos.count)
+                continue;
+
+            for (int k = 0; k < 3; k++)
+            {
+                if (deindex)
+                {
+                    int32_t v = baseVertex + written * 3 + k;
+                    gltf_write_vertex(&buf->vertices[v * 12], (int32_t)tri[k], strides, colorScale);
+                    if (skin)
+                        gltf_write_skin(skin, v, (int32_t)tri[k], jointStride, weightStride);
+                    out[written * 3 + k] = (uint32_t)v;
+                }
+                else
+                {
+                    out[written * 3 + k] = (uint32_t)baseVertex + tri[k];
+                }
+            }
+            written++;
+        }
+
+        buf->vertexCount = baseVertex + (deindex ? written * 3 : pos.count);
+        buf->indexCount = baseIndex + written * 3;
+        if (g_geometry_skins[handle - 1])
+            g_geometry_skins[handle - 1]->vertexCount = buf->vertexCount;
+
+        // Material ids cover the whole buffer once any primitive is tagged
+        if (g_gltf_material >= 0 || g_geometry_materials[handle - 1])
+        {
+            FaceMaterials *materials = ensure_face_materials(handle - 1, buf->indexCount / 3);
+            if (!materials)
+                return -1;
+            memset(&materials->ids[baseIndex / 3], g_gltf_material > 0 ? g_gltf_material : 0, (size_t)written);
+        }
+        return written;
+    }
+
+    // Flat face normals for a buffer whose vertices have none
+    // (GLTFLoader.calculateNormalsIfMissing). Returns 1 if normals were generated.
+    EMSCRIPTEN_KEEPALIVE
+    int32_t gltf_finish_mesh(int32_t handle)
+    {
+        GeometryBuffer *buf = lookup_geometry_buffer(handle);
+        if (!buf)
+            return 0;
+        for (int32_t i = 0; i < buf->vertexCount; i++)
+        {
+            const float *n = &buf->vertices[i * 12 + 3];
+            if (n[0] * n[0] + n[1] * n[1] + n[2] * n[2] > 0.001f)
+                return 0;
+        }
+        for (int32_t t = 0; t + 2 < buf->indexCount; t += 3)
+        {
+            float *a = &buf->vertices[buf->indices[t] * 12];
+            float *b = &buf->vertices[buf->indices[t + 1] * 12];
+            float *c = &buf->vertices[buf->indices[t + 2] * 12];
+            Vec3 e1(b[0] - a[0], b[1] - a[1], b[2] - a[2]);
+            Vec3 e2(c[0] - a[0], c[1] - a[1], c[2] - a[2]);
+            Vec3 n = e1.cross(e2).normalize();
+            float *corners[3] = {a, b, c};
+            for (int k = 0; k < 3; k++)
+            {
+                corners[k][3] = n.x;
+                corners[k][4] = n.y;
+                corners[k][5] = n.z;
+            }
+        }
+        return 1;
+    }
+
+
+    // ============================================================================
+    // Compressed Mesh Codec (scene files / worker transfer)
+    // ============================================================================
+    //
+    // meshopt-style codec for geometry buffers:
+    //  - Vertices are quantized to 16 bytes (u16 positions and UVs over their
+    //    bounds, octahedral i8 normal, u8 RGBA), then each byte lane is delta +
+    //    zigzag coded against the previous vertex and bit-packed in groups of 16
+    //    at 0/2/4/8 bits (2-bit group headers).
+    //  - Triangles are coded one byte each against a FIFO of recent edges and
+    //    vertices; only vertices not seen recently cost an extra varint.
+    //    Triangles may come back rotated (winding is preserved).
+    //
+    // Layout: MeshCodecHeader, vertex stream (vertexStreamSize bytes), index stream.
+
+    constexpr uint32_t MESH_CODEC_MAGIC = 0x314D5350; // "PSM1"
+    constexpr int MESH_CODEC_VERTEX_SIZE = 16;       // Quantized bytes per vertex
+    constexpr int MESH_CODEC_BLOCK_VERTICES = 256;   // Vertices per vertex block
+    constexpr int MESH_CODEC_GROUP = 16;             // Deltas per bit-packed group
+    constexpr int MESH_CODEC_FIFO_SIZE = 16;   // Power of two (slots masked)
+    constexpr int MESH_CODEC_EDGE_REFS = 15;   // Edge slots addressable by a code
+    constexpr int MESH_CODEC_VERTEX_REFS = 14; // Vertex slots addressable by a code
+
+    struct MeshCodecHeader
+    {
+        uint32_t magic;
+        uint32_t vertexCount;
+        uint32_t indexCount;
+        uint32_t vertexStreamSize;
+        uint8_t positionBits;
+        uint8_t uvBits;
+        uint16_t reserved;
+        float positionMin[3];
+        float positionScale[3]; // Dequantize: min + q * scale
+        float uvMin[2];
+        float uvScale[2];
+    };
+
+    static uint8_t *g_codec_output = nullptr;
+    static int32_t g_codec_output_capacity = 0;
+    static int32_t g_codec_output_size = 0;
+
+    static inline uint8_t codec_zigzag8(uint8_t v)
+    {
+        return (uint8_t)(((int8_t)v >> 7) ^ (v << 1));
+    }
+
+    static inline uint8_t codec_unzigzag8(uint8_t v)
+    {
+        return (uint8_t)(-(v & 1) ^ (v >> 1));
+    }
+
+    static inline uint16_t codec_quantize(float v, float min, float invScale, uint32_t maxValue)
+    {
+        float q = (v - min) * invScale + 0.5f;
+        if (!(q > 0.0f))
+            return 0;
+        return (uint16_t)(q >= (float)maxValue ? maxValue : (uint32_t)q);
+    }
+
+    // Octahedral encoding of a unit vector to two signed bytes
+    static inline void codec_encode_normal(const float *n, uint8_t *out)
+    {
+        float l1 = fabsf(n[0]) + fabsf(n[1]) + fabsf(n[2]);
+        if (!(l1 > 1e-8f))
+        {
+            // Zero normal gets its own code so it round-trips (loaders use it to
+            // detect "no normals"); the octahedral range is only -127..127
+            out[0] = out[1] = 0x80;
+            return;
+        }
+        float x = n[0] / l1;
+        float y = n[1] / l1;
+        if (n[2] < 0.0f)
+        {
+            float ox = (1.0f - fabsf(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+            float oy = (1.0f - fabsf(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+            x = ox;
+            y = oy;
+        }
+        out[0] = (uint8_t)(int8_t)lrintf(x * 127.0f);
+        out[1] = (uint8_t)(int8_t)lrintf(y * 127.0f);
+    }
+
+    static inline void codec_decode_normal(const uint8_t *in, float *n)
+    {
+        if (in[0] == 0x80 && in[1] == 0x80)
+        {
+            n[0] = n[1] = n[2] = 0.0f;
+            return;
+        }
+        float x = (int8_t)in[0] * (1.0f / 127.0f);
+        float y = (int8_t)in[1] * (1.0f / 127.0f);
+        float z = 1.0f - fabsf(x) - fabsf(y);
+        if (z < 0.0f)
+        {
+            float ox = (1.0f - fabsf(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+            float oy = (1.0f - fabsf(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+            x = ox;
+            y = oy;
+        }
+        float inv = 1.0f / sqrtf(x * x + y * y + z * z);
+        n[0] = x * inv;
+        n[1] = y * inv;
+        n[2] = z * inv;
+    }
+
+    static inline uint8_t *codec_write_varint(uint8_t *p, uint32_t v)
+    {
+        while (v >= 0x80)
+        {
+            *p++ = (uint8_t)(v | 0x80);
+            v >>= 7;
+        }
+        *p++ = (uint8_t)v;
+        return p;
+    }
+
+    static inline const uint8_t *codec_read_varint(const uint8_t *p, const uint8_t *end, uint32_t &v)
+    {
+        v = 0;
+        for (int shift = 0; shift < 35 && p < end; shift += 7)
+        {
+            uint8_t b = *p++;
+            v |= (uint32_t)(b & 0x7f) << shift;
+            if (!(b & 0x80))
+                return p;
+        }
+        return nullptr;
+    }
+
+    // Bit-pack one byte lane of a block (count deltas, already zigzagged)
+    static uint8_t *codec_encode_lane(uint8_t *p, const uint8_t *deltas, int32_t count)
+    {
+        int32_t groups = (count + MESH_CODEC_GROUP - 1) / MESH_CODEC_GROUP;
+        uint8_t *header = p;
+        p += (groups + 3) / 4;
+        __builtin_memset(header, 0, (groups + 3) / 4);
+
+        for (int32_t g = 0; g < groups; g++)
+        {
+            uint8_t group[MESH_CODEC_GROUP] = {0};
+            int32_t n = count - g * MESH_CODEC_GROUP;
+            if (n > MESH_CODEC_GROUP)
+                n = MESH_CODEC_GROUP;
+            uint8_t maxValue = 0;
+            for (int32_t i = 0; i < n; i++)
+            {
+                group[i] = deltas[g * MESH_CODEC_GROUP + i];
+                maxValue |= group[i];
+            }
+
+            int32_t mode = maxValue == 0 ? 0 : maxValue < 4 ? 1 : maxValue < 16 ? 2 : 3;
+            header[g >> 2] |= (uint8_t)(mode << ((g & 3) * 2));
+            if (mode == 1)
+            {
+                for (int32_t i = 0; i < MESH_CODEC_GROUP; i += 4)
+                    *p++ = (uint8_t)(group[i] | (group[i + 1] << 2) | (group[i + 2] << 4) | (group[i + 3] << 6));
+            }
+            else if (mode == 2)
+            {
+                for (int32_t i = 0; i < MESH_CODEC_GROUP; i += 2)
+                    *p++ = (uint8_t)(group[i] | (group[i + 1] << 4));
+            }
+            else if (mode == 3)
+            {
+                __builtin_memcpy(p, group, MESH_CODEC_GROUP);
+                p += MESH_CODEC_GROUP;
+            }
+        }
+        return p;
+    }
+
+    // Unpack one byte lane of a block into out[0..groups*16)
+    static const uint8_t *codec_decode_lane(const uint8_t *p, const uint8_t *end, uint8_t *out, int32_t count)
+    {
+        int32_t groups = (count + MESH_CODEC_GROUP - 1) / MESH_CODEC_GROUP;
+        const uint8_t *header = p;
+        p += (groups + 3) / 4;
+        if (p > end)
+            return nullptr;
+
+        for (int32_t g = 0; g < groups; g++, out += MESH_CODEC_GROUP)
+        {
+            int32_t mode = (header[g >> 2] >> ((g & 3) * 2)) & 3;
+            int32_t bytes = mode == 0 ? 0 : mode == 1 ? 4 : mode == 2 ? 8 : 16;
+            if (p + bytes > end)
+                return nullptr;
+            switch (mode)
+            {
+            case 0:
+                __builtin_memset(out, 0, MESH_CODEC_GROUP);
+                break;
+            case 1:
+                for (int32_t i = 0; i < 4; i++)
+                {
+                    uint8_t b = p[i];
+                    out[i * 4] = b & 3;
+                    out[i * 4 + 1] = (b >> 2) & 3;
+                    out[i * 4 + 2] = (b >> 4) & 3;
+                    out[i * 4 + 3] = b >> 6;
+                }
+                break;
+            case 2:
+                for (int32_t i = 0; i < 8; i++)
+                {
+                    out[i * 2] = p[i] & 15;
+                    out[i * 2 + 1] = p[i] >> 4;
+                }
+                break;
+            default:
+                __builtin_memcpy(out, p, MESH_CODEC_GROUP);
+                break;
+            }
+            p += bytes;
+        }
+        return p;
+    }
+
+    static void codec_quantize_vertex(const float *v, const MeshCodecHeader &h,
+                                      const float *posInv, const float *uvInv, uint8_t *out)
+    {
+        uint32_t posMax = (1u << h.positionBits) - 1;
+        uint32_t uvMax = (1u << h.uvBits) - 1;
+        for (int c = 0; c < 3; c++)
+        {
+            uint16_t q = codec_quantize(v[c], h.positionMin[c], posInv[c], posMax);
+            __builtin_memcpy(out + c * 2, &q, 2);
+        }
+        for (int c = 0; c < 2; c++)
+        {
+            uint16_t q = codec_quantize(v[6 + c], h.uvMin[c], uvInv[c], uvMax);
+            __builtin_memcpy(out + 6 + c * 2, &q, 2);
+        }
+        codec_encode_normal(&v[3], out + 10);
+        for (int c = 0; c < 4; c++)
+        {
+            float col = v[8 + c];
+            out[12 + c] = (uint8_t)(col <= 0.0f ? 0 : col >= 255.0f ? 255 : (int)(col + 0.5f));
+        }
+    }
+
+    // Index codec: code byte per triangle.
+    //   hi < 15: triangle shares FIFO edge hi (reversed); lo selects the third vertex:
+    //            0 = next new vertex, 1..14 = vertex FIFO slot, 15 = explicit varint
+    //   0xF0:    three consecutive new vertices
+    //   0xFF:    three explicit varints
+    // Explicit vertices are zigzag deltas from the previous explicit vertex.
+    struct CodecIndexState
+    {
+        uint32_t edges[MESH_CODEC_FIFO_SIZE][2];
+        uint32_t vertices[MESH_CODEC_FIFO_SIZE];
+        int32_t edgeHead;
+        int32_t vertexHead;
+        uint32_t next;
+        uint32_t last;
+    };
+
+    static inline void codec_push_edge(CodecIndexState &s, uint32_t a, uint32_t b)
+    {
+        s.edges[s.edgeHead][0] = a;
+        s.edges[s.edgeHead][1] = b;
+        s.edgeHead = (s.edgeHead + 1) & (MESH_CODEC_FIFO_SIZE - 1);
+    }
+
+    static inline void codec_push_vertex(CodecIndexState &s, uint32_t v)
+    {
+        s.vertices[s.vertexHead] = v;
+        s.vertexHead = (s.vertexHead + 1) & (MESH_CODEC_FIFO_SIZE - 1);
+    }
+
+    // FIFO slot i counts back from the most recent entry
+    static inline int32_t codec_edge_slot(const CodecIndexState &s, int32_t i)
+    {
+        return (s.edgeHead - 1 - i) & (MESH_CODEC_FIFO_SIZE - 1);
+    }
+
+    static inline int32_t codec_vertex_slot(const CodecIndexState &s, int32_t i)
+    {
+        return (s.vertexHead - 1 - i) & (MESH_CODEC_FIFO_SIZE - 1);
+    }
+
+    static void codec_index_reset(CodecIndexState &s)
+    {
+        // ~0 never matches a real index
+        __builtin_memset(&s, 0xff, sizeof(CodecIndexState));
+        s.edgeHead = 0;
+        s.vertexHead = 0;
+        s.next = 0;
+        s.last = 0;
+    }
+
+    // Record a decoded/encoded triangle in the FIFOs
+    static inline void codec_index_update(CodecIndexState &s, uint32_t a, uint32_t b, uint32_t c)
+    {
+        codec_push_edge(s, a, b);
+        codec_push_edge(s, b, c);
+        codec_push_edge(s, c, a);
+        codec_push_vertex(s, a);
+        codec_push_vertex(s, b);
+        codec_push_vertex(s, c);
+        if (a == s.next)
+            s.next++;
+        if (b == s.next)
+            s.next++;
+        if (c == s.next)
+            s.next++;
+    }
+
+    static inline uint8_t *codec_write_explicit(uint8_t *p, CodecIndexState &s, uint32_t v)
+    {
+        int32_t delta = (int32_t)(v - s.last);
+        p = codec_write_varint(p, ((uint32_t)delta << 1) ^ (uint32_t)(delta >> 31));
+        s.last = v;
+        return p;
+    }
+
+    static inline const uint8_t *codec_read_explicit(const uint8_t *p, const uint8_t *end,
+                                                     CodecIndexState &s, uint32_t &v)
+    {
+        uint32_t z = 0;
+        p = codec_read_varint(p, end, z);
+        int32_t delta = (int32_t)(z >> 1) ^ -(int32_t)(z & 1);
+        v = s.last + (uint32_t)delta;
+        s.last = v;
+        return p;
+    }
+
+    static uint8_t *codec_encode_indices(uint8_t *p, const uint32_t *indices, int32_t triCount)
+    {
+        CodecIndexState s;
+        codec_index_reset(s);
+
+        for (int32_t t = 0; t < triCount; t++)
+        {
+            uint32_t tri[3] = {indices[t * 3], indices[t * 3 + 1], indices[t * 3 + 2]};
+
+            // Find a rotation whose first edge is a reversed FIFO edge
+            int32_t edge = -1, rotation = 0;
+            for (int32_t i = 0; i < MESH_CODEC_EDGE_REFS && edge < 0; i++)
+            {
+                const uint32_t *e = s.edges[codec_edge_slot(s, i)];
+                for (int32_t r = 0; r < 3; r++)
+                {
+                    if (tri[r] == e[1] && tri[(r + 1) % 3] == e[0])
+                    {
+                        edge = i;
+                        rotation = r;
+                        break;
+                    }
+                }
+            }
+
+            if (edge >= 0)
+            {
+                uint32_t a = tri[rotation], b = tri[(rotation + 1) % 3], c = tri[(rotation + 2) % 3];
+                int32_t lo = 15;
+                if (c == s.next)
+                {
+                    lo = 0;
+                }
+                else
+                {
+                    for (int32_t i = 0; i < MESH_CODEC_VERTEX_REFS; i++)
+                    {
+                        if (s.vertices[codec_vertex_slot(s, i)] == c)
+                        {
+                            lo = i + 1;
+                            break;
+                        }
+                    }
+                }
+                *p++ = (uint8_t)((edge << 4) | lo);
+                if (lo == 15)
+                    p = codec_write_explicit(p, s, c);
+                codec_index_update(s, a, b, c);
+            }
+            else if (tri[0] == s.next && tri[1] == s.next + 1 && tri[2] == s.next + 2)
+            {
+                *p++ = 0xF0;
+                codec_index_update(s, tri[0], tri[1], tri[2]);
+            }
+            else
+            {
+                *p++ = 0xFF;
+                for (int k = 0; k < 3; k++)
+                    p = codec_write_explicit(p, s, tri[k]);
+                codec_index_update(s, tri[0], tri[1], tri[2]);
+            }
+        }
+        return p;
+    }
+
+    static const uint8_t *codec_decode_indices(const uint8_t *p, const uint8_t *end,
+                                               uint32_t *indices, int32_t triCount, uint32_t vertexCount)
+    {
+        CodecIndexState s;
+        codec_index_reset(s);
+
+        for (int32_t t = 0; t < triCount; t++)
+        {
+            if (p >= end)
+                return nullptr;
+            uint8_t code = *p++;
+            uint32_t a, b, c;
+            int32_t hi = code >> 4, lo = code & 15;
+
+            if (hi < 15)
+            {
+                const uint32_t *e = s.edges[codec_edge_slot(s, hi)];
+                a = e[1];
+                b = e[0];
+                if (lo == 0)
+                    c = s.next;
+                else if (lo < 15)
+                    c = s.vertices[codec_vertex_slot(s, lo - 1)];
+                else if (!(p = codec_read_explicit(p, end, s, c)))
+                    return nullptr;
+            }
+            else if (lo == 0)
+            {
+                a = s.next;
+                b = s.next + 1;
+                c = s.next + 2;
+            }
+            else
+            {
+                if (!(p = codec_read_explicit(p, end, s, a)) ||
+                    !(p = codec_read_explicit(p, end, s, b)) ||
+                    !(p = codec_read_explicit(p, end, s, c)))
+                    return nullptr;
+            }
+
+            if (a >= vertexCount || b >= vertexCount || c >= vertexCount)
+                return nullptr;
+            indices[t * 3] = a;
+            indices[t * 3 + 1] = b;
+            indices[t * 3 + 2] = c;
+            codec_index_update(s, a, b, c);
+        }
+        return p;
+    }
+
+    // Encode a geometry buffer. Bits (1-16) set position/UV quantization precision.
+    // Returns the encoded size (0 on failure); read it via mesh_codec_get_output_ptr.
+    EMSCRIPTEN_KEEPALIVE
+    int32_t mesh_encode(int32_t handle, int32_t positionBits, int32_t uvBits)
+    {
+        GeometryBuffer *buf = lookup_geometry_buffer(handle);
+        g_codec_output_size = 0;
+        if (!buf || buf->vertexCount <= 0)
+            return 0;
+        positionBits = positionBits < 1 ? 1 : positionBits > 16 ? 16 : positionBits;
+        uvBits = uvBits < 1 ? 1 : uvBits > 16 ? 16 : uvBits;
+
+        int32_t vertexCount = buf->vertexCount;
+        int32_t triCount = buf->indexCount / 3;
+
+        MeshCodecHeader h;
+        __builtin_memset(&h, 0, sizeof(h));
+        h.magic = MESH_CODEC_MAGIC;
+        h.vertexCount = (uint32_t)vertexCount;
+        h.indexCount = (uint32_t)(triCount * 3);
+        h.positionBits = (uint8_t)positionBits;
+        h.uvBits = (uint8_t)uvBits;
+
+        // Attribute bounds
+        float posMax[3], uvMax[2];
+        for (int c = 0; c < 3; c++)
+            h.positionMin[c] = posMax[c] = buf->vertices[c];
+        for (int c = 0; c < 2; c++)
+            h.uvMin[c] = uvMax[c] = buf->vertices[6 + c];
+        for (int32_t i = 1; i < vertexCount; i++)
+        {
+            const float *v = &buf->vertices[i * 12];
+            for (int c = 0; c < 3; c++)
+            {
+                h.positionMin[c] = fminf(h.positionMin[c], v[c]);
+                posMax[c] = fmaxf(posMax[c], v[c]);
+            }
+            for (int c = 0; c < 2; c++)
+            {
+                h.uvMin[c] = fminf(h.uvMin[c], v[6 + c]);
+                uvMax[c] = fmaxf(uvMax[c], v[6 + c]);
+            }
+        }
+        float posInv[3], uvInv[2];
+        float posSteps = (float)((1u << positionBits) - 1);
+        float uvSteps = (float)((1u << uvBits) - 1);
+        for (int c = 0; c < 3; c++)
+        {
+            float extent = posMax[c] - h.positionMin[c];
+            h.positionScale[c] = extent / posSteps;
+            posInv[c] = extent > 0.0f ? posSteps / extent : 0.0f;
+        }
+        for (int c = 0; c < 2; c++)
+        {
+            float extent = uvMax[c] - h.uvMin[c];
+            h.uvScale[c] = extent / uvSteps;
+            uvInv[c] = extent > 0.0f ? uvSteps / extent : 0.0f;
+        }
+
+        // Worst case: raw lanes + group headers per block, 1 code + 3 varints per triangle
+        int32_t blocks = (vertexCount + MESH_CODEC_BLOCK_VERTICES - 1) / MESH_CODEC_BLOCK_VERTICES;
+        int64_t worst = (int64_t)sizeof(MeshCodecHeader) +
+                        (int64_t)blocks * MESH_CODEC_VERTEX_SIZE * (MESH_CODEC_BLOCK_VERTICES + 4) +
+                        (int64_t)triCount * 16;
+        if (worst > 0x7fffffff || !grow_array(g_codec_output, g_codec_output_capacity, (int32_t)worst))
+            return 0;
+
+        uint8_t *p = g_codec_output + sizeof(MeshCodecHeader);
+        uint8_t *vertexStream = p;
+        alignas(16) uint8_t quantized[MESH_CODEC_BLOCK_VERTICES * MESH_CODEC_VERTEX_SIZE];
+        uint8_t deltas[MESH_CODEC_BLOCK_VERTICES];
+        uint8_t prev[MESH_CODEC_VERTEX_SIZE] = {0};
+
+        for (int32_t base = 0; base < vertexCount; base += MESH_CODEC_BLOCK_VERTICES)
+        {
+            int32_t count = vertexCount - base;
+            if (count > MESH_CODEC_BLOCK_VERTICES)
+                count = MESH_CODEC_BLOCK_VERTICES;
+            for (int32_t i = 0; i < count; i++)
+                codec_quantize_vertex(&buf->vertices[(base + i) * 12], h, posInv, uvInv,
+                                      &quantized[i * MESH_CODEC_VERTEX_SIZE]);
+
+            for (int32_t k = 0; k < MESH_CODEC_VERTEX_SIZE; k++)
+            {
+                uint8_t last = prev[k];
+                for (int32_t i = 0; i < count; i++)
+                {
+                    uint8_t value = quantized[i * MESH_CODEC_VERTEX_SIZE + k];
+                    deltas[i] = codec_zigzag8((uint8_t)(value - last));
+                    last = value;
+                }
+                prev[k] = last;
+                p = codec_encode_lane(p, deltas, count);
+            }
+        }
+        h.vertexStreamSize = (uint32_t)(p - vertexStream);
+
+        p = codec_encode_indices(p, buf->indices, triCount);
+
+        __builtin_memcpy(g_codec_output, &h, sizeof(h));
+        g_codec_output_size = (int32_t)(p - g_codec_output);
+        return g_codec_output_size;
+    }
+
+    EMSCRIPTEN_KEEPALIVE
+    uint8_t *mesh_codec_get_output_ptr()
+    {
+        return g_codec_output;
+    }
+
+    // Get a buffer for JS to copy encoded data into before mesh_decode
+    EMSCRIPTEN_KEEPALIVE
+    uint8_t *mesh_codec_get_input_ptr(int32_t size)
+    {
+        if (!grow_array(g_codec_output, g_codec_output_capacity, size))
+            return nullptr;
+        return g_codec_output;
+    }
+
+    // Decode a validated header's streams into vertices (12 floats each) and
+    // indices. Returns false if a stream is truncated or malformed.
+    static bool codec_decode_mesh(const MeshCodecHeader &h, const uint8_t *p, const uint8_t *vertexEnd,
+                                  const uint8_t *end, float *vertices, uint32_t *indices)
+    {
+        int32_t vertexCount = (int32_t)h.vertexCount;
+        alignas(16) uint8_t quantized[MESH_CODEC_BLOCK_VERTICES * MESH_CODEC_VERTEX_SIZE];
+        alignas(16) uint8_t deltas[MESH_CODEC_BLOCK_VERTICES];
+        uint8_t prev[MESH_CODEC_VERTEX_SIZE] = {0};
+
+        for (int32_t base = 0; base < vertexCount; base += MESH_CODEC_BLOCK_VERTICES)
+        {
+            int32_t count = vertexCount - base;
+            if (count > MESH_CODEC_BLOCK_VERTICES)
+                count = MESH_CODEC_BLOCK_VERTICES;
+
+            for (int32_t k = 0; k < MESH_CODEC_VERTEX_SIZE; k++)
+            {
+                if (!(p = codec_decode_lane(p, vertexEnd, deltas, count)))
+                    return false;
+                uint8_t last = prev[k];
+                for (int32_t i = 0; i < count; i++)
+                {
+                    last = (uint8_t)(last + codec_unzigzag8(deltas[i]));
+                    quantized[i * MESH_CODEC_VERTEX_SIZE + k] = last;
+                }
+                prev[k] = last;
+            }
+
+            // Dequantize the block into the 12-float layout
+            for (int32_t i = 0; i < count; i++)
+            {
+                const uint8_t *q = &quantized[i * MESH_CODEC_VERTEX_SIZE];
+                float *v = &vertices[(base + i) * 12];
+                uint16_t u[5];
+                __builtin_memcpy(u, q, 10);
+                v[0] = h.positionMin[0] + u[0] * h.positionScale[0];
+                v[1] = h.positionMin[1] + u[1] * h.positionScale[1];
+                v[2] = h.positionMin[2] + u[2] * h.positionScale[2];
+                codec_decode_normal(q + 10, &v[3]);
+                v[6] = h.uvMin[0] + u[3] * h.uvScale[0];
+                v[7] = h.uvMin[1] + u[4] * h.uvScale[1];
+                v[8] = q[12];
+                v[9] = q[13];
+                v[10] = q[14];
+                v[11] = q[15];
+            }
+        }
+
+        return codec_decode_indices(vertexEnd, end, indices, (int32_t)h.indexCount / 3, h.vertexCount);
+    }
+
+    // Decode size bytes at data into a geometry buffer (replacing its contents).
+    // The mesh is decoded into new arrays first, so malformed data leaves the
+    // buffer untouched. Returns the vertex count, or -1 if the data is malformed.
+    EMSCRIPTEN_KEEPALIVE
+    int32_t mesh_decode(int32_t handle, const uint8_t *data, int32_t size)
+    {
+        GeometryBuffer *buf = lookup_geometry_buffer(handle);
+        if (!buf || !data || size < (int32_t)sizeof(MeshCodecHeader))
+            return -1;
+
+        MeshCodecHeader h;
+        __builtin_memcpy(&h, data, sizeof(h));
+        if (h.magic != MESH_CODEC_MAGIC || h.vertexCount > 0x7fffffff / 48 ||
+            h.indexCount > 0x7fffffff / 4 || h.indexCount % 3 != 0 ||
+            h.vertexStreamSize > (uint32_t)size - sizeof(MeshCodecHeader))
+            return -1;
+
+        int32_t vertexCount = (int32_t)h.vertexCount;
+        int32_t indexCount = (int32_t)h.indexCount;
+        int32_t vertexCapacity = (vertexCount > 0 ? vertexCount : 1) * 12;
+        int32_t indexCapacity = indexCount > 0 ? indexCount : 1;
+        float *vertices = (float *)malloc((size_t)vertexCapacity * sizeof(float));
+        uint32_t *indices = (uint32_t *)malloc((size_t)indexCapacity * sizeof(uint32_t));
+        const uint8_t *streams = data + sizeof(MeshCodecHeader);
+        if (!vertices || !indices ||
+            !codec_decode_mesh(h, streams, streams + h.vertexStreamSize, data + size, vertices, indices))
+        {
+            free(vertices);
+            free(indices);
+            return -1;
+        }
+
+        free(buf->vertices);
+        free(buf->indices);
+        buf->vertices = vertices;
+        buf->indices = indices;
+        buf->vertexCapacity = vertexCapacity;
+        buf->indexCapacity = indexCapacity;
+        buf->vertexCount = vertexCount;
+        buf->indexCount = indexCount;
+        invalidate_geometry_caches(handle);
+        return vertexCount;
+    }
+
+
+    // ============================================================================
+    // Renderer State Snapshot
+    // ============================================================================
+    //
+    // snapshot_state() writes every live geometry buffer, texture buffer, fixed
+    // texture slot and the bake output into one contiguous versioned image that
+    // JS can cache (IndexedDB / disk). restore_state() validates an image and
+    // rebuilds the same handles from it with bulk copies.
+    //
+    // Layout (little-endian, 4-byte aligned):
+    //   SnapshotHeader, then sections of {tag, size} + payload
+    //   GEOM: handle, vertexCount, indexCount, vertices, indices
+    //   SKIN: handle, vertexCount, joints (u16), weights
+    //   MRPH: handle, vertexCount, targetCount, targetStart[targetCount + 1],
+    //         weights[targetCount], entry vertices, entry deltas
+    //   MATL: handle, triangleCount, material ids (u8)
+    //   LITE: handle (static lighting enabled)
+    //   TEXB: handle, width, height, RGBA
+    //   TEXS: slot, width, height, RGBA (fixed g_textures slots)
+    //   BAKE: width, height, RGBA
+    //
+    // SKIN/MRPH/MATL/LITE follow their buffer's GEOM section (version 2;
+    // version 1 images restore without them). Derived per-buffer state (BVHs,
+    // spatial hashes, cached normals, lighting bakes) is rebuilt on demand;
+    // LOD chains are not stored and must be rebuilt by the caller.
+
+    constexpr uint32_t SNAPSHOT_MAGIC = 0x54535350; // "PSST"
+    constexpr uint32_t SNAPSHOT_VERSION = 2;
+    constexpr uint32_t SNAPSHOT_TAG_GEOMETRY = 0x4D4F4547; // "GEOM"
+    constexpr uint32_t SNAPSHOT_TAG_SKIN = 0x4E494B53;           // "SKIN"
+    constexpr uint32_t SNAPSHOT_TAG_MORPHS = 0x4850524D;         // "MRPH"
+    constexpr uint32_t SNAPSHOT_TAG_MATERIALS = 0x4C54414D;      // "MATL"
+    constexpr uint32_t SNAPSHOT_TAG_LIGHTING = 0x4554494C;       // "LITE"
+    constexpr uint32_t SNAPSHOT_TAG_TEXTURE_BUFFER = 0x42584554; // "TEXB"
+    constexpr uint32_t SNAPSHOT_TAG_TEXTURE_SLOT = 0x53584554;   // "TEXS"
+    constexpr uint32_t SNAPSHOT_TAG_BAKE = 0x454B4142;           // "BAKE"
+
+    struct SnapshotHeader
+    {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t totalSize; // Including this header
+        uint32_t sectionCount;
+    };
+
+    static uint8_t *g_snapshot = nullptr;
+    static int32_t g_snapshot_capacity = 0;
+
+    static inline uint32_t snapshot_align(uint64_t size)
+    {
+        return (uint32_t)((size + 3) & ~(uint64_t)3);
+    }
+
+    static inline uint8_t *snapshot_write_u32(uint8_t *p, uint32_t v)
+    {
+        __builtin_memcpy(p, &v, 4);
+        return p + 4;
+    }
+
+    static inline uint8_t *snapshot_write_section(uint8_t *p, uint32_t tag, uint32_t size)
+    {
+        p = snapshot_write_u32(p, tag);
+        return snapshot_write_u32(p, size);
+    }
+
+    // Copy bytes and zero the padding up to 4-byte alignment
+    static inline uint8_t *snapshot_write_bytes(uint8_t *p, const void *data, uint32_t size)
+    {
+        if (size > 0)
+            __builtin_memcpy(p, data, size);
+        uint32_t padded = snapshot_align(size);
+        __builtin_memset(p + size, 0, padded - size);
+        return p + padded;
+    }
+
+    // Payload size of each section type
+    static inline uint64_t snapshot_geometry_size(const GeometryBuffer *buf)
+    {
+        return 12 + (uint64_t)buf->vertexCount * 12 * sizeof(float) +
+               (uint64_t)buf->indexCount * sizeof(uint32_t);
+    }
+
+    static inline uint64_t snapshot_skin_size(uint64_t vertexCount)
+    {
+        return 8 + snapshot_align(vertexCount * SKIN_INFLUENCES * 2) + vertexCount * SKIN_INFLUENCES * 4;
+    }
+
+    static inline uint64_t snapshot_morph_size(uint64_t targetCount, uint64_t entryCount)
+    {
+        return 12 + (targetCount * 2 + 1) * 4 + entryCount * 28;
+    }
+
+    // Extra per-buffer sections of a slot (skin, morphs, materials, lighting);
+    // adds their sizes to *total and returns the section count
+    static uint32_t snapshot_buffer_extras_size(int32_t slot, uint64_t *total)
+    {
+        uint32_t sections = 0;
+        const SkinData *skin = g_geometry_skins[slot];
+        const MorphSet *morph = g_geometry_morphs[slot];
+        const FaceMaterials *materials = g_geometry_materials[slot];
+        if (skin && skin->vertexCount > 0)
+        {
+            *total += 8 + snapshot_skin_size((uint64_t)skin->vertexCount);
+            sections++;
+        }
+        if (morph && morph->targetCount > 0)
+        {
+            *total += 8 + snapshot_morph_size((uint64_t)morph->targetCount,
+                                              (uint64_t)morph->targetStart[morph->targetCount]);
+            sections++;
+        }
+        if (materials && materials->triangleCount > 0)
+        {
+            *total += 8 + 8 + snapshot_align((uint64_t)materials->triangleCount);
+            sections++;
+        }
+        if (g_geometry_lighting[slot])
+        {
+            *total += 8 + 4;
+            sections++;
+        }
+        return sections;
+    }
+
+    static uint8_t *snapshot_write_buffer_extras(uint8_t *p, int32_t slot)
+    {
+        const SkinData *skin = g_geometry_skins[slot];
+        const MorphSet *morph = g_geometry_morphs[slot];
+        const FaceMaterials *materials = g_geometry_materials[slot];
+        if (skin && skin->vertexCount > 0)
+        {
+            uint32_t count = (uint32_t)skin->vertexCount * SKIN_INFLUENCES;
+            p = snapshot_write_section(p, SNAPSHOT_TAG_SKIN, (uint32_t)snapshot_skin_size((uint64_t)skin->vertexCount));
+            p = snapshot_write_u32(p, (uint32_t)(slot + 1));
+            p = snapshot_write_u32(p, (uint32_t)skin->vertexCount);
+            p = snapshot_write_bytes(p, skin->joints, count * sizeof(uint16_t));
+            p = snapshot_write_bytes(p, skin->weights, count * sizeof(float));
+        }
+        if (morph && morph->targetCount > 0)
+        {
+            int32_t targets = morph->targetCount, entries = morph->targetStart[targets];
+            p = snapshot_write_section(p, SNAPSHOT_TAG_MORPHS,
+                                       (uint32_t)snapshot_morph_size((uint64_t)targets, (uint64_t)entries));
+            p = snapshot_write_u32(p, (uint32_t)(slot + 1));
+            p = snapshot_write_u32(p, (uint32_t)morph->vertexCount);
+            p = snapshot_write_u32(p, (uint32_t)targets);
+            p = snapshot_write_bytes(p, morph->targetStart, (uint32_t)(targets + 1) * sizeof(int32_t));
+            p = snapshot_write_bytes(p, morph->weights, (uint32_t)targets * sizeof(float));
+            p = snapshot_write_bytes(p, morph->indices, (uint32_t)entries * sizeof(uint32_t));
+            p = snapshot_write_bytes(p, morph->deltas, (uint32_t)entries * 6 * sizeof(float));
+        }
+        if (materials && materials->triangleCount > 0)
+        {
+            p = snapshot_write_section(p, SNAPSHOT_TAG_MATERIALS,
+                                       8 + snapshot_align((uint64_t)materials->triangleCount));
+            p = snapshot_write_u32(p, (uint32_t)(slot + 1));
+            p = snapshot_write_u32(p, (uint32_t)materials->triangleCount);
+            p = snapshot_write_bytes(p, materials->ids, (uint32_t)materials->triangleCount);
+        }
+        if (g_geometry_lighting[slot])
+        {
+            p = snapshot_write_section(p, SNAPSHOT_TAG_LIGHTING, 4);
+            p = snapshot_write_u32(p, (uint32_t)(slot + 1));
+        }
+        return p;
+    }
+
+    static inline uint64_t snapshot_image_size(int32_t width, int32_t height)
+    {
+        return 12 + snapshot_align((uint64_t)width * height * 4);
+    }
+
+    // Write a snapshot of all renderer resources.
+    // Returns the image size (0 on failure); read it via get_snapshot_ptr.
+    EMSCRIPTEN_KEEPALIVE
+    int32_t snapshot_state()
+    {
+        // Size pass
+        uint64_t total = sizeof(SnapshotHeader);
+        uint32_t sections = 0;
+        for (int i = 0; i < MAX_GEOMETRY_BUFFERS; i++)
+        {
+            if (g_geometry_buffers[i])
+            {
+                total += 8 + snapshot_geometry_size(g_geometry_buffers[i]);
+                sections += 1 + snapshot_buffer_extras_size(i, &total);
+            }
+        }
+        for (int i = 0; i < MAX_TEXTURE_BUFFERS; i++)
+        {
+            const TextureBuffer *buf = g_texture_buffers[i];
+            if (buf)
+            {
+                total += 8 + snapshot_image_size(buf->data ? buf->width : 0, buf->data ? buf->height : 0);
+                sections++;
+            }
+        }
+        for (int i = 0; i < MAX_TEXTURES; i++)
+        {
+            int32_t w = g_texture_sizes[i * 2], h = g_texture_sizes[i * 2 + 1];
+            if (w > 0 && h > 0 && (int64_t)w * h * 4 <= MAX_TEXTURE_SIZE)
+            {
+                total += 8 + snapshot_image_size(w, h);
+                sections++;
+            }
+        }
+        total += 8 + 8;
+        sections++;
+        int32_t bakeWidth = g_bake_width, bakeHeight = g_bake_height;
+        if (bakeWidth <= 0 || bakeHeight <= 0 || (int64_t)bakeWidth * bakeHeight > MAX_BAKE_SIZE)
+            bakeWidth = bakeHeight = 0;
+        total += snapshot_align((uint64_t)bakeWidth * bakeHeight * 4);
+
+        if (total > 0x7fffffff || !grow_array(g_snapshot, g_snapshot_capacity, (int32_t)total))
+            return 0;
+
+        // Write pass
+        uint8_t *p = g_snapshot;
+        SnapshotHeader header = {SNAPSHOT_MAGIC, SNAPSHOT_VERSION, (uint32_t)total, sections};
+        __builtin_memcpy(p, &header, sizeof(header));
+        p += sizeof(header);
+
+        for (int i = 0; i < MAX_GEOMETRY_BUFFERS; i++)
+        {
+            const GeometryBuffer *buf = g_geometry_buffers[i];
+            if (!buf)
+                continue;
+            p = snapshot_write_section(p, SNAPSHOT_TAG_GEOMETRY, (uint32_t)snapshot_geometry_size(buf));
+            p = snapshot_write_u32(p, (uint32_t)(i + 1));
+            p = snapshot_write_u32(p, (uint32_t)buf->vertexCount);
+            p = snapshot_write_u32(p, (uint32_t)buf->indexCount);
+            p = snapshot_write_bytes(p, buf->vertices, (uint32_t)buf->vertexCount * 12 * sizeof(float));
+            p = snapshot_write_bytes(p, buf->indices, (uint32_t)buf->indexCount * sizeof(uint32_t));
+            p = snapshot_write_buffer_extras(p, i);
+        }
+        for (int i = 0; i < MAX_TEXTURE_BUFFERS; i++)
+        {
+            const TextureBuffer *buf = g_texture_buffers[i];
+            if (!buf)
+                continue;
+            int32_t w = buf->data ? buf->width : 0, h = buf->data ? buf->height : 0;
+            p = snapshot_write_section(p, SNAPSHOT_TAG_TEXTURE_BUFFER, (uint32_t)snapshot_image_size(w, h));
+            p = snapshot_write_u32(p, (uint32_t)(i + 1));
+            p = snapshot_write_u32(p, (uint32_t)w);
+            p = snapshot_write_u32(p, (uint32_t)h);
+            p = snapshot_write_bytes(p, buf->data, (uint32_t)(w * h * 4));
+        }
+        for (int i = 0; i < MAX_TEXTURES; i++)
+        {
+            int32_t w = g_texture_sizes[i * 2], h = g_texture_sizes[i * 2 + 1];
+            if (w <= 0 || h <= 0 || (int64_t)w * h * 4 > MAX_TEXTURE_SIZE)
+                continue;
+            p = snapshot_write_section(p, SNAPSHOT_TAG_TEXTURE_SLOT, (uint32_t)snapshot_image_size(w, h));
+            p = snapshot_write_u32(p, (uint32_t)i);
+            p = snapshot_write_u32(p, (uint32_t)w);
+            p = snapshot_write_u32(p, (uint32_t)h);
+            p = snapshot_write_bytes(p, g_textures[i], (uint32_t)(w * h * 4));
+        }
+        p = snapshot_write_section(p, SNAPSHOT_TAG_BAKE,
+                                   8 + snapshot_align((uint64_t)bakeWidth * bakeHeight * 4));
+        p = snapshot_write_u32(p, (uint32_t)bakeWidth);
+        p = snapshot_write_u32(p, (uint32_t)bakeHeight);
+        p = snapshot_write_bytes(p, g_bake_output, (uint32_t)(bakeWidth * bakeHeight * 4));
+
+        return (int32_t)(p - g_snapshot);
+    }
+
+    EMSCRIPTEN_KEEPALIVE
+    uint8_t *get_snapshot_ptr()
+    {
+        return g_snapshot;
+    }
+
+    // Get a buffer for JS to copy a cached image into before restore_state
+    EMSCRIPTEN_KEEPALIVE
+    uint8_t *get_snapshot_input_ptr(int32_t size)
+    {
+        if (!grow_array(g_snapshot, g_snapshot_capacity, size))
+            return nullptr;
+        return g_snapshot;
+    }
+
+    // Release the snapshot buffer once JS has stored the image
+    EMSCRIPTEN_KEEPALIVE
+    void free_snapshot()
+    {
+        free(g_snapshot);
+        g_snapshot = nullptr;
+        g_snapshot_capacity = 0;
+    }
+
+    static inline uint32_t snapshot_read_u32(const uint8_t *p)
+    {
+        uint32_t v;
+        __builtin_memcpy(&v, p, 4);
+        return v;
+    }
+
+    // Check one section's payload against its tag; returns false if malformed
+    static bool snapshot_validate_section(uint32_t tag, const uint8_t *payload, uint32_t size)
+    {
+        if (tag == SNAPSHOT_TAG_GEOMETRY)
+        {
+            if (size < 12)
+                return false;
+            uint32_t handle = snapshot_read_u32(payload);
+            uint64_t vertexCount = snapshot_read_u32(payload + 4);
+            uint64_t indexCount = snapshot_read_u32(payload + 8);
+            if (handle < 1 || handle > (uint32_t)MAX_GEOMETRY_BUFFERS ||
+                vertexCount * 12 > 0x7fffffff || indexCount > 0x7fffffff)
+                return false;
+            return 12 + vertexCount * 48 + indexCount * 4 == size;
+        }
+        if (tag == SNAPSHOT_TAG_SKIN || tag == SNAPSHOT_TAG_MORPHS || tag == SNAPSHOT_TAG_MATERIALS ||
+            tag == SNAPSHOT_TAG_LIGHTING)
+        {
+            if (size < 4)
+                return false;
+            uint32_t handle = snapshot_read_u32(payload);
+            if (handle < 1 || handle > (uint32_t)MAX_GEOMETRY_BUFFERS)
+                return false;
+            if (tag == SNAPSHOT_TAG_LIGHTING)
+                return size == 4;
+            if (size < 8)
+                return false;
+            uint64_t count = snapshot_read_u32(payload + 4);
+            if (tag == SNAPSHOT_TAG_SKIN)
+                return count * SKIN_INFLUENCES * 4 <= 0x7fffffff && snapshot_skin_size(count) == size;
+            if (tag == SNAPSHOT_TAG_MATERIALS)
+                return count <= 0x7fffffff && 8 + snapshot_align(count) == size;
+            if (size < 12)
+                return false;
+            uint64_t targets = snapshot_read_u32(payload + 8);
+            if (count > 0x7fffffff || targets > (uint64_t)MAX_MORPH_TARGETS || size < 12 + (targets * 2 + 1) * 4)
+                return false;
+            // Target ranges must start at 0 and never run backwards
+            uint32_t previous = 0;
+            for (uint64_t t = 0; t <= targets; t++)
+            {
+                uint32_t start = snapshot_read_u32(payload + 12 + t * 4);
+                if ((t == 0 && start != 0) || start < previous)
+                    return false;
+                previous = start;
+            }
+            return (uint64_t)previous * 6 <= 0x7fffffff && snapshot_morph_size(targets, previous) == size;
+        }
+        if (tag == SNAPSHOT_TAG_TEXTURE_BUFFER || tag == SNAPSHOT_TAG_TEXTURE_SLOT)
+        {
+            if (size < 12)
+                return false;
+            uint32_t index = snapshot_read_u32(payload);
+            uint64_t w = snapshot_read_u32(payload + 4);
+            uint64_t h = snapshot_read_u32(payload + 8);
+            if (tag == SNAPSHOT_TAG_TEXTURE_BUFFER && (index < 1 || index > (uint32_t)MAX_TEXTURE_BUFFERS))
+                return false;
+            if (tag == SNAPSHOT_TAG_TEXTURE_SLOT &&
+                (index >= (uint32_t)MAX_TEXTURES || w * h * 4 > (uint64_t)MAX_TEXTURE_SIZE))
+                return false;
+            return w * h * 4 <= 0x7fffffff && snapshot_image_size((int32_t)w, (int32_t)h) == size;
+        }
+        if (tag == SNAPSHOT_TAG_BAKE)
+        {
+            if (size < 8)
+                return false;
+            uint64_t w = snapshot_read_u32(payload);
+            uint64_t h = snapshot_read_u32(payload + 4);
+            return w * h <= (uint64_t)MAX_BAKE_SIZE && 8 + snapshot_align(w * h * 4) == size;
+        }
+        return true; // Unknown sections from newer writers are skipped
+    }
+
+    // Replace all renderer resources with the contents of a snapshot image.
+    // The image is fully validated first; on failure nothing is changed.
+    // Returns 1 on success, 0 on failure.
+    EMSCRIPTEN_KEEPALIVE
+    int32_t restore_state(const uint8_t *image, int32_t size)
+    {
+        if (!image || size < (int32_t)sizeof(SnapshotHeader))
+            return 0;
+        SnapshotHeader header;
+        __builtin_memcpy(&header, image, sizeof(header));
+        if (header.magic != SNAPSHOT_MAGIC || header.version < 1 || header.version > SNAPSHOT_VERSION ||
+            header.totalSize > (uint32_t)size)
+            return 0;
+
+        const uint8_t *end = image + header.totalSize;
+        const uint8_t *p = image + sizeof(SnapshotHeader);
+        for (uint32_t s = 0; s < header.sectionCount; s++)
+        {
+            if (end - p < 8)
+                return 0;
+            uint32_t tag = snapshot_read_u32(p);
+            uint32_t sectionSize = snapshot_read_u32(p + 4);
+            if (sectionSize > (uint32_t)(end - p - 8) ||
+                !snapshot_validate_section(tag, p + 8, sectionSize))
+                return 0;
+            p += 8 + snapshot_align(sectionSize);
+        }
+
+        // Drop current resources
+        bind_texture_buffer(0);
+        for (int i = 0; i < MAX_GEOMETRY_BUFFERS; i++)
+            delete_geometry_buffer(i + 1);
+        for (int i = 0; i < MAX_TEXTURE_BUFFERS; i++)
+            delete_texture_buffer(i + 1);
+        for (int i = 0; i < MAX_TEXTURES * 2; i++)
+            g_texture_sizes[i] = 0;
+
+        // Rebuild with the original handles
+        int32_t ok = 1;
+        p = image + sizeof(SnapshotHeader);
+        for (uint32_t s = 0; s < header.sectionCount; s++)
+        {
+            uint32_t tag = snapshot_read_u32(p);
+            uint32_t sectionSize = snapshot_read_u32(p + 4);
+            const uint8_t *payload = p + 8;
+            p += 8 + snapshot_align(sectionSize);
+
+            if (tag == SNAPSHOT_TAG_GEOMETRY)
+            {
+                int32_t slot = (int32_t)snapshot_read_u32(payload) - 1;
+                int32_t vertexCount = (int32_t)snapshot_read_u32(payload + 4);
+                int32_t indexCount = (int32_t)snapshot_read_u32(payload + 8);
+                GeometryBuffer *buf = (GeometryBuffer *)calloc(1, sizeof(GeometryBuffer));
+                if (!buf || (vertexCount > 0 && !grow_array(buf->vertices, buf->vertexCapacity, vertexCount * 12)) ||
+                    (indexCount > 0 && !grow_array(buf->indices, buf->indexCapacity, indexCount)))
+                {
+                    if (buf)
+                    {
+                        free(buf->vertices);
+                        free(buf);
+                    }
+                    ok = 0;
+                    continue;
+                }
+                uint32_t vertexBytes = (uint32_t)vertexCount * 12 * sizeof(float);
+                if (vertexCount > 0)
+                    __builtin_memcpy(buf->vertices, payload + 12, vertexBytes);
+                if (indexCount > 0)
+                    __builtin_memcpy(buf->indices, payload + 12 + vertexBytes, (size_t)indexCount * sizeof(uint32_t));
+                buf->vertexCount = vertexCount;
+                buf->indexCount = indexCount;
+                delete_geometry_buffer(slot + 1); // Duplicate handles: last one wins
+                g_geometry_buffers[slot] = buf;
+            }
+            else if (tag == SNAPSHOT_TAG_SKIN || tag == SNAPSHOT_TAG_MORPHS || tag == SNAPSHOT_TAG_MATERIALS ||
+                     tag == SNAPSHOT_TAG_LIGHTING)
+            {
+                int32_t slot = (int32_t)snapshot_read_u32(payload) - 1;
+                if (!g_geometry_buffers[slot])
+                    continue; // No GEOM section for this handle
+                if (tag == SNAPSHOT_TAG_LIGHTING)
+                {
+                    if (!g_geometry_lighting[slot])
+                        g_geometry_lighting[slot] = (LightingBake *)calloc(1, sizeof(LightingBake));
+                    ok = g_geometry_lighting[slot] ? ok : 0;
+                    continue;
+                }
+                int32_t count = (int32_t)snapshot_read_u32(payload + 4);
+                if (tag == SNAPSHOT_TAG_SKIN)
+                {
+                    free_skin_data(g_geometry_skins[slot]);
+                    g_geometry_skins[slot] = nullptr;
+                    SkinData *skin = count > 0 ? ensure_skin_data(slot, count) : nullptr;
+                    if (!skin)
+                    {
+                        ok = count > 0 ? 0 : ok;
+                        continue;
+                    }
+                    uint32_t jointBytes = (uint32_t)count * SKIN_INFLUENCES * sizeof(uint16_t);
+                    __builtin_memcpy(skin->joints, payload + 8, jointBytes);
+                    __builtin_memcpy(skin->weights, payload + 8 + snapshot_align(jointBytes),
+                                     (size_t)count * SKIN_INFLUENCES * sizeof(float));
+                }
+                else if (tag == SNAPSHOT_TAG_MATERIALS)
+                {
+                    free_face_materials(g_geometry_materials[slot]);
+                    g_geometry_materials[slot] = nullptr;
+                    FaceMaterials *materials = count > 0 ? ensure_face_materials(slot, count) : nullptr;
+                    if (!materials)
+                    {
+                        ok = count > 0 ? 0 : ok;
+                        continue;
+                    }
+                    __builtin_memcpy(materials->ids, payload + 8, (size_t)count);
+                }
+                else
+                {
+                    free_morph_set(g_geometry_morphs[slot]);
+                    g_geometry_morphs[slot] = nullptr;
+                    int32_t targets = (int32_t)snapshot_read_u32(payload + 8);
+                    const uint8_t *q = payload + 12;
+                    int32_t entries = (int32_t)snapshot_read_u32(q + targets * 4);
+                    MorphSet *morph = (MorphSet *)calloc(1, sizeof(MorphSet));
+                    if (!morph || !grow_array(morph->indices, morph->indexCapacity, entries > 0 ? entries : 1) ||
+                        !grow_array(morph->deltas, morph->deltaCapacity, (entries > 0 ? entries : 1) * 6))
+                    {
+                        free_morph_set(morph);
+                        ok = 0;
+                        continue;
+                    }
+                    __builtin_memcpy(morph->targetStart, q, (size_t)(targets + 1) * sizeof(int32_t));
+                    q += (targets + 1) * 4;
+                    __builtin_memcpy(morph->weights, q, (size_t)targets * sizeof(float));
+                    q += targets * 4;
+                    __builtin_memcpy(morph->indices, q, (size_t)entries * sizeof(uint32_t));
+                    __builtin_memcpy(morph->deltas, q + (size_t)entries * 4, (size_t)entries * 6 * sizeof(float));
+                    morph->targetCount = targets;
+                    morph->vertexCount = count;
+                    morph->dirty = 1;
+                    g_geometry_morphs[slot] = morph;
+                }
+            }
+            else if (tag == SNAPSHOT_TAG_TEXTURE_BUFFER)
+            {
+                int32_t slot = (int32_t)snapshot_read_u32(payload) - 1;
+                int32_t w = (int32_t)snapshot_read_u32(payload + 4);
+                int32_t h = (int32_t)snapshot_read_u32(payload + 8);
+                TextureBuffer *buf = (TextureBuffer *)calloc(1, sizeof(TextureBuffer));
+                if (!buf)
+                {
+                    ok = 0;
+                    continue;
+                }
+                delete_texture_buffer(slot + 1);
+                g_texture_buffers[slot] = buf;
+                if (w > 0 && h > 0)
+                {
+                    uint8_t *data = texture_buffer_alloc(slot + 1, w, h);
+                    if (!data)
+                    {
+                        ok = 0;
+                        continue;
+                    }
+                    __builtin_memcpy(data, payload + 12, (size_t)w * h * 4);
+                }
+            }
+            else if (tag == SNAPSHOT_TAG_TEXTURE_SLOT)
+            {
+                int32_t slot = (int32_t)snapshot_read_u32(payload);
+                int32_t w = (int32_t)snapshot_read_u32(payload + 4);
+                int32_t h = (int32_t)snapshot_read_u32(payload + 8);
+                __builtin_memcpy(g_textures[slot], payload + 12, (size_t)w * h * 4);
+                g_texture_sizes[slot * 2] = w;
+                g_texture_sizes[slot * 2 + 1] = h;
+            }
+            else if (tag == SNAPSHOT_TAG_BAKE)
+            {
+                int32_t w = (int32_t)snapshot_read_u32(payload);
+                int32_t h = (int32_t)snapshot_read_u32(payload + 4);
+                if (w > 0 && h > 0)
+                {
+                    g_bake_width = w;
+                    g_bake_height = h;
+                    __builtin_memcpy(g_bake_output, payload + 8, (size_t)w * h * 4);
+                }
+            }
+        }
+        return ok;
+    }
+
+
+    // ============================================================================
+    // ID Buffer Picking
+    // ============================================================================
+    //
+    // With the ID buffer enabled, every draw tags its pixels with the object ID
+    // set via set_object_id() and the triangle index within the draw. Picks are
+    // then lookups into the last rendered frame instead of CPU ray casts:
+    // pick() is O(1), pick_rect()/pick_rect_faces() are O(area).
+
+    constexpr int MAX_PICK_RESULTS = 65536;
+
+    alignas(16) static uint32_t g_pick_results[MAX_PICK_RESULTS];
+    static uint32_t g_pick_face = 0;
+    alignas(16) static float g_pick_view_projection[16]; // Written by JS (projection * view)
+    alignas(16) static float g_pick_position[3];
+
+    // Dedup set for rect queries (generation-stamped, power-of-two capacity)
+    static uint32_t *g_pick_set_keys = nullptr;
+    static uint32_t *g_pick_set_stamps = nullptr;
+    static int32_t g_pick_set_capacity = 0;
+    static int32_t g_pick_set_size = 0; // Keys inserted since pick_set_begin
+    static uint32_t g_pick_set_stamp = 0;
+
+    static bool pick_set_begin(int32_t expected)
+    {
+        int32_t needed = 64;
+        while (needed < expected * 2 && needed < MAX_PICK_RESULTS * 2)
+            needed *= 2;
+        if (needed > g_pick_set_capacity)
+        {
+            free(g_pick_set_keys);
+            free(g_pick_set_stamps);
+            g_pick_set_keys = (uint32_t *)malloc((size_t)needed * sizeof(uint32_t));
+            g_pick_set_stamps = (uint32_t *)calloc((size_t)needed, sizeof(uint32_t));
+            if (!g_pick_set_keys || !g_pick_set_stamps)
+            {
+                free(g_pick_set_keys);
+                free(g_pick_set_stamps);
+                g_pick_set_keys = nullptr;
+                g_pick_set_stamps = nullptr;
+                g_pick_set_capacity = 0;
+                return false;
+            }
+            g_pick_set_capacity = needed;
+            g_pick_set_stamp = 0;
+        }
+        g_pick_set_stamp++;
+        g_pick_set_size = 0;
+        return true;
+    }
+
+    // Insert key; returns 1 if it was not present yet, 0 if it was, -1 if the
+    // set is full (one slot is always kept free so probes terminate)
+    static inline int pick_set_insert(uint32_t key)
+    {
+        uint32_t mask = (uint32_t)g_pick_set_capacity - 1;
+        uint32_t slot = (key * 0x9E3779B1u) & mask;
+        while (g_pick_set_stamps[slot] == g_pick_set_stamp)
+        {
+            if (g_pick_set_keys[slot] == key)
+                return 0;
+            slot = (slot + 1) & mask;
+        }
+        if (g_pick_set_size >= g_pick_set_capacity - 1)
+            return -1;
+        g_pick_set_keys[slot] = key;
+        g_pick_set_stamps[slot] = g_pick_set_stamp;
+        g_pick_set_size++;
+        return 1;
+    }
+
+    // Clip a pixel rect (inclusive corners, any order) to the framebuffer
+    static bool pick_clip_rect(int32_t &x0, int32_t &y0, int32_t &x1, int32_t &y1)
+    {
+        if (x0 > x1)
+        {
+            int32_t t = x0;
+            x0 = x1;
+            x1 = t;
+        }
+        if (y0 > y1)
+        {
+            int32_t t = y0;
+            y0 = y1;
+            y1 = t;
+        }
+        x0 = x0 < 0 ? 0 : x0;
+        y0 = y0 < 0 ? 0 : y0;
+        x1 = x1 >= g_render_width ? g_render_width - 1 : x1;
+        y1 = y1 >= g_render_height ? g_render_height - 1 : y1;
+        return x0 <= x1 && y0 <= y1;
+    }
+
+    // Enable/disable the ID buffer (takes effect from the next clear/render)
+    EMSCRIPTEN_KEEPALIVE
+    void set_enable_id_buffer(int32_t enable)
+    {
+        if (enable && !g_id_objects)
+        {
+            g_id_objects = (uint32_t *)calloc(MAX_PIXEL_COUNT, sizeof(uint32_t));
+            g_id_faces = (uint32_t *)calloc(MAX_PIXEL_COUNT, sizeof(uint32_t));
+            if (!g_id_objects || !g_id_faces)
+                enable = 0;
+        }
+        if (!enable)
+        {
+            free(g_id_objects);
+            free(g_id_faces);
+            g_id_objects = nullptr;
+            g_id_faces = nullptr;
+        }
+    }
+
+    // Object ID for subsequent draws (0 = not pickable)
+    EMSCRIPTEN_KEEPALIVE
+    void set_object_id(uint32_t id)
+    {
+        g_id_current_object = id;
+    }
+
+    EMSCRIPTEN_KEEPALIVE
+    uint32_t *get_id_buffer_ptr()
+    {
+        return g_id_objects;
+    }
+
+    EMSCRIPTEN_KEEPALIVE
+    uint32_t *get_face_id_buffer_ptr()
+    {
+        return g_id_faces;
+    }
+
+    // Object ID under pixel (x, y), 0 for background or out of range.
+    // The triangle index is available from pick_get_face().
+    EMSCRIPTEN_KEEPALIVE
+    uint32_t pick(int32_t x, int32_t y)
+    {
+        g_pick_face = 0;
+        if (!g_id_objects || x < 0 || y < 0 || x >= g_render_width || y >= g_render_height)
+            return 0;
+        int32_t idx = y * g_render_width + x;
+        g_pick_face = g_id_faces[idx];
+        return g_id_objects[idx];
+    }
+
+    EMSCRIPTEN_KEEPALIVE
+    uint32_t pick_get_face()
+    {
+        return g_pick_face;
+    }
+
+    // Unique object IDs inside the rect, in scan order; returns the count
+    // (results via get_pick_results_ptr)
+    EMSCRIPTEN_KEEPALIVE
+    int32_t pick_rect(int32_t x0, int32_t y0, int32_t x1, int32_t y1)
+    {
+        if (!g_id_objects || !pick_clip_rect(x0, y0, x1, y1))
+            return 0;
+        int64_t area = (int64_t)(x1 - x0 + 1) * (y1 - y0 + 1);
+        if (!pick_set_begin(area < MAX_PICK_RESULTS ? (int32_t)area : MAX_PICK_RESULTS))
+            return 0;
+
+        int32_t count = 0;
+        for (int32_t y = y0; y <= y1; y++)
+        {
+            const uint32_t *row = &g_id_objects[y * g_render_width];
+            uint32_t last = 0;
+            for (int32_t x = x0; x <= x1; x++)
+            {
+                uint32_t id = row[x];
+                // Runs of the same ID are common; skip the set lookup for them
+                if (id == 0 || id == last)
+                    continue;
+                last = id;
+                int inserted = pick_set_insert(id);
+                if (inserted < 0)
+                    return count;
+                if (inserted)
+                {
+                    g_pick_results[count++] = id;
+                    if (count == MAX_PICK_RESULTS)
+                        return count;
+                }
+            }
+        }
+        return count;
+    }
+
+    // Unique visible triangle indices of one object inside the rect
+    // (box select in edit mode); returns the count
+    EMSCRIPTEN_KEEPALIVE
+    int32_t pick_rect_faces(uint32_t objectId, int32_t x0, int32_t y0, int32_t x1, int32_t y1)
+    {
+        if (!g_id_objects || objectId == 0 || !pick_clip_rect(x0, y0, x1, y1))
+            return 0;
+        int64_t area = (int64_t)(x1 - x0 + 1) * (y1 - y0 + 1);
+        if (!pick_set_begin(area < MAX_PICK_RESULTS ? (int32_t)area : MAX_PICK_RESULTS))
+            return 0;
+
+        int32_t count = 0;
+        for (int32_t y = y0; y <= y1; y++)
+        {
+            int32_t rowOffset = y * g_render_width;
+            uint32_t last = 0xFFFFFFFF;
+            for (int32_t x = x0; x <= x1; x++)
+            {
+                if (g_id_objects[rowOffset + x] != objectId)
+                    continue;
+                uint32_t face = g_id_faces[rowOffset + x];
+                if (face == last)
+                    continue;
+                last = face;
+                int inserted = pick_set_insert(face);
+                if (inserted < 0)
+                    return count;
+                if (inserted)
+                {
+                    g_pick_results[count++] = face;
+                    if (count == MAX_PICK_RESULTS)
+                        return count;
+                }
+            }
+        }
+        return count;
+    }
+
+    EMSCRIPTEN_KEEPALIVE
+    uint32_t *get_pick_results_ptr()
+    {
+        return g_pick_results;
+    }
+
+    // View-projection matrix used by unproject_depth (JS writes it per frame)
+    EMSCRIPTEN_KEEPALIVE
+    float *get_pick_view_projection_ptr()
+    {
+        return g_pick_view_projection;
+    }
+
+    // World position of the surface under pixel (x, y) from the depth buffer.
+    // Returns 1 and writes xyz to get_pick_position_ptr(), 0 for background.
+    EMSCRIPTEN_KEEPALIVE
+    int32_t unproject_depth(int32_t x, int32_t y)
+    {
+        if (x < 0 || y < 0 || x >= g_render_width || y >= g_render_height)
+            return 0;
+        uint16_t depth = g_depth[y * g_render_width + x];
+        if (depth == 0xFFFF)
+            return 0;
+
+        float inv[16];
+        if (!mat4_invert(inv, g_pick_view_projection))
+            return 0;
+
+        // Inverse of the viewport transform in process_vertex (pixel centers)
+        Vec4 ndc(((float)x + 0.5f) / (float)g_render_width * 2.0f - 1.0f,
+                 1.0f - ((float)y + 0.5f) / (float)g_render_height * 2.0f,
+                 (float)depth / 32767.5f - 1.0f,
+                 1.0f);
+        Vec4 world = mat4_mul_vec4(inv, ndc);
+        if (fabsf(world.w) < 1e-12f)
+            return 0;
+        float invW = 1.0f / world.w;
+        g_pick_position[0] = world.x * invW;
+        g_pick_position[1] = world.y * invW;
+        g_pick_position[2] = world.z * invW;
+        return 1;
+    }
+
+    EMSCRIPTEN_KEEPALIVE
+    float *get_pick_position_ptr()
+    {
+        return g_pick_position;
+    }
+
+    // ============================================================================
+    // Triangle BVH (ray picking / snapping)
+    // ============================================================================
+    //
+    // Each geometry buffer gets a 4-wide BVH over its triangles, built with
+    // binned SAH on first use and dropped whenever the buffer is re-uploaded.
+    // Sub-range edits (vertex drags) only need geometry_buffer_refit_bvh, which
+    // refreshes the edited triangles and walks their leaves up to the root.
+    // Rays are in the buffer's object space.
+
+    constexpr int BVH_BINS = 16;
+    constexpr int BVH_MAX_LEAF_SIZE = 4;
+    constexpr int BVH_MAX_SAH_DEPTH = 48; // Deeper nodes fall back to median splits
+    constexpr int BVH_STACK_SIZE = 256;
+    constexpr int MAX_RAYCAST_RAYS = 65536;
+    constexpr int RAY_FLOATS = 8; // origin xyz, tmin, direction xyz, tmax
+
+    // Per-ray result: triangle (-1 = miss), distance, barycentrics of v1/v2
+    struct RayHit
+    {
+        int32_t triangle;
+        float t;
+        float u;
+        float v;
+    };
+
+    // Build-time primitive; partitioned in place so each level streams through memory
+    struct BVHBuildPrim
+    {
+        float bmin[3], bmax[3];
+        float centroid[3];
+        int32_t triangle;
+    };
+
+    // Binary build node (collapsed into BVHNode4 after the build)
+    struct BVHBuildNode
+    {
+        float bmin[3], bmax[3];
+        int32_t start, count; // Prim range
+        int32_t left, right;  // Children (-1 for leaves)
+    };
+
+    alignas(16) static float g_raycast_rays[MAX_RAYCAST_RAYS * RAY_FLOATS];
+    alignas(16) static RayHit g_raycast_results[MAX_RAYCAST_RAYS];
+
+    static inline float bvh_area(const float *bmin, const float *bmax)
+    {
+        float dx = bmax[0] - bmin[0], dy = bmax[1] - bmin[1], dz = bmax[2] - bmin[2];
+        if (dx < 0.0f || dy < 0.0f || dz < 0.0f)
+            return 0.0f;
+        return dx * dy + dy * dz + dz * dx;
+    }
+
+    static inline void bvh_box_reset(float *bmin, float *bmax)
+    {
+        bmin[0] = bmin[1] = bmin[2] = 1e30f;
+        bmax[0] = bmax[1] = bmax[2] = -1e30f;
+    }
+
+    static inline void bvh_box_grow(float *bmin, float *bmax, const float *omin, const float *omax)
+    {
+        for (int k = 0; k < 3; k++)
+        {
+            bmin[k] = omin[k] < bmin[k] ? omin[k] : bmin[k];
+            bmax[k] = omax[k] > bmax[k] ? omax[k] : bmax[k];
+        }
+    }
+
+    // Fetch triangle t's corners (invalid indices collapse to a degenerate triangle)
+    static void bvh_load_triangle(const GeometryBuffer *buf, int32_t t, float *out)
+    {
+        for (int k = 0; k < 3; k++)
+        {
+            uint32_t i = buf->indices[t * 3 + k];
+            if (i < (uint32_t)buf->vertexCount)
+            {
+                out[k * 3] = buf->vertices[i * 12];
+                out[k * 3 + 1] = buf->vertices[i * 12 + 1];
+                out[k * 3 + 2] = buf->vertices[i * 12 + 2];
+            }
+            else
+            {
+                out[k * 3] = out[k * 3 + 1] = out[k * 3 + 2] = 0.0f;
+            }
+        }
+    }
+
+    static inline void bvh_triangle_bounds(const float *v, float *bmin, float *bmax)
+    {
+        for (int k = 0; k < 3; k++)
+        {
+            bmin[k] = fminf(v[k], fminf(v[3 + k], v[6 + k]));
+            bmax[k] = fmaxf(v[k], fmaxf(v[3 + k], v[6 + k]));
+        }
+    }
+
+    // Partition prims[start, start+count) so the median centroid on axis is in the middle
+    static void bvh_median_split(BVHBuildPrim *prims, int32_t start, int32_t count, int axis)
+    {
+        int32_t lo = start, hi = start + count - 1, mid = start + count / 2;
+        while (lo < hi)
+        {
+            float pivot = prims[(lo + hi) / 2].centroid[axis];
+            int32_t i = lo, j = hi;
+            while (i <= j)
+            {
+                while (prims[i].centroid[axis] < pivot)
+                    i++;
+                while (prims[j].centroid[axis] > pivot)
+                    j--;
+                if (i <= j)
+                {
+                    BVHBuildPrim tmp = prims[i];
+                    prims[i++] = prims[j];
+                    prims[j--] = tmp;
+                }
+            }
+            if (mid <= j)
+                hi = j;
+            else if (mid >= i)
+                lo = i;
+            else
+                break;
+        }
+    }
+
+    // Binned SAH build of a binary tree over prims; returns node count (0 on failure)
+    static int32_t bvh_build_binary(BVHBuildNode *&nodes, BVHBuildPrim *prims, int32_t primCount)
+    {
+        int32_t capacity = primCount * 2;
+        nodes = (BVHBuildNode *)malloc((size_t)capacity * sizeof(BVHBuildNode));
+        if (!nodes)
+            return 0;
+
+        int32_t nodeCount = 1;
+        nodes[0].start = 0;
+        nodes[0].count = primCount;
+
+        int32_t stack[BVH_STACK_SIZE][2]; // node, depth
+        int32_t sp = 0;
+        stack[sp][0] = 0;
+        stack[sp++][1] = 0;
+
+        while (sp > 0)
+        {
+            sp--;
+            int32_t ni = stack[sp][0], depth = stack[sp][1];
+            BVHBuildNode &node = nodes[ni];
+            node.left = node.right = -1;
+
+            // Node bounds and centroid bounds
+            float cmin[3], cmax[3];
+            bvh_box_reset(node.bmin, node.bmax);
+            bvh_box_reset(cmin, cmax);
+            for (int32_t i = node.start; i < node.start + node.count; i++)
+            {
+                bvh_box_grow(node.bmin, node.bmax, prims[i].bmin, prims[i].bmax);
+                bvh_box_grow(cmin, cmax, prims[i].centroid, prims[i].centroid);
+            }
+            if (node.count <= BVH_MAX_LEAF_SIZE || sp + 2 > BVH_STACK_SIZE)
+                continue;
+
+            int axis = 0;
+            float extent[3] = {cmax[0] - cmin[0], cmax[1] - cmin[1], cmax[2] - cmin[2]};
+            if (extent[1] > extent[axis])
+                axis = 1;
+            if (extent[2] > extent[axis])
+                axis = 2;
+
+            int32_t split = -1; // Prim index where the right child starts
+            if (extent[axis] > 0.0f && depth < BVH_MAX_SAH_DEPTH)
+            {
+                // Bin centroids along the widest axis
+                int32_t binCount[BVH_BINS] = {0};
+                float binMin[BVH_BINS][3], binMax[BVH_BINS][3];
+                for (int b = 0; b < BVH_BINS; b++)
+                    bvh_box_reset(binMin[b], binMax[b]);
+                float binScale = (float)BVH_BINS * 0.9999f / extent[axis];
+                for (int32_t i = node.start; i < node.start + node.count; i++)
+                {
+                    int b = (int)((prims[i].centroid[axis] - cmin[axis]) * binScale);
+                    binCount[b]++;
+                    bvh_box_grow(binMin[b], binMax[b], prims[i].bmin, prims[i].bmax);
+                }
+
+                // Sweep from the right, then evaluate splits from the left
+                float rightArea[BVH_BINS];
+                int32_t rightCount[BVH_BINS];
+                float accMin[3], accMax[3];
+                bvh_box_reset(accMin, accMax);
+                int32_t acc = 0;
+                for (int b = BVH_BINS - 1; b > 0; b--)
+                {
+                    bvh_box_grow(accMin, accMax, binMin[b], binMax[b]);
+                    acc += binCount[b];
+                    rightArea[b] = bvh_area(accMin, accMax);
+                    rightCount[b] = acc;
+                }
+
+                float bestCost = 1e30f;
+                int bestBin = -1;
+                bvh_box_reset(accMin, accMax);
+                acc = 0;
+                for (int b = 0; b < BVH_BINS - 1; b++)
+                {
+                    bvh_box_grow(accMin, accMax, binMin[b], binMax[b]);
+                    acc += binCount[b];
+                    if (acc == 0 || rightCount[b + 1] == 0)
+                        continue;
+                    float cost = bvh_area(accMin, accMax) * acc + rightArea[b + 1] * rightCount[b + 1];
+                    if (cost < bestCost)
+                    {
+                        bestCost = cost;
+                        bestBin = b;
+                    }
+                }
+
+                if (bestBin >= 0)
+                {
+                    // Partition by bin
+                    int32_t i = node.start, j = node.start + node.count - 1;
+                    while (i <= j)
+                    {
+                        int b = (int)((prims[i].centroid[axis] - cmin[axis]) * binScale);
+                        if (b <= bestBin)
+                            i++;
+                        else
+                        {
+                            BVHBuildPrim tmp = prims[i];
+                            prims[i] = prims[j];
+                            prims[j--] = tmp;
+                        }
+                    }
+                    split = i;
+                }
+            }
+
+            if (split <= node.start || split >= node.start + node.count)
+            {
+                // Coincident centroids or too deep: split at the object median
+                bvh_median_split(prims, node.start, node.count, axis);
+                split = node.start + node.count / 2;
+            }
+
+            if (nodeCount + 2 > capacity)
+                continue;
+            int32_t left = nodeCount++, right = nodeCount++;
+            nodes[left].start = node.start;
+            nodes[left].count = split - node.start;
+            nodes[right].start = split;
+            nodes[right].count = node.start + node.count - split;
+            node.left = left;
+            node.right = right;
+
+            stack[sp][0] = right;
+            stack[sp++][1] = depth + 1;
+            stack[sp][0] = left;
+            stack[sp++][1] = depth + 1;
+        }
+        return nodeCount;
+    }
+
+    static inline void bvh_set_slot_bounds(BVHNode4 &n, int s, const float *bmin, const float *bmax)
+    {
+        n.minX[s] = bmin[0];
+        n.minY[s] = bmin[1];
+        n.minZ[s] = bmin[2];
+        n.maxX[s] = bmax[0];
+        n.maxY[s] = bmax[1];
+        n.maxZ[s] = bmax[2];
+    }
+
+    // Collapse the binary tree into 4-wide nodes (preorder: parents before children)
+    static bool bvh_collapse(TriangleBVH *bvh, const BVHBuildNode *bin, int32_t binCount)
+    {
+        bvh->nodes = (BVHNode4 *)malloc((size_t)binCount * sizeof(BVHNode4));
+        bvh->parentSlot = (int32_t *)malloc((size_t)binCount * sizeof(int32_t));
+        if (!bvh->nodes || !bvh->parentSlot)
+            return false;
+
+        int32_t stack[BVH_STACK_SIZE][2]; // node4 index, binary node
+        int32_t sp = 0;
+        bvh->nodeCount = 1;
+        bvh->parentSlot[0] = -1;
+        stack[sp][0] = 0;
+        stack[sp++][1] = 0;
+
+        while (sp > 0)
+        {
+            sp--;
+            int32_t ni = stack[sp][0];
+            const BVHBuildNode &root = bin[stack[sp][1]];
+
+            // Gather up to four children by opening the largest inner child
+            int32_t children[4];
+            int32_t childCount = 0;
+            if (root.left < 0)
+                children[childCount++] = stack[sp][1]; // Root is a leaf
+            else
+            {
+                children[childCount++] = root.left;
+                children[childCount++] = root.right;
+            }
+            while (childCount < 4)
+            {
+                int best = -1;
+                float bestArea = -1.0f;
+                for (int c = 0; c < childCount; c++)
+                {
+                    const BVHBuildNode &cn = bin[children[c]];
+                    float a = bvh_area(cn.bmin, cn.bmax);
+                    if (cn.left >= 0 && a > bestArea)
+                    {
+                        bestArea = a;
+                        best = c;
+                    }
+                }
+                if (best < 0)
+                    break;
+                int32_t opened = children[best];
+                children[best] = bin[opened].left;
+                children[childCount++] = bin[opened].right;
+            }
+
+            BVHNode4 &n = bvh->nodes[ni];
+            for (int s = 0; s < 4; s++)
+            {
+                if (s >= childCount)
+                {
+                    float emptyMin[3] = {1e30f, 1e30f, 1e30f}, emptyMax[3] = {-1e30f, -1e30f, -1e30f};
+                    bvh_set_slot_bounds(n, s, emptyMin, emptyMax);
+                    n.child[s] = 0;
+                    n.count[s] = -1;
+                    continue;
+                }
+                const BVHBuildNode &cn = bin[children[s]];
+                bvh_set_slot_bounds(n, s, cn.bmin, cn.bmax);
+                if (cn.left < 0)
+                {
+                    n.child[s] = cn.start;
+                    n.count[s] = cn.count;
+                    for (int32_t p = cn.start; p < cn.start + cn.count; p++)
+                        bvh->primSlot[p] = ni * 4 + s;
+                }
+                else
+                {
+                    if (sp >= BVH_STACK_SIZE)
+                        return false;
+                    int32_t ci = bvh->nodeCount++;
+                    bvh->parentSlot[ci] = ni * 4 + s;
+                    n.child[s] = ci;
+                    n.count[s] = 0;
+                    stack[sp][0] = ci;
+                    stack[sp++][1] = children[s];
+                }
+            }
+        }
+        return true;
+    }
+
+    // Build (or return the cached) BVH for a geometry buffer
+    static TriangleBVH *get_geometry_bvh(int32_t handle)
+    {
+        GeometryBuffer *buf = lookup_geometry_buffer(handle);
+        if (!buf || !buf->vertices || !buf->indices || buf->indexCount < 3)
+            return nullptr;
+
+        TriangleBVH *bvh = g_geometry_bvhs[handle - 1];
+        if (bvh && bvh->vertices == buf->vertices && bvh->indices == buf->indices &&
+            bvh->vertexCount == buf->vertexCount && bvh->indexCount == buf->indexCount)
+            return bvh;
+        invalidate_geometry_bvh(handle);
+
+        int32_t triCount = buf->indexCount / 3;
+        bvh = (TriangleBVH *)calloc(1, sizeof(TriangleBVH));
+        BVHBuildPrim *prims = (BVHBuildPrim *)malloc((size_t)triCount * sizeof(BVHBuildPrim));
+        BVHBuildNode *bin = nullptr;
+        bool ok = bvh && prims;
+
+        if (ok)
+        {
+            for (int32_t t = 0; t < triCount; t++)
+            {
+                float v[9];
+                BVHBuildPrim &p = prims[t];
+                bvh_load_triangle(buf, t, v);
+                bvh_triangle_bounds(v, p.bmin, p.bmax);
+                for (int k = 0; k < 3; k++)
+                    p.centroid[k] = (p.bmin[k] + p.bmax[k]) * 0.5f;
+                p.triangle = t;
+            }
+
+            bvh->triangleCount = triCount;
+            bvh->primTriangles = (uint32_t *)malloc((size_t)triCount * sizeof(uint32_t));
+            bvh->primVertices = (float *)malloc((size_t)triCount * 9 * sizeof(float));
+            bvh->primSlot = (int32_t *)malloc((size_t)triCount * sizeof(int32_t));
+            bvh->trianglePrim = (int32_t *)malloc((size_t)triCount * sizeof(int32_t));
+            ok = bvh->primTriangles && bvh->primVertices && bvh->primSlot && bvh->trianglePrim;
+        }
+
+        int32_t binCount = ok ? bvh_build_binary(bin, prims, triCount) : 0;
+        ok = ok && binCount > 0 && bvh_collapse(bvh, bin, binCount);
+
+        if (ok)
+        {
+            // Store prims in leaf order so leaves read contiguous triangle data
+            for (int32_t p = 0; p < triCount; p++)
+            {
+                int32_t t = prims[p].triangle;
+                bvh->primTriangles[p] = (uint32_t)t;
+                bvh->trianglePrim[t] = p;
+                bvh_load_triangle(buf, t, &bvh->primVertices[p * 9]);
+            }
+            bvh->dirty = (uint8_t *)calloc((size_t)bvh->nodeCount, 1);
+            ok = bvh->dirty != nullptr;
+        }
+
+        free(prims);
+        free(bin);
+        if (!ok)
+        {
+            free_triangle_bvh(bvh);
+            return nullptr;
+        }
+
+        bvh->vertices = buf->vertices;
+        bvh->indices = buf->indices;
+        bvh->vertexCount = buf->vertexCount;
+        bvh->indexCount = buf->indexCount;
+        g_geometry_bvhs[handle - 1] = bvh;
+        return bvh;
+    }
+
+    // Moller-Trumbore; updates hit if closer than hit.t (double-sided)
+    static inline bool bvh_intersect_triangle(const float *o, const float *d, const float *v,
+                                              float tmin, RayHit &hit)
+    {
+        float e1x = v[3] - v[0], e1y = v[4] - v[1], e1z = v[5] - v[2];
+        float e2x = v[6] - v[0], e2y = v[7] - v[1], e2z = v[8] - v[2];
+        float px = d[1] * e2z - d[2] * e2y;
+        float py = d[2] * e2x - d[0] * e2z;
+        float pz = d[0] * e2y - d[1] * e2x;
+        float det = e1x * px + e1y * py + e1z * pz;
+        if (fabsf(det) < 1e-12f)
+            return false;
+        float invDet = 1.0f / det;
+        float sx = o[0] - v[0], sy = o[1] - v[1], sz = o[2] - v[2];
+        float u = (sx * px + sy * py + sz * pz) * invDet;
+        if (u < 0.0f || u > 1.0f)
+            return false;
+        float qx = sy * e1z - sz * e1y;
+        float qy = sz * e1x - sx * e1z;
+        float qz = sx * e1y - sy * e1x;
+        float w = (d[0] * qx + d[1] * qy + d[2] * qz) * invDet;
+        if (w < 0.0f || u + w > 1.0f)
+            return false;
+        float t = (e2x * qx + e2y * qy + e2z * qz) * invDet;
+        if (t < tmin || t >= hit.t)
+            return false;
+        hit.t = t;
+        hit.u = u;
+        hit.v = w;
+        return true;
+    }
+
+    // Closest hit, or any hit within [tmin, tmax] when anyHit is set (occlusion
+    // queries; the reported hit is then not necessarily the nearest)
+    static void bvh_trace(const TriangleBVH *bvh, const float *ray, RayHit &hit, bool anyHit = false)
+    {
+        const float o[3] = {ray[0], ray[1], ray[2]};
+        const float d[3] = {ray[4], ray[5], ray[6]};
+        float tmin = ray[3];
+        hit.triangle = -1;
+        hit.t = ray[7] > tmin ? ray[7] : 1e30f;
+        hit.u = hit.v = 0.0f;
+
+        // Reciprocal direction (zero components nudged to avoid 0 * inf)
+        float inv[3];
+        for (int k = 0; k < 3; k++)
+            inv[k] = 1.0f / (fabsf(d[k]) > 1e-12f ? d[k] : (d[k] < 0.0f ? -1e-12f : 1e-12f));
+
+        v128_t ox = wasm_f32x4_splat(o[0]), oy = wasm_f32x4_splat(o[1]), oz = wasm_f32x4_splat(o[2]);
+        v128_t ix = wasm_f32x4_splat(inv[0]), iy = wasm_f32x4_splat(inv[1]), iz = wasm_f32x4_splat(inv[2]);
+        v128_t vtmin = wasm_f32x4_splat(tmin);
+
+        int32_t stack[BVH_STACK_SIZE];
+        int32_t sp = 0;
+        stack[sp++] = 0;
+
+        while (sp > 0)
+        {
+            const BVHNode4 &n = bvh->nodes[stack[--sp]];
+
+            // Slab test against all four child boxes
+            v128_t t0 = wasm_f32x4_mul(wasm_f32x4_sub(wasm_v128_load(n.minX), ox), ix);
+            v128_t t1 = wasm_f32x4_mul(wasm_f32x4_sub(wasm_v128_load(n.maxX), ox), ix);
+            v128_t tnear = wasm_f32x4_min(t0, t1);
+            v128_t tfar = wasm_f32x4_max(t0, t1);
+            t0 = wasm_f32x4_mul(wasm_f32x4_sub(wasm_v128_load(n.minY), oy), iy);
+            t1 = wasm_f32x4_mul(wasm_f32x4_sub(wasm_v128_load(n.maxY), oy), iy);
+            tnear = wasm_f32x4_max(tnear, wasm_f32x4_min(t0, t1));
+            tfar = wasm_f32x4_min(tfar, wasm_f32x4_max(t0, t1));
+            t0 = wasm_f32x4_mul(wasm_f32x4_sub(wasm_v128_load(n.minZ), oz), iz);
+            t1 = wasm_f32x4_mul(wasm_f32x4_sub(wasm_v128_load(n.maxZ), oz), iz);
+            tnear = wasm_f32x4_max(tnear, wasm_f32x4_min(t0, t1));
+            tfar = wasm_f32x4_min(tfar, wasm_f32x4_max(t0, t1));
+            tnear = wasm_f32x4_max(tnear, vtmin);
+            tfar = wasm_f32x4_min(tfar, wasm_f32x4_splat(hit.t));
+            uint32_t mask = wasm_i32x4_bitmask(wasm_f32x4_le(tnear, tfar));
+            if (!mask)
+                continue;
+
+            alignas(16) float nearT[4];
+            wasm_v128_store(nearT, tnear);
+
+            // Push inner children far-to-near so the nearest is visited first
+            int32_t order[4];
+            int32_t orderCount = 0;
+            for (int s = 0; s < 4; s++)
+            {
+                if (!(mask & (1u << s)) || n.count[s] < 0)
+                    continue;
+                if (n.count[s] > 0)
+                {
+                    // Leaf: test its triangles right away
+                    for (int32_t p = n.child[s]; p < n.child[s] + n.count[s]; p++)
+                    {
+                        if (bvh_intersect_triangle(o, d, &bvh->primVertices[p * 9], tmin, hit))
+                        {
+                            hit.triangle = (int32_t)bvh->primTriangles[p];
+                            if (anyHit)
+                                return;
+                        }
+                    }
+                    continue;
+                }
+                int32_t k = orderCount++;
+                while (k > 0 && nearT[order[k - 1]] < nearT[s])
+                {
+                    order[k] = order[k - 1];
+                    k--;
+                }
+                order[k] = s;
+            }
+            for (int32_t k = 0; k < orderCount && sp < BVH_STACK_SIZE; k++)
+                stack[sp++] = n.child[order[k]];
+        }
+    }
+
+    // Build the BVH now (e.g. right after upload) instead of on the first raycast.
+    // Returns the node count, 0 on failure.
+    EMSCRIPTEN_KEEPALIVE
+    int32_t geometry_buffer_build_bvh(int32_t handle)
+    {
+        TriangleBVH *bvh = get_geometry_bvh(handle);
+        return bvh ? bvh->nodeCount : 0;
+    }
+
+    // Refit after editing vertex positions of triangles [firstTriangle, +count)
+    // in place (topology unchanged). Returns 1 if refitted, 0 if the BVH will be
+    // rebuilt on the next raycast instead.
+    EMSCRIPTEN_KEEPALIVE
+    int32_t geometry_buffer_refit_bvh(int32_t handle, int32_t firstTriangle, int32_t triangleCount)
+    {
+        GeometryBuffer *buf = lookup_geometry_buffer(handle);
+        TriangleBVH *bvh = buf ? g_geometry_bvhs[handle - 1] : nullptr;
+        if (!bvh || bvh->vertices != buf->vertices || bvh->indices != buf->indices ||
+            bvh->vertexCount != buf->vertexCount || bvh->indexCount != buf->indexCount)
+            return 0;
+
+        if (firstTriangle < 0)
+            firstTriangle = 0;
+        int32_t end = firstTriangle + triangleCount;
+        if (end > bvh->triangleCount)
+            end = bvh->triangleCount;
+
+        // Refresh edited triangles and the leaf slots holding them
+        int32_t maxDirty = -1;
+        for (int32_t t = firstTriangle; t < end; t++)
+        {
+            int32_t p = bvh->trianglePrim[t];
+            bvh_load_triangle(buf, t, &bvh->primVertices[p * 9]);
+            int32_t node = bvh->primSlot[p] >> 2;
+            bvh->dirty[node] = 1;
+            if (node > maxDirty)
+                maxDirty = node;
+        }
+
+        // Children always follow their parent, so a reverse sweep sees them first
+        for (int32_t ni = maxDirty; ni >= 0; ni--)
+        {
+            if (!bvh->dirty[ni])
+                continue;
+            bvh->dirty[ni] = 0;
+            BVHNode4 &n = bvh->nodes[ni];
+            for (int s = 0; s < 4; s++)
+            {
+                if (n.count[s] < 0)
+                    continue;
+                float bmin[3], bmax[3];
+                bvh_box_reset(bmin, bmax);
+                if (n.count[s] > 0)
+                {
+                    for (int32_t p = n.child[s]; p < n.child[s] + n.count[s]; p++)
+                    {
+                        float tmin[3], tmax[3];
+                        bvh_triangle_bounds(&bvh->primVertices[p * 9], tmin, tmax);
+                        bvh_box_grow(bmin, bmax, tmin, tmax);
+                    }
+                }
+                else
+                {
+                    const BVHNode4 &c = bvh->nodes[n.child[s]];
+                    for (int cs = 0; cs < 4; cs++)
+                    {
+                        if (c.count[cs] < 0)
+                            continue;
+                        float cmin[3] = {c.minX[cs], c.minY[cs], c.minZ[cs]};
+                        float cmax[3] = {c.maxX[cs], c.maxY[cs], c.maxZ[cs]};
+                        bvh_box_grow(bmin, bmax, cmin, cmax);
+                    }
+                }
+                bvh_set_slot_bounds(n, s, bmin, bmax);
+            }
+            if (bvh->parentSlot[ni] >= 0)
+                bvh->dirty[bvh->parentSlot[ni] >> 2] = 1;
+        }
+        return 1;
+    }
+
+    // Scratch space for up to MAX_RAYCAST_RAYS rays (RAY_FLOATS each)
+    EMSCRIPTEN_KEEPALIVE
+    float *get_raycast_rays_ptr()
+    {
+        return g_raycast_rays;
+    }
+
+    // Scratch space for results (RayHit: triangle i32, t, u, v)
+    EMSCRIPTEN_KEEPALIVE
+    RayHit *get_raycast_results_ptr()
+    {
+        return g_raycast_results;
+    }
+
+    // Trace count rays (object space) against a geometry buffer.
+    // Returns the number of rays that hit, -1 if the BVH could not be built.
+    EMSCRIPTEN_KEEPALIVE
+    int32_t raycast(int32_t handle, const float *rays, int32_t count, RayHit *results)
+    {
+        TriangleBVH *bvh = get_geometry_bvh(handle);
+        if (!bvh || !rays || !results)
+            return -1;
+        int32_t hits = 0;
+        for (int32_t i = 0; i < count; i++)
+        {
+            bvh_trace(bvh, &rays[i * RAY_FLOATS], results[i]);
+            if (results[i].triangle >= 0)
+                hits++;
+        }
+        return hits;
+    }
+
+
+    // ============================================================================
+    // Screen-Space Vertex Index (hover, box/lasso select, snapping)
+    // ============================================================================
+    //
+    // vertex_index_build() projects every vertex of a geometry buffer through
+    // the current MVP matrix and buckets the on-screen ones into a uniform grid
+    // of VERTEX_GRID_CELL pixel cells (counting sort, so each cell is a
+    // contiguous run). Queries then only visit the cells they overlap.
+    // Selections come back as a bitset with one bit per vertex.
+
+    constexpr int VERTEX_GRID_CELL = 16;       // Cell size in pixels
+    constexpr int MAX_LASSO_POINTS = 4096;
+    constexpr uint16_t VERTEX_OCCLUSION_BIAS = 96; // Depth units (~0.3% of the range)
+
+    static float *g_vertex_screen = nullptr; // x, y, depth (0-65535) per vertex
+    static int32_t g_vertex_screen_capacity = 0;
+    static int32_t *g_vertex_grid_entries = nullptr; // Vertex indices grouped by cell
+    static int32_t g_vertex_grid_entries_capacity = 0;
+    static int32_t *g_vertex_grid_start = nullptr; // Per-cell run start (cells + 1)
+    static int32_t g_vertex_grid_start_capacity = 0;
+    static uint8_t *g_lasso_mask = nullptr; // Lasso coverage over its pixel bounds
+    static int32_t g_lasso_mask_capacity = 0;
+    static float *g_lasso_crossings = nullptr;
+    static int32_t g_lasso_crossings_capacity = 0;
+    static uint32_t *g_vertex_select_bits = nullptr;
+    static int32_t g_vertex_select_bits_capacity = 0;
+    static int32_t g_vertex_index_count = 0; // Vertices in the indexed buffer
+    static int32_t g_vertex_grid_w = 0, g_vertex_grid_h = 0;
+    static float g_vertex_nearest_distance = 0.0f;
+    alignas(16) static float g_lasso_points[MAX_LASSO_POINTS * 2];
+
+    // Vertex is visible if it is not behind the depth buffer around its pixel
+    static inline bool vertex_index_visible(int32_t v)
+    {
+        int32_t px = (int32_t)g_vertex_screen[v * 3];
+        int32_t py = (int32_t)g_vertex_screen[v * 3 + 1];
+        uint32_t depth = (uint32_t)g_vertex_screen[v * 3 + 2];
+
+        // Max over the 3x3 neighbourhood so silhouette vertices are not lost
+        uint32_t surface = 0;
+        for (int32_t y = py - 1; y <= py + 1; y++)
+        {
+            if (y < 0 || y >= g_render_height)
+                continue;
+            for (int32_t x = px - 1; x <= px + 1; x++)
+            {
+                if (x < 0 || x >= g_render_width)
+                    continue;
+                uint32_t d = g_depth[y * g_render_width + x];
+                if (d > surface)
+                    surface = d;
+            }
+        }
+        return depth <= surface + VERTEX_OCCLUSION_BIAS;
+    }
+
+    static inline void vertex_index_cell_range(float x0, float y0, float x1, float y1,
+                                               int32_t &cx0, int32_t &cy0, int32_t &cx1, int32_t &cy1)
+    {
+        cx0 = (int32_t)floorf(fminf(x0, x1) / VERTEX_GRID_CELL);
+        cy0 = (int32_t)floorf(fminf(y0, y1) / VERTEX_GRID_CELL);
+        cx1 = (int32_t)floorf(fmaxf(x0, x1) / VERTEX_GRID_CELL);
+        cy1 = (int32_t)floorf(fmaxf(y0, y1) / VERTEX_GRID_CELL);
+        cx0 = cx0 < 0 ? 0 : cx0;
+        cy0 = cy0 < 0 ? 0 : cy0;
+        cx1 = cx1 >= g_vertex_grid_w ? g_vertex_grid_w - 1 : cx1;
+        cy1 = cy1 >= g_vertex_grid_h ? g_vertex_grid_h - 1 : cy1;
+    }
+
+    // Scanline-fill the lasso (even-odd, pixel centres) into a mask covering
+    // pixels [x0, x0 + w) x [y0, y0 + h)
+    static void lasso_fill_mask(int32_t pointCount, int32_t x0, int32_t y0, int32_t w, int32_t h)
+    {
+        __builtin_memset(g_lasso_mask, 0, (size_t)w * h);
+        for (int32_t row = 0; row < h; row++)
+        {
+            float y = (float)(y0 + row) + 0.5f;
+            int32_t crossings = 0;
+            for (int32_t i = 0, j = pointCount - 1; i < pointCount; j = i++)
+            {
+                float xi = g_lasso_points[i * 2], yi = g_lasso_points[i * 2 + 1];
+                float xj = g_lasso_points[j * 2], yj = g_lasso_points[j * 2 + 1];
+                if ((yi > y) != (yj > y))
+                    g_lasso_crossings[crossings++] = (xj - xi) * (y - yi) / (yj - yi) + xi;
+            }
+            // Insertion sort: a lasso crosses a row only a handful of times
+            for (int32_t i = 1; i < crossings; i++)
+            {
+                float c = g_lasso_crossings[i];
+                int32_t k = i;
+                for (; k > 0 && g_lasso_crossings[k - 1] > c; k--)
+                    g_lasso_crossings[k] = g_lasso_crossings[k - 1];
+                g_lasso_crossings[k] = c;
+            }
+            uint8_t *mask = &g_lasso_mask[row * w];
+            for (int32_t i = 0; i + 1 < crossings; i += 2)
+            {
+                // Pixels whose centre lies in [left, right)
+                int32_t left = (int32_t)ceilf(g_lasso_crossings[i] - 0.5f) - x0;
+                int32_t right = (int32_t)ceilf(g_lasso_crossings[i + 1] - 0.5f) - x0;
+                left = left < 0 ? 0 : left;
+                right = right > w ? w : right;
+                if (left < right)
+                    __builtin_memset(mask + left, 1, (size_t)(right - left));
+            }
+        }
+    }
+
+    static bool vertex_select_begin()
+    {
+        int32_t words = (g_vertex_index_count + 31) / 32;
+        if (!grow_array(g_vertex_select_bits, g_vertex_select_bits_capacity, words > 0 ? words : 1))
+            return false;
+        __builtin_memset(g_vertex_select_bits, 0, (size_t)words * sizeof(uint32_t));
+        return true;
+    }
+
+    // Project a geometry buffer's vertices with the current MVP matrix and
+    // rebuild the grid. Returns the number of on-screen vertices, -1 on error.
+    EMSCRIPTEN_KEEPALIVE
+    int32_t vertex_index_build(int32_t handle)
+    {
+        g_vertex_index_count = 0;
+        GeometryBuffer *buf = lookup_geometry_buffer(handle);
+        if (!buf || !buf->vertices)
+            return -1;
+
+        int32_t count = buf->vertexCount;
+        g_vertex_grid_w = (g_render_width + VERTEX_GRID_CELL - 1) / VERTEX_GRID_CELL;
+        g_vertex_grid_h = (g_render_height + VERTEX_GRID_CELL - 1) / VERTEX_GRID_CELL;
+        int32_t cells = g_vertex_grid_w * g_vertex_grid_h;
+        if (!grow_array(g_vertex_screen, g_vertex_screen_capacity, count * 3 + 12) ||
+            !grow_array(g_vertex_grid_entries, g_vertex_grid_entries_capacity, count > 0 ? count : 1) ||
+            !grow_array(g_vertex_grid_start, g_vertex_grid_start_capacity, cells + 1))
+            return -1;
+        g_vertex_index_count = count;
+
+        // Project four vertices at a time (rows of the row-major MVP)
+        const float *m = g_mvp_matrix;
+        v128_t m00 = wasm_f32x4_splat(m[0]), m01 = wasm_f32x4_splat(m[1]);
+        v128_t m02 = wasm_f32x4_splat(m[2]), m03 = wasm_f32x4_splat(m[3]);
+        v128_t m10 = wasm_f32x4_splat(m[4]), m11 = wasm_f32x4_splat(m[5]);
+        v128_t m12 = wasm_f32x4_splat(m[6]), m13 = wasm_f32x4_splat(m[7]);
+        v128_t m20 = wasm_f32x4_splat(m[8]), m21 = wasm_f32x4_splat(m[9]);
+        v128_t m22 = wasm_f32x4_splat(m[10]), m23 = wasm_f32x4_splat(m[11]);
+        v128_t m30 = wasm_f32x4_splat(m[12]), m31 = wasm_f32x4_splat(m[13]);
+        v128_t m32 = wasm_f32x4_splat(m[14]), m33 = wasm_f32x4_splat(m[15]);
+        v128_t halfW = wasm_f32x4_splat(0.5f * (float)g_render_width);
+        v128_t halfH = wasm_f32x4_splat(0.5f * (float)g_render_height);
+        v128_t one = wasm_f32x4_splat(1.0f);
+        v128_t depthScale = wasm_f32x4_splat(32767.5f);
+        v128_t epsilon = wasm_f32x4_splat(1e-6f);
+        const float *src = buf->vertices;
+
+        for (int32_t i = 0; i < count; i += 4)
+        {
+            float px[4] = {0}, py[4] = {0}, pz[4] = {0};
+            for (int k = 0; k < 4 && i + k < count; k++)
+            {
+                px[k] = src[(i + k) * 12];
+                py[k] = src[(i + k) * 12 + 1];
+                pz[k] = src[(i + k) * 12 + 2];
+            }
+            v128_t x = wasm_v128_load(px), y = wasm_v128_load(py), z = wasm_v128_load(pz);
+
+            v128_t cx = wasm_f32x4_add(wasm_f32x4_add(wasm_f32x4_mul(m00, x), wasm_f32x4_mul(m01, y)),
+                                       wasm_f32x4_add(wasm_f32x4_mul(m02, z), m03));
+            v128_t cy = wasm_f32x4_add(wasm_f32x4_add(wasm_f32x4_mul(m10, x), wasm_f32x4_mul(m11, y)),
+                                       wasm_f32x4_add(wasm_f32x4_mul(m12, z), m13));
+            v128_t cz = wasm_f32x4_add(wasm_f32x4_add(wasm_f32x4_mul(m20, x), wasm_f32x4_mul(m21, y)),
+                                       wasm_f32x4_add(wasm_f32x4_mul(m22, z), m23));
+            v128_t cw = wasm_f32x4_add(wasm_f32x4_add(wasm_f32x4_mul(m30, x), wasm_f32x4_mul(m31, y)),
+                                       wasm_f32x4_add(wasm_f32x4_mul(m32, z), m33));
+
+            // Behind the camera: push the depth past the far plane so it is culled below
+            v128_t behind = wasm_f32x4_le(cw, epsilon);
+            v128_t invW = wasm_f32x4_div(one, wasm_v128_bitselect(one, cw, behind));
+            v128_t sx = wasm_f32x4_mul(wasm_f32x4_add(wasm_f32x4_mul(cx, invW), one), halfW);
+            v128_t sy = wasm_f32x4_mul(wasm_f32x4_sub(one, wasm_f32x4_mul(cy, invW)), halfH);
+            v128_t sz = wasm_f32x4_mul(wasm_f32x4_add(wasm_f32x4_mul(cz, invW), one), depthScale);
+            sz = wasm_v128_bitselect(wasm_f32x4_splat(1e30f), sz, behind);
+
+            alignas(16) float outX[4], outY[4], outZ[4];
+            wasm_v128_store(outX, sx);
+            wasm_v128_store(outY, sy);
+            wasm_v128_store(outZ, sz);
+            for (int k = 0; k < 4; k++)
+            {
+                g_vertex_screen[(i + k) * 3] = outX[k];
+                g_vertex_screen[(i + k) * 3 + 1] = outY[k];
+                g_vertex_screen[(i + k) * 3 + 2] = outZ[k];
+            }
+        }
+
+        // Counting sort into cells; off-screen and clipped vertices are skipped
+        __builtin_memset(g_vertex_grid_start, 0, (size_t)(cells + 1) * sizeof(int32_t));
+        for (int32_t v = 0; v < count; v++)
+        {
+            float sx = g_vertex_screen[v * 3], sy = g_vertex_screen[v * 3 + 1];
+            float sz = g_vertex_screen[v * 3 + 2];
+            if (!(sx >= 0.0f && sx < (float)g_render_width && sy >= 0.0f && sy < (float)g_render_height &&
+                  sz >= 0.0f && sz <= 65535.0f))
+                continue;
+            int32_t cell = ((int32_t)sy / VERTEX_GRID_CELL) * g_vertex_grid_w + (int32_t)sx / VERTEX_GRID_CELL;
+            g_vertex_grid_start[cell + 1]++;
+        }
+        for (int32_t c = 0; c < cells; c++)
+            g_vertex_grid_start[c + 1] += g_vertex_grid_start[c];
+        int32_t visible = g_vertex_grid_start[cells];
+
+        // Fill using the run starts as cursors, then shift them back
+        for (int32_t v = 0; v < count; v++)
+        {
+            float sx = g_vertex_screen[v * 3], sy = g_vertex_screen[v * 3 + 1];
+            float sz = g_vertex_screen[v * 3 + 2];
+            if (!(sx >= 0.0f && sx < (float)g_render_width && sy >= 0.0f && sy < (float)g_render_height &&
+                  sz >= 0.0f && sz <= 65535.0f))
+                continue;
+            int32_t cell = ((int32_t)sy / VERTEX_GRID_CELL) * g_vertex_grid_w + (int32_t)sx / VERTEX_GRID_CELL;
+            g_vertex_grid_entries[g_vertex_grid_start[cell]++] = v;
+        }
+        for (int32_t c = cells; c > 0; c--)
+            g_vertex_grid_start[c] = g_vertex_grid_start[c - 1];
+        g_vertex_grid_start[0] = 0;
+
+        return visible;
+    }
+
+    // Projected positions from the last build: x, y (pixels), depth (0-65535)
+    EMSCRIPTEN_KEEPALIVE
+    float *get_vertex_screen_ptr()
+    {
+        return g_vertex_screen;
+    }
+
+    // Nearest indexed vertex within radius pixels of (x, y), or -1.
+    // occlusion != 0 skips vertices hidden behind the last rendered depth.
+    EMSCRIPTEN_KEEPALIVE
+    int32_t vertex_index_nearest(float x, float y, float radius, int32_t occlusion)
+    {
+        if (g_vertex_index_count == 0)
+            return -1;
+        int32_t cx0, cy0, cx1, cy1;
+        vertex_index_cell_range(x - radius, y - radius, x + radius, y + radius, cx0, cy0, cx1, cy1);
+
+        int32_t best = -1;
+        float bestDist = radius * radius;
+        for (int32_t cy = cy0; cy <= cy1; cy++)
+        {
+            for (int32_t cx = cx0; cx <= cx1; cx++)
+            {
+                int32_t cell = cy * g_vertex_grid_w + cx;
+                for (int32_t e = g_vertex_grid_start[cell]; e < g_vertex_grid_start[cell + 1]; e++)
+                {
+                    int32_t v = g_vertex_grid_entries[e];
+                    float dx = g_vertex_screen[v * 3] - x, dy = g_vertex_screen[v * 3 + 1] - y;
+                    float d = dx * dx + dy * dy;
+                    // Ties go to the vertex closer to the camera
+                    if (d > bestDist || (d == bestDist && best >= 0 &&
+                                         g_vertex_screen[v * 3 + 2] >= g_vertex_screen[best * 3 + 2]))
+                        continue;
+                    if (occlusion && !vertex_index_visible(v))
+                        continue;
+                    best = v;
+                    bestDist = d;
+                }
+            }
+        }
+        g_vertex_nearest_distance = best >= 0 ? sqrtf(bestDist) : 0.0f;
+        return best;
+    }
+
+    // Screen distance of the last vertex_index_nearest() hit
+    EMSCRIPTEN_KEEPALIVE
+    float vertex_index_get_nearest_distance()
+    {
+        return g_vertex_nearest_distance;
+    }
+
+    // Select indexed vertices inside a pixel rect (inclusive).
+    // Returns the selected count; bits are in get_vertex_select_bits_ptr().
+    EMSCRIPTEN_KEEPALIVE
+    int32_t vertex_index_select_rect(float x0, float y0, float x1, float y1, int32_t occlusion)
+    {
+        if (g_vertex_index_count == 0 || !vertex_select_begin())
+            return 0;
+        float minX = fminf(x0, x1), maxX = fmaxf(x0, x1);
+        float minY = fminf(y0, y1), maxY = fmaxf(y0, y1);
+        int32_t cx0, cy0, cx1, cy1;
+        vertex_index_cell_range(minX, minY, maxX, maxY, cx0, cy0, cx1, cy1);
+
+        int32_t selected = 0;
+        for (int32_t cy = cy0; cy <= cy1; cy++)
+        {
+            for (int32_t cx = cx0; cx <= cx1; cx++)
+            {
+                int32_t cell = cy * g_vertex_grid_w + cx;
+                // Interior cells need no per-vertex bounds test
+                bool inside = cx > cx0 && cx < cx1 && cy > cy0 && cy < cy1;
+                for (int32_t e = g_vertex_grid_start[cell]; e < g_vertex_grid_start[cell + 1]; e++)
+                {
+                    int32_t v = g_vertex_grid_entries[e];
+                    float sx = g_vertex_screen[v * 3], sy = g_vertex_screen[v * 3 + 1];
+                    if (!inside && (sx < minX || sx > maxX || sy < minY || sy > maxY))
+                        continue;
+                    if (occlusion && !vertex_index_visible(v))
+                        continue;
+                    g_vertex_select_bits[v >> 5] |= 1u << (v & 31);
+                    selected++;
+                }
+            }
+        }
+        return selected;
+    }
+
+    // Scratch space for lasso polygons (x, y pairs, up to MAX_LASSO_POINTS)
+    EMSCRIPTEN_KEEPALIVE
+    float *get_lasso_points_ptr()
+    {
+        return g_lasso_points;
+    }
+
+    // Select indexed vertices inside the lasso polygon (even-odd rule, tested
+    // at the centre of the pixel each vertex falls in)
+    EMSCRIPTEN_KEEPALIVE
+    int32_t vertex_index_select_lasso(int32_t pointCount, int32_t occlusion)
+    {
+        if (g_vertex_index_count == 0 || pointCount < 3 || pointCount > MAX_LASSO_POINTS ||
+            !vertex_select_begin())
+            return 0;
+
+        float minX = g_lasso_points[0], maxX = minX;
+        float minY = g_lasso_points[1], maxY = minY;
+        for (int32_t i = 1; i < pointCount; i++)
+        {
+            minX = fminf(minX, g_lasso_points[i * 2]);
+            maxX = fmaxf(maxX, g_lasso_points[i * 2]);
+            minY = fminf(minY, g_lasso_points[i * 2 + 1]);
+            maxY = fmaxf(maxY, g_lasso_points[i * 2 + 1]);
+        }
+        // Rasterize the lasso over its on-screen bounds, then test vertices by pixel
+        int32_t x0 = (int32_t)floorf(fmaxf(minX, 0.0f));
+        int32_t y0 = (int32_t)floorf(fmaxf(minY, 0.0f));
+        int32_t x1 = (int32_t)fminf(maxX, (float)(g_render_width - 1));
+        int32_t y1 = (int32_t)fminf(maxY, (float)(g_render_height - 1));
+        if (x0 > x1 || y0 > y1)
+            return 0;
+        int32_t w = x1 - x0 + 1, h = y1 - y0 + 1;
+        if (!grow_array(g_lasso_mask, g_lasso_mask_capacity, w * h) ||
+            !grow_array(g_lasso_crossings, g_lasso_crossings_capacity, pointCount))
+            return 0;
+        lasso_fill_mask(pointCount, x0, y0, w, h);
+
+        int32_t cx0, cy0, cx1, cy1;
+        vertex_index_cell_range((float)x0, (float)y0, (float)x1, (float)y1, cx0, cy0, cx1, cy1);
+        int32_t selected = 0;
+        for (int32_t cy = cy0; cy <= cy1; cy++)
+        {
+            for (int32_t cx = cx0; cx <= cx1; cx++)
+            {
+                int32_t cell = cy * g_vertex_grid_w + cx;
+                for (int32_t e = g_vertex_grid_start[cell]; e < g_vertex_grid_start[cell + 1]; e++)
+                {
+                    int32_t v = g_vertex_grid_entries[e];
+                    int32_t px = (int32_t)g_vertex_screen[v * 3] - x0;
+                    int32_t py = (int32_t)g_vertex_screen[v * 3 + 1] - y0;
+                    if (px < 0 || px >= w || py < 0 || py >= h || !g_lasso_mask[py * w + px])
+                        continue;
+                    if (occlusion && !vertex_index_visible(v))
+                        continue;
+                    g_vertex_select_bits[v >> 5] |= 1u << (v & 31);
+                    selected++;
+                }
+            }
+        }
+        return selected;
+    }
+
+    // Vertex count of the indexed buffer (selection bitsets hold this many bits)
+    EMSCRIPTEN_KEEPALIVE
+    int32_t vertex_index_get_count()
+    {
+        return g_vertex_index_count;
+    }
+
+    // Selection bitset from the last rect/lasso query ((vertexCount + 31) / 32 words)
+    EMSCRIPTEN_KEEPALIVE
+    uint32_t *get_vertex_select_bits_ptr()
+    {
+        return g_vertex_select_bits;
+    }
+
+
+    // ============================================================================
+    // Vertex Spatial Hash (co-location queries and welding)
+    // ============================================================================
+    //
+    // Positions are bucketed into cubic cells of size epsilon, so every vertex
+    // within epsilon (per axis, like the editor's co-location test) lies in the
+    // 27 cells around the query. Groups are seeded by the lowest vertex index:
+    // each unassigned vertex claims every unassigned vertex within epsilon.
+
+    constexpr float SPATIAL_HASH_DEFAULT_EPSILON = 0.0001f;
+
+    static int32_t *g_colocated_results = nullptr;
+    static int32_t g_colocated_results_capacity = 0;
+
+    static inline int32_t spatial_hash_coord(float v, float invCell)
+    {
+        float c = floorf(v * invCell);
+        // Clamp so huge coordinates / tiny epsilons cannot overflow the cast
+        c = c < -1e9f ? -1e9f : (c > 1e9f ? 1e9f : c);
+        return (int32_t)c;
+    }
+
+    // Table slot holding cell (x, y, z); -1 if absent and insert is false
+    static int32_t spatial_hash_slot(VertexSpatialHash *hash, int32_t x, int32_t y, int32_t z, bool insert)
+    {
+        uint32_t h = ((uint32_t)x * 73856093u) ^ ((uint32_t)y * 19349663u) ^ ((uint32_t)z * 83492791u);
+        for (int32_t slot = (int32_t)(h & (uint32_t)hash->tableMask);; slot = (slot + 1) & hash->tableMask)
+        {
+            int32_t *key = &hash->cellKeys[slot * 3];
+            if (hash->cellHead[slot] < 0)
+            {
+                if (!insert)
+                    return -1;
+                key[0] = x;
+                key[1] = y;
+                key[2] = z;
+                return slot;
+            }
+            if (key[0] == x && key[1] == y && key[2] == z)
+                return slot;
+        }
+    }
+
+    // Collect vertices within epsilon of (px, py, pz) into g_colocated_results
+    static int32_t spatial_hash_gather(VertexSpatialHash *hash, float px, float py, float pz)
+    {
+        int32_t cx = spatial_hash_coord(px, hash->invCell);
+        int32_t cy = spatial_hash_coord(py, hash->invCell);
+        int32_t cz = spatial_hash_coord(pz, hash->invCell);
+        float eps = hash->epsilon;
+        int32_t found = 0;
+
+        for (int32_t dz = -1; dz <= 1; dz++)
+        {
+            for (int32_t dy = -1; dy <= 1; dy++)
+            {
+                for (int32_t dx = -1; dx <= 1; dx++)
+                {
+                    int32_t slot = spatial_hash_slot(hash, cx + dx, cy + dy, cz + dz, false);
+                    if (slot < 0)
+                        continue;
+                    for (int32_t v = hash->cellHead[slot]; v >= 0; v = hash->next[v])
+                    {
+                        const float *p = &hash->vertices[v * 12];
+                        if (fabsf(p[0] - px) >= eps || fabsf(p[1] - py) >= eps || fabsf(p[2] - pz) >= eps)
+                            continue;
+                        if (!grow_array(g_colocated_results, g_colocated_results_capacity, found + 1))
+                            return found;
+                        g_colocated_results[found++] = v;
+                    }
+                }
+            }
+        }
+        return found;
+    }
+
+    static VertexSpatialHash *build_vertex_spatial_hash(int32_t handle, float epsilon)
+    {
+        GeometryBuffer *buf = lookup_geometry_buffer(handle);
+        if (!buf || !buf->vertices)
+            return nullptr;
+        free_vertex_spatial_hash(g_geometry_spatial_hashes[handle - 1]);
+        g_geometry_spatial_hashes[handle - 1] = nullptr;
+
+        int32_t count = buf->vertexCount;
+        int32_t tableSize = 16;
+        while (tableSize < count * 2)
+            tableSize *= 2;
+
+        VertexSpatialHash *hash = (VertexSpatialHash *)calloc(1, sizeof(VertexSpatialHash));
+        if (!hash)
+            return nullptr;
+        hash->epsilon = epsilon > 1e-7f ? epsilon : 1e-7f;
+        hash->invCell = 1.0f / hash->epsilon;
+        hash->tableMask = tableSize - 1;
+        hash->vertices = buf->vertices;
+        hash->vertexCount = count;
+        hash->cellKeys = (int32_t *)malloc((size_t)tableSize * 3 * sizeof(int32_t));
+        hash->cellHead = (int32_t *)malloc((size_t)tableSize * sizeof(int32_t));
+        hash->next = (int32_t *)malloc((size_t)(count + 1) * sizeof(int32_t));
+        hash->group = (int32_t *)malloc((size_t)(count + 1) * sizeof(int32_t));
+        hash->groupStart = (int32_t *)malloc((size_t)(count + 2) * sizeof(int32_t));
+        hash->groupMembers = (int32_t *)malloc((size_t)(count + 1) * sizeof(int32_t));
+        if (!hash->cellKeys || !hash->cellHead || !hash->next || !hash->group || !hash->groupStart ||
+            !hash->groupMembers)
+        {
+            free_vertex_spatial_hash(hash);
+            return nullptr;
+        }
+        __builtin_memset(hash->cellHead, 0xFF, (size_t)tableSize * sizeof(int32_t));
+
+        // Insert in reverse so each cell lists its vertices in ascending order
+        for (int32_t v = count - 1; v >= 0; v--)
+        {
+            const float *p = &buf->vertices[v * 12];
+            int32_t slot = spatial_hash_slot(hash, spatial_hash_coord(p[0], hash->invCell),
+                                             spatial_hash_coord(p[1], hash->invCell),
+                                             spatial_hash_coord(p[2], hash->invCell), true);
+            hash->next[v] = hash->cellHead[slot];
+            hash->cellHead[slot] = v;
+        }
+
+        // Seed groups from the lowest unassigned vertex
+        __builtin_memset(hash->group, 0xFF, (size_t)count * sizeof(int32_t));
+        __builtin_memset(hash->groupStart, 0, (size_t)(count + 2) * sizeof(int32_t));
+        for (int32_t v = 0; v < count; v++)
+        {
+            if (hash->group[v] >= 0)
+                continue;
+            int32_t g = hash->groupCount++;
+            const float *p = &buf->vertices[v * 12];
+            int32_t found = spatial_hash_gather(hash, p[0], p[1], p[2]);
+            for (int32_t i = 0; i < found; i++)
+            {
+                int32_t m = g_colocated_results[i];
+                if (hash->group[m] < 0)
+                {
+                    hash->group[m] = g;
+                    hash->groupStart[g + 1]++;
+                }
+            }
+        }
+
+        // Members grouped by group id, ascending within each group
+        for (int32_t g = 0; g < hash->groupCount; g++)
+            hash->groupStart[g + 1] += hash->groupStart[g];
+        for (int32_t v = 0; v < count; v++)
+            hash->groupMembers[hash->groupStart[hash->group[v]]++] = v;
+        for (int32_t g = hash->groupCount; g > 0; g--)
+            hash->groupStart[g] = hash->groupStart[g - 1];
+        hash->groupStart[0] = 0;
+
+        g_geometry_spatial_hashes[handle - 1] = hash;
+        return hash;
+    }
+
+    // Cached hash, rebuilt with the default epsilon if missing or stale
+    static VertexSpatialHash *get_vertex_spatial_hash(int32_t handle)
+    {
+        GeometryBuffer *buf = lookup_geometry_buffer(handle);
+        if (!buf)
+            return nullptr;
+        VertexSpatialHash *hash = g_geometry_spatial_hashes[handle - 1];
+        if (hash && hash->vertices == buf->vertices && hash->vertexCount == buf->vertexCount)
+            return hash;
+        return build_vertex_spatial_hash(handle, hash ? hash->epsilon : SPATIAL_HASH_DEFAULT_EPSILON);
+    }
+
+    // (Re)build the spatial hash after vertex positions changed.
+    // Returns the number of co-location groups, -1 on error.
+    EMSCRIPTEN_KEEPALIVE
+    int32_t spatial_hash_build(int32_t handle, float epsilon)
+    {
+        invalidate_geometry_caches(handle); // Positions moved: every derived structure is stale
+        VertexSpatialHash *hash = build_vertex_spatial_hash(handle, epsilon);
+        return hash ? hash->groupCount : -1;
+    }
+
+    // Vertices within epsilon of vertex (itself included), written to
+    // get_colocated_results_ptr(). Returns the count.
+    EMSCRIPTEN_KEEPALIVE
+    int32_t colocated_vertices(int32_t handle, int32_t vertex)
+    {
+        VertexSpatialHash *hash = get_vertex_spatial_hash(handle);
+        if (!hash || vertex < 0 || vertex >= hash->vertexCount)
+            return 0;
+        const float *p = &hash->vertices[vertex * 12];
+        return spatial_hash_gather(hash, p[0], p[1], p[2]);
+    }
+
+    // Vertices within epsilon of an object-space position
+    EMSCRIPTEN_KEEPALIVE
+    int32_t colocated_vertices_at(int32_t handle, float x, float y, float z)
+    {
+        VertexSpatialHash *hash = get_vertex_spatial_hash(handle);
+        return hash ? spatial_hash_gather(hash, x, y, z) : 0;
+    }
+
+    EMSCRIPTEN_KEEPALIVE
+    int32_t *get_colocated_results_ptr()
+    {
+        return g_colocated_results;
+    }
+
+    // All groups: group id per vertex, plus members sorted by group with
+    // groupCount + 1 run starts. Valid until the buffer changes.
+    EMSCRIPTEN_KEEPALIVE
+    int32_t spatial_hash_get_group_count(int32_t handle)
+    {
+        VertexSpatialHash *hash = get_vertex_spatial_hash(handle);
+        return hash ? hash->groupCount : 0;
+    }
+
+    EMSCRIPTEN_KEEPALIVE
+    int32_t *spatial_hash_get_groups_ptr(int32_t handle)
+    {
+        VertexSpatialHash *hash = get_vertex_spatial_hash(handle);
+        return hash ? hash->group : nullptr;
+    }
+
+    EMSCRIPTEN_KEEPALIVE
+    int32_t *spatial_hash_get_group_starts_ptr(int32_t handle)
+    {
+        VertexSpatialHash *hash = get_vertex_spatial_hash(handle);
+        return hash ? hash->groupStart : nullptr;
+    }
+
+    EMSCRIPTEN_KEEPALIVE
+    int32_t *spatial_hash_get_group_members_ptr(int32_t handle)
+    {
+        VertexSpatialHash *hash = get_vertex_spatial_hash(handle);
+        return hash ? hash->groupMembers : nullptr;
+    }
+
+    // Merge vertices within epsilon of each other into their group's first
+    // vertex (whose attributes are kept), compact the vertex array, remap
+    // indices and drop triangles that collapse. Returns the new vertex count,
+    // -1 on error.
+    EMSCRIPTEN_KEEPALIVE
+    int32_t weld_vertices(int32_t handle, float epsilon)
+    {
+        VertexSpatialHash *hash = build_vertex_spatial_hash(handle, epsilon);
+        if (!hash)
+            return -1;
+        GeometryBuffer *buf = lookup_geometry_buffer(handle);
+
+        // Group seeds are the lowest member and groups are numbered in seed
+        // order, so compacting in place never overwrites an unread seed
+        for (int32_t g = 0; g < hash->groupCount; g++)
+        {
+            int32_t seed = hash->groupMembers[hash->groupStart[g]];
+            if (seed != g)
+                __builtin_memcpy(&buf->vertices[g * 12], &buf->vertices[seed * 12], 12 * sizeof(float));
+        }
+
+        int32_t kept = 0;
+        for (int32_t t = 0; t + 2 < buf->indexCount; t += 3)
+        {
+            uint32_t remapped[3];
+            bool valid = true;
+            for (int k = 0; k < 3; k++)
+            {
+                uint32_t i = buf->indices[t + k];
+                valid = valid && i < (uint32_t)hash->vertexCount;
+                remapped[k] = valid ? (uint32_t)hash->group[i] : 0;
+            }
+            if (!valid || remapped[0] == remapped[1] || remapped[1] == remapped[2] || remapped[0] == remapped[2])
+                continue;
+            buf->indices[kept++] = remapped[0];
+            buf->indices[kept++] = remapped[1];
+            buf->indices[kept++] = remapped[2];
+        }
+
+        buf->vertexCount = hash->groupCount;
+        buf->indexCount = kept;
+        invalidate_geometry_caches(handle);
+        return buf->vertexCount;
+    }
+
+
+    // ============================================================================
+    // Half-Edge Edit Meshes (polygon cages for subdivision and modifiers)
+    // ============================================================================
+    //
+    // An edit mesh holds the polygon faces of one geometry buffer as an
+    // indexed half-edge structure: a face's half-edges are stored contiguously
+    // (so next/prev are index arithmetic), each knows its origin vertex, face
+    // and twin, and per-vertex outgoing lists find twins as faces come and go.
+    // Vertex attributes stay in the geometry buffer; edit_mesh_write_back()
+    // re-triangulates the faces into it. Interactive edit operations stay in
+    // mesh-edit.ts, which works on the main thread's JS meshes.
+    //
+    // Face lists are passed in through the buffer from
+    // edit_mesh_get_input_ptr(); edit_mesh_get_faces() writes them back
+    // through edit_mesh_get_results_ptr().
+
+    constexpr int MAX_EDIT_MESHES = 256;
+
+    struct EditMesh
+    {
+        int32_t geometry; // Geometry buffer handle holding the vertices
+        int32_t faceCount;
+        int32_t faceCapacity;
+        int32_t *faceFirst; // First half-edge of each face
+        int32_t *faceSize;
+        int32_t halfEdgeCount;
+        int32_t halfEdgeCapacity;
+        int32_t *heVertex; // Origin vertex
+        int32_t *heTwin;   // Opposite half-edge, -1 on a boundary
+        int32_t *heFace;
+        int32_t *heNextOut; // Next half-edge leaving the same vertex, -1 at the end
+        int32_t vertexCount; // Initialized entries of vertexOut
+        int32_t vertexCapacity;
+        int32_t *vertexOut; // First outgoing half-edge per vertex, -1 if none
+    };
+
+    static EditMesh *g_edit_meshes[MAX_EDIT_MESHES] = {nullptr};
+    static int32_t *g_edit_input = nullptr;
+    static int32_t g_edit_input_capacity = 0;
+    static int32_t *g_edit_results = nullptr;
+    static int32_t g_edit_results_capacity = 0;
+
+    static inline EditMesh *lookup_edit_mesh(int32_t handle)
+    {
+        int slot = handle - 1;
+        if (slot < 0 || slot >= MAX_EDIT_MESHES)
+            return nullptr;
+        return g_edit_meshes[slot];
+    }
+
+    static inline int32_t edit_next(const EditMesh *m, int32_t h)
+    {
+        int32_t f = m->heFace[h];
+        int32_t i = h - m->faceFirst[f] + 1;
+        return m->faceFirst[f] + (i == m->faceSize[f] ? 0 : i);
+    }
+
+    static inline int32_t edit_prev(const EditMesh *m, int32_t h)
+    {
+        int32_t f = m->heFace[h];
+        int32_t i = h - m->faceFirst[f];
+        return m->faceFirst[f] + (i == 0 ? m->faceSize[f] - 1 : i - 1);
+    }
+
+    static inline int32_t edit_dest(const EditMesh *m, int32_t h)
+    {
+        return m->heVertex[edit_next(m, h)];
+    }
+
+    // Half-edge from a to b, or -1
+    static int32_t edit_find_edge(const EditMesh *m, int32_t a, int32_t b)
+    {
+        if (a < 0 || a >= m->vertexCount)
+            return -1;
+        for (int32_t h = m->vertexOut[a]; h >= 0; h = m->heNextOut[h])
+            if (edit_dest(m, h) == b)
+                return h;
+        return -1;
+    }
+
+    // Make vertexOut cover count vertices (new entries have no edges)
+    static bool edit_reserve_vertices(EditMesh *m, int32_t count)
+    {
+        if (count <= m->vertexCount)
+            return true;
+        if (!grow_array(m->vertexOut, m->vertexCapacity, count))
+            return false;
+        for (int32_t v = m->vertexCount; v < count; v++)
+            m->vertexOut[v] = -1;
+        m->vertexCount = count;
+        return true;
+    }
+
+    static bool edit_reserve(EditMesh *m, int32_t faces, int32_t halfEdges)
+    {
+        int32_t capacity = m->faceCapacity;
+        bool ok = grow_array(m->faceFirst, capacity, faces);
+        capacity = m->faceCapacity;
+        ok = ok && grow_array(m->faceSize, capacity, faces);
+        m->faceCapacity = ok ? capacity : m->faceCapacity;
+
+        int32_t heCapacity = m->halfEdgeCapacity;
+        ok = ok && grow_array(m->heVertex, heCapacity, halfEdges);
+        heCapacity = m->halfEdgeCapacity;
+        ok = ok && grow_array(m->heTwin, heCapacity, halfEdges);
+        heCapacity = m->halfEdgeCapacity;
+        ok = ok && grow_array(m->heFace, heCapacity, halfEdges);
+        heCapacity = m->halfEdgeCapacity;
+        ok = ok && grow_array(m->heNextOut, heCapacity, halfEdges);
+        m->halfEdgeCapacity = ok ? heCapacity : m->halfEdgeCapacity;
+        return ok;
+    }
+
+    // Append a face and link its half-edges to existing twins; returns the face index
+    static int32_t edit_add_face(EditMesh *m, const int32_t *verts, int32_t size)
+    {
+        int32_t maxVertex = 0;
+        for (int32_t i = 0; i < size; i++)
+            maxVertex = verts[i] > maxVertex ? verts[i] : maxVertex;
+        if (!edit_reserve(m, m->faceCount + 1, m->halfEdgeCount + size) || !edit_reserve_vertices(m, maxVertex + 1))
+            return -1;
+        int32_t f = m->faceCount++;
+        int32_t first = m->halfEdgeCount;
+        m->faceFirst[f] = first;
+        m->faceSize[f] = size;
+        m->halfEdgeCount += size;
+        for (int32_t i = 0; i < size; i++)
+        {
+            m->heVertex[first + i] = verts[i];
+            m->heFace[first + i] = f;
+            m->heTwin[first + i] = -1;
+        }
+        for (int32_t i = 0; i < size; i++)
+        {
+            int32_t a = verts[i], b = verts[i + 1 == size ? 0 : i + 1];
+            int32_t twin = edit_find_edge(m, b, a);
+            if (twin >= 0 && m->heTwin[twin] < 0)
+            {
+                m->heTwin[first + i] = twin;
+                m->heTwin[twin] = first + i;
+            }
+            m->heNextOut[first + i] = m->vertexOut[a];
+            m->vertexOut[a] = first + i;
+        }
+        return f;
+    }
+
+    static bool edit_results_reserve(int32_t count)
+    {
+        return grow_array(g_edit_results, g_edit_results_capacity, count > 0 ? count : 1);
+    }
+
+    // Int scratch buffer for passing lists in (grown to count ints)
+    EMSCRIPTEN_KEEPALIVE
+    int32_t *edit_mesh_get_input_ptr(int32_t count)
+    {
+        if (!grow_array(g_edit_input, g_edit_input_capacity, count > 0 ? count : 1))
+            return nullptr;
+        return g_edit_input;
+    }
+
+    EMSCRIPTEN_KEEPALIVE
+    int32_t *edit_mesh_get_results_ptr()
+    {
+        return g_edit_results;
+    }
+
+    // Create an edit mesh over a geometry buffer's vertices. Returns a handle
+    // (0 on failure); load faces with edit_mesh_set_faces().
+    EMSCRIPTEN_KEEPALIVE
+    int32_t edit_mesh_create(int32_t geometryHandle)
+    {
+        if (!lookup_geometry_buffer(geometryHandle))
+            return 0;
+        for (int slot = 0; slot < MAX_EDIT_MESHES; slot++)
+        {
+            if (g_edit_meshes[slot])
+                continue;
+            EditMesh *m = (EditMesh *)calloc(1, sizeof(EditMesh));
+            if (!m)
+                return 0;
+            m->geometry = geometryHandle;
+            g_edit_meshes[slot] = m;
+            return slot + 1;
+        }
+        return 0;
+    }
+
+    static void free_edit_mesh(EditMesh *m)
+    {
+        if (!m)
+            return;
+        free(m->faceFirst);
+        free(m->faceSize);
+        free(m->heVertex);
+        free(m->heTwin);
+        free(m->heFace);
+        free(m->heNextOut);
+        free(m->vertexOut);
+        free(m);
+    }
+
+    EMSCRIPTEN_KEEPALIVE
+    void edit_mesh_delete(int32_t handle)
+    {
+        EditMesh *m = lookup_edit_mesh(handle);
+        if (!m)
+            return;
+        free_edit_mesh(m);
+        g_edit_meshes[handle - 1] = nullptr;
+    }
+
+    // Replace all faces. Input: faceCount sizes followed by the corners of
+    // every face (CCW). Every face needs at least 2 corners, all within the
+    // buffer's vertices; on any invalid face the mesh is left unchanged.
+    // Returns the half-edge count, -1 on error.
+    EMSCRIPTEN_KEEPALIVE
+    int32_t edit_mesh_set_faces(int32_t handle, int32_t faceCount)
+    {
+        EditMesh *m = lookup_edit_mesh(handle);
+        GeometryBuffer *buf = m ? lookup_geometry_buffer(m->geometry) : nullptr;
+        if (!buf || faceCount < 0 || faceCount > g_edit_input_capacity)
+            return -1;
+
+        // Validate everything before touching the mesh
+        int64_t corners = 0;
+        for (int32_t f = 0; f < faceCount; f++)
+        {
+            if (g_edit_input[f] < 2)
+                return -1;
+            corners += g_edit_input[f];
+        }
+        if (faceCount + corners > g_edit_input_capacity)
+            return -1;
+        const int32_t *verts = &g_edit_input[faceCount];
+        for (int64_t i = 0; i < corners; i++)
+            if (verts[i] < 0 || verts[i] >= buf->vertexCount)
+                return -1;
+
+        m->faceCount = 0;
+        m->halfEdgeCount = 0;
+        m->vertexCount = 0;
+        if (!edit_reserve(m, faceCount, (int32_t)corners) || !edit_reserve_vertices(m, buf->vertexCount))
+            return -1;
+        for (int32_t f = 0; f < faceCount; f++)
+        {
+            edit_add_face(m, verts, g_edit_input[f]);
+            verts += g_edit_input[f];
+        }
+        return m->halfEdgeCount;
+    }
+
+    EMSCRIPTEN_KEEPALIVE
+    int32_t edit_mesh_get_face_count(int32_t handle)
+    {
+        EditMesh *m = lookup_edit_mesh(handle);
+        return m ? m->faceCount : 0;
+    }
+
+    // Export faces into the results buffer in edit_mesh_set_faces() layout.
+    // Returns the total int count (faceCount + corners), -1 on error.
+    EMSCRIPTEN_KEEPALIVE
+    int32_t edit_mesh_get_faces(int32_t handle)
+    {
+        EditMesh *m = lookup_edit_mesh(handle);
+        if (!m || !edit_results_reserve(m->faceCount + m->halfEdgeCount))
+            return -1;
+        for (int32_t f = 0; f < m->faceCount; f++)
+            g_edit_results[f] = m->faceSize[f];
+        __builtin_memcpy(&g_edit_results[m->faceCount], m->heVertex, (size_t)m->halfEdgeCount * sizeof(int32_t));
+        return m->faceCount + m->halfEdgeCount;
+    }
+
+    // Triangulate the faces (fans) into the geometry buffer's index array.
+    // Two-vertex edge faces produce no triangles. Returns the index count.
+    EMSCRIPTEN_KEEPALIVE
+    int32_t edit_mesh_write_back(int32_t handle)
+    {
+        EditMesh *m = lookup_edit_mesh(handle);
+        GeometryBuffer *buf = m ? lookup_geometry_buffer(m->geometry) : nullptr;
+        if (!buf)
+            return -1;
+        int32_t indexCount = 0;
+        for (int32_t f = 0; f < m->faceCount; f++)
+            indexCount += m->faceSize[f] > 2 ? (m->faceSize[f] - 2) * 3 : 0;
+        if (!grow_array(buf->indices, buf->indexCapacity, indexCount > 0 ? indexCount : 1))
+            return -1;
+
+        uint32_t *out = buf->indices;
+        for (int32_t f = 0; f < m->faceCount; f++)
+        {
+            const int32_t *v = &m->heVertex[m->faceFirst[f]];
+            for (int32_t i = 1; i + 1 < m->faceSize[f]; i++)
+            {
+                *out++ = (uint32_t)v[0];
+                *out++ = (uint32_t)v[i];
+                *out++ = (uint32_t)v[i + 1];
+            }
+        }
+        buf->indexCount = indexCount;
+        invalidate_geometry_caches(m->geometry);
+        return indexCount;
+    }
+
+    // ============================================================================
+    // Normal Recomputation
+    // ============================================================================
+    //
+    // Face normals live in a per-buffer cache (also used by flat shading in
+    // render_geometry_buffer). Vertex normals are written into the buffer's
+    // nx, ny, nz: NORMALS_AREA_WEIGHTED sums unnormalized face normals,
+    // NORMALS_ANGLE_WEIGHTED weights unit face normals by the corner angle.
+    // After moving vertices in place, geometry_buffer_update_normals()
+    // refreshes only the faces and vertices around the edited range.
+
+    constexpr int NORMALS_AREA_WEIGHTED = 0;
+    constexpr int NORMALS_ANGLE_WEIGHTED = 1;
+
+    // Build the vertex -> triangle adjacency (CSR) once per topology
+    static bool normal_cache_build_adjacency(NormalCache *cache, const GeometryBuffer *buf)
+    {
+        if (cache->vertexTriStart)
+            return true;
+        int32_t vertexCount = buf->vertexCount;
+        cache->vertexTriStart = (int32_t *)calloc((size_t)vertexCount + 2, sizeof(int32_t));
+        cache->vertexTris = (int32_t *)malloc((size_t)cache->triangleCount * 3 * sizeof(int32_t) + 1);
+        cache->marks = (uint8_t *)malloc((size_t)(vertexCount > cache->triangleCount ? vertexCount : cache->triangleCount) + 1);
+        if (!cache->vertexTriStart || !cache->vertexTris || !cache->marks)
+        {
+            free(cache->vertexTriStart);
+            free(cache->vertexTris);
+            free(cache->marks);
+            cache->vertexTriStart = nullptr;
+            cache->vertexTris = nullptr;
+            cache->marks = nullptr;
+            return false;
+        }
+        for (int32_t i = 0; i < cache->triangleCount * 3; i++)
+            if (buf->indices[i] < (uint32_t)vertexCount)
+                cache->vertexTriStart[buf->indices[i] + 1]++;
+        for (int32_t v = 0; v < vertexCount; v++)
+            cache->vertexTriStart[v + 1] += cache->vertexTriStart[v];
+        for (int32_t i = 0; i < cache->triangleCount * 3; i++)
+            if (buf->indices[i] < (uint32_t)vertexCount)
+                cache->vertexTris[cache->vertexTriStart[buf->indices[i]]++] = i / 3;
+        for (int32_t v = vertexCount; v > 0; v--)
+            cache->vertexTriStart[v] = cache->vertexTriStart[v - 1];
+        cache->vertexTriStart[0] = 0;
+        return true;
+    }
+
+    static inline bool triangle_indices_valid(const GeometryBuffer *buf, int32_t t)
+    {
+        uint32_t limit = (uint32_t)buf->vertexCount;
+        return buf->indices[t * 3] < limit && buf->indices[t * 3 + 1] < limit && buf->indices[t * 3 + 2] < limit;
+    }
+
+    static inline void store_vertex_normal(GeometryBuffer *buf, int32_t v, float x, float y, float z)
+    {
+        float len = sqrtf(x * x + y * y + z * z);
+        float inv = len > 1e-20f ? 1.0f / len : 0.0f;
+        buf->vertices[v * 12 + 3] = x * inv;
+        buf->vertices[v * 12 + 4] = y * inv;
+        buf->vertices[v * 12 + 5] = z * inv;
+    }
+
+    // Recompute every face normal and vertex normal of a buffer.
+    // Returns the triangle count, -1 on error.
+    EMSCRIPTEN_KEEPALIVE
+    int32_t geometry_buffer_compute_normals(int32_t handle, int32_t mode)
+    {
+        NormalCache *cache = get_normal_cache(handle);
+        if (!cache)
+            return -1;
+        GeometryBuffer *buf = lookup_geometry_buffer(handle);
+        // A validated cache may predate in-place position edits
+        compute_face_normals(buf, cache->faceNormals, cache->faceAreas, 0, cache->triangleCount);
+
+        float *sums = (float *)calloc((size_t)buf->vertexCount * 3 + 1, sizeof(float));
+        if (!sums)
+            return -1;
+        for (int32_t t = 0; t < cache->triangleCount; t++)
+        {
+            if (!triangle_indices_valid(buf, t))
+                continue;
+            const float *n = &cache->faceNormals[t * 3];
+            for (int c = 0; c < 3; c++)
+            {
+                float w = mode == NORMALS_ANGLE_WEIGHTED ? triangle_corner_angle(buf, t, c) : cache->faceAreas[t];
+                float *sum = &sums[buf->indices[t * 3 + c] * 3];
+                sum[0] += n[0] * w;
+                sum[1] += n[1] * w;
+                sum[2] += n[2] * w;
+            }
+        }
+        for (int32_t v = 0; v < buf->vertexCount; v++)
+        {
+            // Vertices without faces keep their normal
+            if (sums[v * 3] != 0.0f || sums[v * 3 + 1] != 0.0f || sums[v * 3 + 2] != 0.0f)
+                store_vertex_normal(buf, v, sums[v * 3], sums[v * 3 + 1], sums[v * 3 + 2]);
+        }
+        free(sums);
+        return cache->triangleCount;
+    }
+
+    // Refresh normals after vertices [firstVertex, firstVertex + count) moved
+    // in place: their faces, then every vertex of those faces. Returns the
+    // number of vertex normals rewritten, -1 on error.
+    EMSCRIPTEN_KEEPALIVE
+    int32_t geometry_buffer_update_normals(int32_t handle, int32_t firstVertex, int32_t count, int32_t mode)
+    {
+        NormalCache *cache = get_normal_cache(handle);
+        GeometryBuffer *buf = lookup_geometry_buffer(handle);
+        if (!cache || !normal_cache_build_adjacency(cache, buf))
+            return -1;
+        touch_geometry_morphs(handle - 1); // Vertices were edited in place
+        touch_geometry_lighting(handle - 1);
+        int32_t end = firstVertex + count;
+        firstVertex = firstVertex < 0 ? 0 : firstVertex;
+        end = end > buf->vertexCount ? buf->vertexCount : end;
+        const int32_t *start = cache->vertexTriStart;
+
+        // Marks: bit 0 = face refreshed (by triangle), bit 1 = vertex rewritten
+        int32_t markCount = buf->vertexCount > cache->triangleCount ? buf->vertexCount : cache->triangleCount;
+        __builtin_memset(cache->marks, 0, (size_t)markCount);
+
+        // Faces around the edited vertices
+        for (int32_t v = firstVertex; v < end; v++)
+        {
+            for (int32_t i = start[v]; i < start[v + 1]; i++)
+            {
+                int32_t t = cache->vertexTris[i];
+                if (cache->marks[t] & 1)
+                    continue;
+                cache->marks[t] |= 1;
+                compute_face_normals(buf, cache->faceNormals, cache->faceAreas, t, t + 1);
+            }
+        }
+
+        // Every vertex of those faces, from all of its adjacent faces
+        int32_t updated = 0;
+        for (int32_t v = firstVertex; v < end; v++)
+        {
+            for (int32_t i = start[v]; i < start[v + 1]; i++)
+            {
+                int32_t t = cache->vertexTris[i];
+                for (int c = 0; c < 3; c++)
+                {
+                    uint32_t u = buf->indices[t * 3 + c];
+                    if (u >= (uint32_t)buf->vertexCount || (cache->marks[u] & 2))
+                        continue;
+                    cache->marks[u] |= 2;
+                    float sx = 0.0f, sy = 0.0f, sz = 0.0f;
+                    for (int32_t j = start[u]; j < start[u + 1]; j++)
+                    {
+                        int32_t f = cache->vertexTris[j];
+                        const float *n = &cache->faceNormals[f * 3];
+                        float w = cache->faceAreas[f];
+                        if (mode == NORMALS_ANGLE_WEIGHTED)
+                        {
+                            int corner = buf->indices[f * 3] == u ? 0 : (buf->indices[f * 3 + 1] == u ? 1 : 2);
+                            w = triangle_corner_angle(buf, f, corner);
+                        }
+                        sx += n[0] * w;
+                        sy += n[1] * w;
+                        sz += n[2] * w;
+                    }
+                    if (sx != 0.0f || sy != 0.0f || sz != 0.0f)
+                        store_vertex_normal(buf, (int32_t)u, sx, sy, sz);
+                    updated++;
+                }
+            }
+        }
+        return updated;
+    }
+
+    // Cached object-space face normals (3 floats per triangle), computed on demand
+    EMSCRIPTEN_KEEPALIVE
+    float *geometry_buffer_get_face_normals_ptr(int32_t handle)
+    {
+        NormalCache *cache = get_normal_cache(handle);
+        return cache ? cache->faceNormals : nullptr;
+    }
+
+
+    // ============================================================================
+    // Catmull-Clark Subdivision
+    // ============================================================================
+    //
+    // A subdivision surface refines the faces of an edit mesh (the cage).
+    // Building it is topology-only: every level gets a stencil table, each
+    // new vertex being a weighted sum of the previous level's vertices, plus
+    // its triangle list. Evaluating a level then just runs the tables over
+    // the cage vertices, cheap enough to redo whenever the cage moves, and
+    // writes into a derived geometry buffer owned by the surface. Call
+    // subdiv_update_topology() after the cage's faces change.
+    //
+    // Level vertex order is previous-level vertices (as vertex points), then
+    // one edge point per edge, then one face point per face, so cage vertex
+    // i stays vertex i at every level. Boundaries follow the crease rules
+    // (edge midpoints, 1-6-1 vertex points); corners and non-manifold
+    // vertices stay put. All 12 vertex floats go through the stencils and
+    // normals are recomputed from the refined faces.
+
+    constexpr int MAX_SUBDIVISION_SURFACES = 64;
+    constexpr int MAX_SUBDIVISION_LEVEL = 4;
+
+    struct StencilEntry
+    {
+        int32_t index; // Source vertex
+        float weight;
+    };
+
+    struct StencilTable
+    {
+        int32_t count;  // Output vertices
+        int32_t *start; // count + 1 offsets into entries
+        StencilEntry *entries;
+        int32_t entryCount;
+        int32_t entryCapacity;
+    };
+
+    struct SubdivisionSurface
+    {
+        int32_t editMesh;        // Cage topology (over its geometry buffer)
+        int32_t requestedLevels; // Levels to build on topology updates
+        int32_t levelCount;      // Levels built
+        int32_t cageVertexCount;
+        StencilTable stencils[MAX_SUBDIVISION_LEVEL]; // Level L -> L + 1
+        int32_t vertexCount[MAX_SUBDIVISION_LEVEL + 1];
+        uint32_t *triangles[MAX_SUBDIVISION_LEVEL + 1]; // Level 0 = cage
+        int32_t triangleCount[MAX_SUBDIVISION_LEVEL + 1];
+        float *scratch;          // Intermediate levels during evaluation
+        int32_t scratchCapacity; // In floats
+        int32_t output;          // Derived geometry buffer (0 until evaluated)
+        int32_t outputLevel;     // Level whose triangles the output holds (-1 none)
+    };
+
+    static SubdivisionSurface *g_subdivision_surfaces[MAX_SUBDIVISION_SURFACES] = {nullptr};
+    static StencilEntry *g_stencil_row = nullptr; // Stencil being assembled
+    static int32_t g_stencil_row_capacity = 0;
+    static int32_t g_stencil_row_size = 0;
+
+    static inline SubdivisionSurface *lookup_subdivision_surface(int32_t handle)
+    {
+        int slot = handle - 1;
+        if (slot < 0 || slot >= MAX_SUBDIVISION_SURFACES)
+            return nullptr;
+        return g_subdivision_surfaces[slot];
+    }
+
+    // Add a weighted source vertex to the current row, merging duplicates
+    static bool stencil_row_add(int32_t index, float weight)
+    {
+        for (int32_t i = 0; i < g_stencil_row_size; i++)
+        {
+            if (g_stencil_row[i].index == index)
+            {
+                g_stencil_row[i].weight += weight;
+                return true;
+            }
+        }
+        if (!grow_array(g_stencil_row, g_stencil_row_capacity, g_stencil_row_size + 1))
+            return false;
+        g_stencil_row[g_stencil_row_size].index = index;
+        g_stencil_row[g_stencil_row_size].weight = weight;
+        g_stencil_row_size++;
+        return true;
+    }
+
+    // Face point (centroid) of face f, scaled by weight
+    static bool stencil_row_add_face(const EditMesh *m, int32_t f, float weight)
+    {
+        float w = weight / (float)m->faceSize[f];
+        for (int32_t h = m->faceFirst[f]; h < m->faceFirst[f] + m->faceSize[f]; h++)
+            if (!stencil_row_add(m->heVertex[h], w))
+                return false;
+        return true;
+    }
+
+    // Append the current row as output vertex `row` and start a new one
+    static bool stencil_table_commit(StencilTable *t, int32_t row)
+    {
+        if (!grow_array(t->entries, t->entryCapacity, t->entryCount + g_stencil_row_size))
+            return false;
+        __builtin_memcpy(&t->entries[t->entryCount], g_stencil_row, (size_t)g_stencil_row_size * sizeof(StencilEntry));
+        t->entryCount += g_stencil_row_size;
+        t->start[row + 1] = t->entryCount;
+        g_stencil_row_size = 0;
+        return true;
+    }
+
+    static void free_stencil_table(StencilTable *t)
+    {
+        free(t->start);
+        free(t->entries);
+        __builtin_memset(t, 0, sizeof(StencilTable));
+    }
+
+    // Vertex point stencil for v
+    static bool subdiv_vertex_stencil(const EditMesh *m, int32_t v)
+    {
+        int32_t faces = 0, boundary = 0, boundaryA = -1, boundaryB = -1;
+        int32_t first = v < m->vertexCount ? m->vertexOut[v] : -1;
+        for (int32_t h = first; h >= 0; h = m->heNextOut[h])
+        {
+            faces++;
+            if (m->heTwin[h] < 0)
+            {
+                boundary++;
+                boundaryA = edit_dest(m, h);
+            }
+            int32_t in = edit_prev(m, h);
+            if (m->heTwin[in] < 0)
+            {
+                boundary++;
+                boundaryB = m->heVertex[in];
+            }
+        }
+
+        if (faces == 0 || boundary > 2 || (boundary == 0 && faces < 3))
+            return stencil_row_add(v, 1.0f);
+        if (boundary == 2)
+        {
+            // Boundary curve rule
+            return stencil_row_add(v, 0.75f) && stencil_row_add(boundaryA, 0.125f) &&
+                   stencil_row_add(boundaryB, 0.125f);
+        }
+        if (boundary == 1)
+            return stencil_row_add(v, 1.0f);
+
+        // Interior: ((n - 2) V + avg(neighbours) + avg(face points)) / n
+        float n = (float)faces;
+        float w = 1.0f / (n * n);
+        if (!stencil_row_add(v, (n - 2.0f) / n))
+            return false;
+        for (int32_t h = first; h >= 0; h = m->heNextOut[h])
+        {
+            if (!stencil_row_add(edit_dest(m, h), w) || !stencil_row_add_face(m, m->heFace[h], w))
+                return false;
+        }
+        return true;
+    }
+
+    // Refine one level: build the stencil table from m's vertexCount vertices
+    // and the next level's triangles. Returns the next level's topology
+    // (nullptr on failure); the caller frees it.
+    static EditMesh *subdiv_refine(const EditMesh *m, int32_t vertexCount, StencilTable *table,
+                                   uint32_t **triangles, int32_t *triangleCount)
+    {
+        int32_t halfEdges = m->halfEdgeCount;
+        int32_t *heEdge = (int32_t *)malloc((size_t)(halfEdges + 1) * sizeof(int32_t));
+        EditMesh *next = (EditMesh *)calloc(1, sizeof(EditMesh));
+        if (!heEdge || !next)
+        {
+            free(heEdge);
+            free(next);
+            return nullptr;
+        }
+
+        // One edge per boundary half-edge or twin pair
+        int32_t edgeCount = 0;
+        for (int32_t h = 0; h < halfEdges; h++)
+            if (m->heTwin[h] < 0 || h < m->heTwin[h])
+                heEdge[h] = edgeCount++;
+        for (int32_t h = 0; h < halfEdges; h++)
+            if (m->heTwin[h] >= 0 && h > m->heTwin[h])
+                heEdge[h] = heEdge[m->heTwin[h]];
+
+        int32_t edgeBase = vertexCount;
+        int32_t faceBase = vertexCount + edgeCount;
+        int32_t count = faceBase + m->faceCount;
+        free_stencil_table(table);
+        table->count = count;
+        table->start = (int32_t *)malloc((size_t)(count + 1) * sizeof(int32_t));
+        *triangles = (uint32_t *)malloc((size_t)halfEdges * 6 * sizeof(uint32_t) + 1);
+        bool ok = table->start && *triangles && edit_reserve(next, halfEdges, halfEdges * 4) &&
+                  edit_reserve_vertices(next, count);
+        if (ok)
+            table->start[0] = 0;
+        g_stencil_row_size = 0;
+
+        for (int32_t v = 0; ok && v < vertexCount; v++)
+            ok = subdiv_vertex_stencil(m, v) && stencil_table_commit(table, v);
+
+        for (int32_t h = 0; ok && h < halfEdges; h++)
+        {
+            int32_t twin = m->heTwin[h];
+            if (twin >= 0 && h > twin)
+                continue;
+            int32_t a = m->heVertex[h], b = edit_dest(m, h);
+            if (twin < 0)
+                ok = stencil_row_add(a, 0.5f) && stencil_row_add(b, 0.5f);
+            else
+                ok = stencil_row_add(a, 0.25f) && stencil_row_add(b, 0.25f) &&
+                     stencil_row_add_face(m, m->heFace[h], 0.25f) && stencil_row_add_face(m, m->heFace[twin], 0.25f);
+            ok = ok && stencil_table_commit(table, edgeBase + heEdge[h]);
+        }
+
+        for (int32_t f = 0; ok && f < m->faceCount; f++)
+            ok = stencil_row_add_face(m, f, 1.0f) && stencil_table_commit(table, faceBase + f);
+
+        // One quad per face corner: vertex, outgoing edge, face, incoming edge
+        uint32_t *tri = ok ? *triangles : nullptr;
+        for (int32_t f = 0; ok && f < m->faceCount; f++)
+        {
+            for (int32_t h = m->faceFirst[f]; ok && h < m->faceFirst[f] + m->faceSize[f]; h++)
+            {
+                int32_t quad[4] = {m->heVertex[h], edgeBase + heEdge[h], faceBase + f,
+                                   edgeBase + heEdge[edit_prev(m, h)]};
+                ok = edit_add_face(next, quad, 4) >= 0;
+                *tri++ = (uint32_t)quad[0];
+                *tri++ = (uint32_t)quad[1];
+                *tri++ = (uint32_t)quad[2];
+                *tri++ = (uint32_t)quad[0];
+                *tri++ = (uint32_t)quad[2];
+                *tri++ = (uint32_t)quad[3];
+            }
+        }
+        *triangleCount = halfEdges * 2;
+        free(heEdge);
+        if (!ok)
+        {
+            free_edit_mesh(next);
+            return nullptr;
+        }
+        return next;
+    }
+
+    // dst[i] = sum of weight * src[index] over row i, 12 floats per vertex
+    static void apply_stencil_table(const StencilTable *t, const float *src, float *dst)
+    {
+        for (int32_t i = 0; i < t->count; i++)
+        {
+            v128_t a0 = wasm_f32x4_splat(0.0f);
+            v128_t a1 = a0, a2 = a0;
+            for (int32_t k = t->start[i]; k < t->start[i + 1]; k++)
+            {
+                const float *s = &src[t->entries[k].index * 12];
+                v128_t w = wasm_f32x4_splat(t->entries[k].weight);
+                a0 = wasm_f32x4_add(a0, wasm_f32x4_mul(wasm_v128_load(s), w));
+                a1 = wasm_f32x4_add(a1, wasm_f32x4_mul(wasm_v128_load(s + 4), w));
+                a2 = wasm_f32x4_add(a2, wasm_f32x4_mul(wasm_v128_load(s + 8), w));
+            }
+            wasm_v128_store(&dst[i * 12], a0);
+            wasm_v128_store(&dst[i * 12 + 4], a1);
+            wasm_v128_store(&dst[i * 12 + 8], a2);
+        }
+    }
+
+    static void subdiv_free_levels(SubdivisionSurface *s)
+    {
+        for (int l = 0; l < MAX_SUBDIVISION_LEVEL; l++)
+            free_stencil_table(&s->stencils[l]);
+        for (int l = 0; l <= MAX_SUBDIVISION_LEVEL; l++)
+        {
+            free(s->triangles[l]);
+            s->triangles[l] = nullptr;
+            s->triangleCount[l] = 0;
+            s->vertexCount[l] = 0;
+        }
+        s->levelCount = 0;
+        s->outputLevel = -1;
+    }
+
+    // Rebuild stencil tables and triangles from the cage's current faces.
+    // Returns the number of levels built, -1 on error.
+    EMSCRIPTEN_KEEPALIVE
+    int32_t subdiv_update_topology(int32_t handle)
+    {
+        SubdivisionSurface *s = lookup_subdivision_surface(handle);
+        EditMesh *cage = s ? lookup_edit_mesh(s->editMesh) : nullptr;
+        GeometryBuffer *buf = cage ? lookup_geometry_buffer(cage->geometry) : nullptr;
+        if (!buf)
+            return -1;
+        subdiv_free_levels(s);
+
+        // Level 0: the cage itself, fan-triangulated
+        int32_t cageTriangles = 0;
+        for (int32_t f = 0; f < cage->faceCount; f++)
+            cageTriangles += cage->faceSize[f] > 2 ? cage->faceSize[f] - 2 : 0;
+        s->triangles[0] = (uint32_t *)malloc((size_t)cageTriangles * 3 * sizeof(uint32_t) + 1);
+        if (!s->triangles[0])
+            return -1;
+        uint32_t *tri = s->triangles[0];
+        for (int32_t f = 0; f < cage->faceCount; f++)
+        {
+            const int32_t *v = &cage->heVertex[cage->faceFirst[f]];
+            for (int32_t i = 1; i + 1 < cage->faceSize[f]; i++)
+            {
+                *tri++ = (uint32_t)v[0];
+                *tri++ = (uint32_t)v[i];
+                *tri++ = (uint32_t)v[i + 1];
+            }
+        }
+        s->triangleCount[0] = cageTriangles;
+        s->cageVertexCount = buf->vertexCount;
+        s->vertexCount[0] = buf->vertexCount;
+
+        const EditMesh *level = cage;
+        EditMesh *refined = nullptr;
+        for (int32_t l = 0; l < s->requestedLevels; l++)
+        {
+            EditMesh *next = subdiv_refine(level, s->vertexCount[l], &s->stencils[l], &s->triangles[l + 1],
+                                           &s->triangleCount[l + 1]);
+            free_edit_mesh(refined);
+            if (!next)
+                return -1;
+            refined = next;
+            level = next;
+            s->vertexCount[l + 1] = s->stencils[l].count;
+            s->levelCount = l + 1;
+        }
+        free_edit_mesh(refined);
+        return s->levelCount;
+    }
+
+    // Create a subdivision surface over an edit mesh, refined up to `levels`
+    // (1-4). Returns a handle, 0 on failure.
+    EMSCRIPTEN_KEEPALIVE
+    int32_t subdiv_create(int32_t editMeshHandle, int32_t levels)
+    {
+        if (!lookup_edit_mesh(editMeshHandle))
+            return 0;
+        for (int slot = 0; slot < MAX_SUBDIVISION_SURFACES; slot++)
+        {
+            if (g_subdivision_surfaces[slot])
+                continue;
+            SubdivisionSurface *s = (SubdivisionSurface *)calloc(1, sizeof(SubdivisionSurface));
+            if (!s)
+                return 0;
+            s->editMesh = editMeshHandle;
+            s->requestedLevels = levels < 1 ? 1 : (levels > MAX_SUBDIVISION_LEVEL ? MAX_SUBDIVISION_LEVEL : levels);
+            s->outputLevel = -1;
+            g_subdivision_surfaces[slot] = s;
+            if (subdiv_update_topology(slot + 1) < 0)
+            {
+                subdiv_free_levels(s);
+                free(s);
+                g_subdivision_surfaces[slot] = nullptr;
+                return 0;
+            }
+            return slot + 1;
+        }
+        return 0;
+    }
+
+    // Frees the surface and its derived geometry buffer
+    EMSCRIPTEN_KEEPALIVE
+    void subdiv_delete(int32_t handle)
+    {
+        SubdivisionSurface *s = lookup_subdivision_surface(handle);
+        if (!s)
+            return;
+        subdiv_free_levels(s);
+        if (s->output)
+            delete_geometry_buffer(s->output);
+        free(s->scratch);
+        free(s);
+        g_subdivision_surfaces[handle - 1] = nullptr;
+    }
+
+    // Evaluate `level` (0 = cage) from the cage's current vertices into the
+    // derived geometry buffer. Returns that buffer's handle, 0 on error
+    // (including a cage whose vertex count changed since the last
+    // subdiv_update_topology()).
+    EMSCRIPTEN_KEEPALIVE
+    int32_t subdiv_evaluate(int32_t handle, int32_t level)
+    {
+        SubdivisionSurface *s = lookup_subdivision_surface(handle);
+        EditMesh *cage = s ? lookup_edit_mesh(s->editMesh) : nullptr;
+        GeometryBuffer *buf = cage ? lookup_geometry_buffer(cage->geometry) : nullptr;
+        if (!buf || buf->vertexCount != s->cageVertexCount || level < 0 || level > s->levelCount)
+            return 0;
+        if (!s->output)
+        {
+            s->output = create_geometry_buffer();
+            s->outputLevel = -1;
+            if (!s->output)
+                return 0;
+        }
+
+        // Intermediate levels ping-pong: odd levels in the first half of
+        // scratch, even levels in the second
+        int32_t oddFloats = 0, evenFloats = 0;
+        for (int32_t l = 1; l < level; l++)
+            *((l & 1) ? &oddFloats : &evenFloats) = s->vertexCount[l] * 12;
+        if (!grow_array(s->scratch, s->scratchCapacity, oddFloats + evenFloats + 1))
+            return 0;
+        float *out = geometry_buffer_alloc_vertices(s->output, s->vertexCount[level]);
+        if (!out)
+            return 0;
+
+        const float *src = buf->vertices;
+        float *odd = s->scratch;
+        float *even = s->scratch + oddFloats;
+        for (int32_t l = 0; l < level; l++)
+        {
+            float *dst = l + 1 == level ? out : ((l & 1) ? even : odd);
+            apply_stencil_table(&s->stencils[l], src, dst);
+            src = dst;
+        }
+        if (level == 0)
+            __builtin_memcpy(out, buf->vertices, (size_t)buf->vertexCount * 12 * sizeof(float));
+
+        GeometryBuffer *outBuf = lookup_geometry_buffer(s->output);
+        if (s->outputLevel != level || outBuf->indexCount != s->triangleCount[level] * 3)
+        {
+            uint32_t *indices = geometry_buffer_alloc_indices(s->output, s->triangleCount[level] * 3);
+            if (!indices && s->triangleCount[level] > 0)
+                return 0;
+            __builtin_memcpy(indices, s->triangles[level], (size_t)s->triangleCount[level] * 3 * sizeof(uint32_t));
+            s->outputLevel = level;
+        }
+        if (s->triangleCount[level] > 0)
+            geometry_buffer_compute_normals(s->output, NORMALS_AREA_WEIGHTED);
+        return s->output;
+    }
+
+    EMSCRIPTEN_KEEPALIVE
+    int32_t subdiv_get_level_count(int32_t handle)
+    {
+        SubdivisionSurface *s = lookup_subdivision_surface(handle);
+        return s ? s->levelCount : 0;
+    }
+
+    EMSCRIPTEN_KEEPALIVE
+    int32_t subdiv_get_vertex_count(int32_t handle, int32_t level)
+    {
+        SubdivisionSurface *s = lookup_subdivision_surface(handle);
+        return s && level >= 0 && level <= s->levelCount ? s->vertexCount[level] : 0;
+    }
+
+    EMSCRIPTEN_KEEPALIVE
+    int32_t subdiv_get_triangle_count(int32_t handle, int32_t level)
+    {
+        SubdivisionSurface *s = lookup_subdivision_surface(handle);
+        return s && level >= 0 && level <= s->levelCount ? s->triangleCount[level] : 0;
+    }
+
+
+    // ============================================================================
+    // Modifier Stacks (non-destructive, lazily evaluated)
+    // ============================================================================
+    //
+    // A modifier stack runs an ordered list of modifiers over a base geometry
+    // buffer. Every stage caches its output in its own geometry buffer, keyed
+    // by the version of its input and of its parameters; evaluation walks the
+    // stack and only re-runs stages whose keys changed. Versions come from one
+    // global counter, so a key can never match a stale stage by accident.
+    //
+    // The base is re-read when its buffer is re-uploaded (pointer or count
+    // change); after editing it in place call modifier_stack_touch().
+    // Array modifiers at the end of the stack are not materialized:
+    // modifier_stack_render() draws the last evaluated stage once per
+    // instance with an offset model matrix, so changing their count or
+    // offset costs nothing. modifier_stack_materialize() expands them into
+    // a standalone buffer for export.
+
+    constexpr int MAX_MODIFIER_STACKS = 256;
+    constexpr int MAX_MODIFIERS = 16;
+    constexpr int MAX_MODIFIER_PARAMS = 8;
+    constexpr int MAX_ARRAY_COUNT = 4096;
+    constexpr int MAX_MODIFIER_INSTANCES = 65536;
+
+    // Modifier types and their parameters
+    constexpr int MODIFIER_MIRROR = 0;    // axis (0-2), merge distance
+    constexpr int MODIFIER_ARRAY = 1;     // count, offset x, y, z
+    constexpr int MODIFIER_SOLIDIFY = 2;  // thickness
+    constexpr int MODIFIER_SUBDIVIDE = 3; // levels (Catmull-Clark)
+
+    struct ModifierStage
+    {
+        int32_t type;
+        float params[MAX_MODIFIER_PARAMS];
+        uint32_t paramsVersion;
+        // Cache key: what the output was computed from
+        uint32_t evaluatedParams;
+        uint32_t inputVersion;
+        uint32_t inputTopology;
+        // Output
+        int32_t output;           // Geometry buffer (owned by subdiv for SUBDIVIDE)
+        uint32_t version;         // Bumped on every evaluation
+        uint32_t topologyVersion; // Bumped when the output's indices change
+        uint32_t topologyHash;
+        int32_t editMesh; // SUBDIVIDE: cage over the input buffer
+        int32_t subdiv;
+    };
+
+    struct ModifierStack
+    {
+        int32_t base; // Geometry buffer handle
+        uint32_t baseVersion;
+        uint32_t baseTopology;
+        // Base buffer state at last evaluation (a change bumps the versions)
+        const float *baseVertices;
+        const uint32_t *baseIndices;
+        int32_t baseVertexCount;
+        int32_t baseIndexCount;
+        int32_t count;
+        ModifierStage stages[MAX_MODIFIERS];
+        int32_t evaluations; // Stages re-run by the last evaluation
+    };
+
+    static ModifierStack *g_modifier_stacks[MAX_MODIFIER_STACKS] = {nullptr};
+    static uint32_t g_modifier_version = 0;
+    static float *g_modifier_offsets = nullptr; // Instance offsets (3 floats each)
+    static int32_t g_modifier_offsets_capacity = 0;
+
+    static inline ModifierStack *lookup_modifier_stack(int32_t handle)
+    {
+        int slot = handle - 1;
+        if (slot < 0 || slot >= MAX_MODIFIER_STACKS)
+            return nullptr;
+        return g_modifier_stacks[slot];
+    }
+
+    static void free_modifier_stage(ModifierStage *st)
+    {
+        if (st->subdiv)
+            subdiv_delete(st->subdiv); // Also frees the output buffer
+        else if (st->output)
+            delete_geometry_buffer(st->output);
+        if (st->editMesh)
+            edit_mesh_delete(st->editMesh);
+        st->subdiv = 0;
+        st->output = 0;
+        st->editMesh = 0;
+    }
+
+    // First of the trailing array modifiers (count if there are none)
+    static int32_t modifier_instanced_start(const ModifierStack *stack)
+    {
+        int32_t first = stack->count;
+        while (first > 0 && stack->stages[first - 1].type == MODIFIER_ARRAY)
+            first--;
+        return first;
+    }
+
+    static inline int32_t modifier_array_count(const ModifierStage *st)
+    {
+        int32_t n = (int32_t)st->params[0];
+        return n < 1 ? 1 : (n > MAX_ARRAY_COUNT ? MAX_ARRAY_COUNT : n);
+    }
+
+    // Fill g_modifier_offsets with the combined offsets of array stages
+    // [first, end), stopping before the instance cap. Returns the instance
+    // count, 0 on error.
+    static int32_t modifier_build_offsets(const ModifierStack *stack, int32_t first, int32_t end)
+    {
+        int32_t instances = 1;
+        for (int32_t i = first; i < end; i++)
+        {
+            int32_t n = modifier_array_count(&stack->stages[i]);
+            if (instances * n > MAX_MODIFIER_INSTANCES)
+            {
+                end = i;
+                break;
+            }
+            instances *= n;
+        }
+        if (!grow_array(g_modifier_offsets, g_modifier_offsets_capacity, instances * 3))
+            return 0;
+        g_modifier_offsets[0] = g_modifier_offsets[1] = g_modifier_offsets[2] = 0.0f;
+        int32_t filled = 1;
+        for (int32_t i = first; i < end; i++)
+        {
+            const ModifierStage *st = &stack->stages[i];
+            int32_t n = modifier_array_count(st);
+            // Each existing instance gets n copies stepping by this offset
+            for (int32_t k = n - 1; k >= 0; k--)
+            {
+                for (int32_t j = 0; j < filled; j++)
+                {
+                    float *dst = &g_modifier_offsets[(k * filled + j) * 3];
+                    const float *src = &g_modifier_offsets[j * 3];
+                    dst[0] = src[0] + st->params[1] * (float)k;
+                    dst[1] = src[1] + st->params[2] * (float)k;
+                    dst[2] = src[2] + st->params[3] * (float)k;
+                }
+            }
+            filled *= n;
+        }
+        return filled;
+    }
+
+    // Write one translated copy of `in` per offset into buffer `out`
+    static bool modifier_replicate(const GeometryBuffer *in, int32_t out, const float *offsets, int32_t copies)
+    {
+        int32_t vertexCount = in->vertexCount, indexCount = in->indexCount;
+        float *v = geometry_buffer_alloc_vertices(out, vertexCount * copies);
+        uint32_t *idx = geometry_buffer_alloc_indices(out, indexCount * copies);
+        if ((!v && vertexCount > 0) || (!idx && indexCount > 0))
+            return false;
+        for (int32_t c = 0; c < copies; c++)
+        {
+            float *dst = &v[(size_t)c * vertexCount * 12];
+            __builtin_memcpy(dst, in->vertices, (size_t)vertexCount * 12 * sizeof(float));
+            for (int32_t i = 0; i < vertexCount; i++)
+            {
+                dst[i * 12] += offsets[c * 3];
+                dst[i * 12 + 1] += offsets[c * 3 + 1];
+                dst[i * 12 + 2] += offsets[c * 3 + 2];
+            }
+            uint32_t base = (uint32_t)(c * vertexCount);
+            for (int32_t i = 0; i < indexCount; i++)
+                idx[(size_t)c * indexCount + i] = in->indices[i] + base;
+        }
+        return true;
+    }
+
+    static bool modifier_mirror(const GeometryBuffer *in, int32_t out, const float *params)
+    {
+        int axis = (int)params[0];
+        axis = axis < 0 ? 0 : (axis > 2 ? 2 : axis);
+        float merge = params[1];
+        int32_t vertexCount = in->vertexCount, indexCount = in->indexCount;
+        int32_t *remap = (int32_t *)malloc((size_t)(vertexCount + 1) * sizeof(int32_t));
+        if (!remap)
+            return false;
+
+        // Vertices on the plane are shared by both halves
+        int32_t total = vertexCount;
+        for (int32_t i = 0; i < vertexCount; i++)
+            remap[i] = fabsf(in->vertices[i * 12 + axis]) <= merge ? i : total++;
+        float *v = geometry_buffer_alloc_vertices(out, total);
+        uint32_t *idx = geometry_buffer_alloc_indices(out, indexCount * 2);
+        if ((!v && total > 0) || (!idx && indexCount > 0))
+        {
+            free(remap);
+            return false;
+        }
+        __builtin_memcpy(v, in->vertices, (size_t)vertexCount * 12 * sizeof(float));
+        for (int32_t i = 0; i < vertexCount; i++)
+        {
+            if (remap[i] == i)
+                continue;
+            float *dst = &v[remap[i] * 12];
+            __builtin_memcpy(dst, &in->vertices[i * 12], 12 * sizeof(float));
+            dst[axis] = -dst[axis];
+            dst[3 + axis] = -dst[3 + axis];
+        }
+
+        // Mirrored triangles with flipped winding: (a, c, b)
+        __builtin_memcpy(idx, in->indices, (size_t)indexCount * sizeof(uint32_t));
+        for (int32_t t = 0; t + 2 < indexCount; t += 3)
+        {
+            for (int c = 0; c < 3; c++)
+            {
+                uint32_t i = in->indices[t + (c == 0 ? 0 : 3 - c)];
+                idx[indexCount + t + c] = i < (uint32_t)vertexCount ? (uint32_t)remap[i] : i;
+            }
+        }
+        free(remap);
+        return true;
+    }
+
+    static bool modifier_solidify(const GeometryBuffer *in, int32_t out, const float *params)
+    {
+        float thickness = params[0];
+        int32_t vertexCount = in->vertexCount, triangleCount = in->indexCount / 3;
+
+        // Boundary edges from a throwaway half-edge mesh of the triangles
+        EditMesh *m = (EditMesh *)calloc(1, sizeof(EditMesh));
+        if (!m || !edit_reserve(m, triangleCount, triangleCount * 3) || !edit_reserve_vertices(m, vertexCount))
+        {
+            free_edit_mesh(m);
+            return false;
+        }
+        for (int32_t t = 0; t < triangleCount; t++)
+        {
+            int32_t tri[3] = {(int32_t)in->indices[t * 3], (int32_t)in->indices[t * 3 + 1],
+                              (int32_t)in->indices[t * 3 + 2]};
+            if ((uint32_t)tri[0] < (uint32_t)vertexCount && (uint32_t)tri[1] < (uint32_t)vertexCount &&
+                (uint32_t)tri[2] < (uint32_t)vertexCount)
+                edit_add_face(m, tri, 3);
+        }
+        int32_t boundary = 0;
+        for (int32_t h = 0; h < m->halfEdgeCount; h++)
+            boundary += m->heTwin[h] < 0;
+
+        float *v = geometry_buffer_alloc_vertices(out, vertexCount * 2);
+        uint32_t *idx = geometry_buffer_alloc_indices(out, m->halfEdgeCount * 2 + boundary * 6);
+        if ((!v && vertexCount > 0) || (!idx && m->halfEdgeCount > 0))
+        {
+            free_edit_mesh(m);
+            return false;
+        }
+
+        // Inner shell: pushed back along the normal, facing the other way
+        __builtin_memcpy(v, in->vertices, (size_t)vertexCount * 12 * sizeof(float));
+        for (int32_t i = 0; i < vertexCount; i++)
+        {
+            float *dst = &v[(vertexCount + i) * 12];
+            __builtin_memcpy(dst, &in->vertices[i * 12], 12 * sizeof(float));
+            Vec3 n = Vec3(dst[3], dst[4], dst[5]).normalize();
+            dst[0] -= n.x * thickness;
+            dst[1] -= n.y * thickness;
+            dst[2] -= n.z * thickness;
+            dst[3] = -dst[3];
+            dst[4] = -dst[4];
+            dst[5] = -dst[5];
+        }
+        uint32_t *o = idx;
+        uint32_t inner = (uint32_t)vertexCount;
+        for (int32_t f = 0; f < m->faceCount; f++)
+        {
+            const int32_t *c = &m->heVertex[m->faceFirst[f]];
+            *o++ = (uint32_t)c[0];
+            *o++ = (uint32_t)c[1];
+            *o++ = (uint32_t)c[2];
+        }
+        for (int32_t f = 0; f < m->faceCount; f++)
+        {
+            const int32_t *c = &m->heVertex[m->faceFirst[f]];
+            *o++ = inner + (uint32_t)c[0];
+            *o++ = inner + (uint32_t)c[2];
+            *o++ = inner + (uint32_t)c[1];
+        }
+
+        // Rim quad (b, a, a', b') along each boundary edge a -> b
+        for (int32_t h = 0; h < m->halfEdgeCount; h++)
+        {
+            if (m->heTwin[h] >= 0)
+                continue;
+            uint32_t a = (uint32_t)m->heVertex[h], b = (uint32_t)edit_dest(m, h);
+            *o++ = b;
+            *o++ = a;
+            *o++ = inner + a;
+            *o++ = b;
+            *o++ = inner + a;
+            *o++ = inner + b;
+        }
+        free_edit_mesh(m);
+        return true;
+    }
+
+    // Consecutive triangles (a, b, c), (a, c, d) - or their flipped form
+    // (a, c, b), (a, d, c) - are one fan-triangulated quad. Writes it to quad.
+    static bool modifier_pair_quad(const uint32_t *t0, int32_t vertexCount, int32_t *quad)
+    {
+        const uint32_t *t1 = t0 + 3;
+        if (t1[0] != t0[0])
+            return false;
+        if (t1[1] == t0[2] && t1[2] != t0[1])
+        {
+            quad[0] = (int32_t)t0[0], quad[1] = (int32_t)t0[1], quad[2] = (int32_t)t0[2], quad[3] = (int32_t)t1[2];
+        }
+        else if (t1[2] == t0[1] && t1[1] != t0[2])
+        {
+            quad[0] = (int32_t)t1[0], quad[1] = (int32_t)t1[1], quad[2] = (int32_t)t1[2], quad[3] = (int32_t)t0[2];
+        }
+        else
+            return false;
+        for (int i = 0; i < 4; i++)
+            if ((uint32_t)quad[i] >= (uint32_t)vertexCount)
+                return false;
+        return true;
+    }
+
+    // Load the input's triangles into the stage's edit mesh, re-pairing
+    // fan-triangulated quads so Catmull-Clark sees the original quads
+    static bool modifier_load_cage(ModifierStage *st, const GeometryBuffer *in)
+    {
+        int32_t triangleCount = in->indexCount / 3;
+        int32_t *input = edit_mesh_get_input_ptr(triangleCount * 4 + 1);
+        if (!input)
+            return false;
+        int32_t faces = 0, quad[4];
+        for (int32_t t = 0; t < triangleCount; t++, faces++)
+            t += t + 1 < triangleCount && modifier_pair_quad(&in->indices[t * 3], in->vertexCount, quad);
+
+        int32_t *corners = &input[faces];
+        faces = 0;
+        for (int32_t t = 0; t < triangleCount; t++)
+        {
+            if (t + 1 < triangleCount && modifier_pair_quad(&in->indices[t * 3], in->vertexCount, quad))
+            {
+                input[faces++] = 4;
+                __builtin_memcpy(corners, quad, sizeof(quad));
+                corners += 4;
+                t++;
+                continue;
+            }
+            input[faces++] = 3;
+            for (int c = 0; c < 3; c++)
+                *corners++ = (int32_t)in->indices[t * 3 + c];
+        }
+        return edit_mesh_set_faces(st->editMesh, faces) >= 0;
+    }
+
+    static bool modifier_subdivide(ModifierStage *st, int32_t inputHandle, bool topologyChanged)
+    {
+        const GeometryBuffer *in = lookup_geometry_buffer(inputHandle);
+        EditMesh *cage = lookup_edit_mesh(st->editMesh);
+        int32_t levels = (int32_t)st->params[0];
+        levels = levels < 1 ? 1 : (levels > MAX_SUBDIVISION_LEVEL ? MAX_SUBDIVISION_LEVEL : levels);
+        if (!cage || cage->geometry != inputHandle)
+        {
+            // The stage was moved onto a different input
+            free_modifier_stage(st);
+            st->editMesh = edit_mesh_create(inputHandle);
+            topologyChanged = true;
+        }
+        if (!st->editMesh)
+            return false;
+
+        SubdivisionSurface *s = lookup_subdivision_surface(st->subdiv);
+        if (topologyChanged || !s || s->requestedLevels != levels)
+        {
+            if (!modifier_load_cage(st, in))
+                return false;
+            if (!s)
+            {
+                st->subdiv = subdiv_create(st->editMesh, levels);
+                if (!st->subdiv)
+                    return false;
+            }
+            else
+            {
+                s->requestedLevels = levels;
+                if (subdiv_update_topology(st->subdiv) < 0)
+                    return false;
+            }
+        }
+        st->output = subdiv_evaluate(st->subdiv, levels);
+        return st->output != 0;
+    }
+
+    static uint32_t modifier_topology_hash(const GeometryBuffer *buf)
+    {
+        uint32_t h = 2166136261u ^ (uint32_t)buf->vertexCount;
+        for (int32_t i = 0; i < buf->indexCount; i++)
+            h = (h ^ buf->indices[i]) * 16777619u;
+        return h;
+    }
+
+    static bool modifier_run_stage(ModifierStage *st, int32_t inputHandle, bool topologyChanged)
+    {
+        const GeometryBuffer *in = lookup_geometry_buffer(inputHandle);
+        if (!in)
+            return false;
+        if (st->type == MODIFIER_SUBDIVIDE)
+            return modifier_subdivide(st, inputHandle, topologyChanged);
+        if (!st->output)
+            st->output = create_geometry_buffer();
+        if (!st->output)
+            return false;
+        if (st->type == MODIFIER_MIRROR)
+            return modifier_mirror(in, st->output, st->params);
+        if (st->type == MODIFIER_SOLIDIFY)
+            return modifier_solidify(in, st->output, st->params);
+        if (st->type == MODIFIER_ARRAY)
+        {
+            int32_t copies = modifier_array_count(st);
+            if (!grow_array(g_modifier_offsets, g_modifier_offsets_capacity, copies * 3))
+                return false;
+            for (int32_t k = 0; k < copies; k++)
+            {
+                g_modifier_offsets[k * 3] = st->params[1] * (float)k;
+                g_modifier_offsets[k * 3 + 1] = st->params[2] * (float)k;
+                g_modifier_offsets[k * 3 + 2] = st->params[3] * (float)k;
+            }
+            return modifier_replicate(in, st->output, g_modifier_offsets, copies);
+        }
+        return false;
+    }
+
+    // Create a stack over a geometry buffer. Returns a handle, 0 on failure.
+    EMSCRIPTEN_KEEPALIVE
+    int32_t modifier_stack_create(int32_t baseHandle)
+    {
+        if (!lookup_geometry_buffer(baseHandle))
+            return 0;
+        for (int slot = 0; slot < MAX_MODIFIER_STACKS; slot++)
+        {
+            if (g_modifier_stacks[slot])
+                continue;
+            ModifierStack *stack = (ModifierStack *)calloc(1, sizeof(ModifierStack));
+            if (!stack)
+                return 0;
+            stack->base = baseHandle;
+            stack->baseVersion = ++g_modifier_version;
+            stack->baseTopology = ++g_modifier_version;
+            g_modifier_stacks[slot] = stack;
+            return slot + 1;
+        }
+        return 0;
+    }
+
+    // Frees the stack and every cached stage output (not the base)
+    EMSCRIPTEN_KEEPALIVE
+    void modifier_stack_delete(int32_t handle)
+    {
+        ModifierStack *stack = lookup_modifier_stack(handle);
+        if (!stack)
+            return;
+        for (int32_t i = 0; i < stack->count; i++)
+            free_modifier_stage(&stack->stages[i]);
+        free(stack);
+        g_modifier_stacks[handle - 1] = nullptr;
+    }
+
+    // Mark the base as edited in place (topology != 0 if indices changed)
+    EMSCRIPTEN_KEEPALIVE
+    void modifier_stack_touch(int32_t handle, int32_t topology)
+    {
+        ModifierStack *stack = lookup_modifier_stack(handle);
+        if (!stack)
+            return;
+        stack->baseVersion = ++g_modifier_version;
+        if (topology)
+            stack->baseTopology = ++g_modifier_version;
+    }
+
+    // Append a modifier with default parameters. Returns its index, -1 on error.
+    EMSCRIPTEN_KEEPALIVE
+    int32_t modifier_stack_add(int32_t handle, int32_t type)
+    {
+        ModifierStack *stack = lookup_modifier_stack(handle);
+        if (!stack || stack->count >= MAX_MODIFIERS || type < MODIFIER_MIRROR || type > MODIFIER_SUBDIVIDE)
+            return -1;
+        ModifierStage *st = &stack->stages[stack->count];
+        __builtin_memset(st, 0, sizeof(ModifierStage));
+        st->type = type;
+        if (type == MODIFIER_MIRROR)
+            st->params[1] = 0.001f;
+        else if (type == MODIFIER_ARRAY)
+        {
+            st->params[0] = 2.0f;
+            st->params[1] = 1.0f;
+        }
+        else if (type == MODIFIER_SOLIDIFY)
+            st->params[0] = 0.1f;
+        else
+            st->params[0] = 1.0f;
+        st->paramsVersion = ++g_modifier_version;
+        return stack->count++;
+    }
+
+    // Remove a modifier; stages after it are re-evaluated on their new input
+    EMSCRIPTEN_KEEPALIVE
+    void modifier_stack_remove(int32_t handle, int32_t index)
+    {
+        ModifierStack *stack = lookup_modifier_stack(handle);
+        if (!stack || index < 0 || index >= stack->count)
+            return;
+        free_modifier_stage(&stack->stages[index]);
+        for (int32_t i = index; i + 1 < stack->count; i++)
+        {
+            stack->stages[i] = stack->stages[i + 1];
+            stack->stages[i].paramsVersion = ++g_modifier_version;
+        }
+        stack->count--;
+    }
+
+    EMSCRIPTEN_KEEPALIVE
+    void modifier_stack_set_param(int32_t handle, int32_t index, int32_t param, float value)
+    {
+        ModifierStack *stack = lookup_modifier_stack(handle);
+        if (!stack || index < 0 || index >= stack->count || param < 0 || param >= MAX_MODIFIER_PARAMS)
+            return;
+        ModifierStage *st = &stack->stages[index];
+        if (st->params[param] == value)
+            return;
+        st->params[param] = value;
+        st->paramsVersion = ++g_modifier_version;
+    }
+
+    EMSCRIPTEN_KEEPALIVE
+    int32_t modifier_stack_get_count(int32_t handle)
+    {
+        ModifierStack *stack = lookup_modifier_stack(handle);
+        return stack ? stack->count : 0;
+    }
+
+    // Bring every stage before the trailing arrays up to date. Returns the
+    // geometry buffer to draw (the base if nothing needs materializing),
+    // 0 on error.
+    EMSCRIPTEN_KEEPALIVE
+    int32_t modifier_stack_evaluate(int32_t handle)
+    {
+        ModifierStack *stack = lookup_modifier_stack(handle);
+        GeometryBuffer *base = stack ? lookup_geometry_buffer(stack->base) : nullptr;
+        if (!base)
+            return 0;
+        if (base->vertices != stack->baseVertices)
+            stack->baseVersion = ++g_modifier_version;
+        if (base->indices != stack->baseIndices || base->indexCount != stack->baseIndexCount ||
+            base->vertexCount != stack->baseVertexCount)
+            stack->baseVersion = stack->baseTopology = ++g_modifier_version;
+        stack->baseVertices = base->vertices;
+        stack->baseIndices = base->indices;
+        stack->baseVertexCount = base->vertexCount;
+        stack->baseIndexCount = base->indexCount;
+
+        int32_t input = stack->base;
+        uint32_t inputVersion = stack->baseVersion, inputTopology = stack->baseTopology;
+        int32_t end = modifier_instanced_start(stack);
+        stack->evaluations = 0;
+        for (int32_t i = 0; i < end; i++)
+        {
+            ModifierStage *st = &stack->stages[i];
+            bool paramsChanged = st->evaluatedParams != st->paramsVersion;
+            bool topologyChanged = paramsChanged || st->inputTopology != inputTopology;
+            if (paramsChanged || topologyChanged || st->inputVersion != inputVersion || !st->output)
             {
-                int stackPtr = 0;
+                if (!modifier_run_stage(st, input, topologyChanged))
+                {
+                    st->evaluatedParams = 0; // Retry next time
+                    return 0;
+                }
+                st->evaluatedParams = st->paramsVersion;
+                st->inputVersion = inputVersion;
+                st->inputTopology = inputTopology;
+                st->version = ++g_modifier_version;
+                uint32_t hash = modifier_topology_hash(lookup_geometry_buffer(st->output));
+                if (hash != st->topologyHash || st->topologyVersion == 0)
+                    st->topologyVersion = ++g_modifier_version;
+                st->topologyHash = hash;
+                stack->evaluations++;
+            }
+            input = st->output;
+            inputVersion = st->version;
+            inputTopology = st->topologyVersion;
+        }
+        return input;
+    }
 
-                // Handle edge case where we don't have full 4 pixels
-                int pixelCount = (x + 4 <= width) ? 4 : (width - x);
+    // Stages re-run by the last modifier_stack_evaluate()
+    EMSCRIPTEN_KEEPALIVE
+    int32_t modifier_stack_get_evaluation_count(int32_t handle)
+    {
+        ModifierStack *stack = lookup_modifier_stack(handle);
+        return stack ? stack->evaluations : 0;
+    }
 
-                // U coordinates for 4 pixels
-                v128_t v_x = wasm_f32x4_add(
-                    wasm_f32x4_make((float)x, (float)(x + 1), (float)(x + 2), (float)(x + 3)),
-                    v_half);
-                v128_t v_u = wasm_f32x4_mul(v_x, v_invWidth);
+    // Evaluate and draw, instancing the trailing array modifiers with the
+    // current MVP/model matrices. Returns the number of instances drawn.
+    EMSCRIPTEN_KEEPALIVE
+    int32_t modifier_stack_render(int32_t handle)
+    {
+        int32_t geometry = modifier_stack_evaluate(handle);
+        ModifierStack *stack = lookup_modifier_stack(handle);
+        if (!geometry)
+        {
+            g_material_count = 0; // Per-draw table, as for render_geometry_buffer
+            return 0;
+        }
+        int32_t instances = modifier_build_offsets(stack, modifier_instanced_start(stack), stack->count);
+        if (instances <= 1)
+        {
+            render_geometry_buffer(geometry);
+            return 1;
+        }
 
-                // Execute program for all 4 pixels
-                uint8_t *pc = g_bake_program;
-                bool done = false;
+        alignas(16) float mvp[16], model[16], translate[16];
+        __builtin_memcpy(mvp, g_mvp_matrix, sizeof(mvp));
+        __builtin_memcpy(model, g_model_matrix, sizeof(model));
+        for (int i = 0; i < 16; i++)
+            translate[i] = i % 5 == 0 ? 1.0f : 0.0f;
+        for (int32_t k = 0; k < instances; k++)
+        {
+            translate[3] = g_modifier_offsets[k * 3];
+            translate[7] = g_modifier_offsets[k * 3 + 1];
+            translate[11] = g_modifier_offsets[k * 3 + 2];
+            mat4_mul(g_mvp_matrix, mvp, translate);
+            mat4_mul(g_model_matrix, model, translate);
+            draw_geometry_buffer(geometry);
+        }
+        __builtin_memcpy(g_mvp_matrix, mvp, sizeof(mvp));
+        __builtin_memcpy(g_model_matrix, model, sizeof(model));
+        g_material_count = 0;
+        return instances;
+    }
 
-                while (!done)
+    // Full result with the trailing arrays expanded, in a new geometry
+    // buffer the caller owns. Returns its handle, 0 on error.
+    EMSCRIPTEN_KEEPALIVE
+    int32_t modifier_stack_materialize(int32_t handle)
+    {
+        int32_t geometry = modifier_stack_evaluate(handle);
+        ModifierStack *stack = lookup_modifier_stack(handle);
+        if (!geometry)
+            return 0;
+        int32_t instances = modifier_build_offsets(stack, modifier_instanced_start(stack), stack->count);
+        int32_t out = instances > 0 ? create_geometry_buffer() : 0;
+        if (!out)
+            return 0;
+        if (!modifier_replicate(lookup_geometry_buffer(geometry), out, g_modifier_offsets, instances))
+        {
+            delete_geometry_buffer(out);
+            return 0;
+        }
+        return out;
+    }
+
+
+    // ============================================================================
+    // Mesh Simplification and LOD Chains
+    // ============================================================================
+    //
+    // Quadric error metric simplification by half-edge collapse: a vertex is
+    // merged into a neighbour, so every level is only an index list over the
+    // buffer's own vertices and attributes are never interpolated. Collapses
+    // run in passes, cheapest first, each pass touching a neighbourhood at
+    // most once, until the target triangle count is reached.
+    //
+    // Collapses move whole position groups, so vertices split only by their
+    // normal (flat-shaded meshes duplicate every corner per face) stay welded.
+    // Groups whose vertices disagree on UV or color and groups on
+    // non-manifold edges are locked, so texture / color seams are kept
+    // exactly. Open borders only collapse along themselves and carry extra
+    // edge planes so silhouettes hold. The cost adds a penalty for UV, normal
+    // and color differences so visually distinct vertices survive longer.
+    //
+    // render_geometry_buffer() picks a level per draw (see
+    // select_geometry_lod); set_lod_pixel_error() sets the tolerance.
+
+    constexpr float LOD_BORDER_WEIGHT = 10.0f;
+    constexpr float LOD_ATTRIBUTE_WEIGHT = 0.05f; // Radius fraction per unit of attribute change
+    constexpr uint8_t LOD_VERTEX_LOCKED = 1;
+    constexpr uint8_t LOD_VERTEX_BORDER = 2;
+
+    // Symmetric 4x4 error quadric: error(p) = p'Ap + 2b'p + c, area weighted
+    struct Quadric
+    {
+        double a00, a01, a02, a11, a12, a22;
+        double b0, b1, b2;
+        double c;
+        double w; // Accumulated weight
+    };
+
+    static void quadric_add_plane(Quadric *q, double nx, double ny, double nz, double d, double w)
+    {
+        q->a00 += w * nx * nx;
+        q->a01 += w * nx * ny;
+        q->a02 += w * nx * nz;
+        q->a11 += w * ny * ny;
+        q->a12 += w * ny * nz;
+        q->a22 += w * nz * nz;
+        q->b0 += w * nx * d;
+        q->b1 += w * ny * d;
+        q->b2 += w * nz * d;
+        q->c += w * d * d;
+        q->w += w;
+    }
+
+    static void quadric_add(Quadric *q, const Quadric *r)
+    {
+        double *dst = &q->a00;
+        const double *src = &r->a00;
+        for (int i = 0; i < 11; i++)
+            dst[i] += src[i];
+    }
+
+    static double quadric_error(const Quadric *q, const float *p)
+    {
+        double x = p[0], y = p[1], z = p[2];
+        double e = q->a00 * x * x + q->a11 * y * y + q->a22 * z * z +
+                   2.0 * (q->a01 * x * y + q->a02 * x * z + q->a12 * y * z) +
+                   2.0 * (q->b0 * x + q->b1 * y + q->b2 * z) + q->c;
+        return e > 0.0 ? e : 0.0;
+    }
+
+    // Directed edge table over position groups
+    static int32_t lod_edge_slot(const uint64_t *keys, int32_t mask, uint64_t key)
+    {
+        uint64_t h = key * 0x9E3779B97F4A7C15ull;
+        for (int32_t slot = (int32_t)(h >> 40) & mask;; slot = (slot + 1) & mask)
+            if (keys[slot] == key || keys[slot] == ~0ull)
+                return slot;
+    }
+
+    static inline uint64_t lod_edge_key(int32_t a, int32_t b)
+    {
+        return ((uint64_t)(uint32_t)a << 32) | (uint32_t)b;
+    }
+
+    static inline bool lod_has_edge(const uint64_t *keys, int32_t mask, int32_t a, int32_t b)
+    {
+        uint64_t key = lod_edge_key(a, b);
+        return keys[lod_edge_slot(keys, mask, key)] == key;
+    }
+
+    // Squared UV / normal / color difference between two vertices
+    static inline float lod_attribute_distance(const float *a, const float *b)
+    {
+        float d = 0.0f;
+        for (int i = 6; i < 11; i++)
+            d += (a[i] - b[i]) * (a[i] - b[i]);
+        for (int i = 3; i < 6; i++)
+            d += 0.25f * (a[i] - b[i]) * (a[i] - b[i]);
+        return d;
+    }
+
+    // True if two co-located vertices differ in UV or color (a real seam)
+    static inline bool lod_attribute_seam(const float *a, const float *b)
+    {
+        for (int i = 6; i < 8; i++)
+            if (fabsf(a[i] - b[i]) > 1e-5f)
+                return true;
+        for (int i = 8; i < 12; i++)
+            if (fabsf(a[i] - b[i]) > 0.5f)
+                return true;
+        return false;
+    }
+
+    static inline Vec3 lod_triangle_normal(const float *a, const float *b, const float *c)
+    {
+        Vec3 e1(b[0] - a[0], b[1] - a[1], b[2] - a[2]);
+        Vec3 e2(c[0] - a[0], c[1] - a[1], c[2] - a[2]);
+        return e1.cross(e2);
+    }
+
+    // Sort candidate ids by non-negative float cost (two 16-bit radix passes)
+    static void lod_sort_candidates(const float *cost, uint32_t *order, uint32_t *tmp, int32_t count,
+                                    int32_t *histogram)
+    {
+        for (int pass = 0; pass < 2; pass++)
+        {
+            int shift = pass * 16;
+            __builtin_memset(histogram, 0, 65536 * sizeof(int32_t));
+            const uint32_t *src = pass == 0 ? nullptr : tmp;
+            uint32_t *dst = pass == 0 ? tmp : order;
+            for (int32_t i = 0; i < count; i++)
+            {
+                uint32_t id = src ? src[i] : (uint32_t)i;
+                uint32_t bits;
+                __builtin_memcpy(&bits, &cost[id], 4);
+                histogram[(bits >> shift) & 0xFFFF]++;
+            }
+            int32_t sum = 0;
+            for (int i = 0; i < 65536; i++)
+            {
+                int32_t c = histogram[i];
+                histogram[i] = sum;
+                sum += c;
+            }
+            for (int32_t i = 0; i < count; i++)
+            {
+                uint32_t id = src ? src[i] : (uint32_t)i;
+                uint32_t bits;
+                __builtin_memcpy(&bits, &cost[id], 4);
+                dst[histogram[(bits >> shift) & 0xFFFF]++] = id;
+            }
+        }
+    }
+
+    // Simplify the triangles in `indices` (rewritten in place) towards
+    // targetIndexCount. Quadrics, flags and adjacency are kept per position
+    // group of `hash`; a collapse remaps every vertex of one group to the
+    // closest-attribute vertex of the other.
+    // Returns the new index count; *error gets the largest collapse distance.
+    static int32_t simplify_index_list(const GeometryBuffer *buf, const VertexSpatialHash *hash, uint32_t *indices,
+                                       int32_t indexCount, int32_t targetIndexCount, float attributeScale,
+                                       float *error)
+    {
+        *error = 0.0f;
+        int32_t vertexCount = buf->vertexCount;
+        int32_t groupCount = hash->groupCount;
+        const int32_t *group = hash->group;
+        const float *vtx = buf->vertices;
+        int32_t tableSize = 16;
+        while (tableSize < indexCount * 2)
+            tableSize *= 2;
+        int32_t mask = tableSize - 1;
+        int32_t candidateMax = indexCount * 2;
+
+        Quadric *quadrics = (Quadric *)calloc((size_t)groupCount + 1, sizeof(Quadric));
+        uint8_t *flags = (uint8_t *)calloc((size_t)groupCount + 1, 1);
+        uint8_t *touched = (uint8_t *)malloc((size_t)groupCount + 1);
+        int32_t *remap = (int32_t *)malloc(((size_t)vertexCount + 1) * sizeof(int32_t));
+        int32_t *triStart = (int32_t *)malloc(((size_t)groupCount + 2) * sizeof(int32_t));
+        int32_t *triList = (int32_t *)malloc(((size_t)indexCount + 1) * sizeof(int32_t));
+        uint64_t *edgeKeys = (uint64_t *)malloc((size_t)tableSize * sizeof(uint64_t));
+        uint8_t *edgeCount = (uint8_t *)malloc((size_t)tableSize);
+        int32_t *candidates = (int32_t *)malloc(((size_t)candidateMax + 1) * 2 * sizeof(int32_t));
+        float *cost = (float *)malloc(((size_t)candidateMax + 1) * sizeof(float));
+        uint32_t *order = (uint32_t *)malloc(((size_t)candidateMax + 1) * sizeof(uint32_t));
+        uint32_t *sortTmp = (uint32_t *)malloc(((size_t)candidateMax + 1) * sizeof(uint32_t));
+        int32_t *histogram = (int32_t *)malloc(65536 * sizeof(int32_t));
+        bool ok = quadrics && flags && touched && remap && triStart && triList && edgeKeys && edgeCount &&
+                  candidates && cost && order && sortTmp && histogram;
+
+        // Drop triangles with invalid or co-located corners up front
+        int32_t kept = 0;
+        for (int32_t t = 0; ok && t + 2 < indexCount; t += 3)
+        {
+            uint32_t a = indices[t], b = indices[t + 1], c = indices[t + 2];
+            if (a >= (uint32_t)vertexCount || b >= (uint32_t)vertexCount || c >= (uint32_t)vertexCount ||
+                group[a] == group[b] || group[b] == group[c] || group[a] == group[c])
+                continue;
+            indices[kept++] = a;
+            indices[kept++] = b;
+            indices[kept++] = c;
+        }
+        indexCount = ok ? kept : indexCount;
+
+        // Directed edges between position groups: borders have no reverse,
+        // non-manifold edges repeat
+        for (int32_t i = 0; ok && i < tableSize; i++)
+            edgeKeys[i] = ~0ull;
+        for (int32_t t = 0; ok && t < indexCount; t += 3)
+        {
+            for (int c = 0; c < 3; c++)
+            {
+                uint64_t key = lod_edge_key(group[indices[t + c]], group[indices[t + (c + 1) % 3]]);
+                int32_t slot = lod_edge_slot(edgeKeys, mask, key);
+                if (edgeKeys[slot] != key)
                 {
-                    BakeOpcode op = (BakeOpcode)*pc++;
+                    edgeKeys[slot] = key;
+                    edgeCount[slot] = 0;
+                }
+                edgeCount[slot] += edgeCount[slot] < 255;
+            }
+        }
+
+        // Plane quadrics per triangle, edge planes along borders
+        for (int32_t t = 0; ok && t < indexCount; t += 3)
+        {
+            const float *p[3] = {&vtx[indices[t] * 12], &vtx[indices[t + 1] * 12], &vtx[indices[t + 2] * 12]};
+            Vec3 n = lod_triangle_normal(p[0], p[1], p[2]);
+            float area = n.length();
+            if (area > 1e-20f)
+            {
+                n = n * (1.0f / area);
+                double d = -(n.x * p[0][0] + n.y * p[0][1] + n.z * p[0][2]);
+                for (int c = 0; c < 3; c++)
+                    quadric_add_plane(&quadrics[group[indices[t + c]]], n.x, n.y, n.z, d, area * 0.5);
+            }
+            for (int c = 0; c < 3; c++)
+            {
+                uint32_t a = indices[t + c], b = indices[t + (c + 1) % 3];
+                int32_t ga = group[a], gb = group[b];
+                int32_t slot = lod_edge_slot(edgeKeys, mask, lod_edge_key(ga, gb));
+                if (edgeCount[slot] > 1)
+                {
+                    flags[ga] |= LOD_VERTEX_LOCKED;
+                    flags[gb] |= LOD_VERTEX_LOCKED;
+                }
+                if (lod_has_edge(edgeKeys, mask, gb, ga))
+                    continue;
+                flags[ga] |= LOD_VERTEX_BORDER;
+                flags[gb] |= LOD_VERTEX_BORDER;
+                const float *pa = &vtx[a * 12], *pb = &vtx[b * 12];
+                Vec3 edge(pb[0] - pa[0], pb[1] - pa[1], pb[2] - pa[2]);
+                Vec3 side = edge.cross(n);
+                float len = side.length();
+                if (len <= 1e-20f)
+                    continue;
+                side = side * (1.0f / len);
+                double d = -(side.x * pa[0] + side.y * pa[1] + side.z * pa[2]);
+                double w = edge.dot(edge) * LOD_BORDER_WEIGHT;
+                quadric_add_plane(&quadrics[ga], side.x, side.y, side.z, d, w);
+                quadric_add_plane(&quadrics[gb], side.x, side.y, side.z, d, w);
+            }
+        }
+        for (int32_t g = 0; ok && g < groupCount; g++)
+        {
+            const int32_t *members = &hash->groupMembers[hash->groupStart[g]];
+            int32_t size = hash->groupStart[g + 1] - hash->groupStart[g];
+            for (int32_t m = 1; m < size; m++)
+            {
+                if (lod_attribute_seam(&vtx[members[0] * 12], &vtx[members[m] * 12]))
+                {
+                    flags[g] |= LOD_VERTEX_LOCKED;
+                    break;
+                }
+            }
+        }
+
+        while (ok && indexCount > targetIndexCount)
+        {
+            // Current directed edges (borders can change as collapses run)
+            for (int32_t i = 0; i < tableSize; i++)
+                edgeKeys[i] = ~0ull;
+            for (int32_t t = 0; t < indexCount; t += 3)
+            {
+                for (int c = 0; c < 3; c++)
+                {
+                    uint64_t key = lod_edge_key(group[indices[t + c]], group[indices[t + (c + 1) % 3]]);
+                    edgeKeys[lod_edge_slot(edgeKeys, mask, key)] = key;
+                }
+            }
+
+            // Group -> triangle adjacency
+            __builtin_memset(triStart, 0, ((size_t)groupCount + 2) * sizeof(int32_t));
+            for (int32_t i = 0; i < indexCount; i++)
+                triStart[group[indices[i]] + 1]++;
+            for (int32_t g = 0; g < groupCount; g++)
+                triStart[g + 1] += triStart[g];
+            for (int32_t i = 0; i < indexCount; i++)
+                triList[triStart[group[indices[i]]]++] = i / 3;
+            for (int32_t g = groupCount; g > 0; g--)
+                triStart[g] = triStart[g - 1];
+            triStart[0] = 0;
+
+            // Candidates: every half-edge a -> b, plus b -> a on borders
+            int32_t candidateCount = 0;
+            for (int32_t t = 0; t < indexCount; t += 3)
+            {
+                for (int c = 0; c < 3; c++)
+                {
+                    uint32_t a = indices[t + c], b = indices[t + (c + 1) % 3];
+                    bool border = !lod_has_edge(edgeKeys, mask, group[b], group[a]);
+                    for (int dir = 0; dir < (border ? 2 : 1); dir++)
+                    {
+                        uint32_t u = dir ? b : a, v = dir ? a : b;
+                        uint8_t f = flags[group[u]];
+                        if ((f & LOD_VERTEX_LOCKED) || ((f & LOD_VERTEX_BORDER) && !border))
+                            continue;
+                        const Quadric *q = &quadrics[group[u]];
+                        double e = quadric_error(q, &vtx[v * 12]) +
+                                   q->w * attributeScale * lod_attribute_distance(&vtx[u * 12], &vtx[v * 12]);
+                        candidates[candidateCount * 2] = (int32_t)u;
+                        candidates[candidateCount * 2 + 1] = (int32_t)v;
+                        cost[candidateCount++] = (float)e;
+                    }
+                }
+            }
+            lod_sort_candidates(cost, order, sortTmp, candidateCount, histogram);
+
+            __builtin_memset(touched, 0, (size_t)groupCount);
+            for (int32_t v = 0; v < vertexCount; v++)
+                remap[v] = v;
+            int32_t removedIndices = 0, collapses = 0;
+            for (int32_t k = 0; k < candidateCount && indexCount - removedIndices > targetIndexCount; k++)
+            {
+                int32_t u = candidates[order[k] * 2], v = candidates[order[k] * 2 + 1];
+                int32_t gu = group[u], gv = group[v];
+                if (touched[gu] || touched[gv])
+                    continue;
+
+                // Reject collapses that flip or degenerate a surviving triangle
+                bool valid = true;
+                int32_t collapsed = 0;
+                const float *pv = &vtx[v * 12];
+                for (int32_t i = triStart[gu]; valid && i < triStart[gu + 1]; i++)
+                {
+                    const uint32_t *tri = &indices[triList[i] * 3];
+                    if (group[tri[0]] == gv || group[tri[1]] == gv || group[tri[2]] == gv)
+                    {
+                        collapsed++;
+                        continue;
+                    }
+                    const float *p[3], *q[3];
+                    for (int c = 0; c < 3; c++)
+                    {
+                        p[c] = &vtx[tri[c] * 12];
+                        q[c] = group[tri[c]] == gu ? pv : p[c];
+                    }
+                    Vec3 before = lod_triangle_normal(p[0], p[1], p[2]);
+                    Vec3 after = lod_triangle_normal(q[0], q[1], q[2]);
+                    valid = after.dot(before) > 0.0f && after.dot(after) > 1e-4f * before.dot(before);
+                }
+                if (!valid || collapsed == 0)
+                    continue;
+
+                // Each vertex of the group follows the closest match in gv
+                const int32_t *from = &hash->groupMembers[hash->groupStart[gu]];
+                const int32_t *to = &hash->groupMembers[hash->groupStart[gv]];
+                int32_t fromCount = hash->groupStart[gu + 1] - hash->groupStart[gu];
+                int32_t toCount = hash->groupStart[gv + 1] - hash->groupStart[gv];
+                for (int32_t m = 0; m < fromCount; m++)
+                {
+                    int32_t best = v;
+                    float bestDistance = 1e30f;
+                    for (int32_t n = 0; toCount > 1 && n < toCount; n++)
+                    {
+                        float d = lod_attribute_distance(&vtx[from[m] * 12], &vtx[to[n] * 12]);
+                        if (d < bestDistance)
+                        {
+                            bestDistance = d;
+                            best = to[n];
+                        }
+                    }
+                    remap[from[m]] = best;
+                }
+                quadric_add(&quadrics[gv], &quadrics[gu]);
+                for (int32_t i = triStart[gu]; i < triStart[gu + 1]; i++)
+                {
+                    const uint32_t *tri = &indices[triList[i] * 3];
+                    touched[group[tri[0]]] = touched[group[tri[1]]] = touched[group[tri[2]]] = 1;
+                }
+                removedIndices += collapsed * 3;
+                collapses++;
+                float distance = sqrtf(cost[order[k]] / (float)(quadrics[gu].w > 1e-30 ? quadrics[gu].w : 1e-30));
+                *error = distance > *error ? distance : *error;
+            }
+            if (collapses == 0)
+                break;
+
+            // Apply the pass and drop collapsed triangles
+            int32_t out = 0;
+            for (int32_t t = 0; t < indexCount; t += 3)
+            {
+                uint32_t a = (uint32_t)remap[indices[t]], b = (uint32_t)remap[indices[t + 1]],
+                         c = (uint32_t)remap[indices[t + 2]];
+                if (group[a] == group[b] || group[b] == group[c] || group[a] == group[c])
+                    continue;
+                indices[out++] = a;
+                indices[out++] = b;
+                indices[out++] = c;
+            }
+            indexCount = out;
+        }
+
+        free(quadrics);
+        free(flags);
+        free(touched);
+        free(remap);
+        free(triStart);
+        free(triList);
+        free(edgeKeys);
+        free(edgeCount);
+        free(candidates);
+        free(cost);
+        free(order);
+        free(sortTmp);
+        free(histogram);
+        return indexCount;
+    }
+
+    // Build a chain of up to `levels` simplified index lists, each keeping
+    // about `ratio` of the previous level's triangles. Stops early once a
+    // level no longer shrinks. Returns the level count including level 0,
+    // -1 on error.
+    EMSCRIPTEN_KEEPALIVE
+    int32_t geometry_buffer_build_lods(int32_t handle, int32_t levels, float ratio)
+    {
+        GeometryBuffer *buf = lookup_geometry_buffer(handle);
+        if (!buf || !buf->vertices || !buf->indices || buf->indexCount < 3)
+            return -1;
+        free_lod_chain(g_geometry_lods[handle - 1]);
+        g_geometry_lods[handle - 1] = nullptr;
+        levels = levels < 0 ? 0 : (levels > MAX_LOD_LEVELS - 1 ? MAX_LOD_LEVELS - 1 : levels);
+        ratio = ratio > 0.05f ? (ratio < 0.95f ? ratio : 0.95f) : 0.05f;
+
+        VertexSpatialHash *hash = get_vertex_spatial_hash(handle);
+        LodChain *lod = (LodChain *)calloc(1, sizeof(LodChain));
+        uint32_t *work = (uint32_t *)malloc((size_t)buf->indexCount * sizeof(uint32_t));
+        if (!hash || !lod || !work)
+        {
+            free(lod);
+            free(work);
+            return -1;
+        }
+
+        // Bounding sphere (box centre) of the referenced vertices
+        float lo[3] = {1e30f, 1e30f, 1e30f}, hi[3] = {-1e30f, -1e30f, -1e30f};
+        for (int32_t i = 0; i < buf->indexCount; i++)
+        {
+            if (buf->indices[i] >= (uint32_t)buf->vertexCount)
+                continue;
+            const float *p = &buf->vertices[buf->indices[i] * 12];
+            for (int k = 0; k < 3; k++)
+            {
+                lo[k] = p[k] < lo[k] ? p[k] : lo[k];
+                hi[k] = p[k] > hi[k] ? p[k] : hi[k];
+            }
+        }
+        for (int k = 0; k < 3; k++)
+            lod->center[k] = lo[k] <= hi[k] ? (lo[k] + hi[k]) * 0.5f : 0.0f;
+        float radius2 = 0.0f;
+        for (int32_t i = 0; i < buf->indexCount; i++)
+        {
+            if (buf->indices[i] >= (uint32_t)buf->vertexCount)
+                continue;
+            const float *p = &buf->vertices[buf->indices[i] * 12];
+            float dx = p[0] - lod->center[0], dy = p[1] - lod->center[1], dz = p[2] - lod->center[2];
+            float d2 = dx * dx + dy * dy + dz * dz;
+            radius2 = d2 > radius2 ? d2 : radius2;
+        }
+        lod->radius = sqrtf(radius2);
+        float attributeScale = LOD_ATTRIBUTE_WEIGHT * lod->radius;
+        attributeScale *= attributeScale;
+
+        lod->levelCount = 1;
+        lod->indices[0] = buf->indices;
+        lod->indexCount[0] = buf->indexCount;
+        __builtin_memcpy(work, buf->indices, (size_t)buf->indexCount * sizeof(uint32_t));
+        int32_t count = buf->indexCount;
+        for (int32_t l = 1; l <= levels; l++)
+        {
+            int32_t target = (int32_t)((float)(count / 3) * ratio) * 3;
+            if (target < 12)
+                break;
+            float error = 0.0f;
+            int32_t simplified = simplify_index_list(buf, hash, work, count, target, attributeScale, &error);
+            if (simplified > count - count / 10)
+                break; // Locked seams / borders: not worth another level
+            uint32_t *indices = (uint32_t *)malloc((size_t)simplified * sizeof(uint32_t));
+            if (!indices)
+                break;
+            __builtin_memcpy(indices, work, (size_t)simplified * sizeof(uint32_t));
+            lod->indices[l] = indices;
+            lod->indexCount[l] = simplified;
+            lod->error[l] = lod->error[l - 1] + error;
+            lod->levelCount = l + 1;
+            count = simplified;
+        }
+        free(work);
+
+        lod->vertices = buf->vertices;
+        lod->sourceIndices = buf->indices;
+        lod->vertexCount = buf->vertexCount;
+        lod->indexCount0 = buf->indexCount;
+        g_geometry_lods[handle - 1] = lod;
+        return lod->levelCount;
+    }
+
+    EMSCRIPTEN_KEEPALIVE
+    void geometry_buffer_clear_lods(int32_t handle)
+    {
+        if (!lookup_geometry_buffer(handle))
+            return;
+        free_lod_chain(g_geometry_lods[handle - 1]);
+        g_geometry_lods[handle - 1] = nullptr;
+    }
+
+    EMSCRIPTEN_KEEPALIVE
+    int32_t geometry_buffer_get_lod_count(int32_t handle)
+    {
+        if (!lookup_geometry_buffer(handle))
+            return 0;
+        LodChain *lod = g_geometry_lods[handle - 1];
+        return lod ? lod->levelCount : 1;
+    }
+
+    EMSCRIPTEN_KEEPALIVE
+    int32_t geometry_buffer_get_lod_index_count(int32_t handle, int32_t level)
+    {
+        GeometryBuffer *buf = lookup_geometry_buffer(handle);
+        LodChain *lod = buf ? g_geometry_lods[handle - 1] : nullptr;
+        if (!buf || level < 0)
+            return 0;
+        if (level == 0)
+            return buf->indexCount;
+        return lod && level < lod->levelCount ? lod->indexCount[level] : 0;
+    }
+
+    EMSCRIPTEN_KEEPALIVE
+    uint32_t *geometry_buffer_get_lod_indices_ptr(int32_t handle, int32_t level)
+    {
+        GeometryBuffer *buf = lookup_geometry_buffer(handle);
+        LodChain *lod = buf ? g_geometry_lods[handle - 1] : nullptr;
+        if (!buf || level < 0)
+            return nullptr;
+        if (level == 0)
+            return buf->indices;
+        return lod && level < lod->levelCount ? lod->indices[level] : nullptr;
+    }
+
+    // Object-space error of a level (0 for level 0)
+    EMSCRIPTEN_KEEPALIVE
+    float geometry_buffer_get_lod_error(int32_t handle, int32_t level)
+    {
+        LodChain *lod = lookup_geometry_buffer(handle) ? g_geometry_lods[handle - 1] : nullptr;
+        return lod && level > 0 && level < lod->levelCount ? lod->error[level] : 0.0f;
+    }
+
+    // Screen-space error (pixels) allowed when picking a level; 0 disables LOD
+    EMSCRIPTEN_KEEPALIVE
+    void set_lod_pixel_error(float pixels)
+    {
+        g_lod_pixel_error = pixels;
+    }
+
+    // Level used by the last render_geometry_buffer() call
+    EMSCRIPTEN_KEEPALIVE
+    int32_t get_last_lod_level()
+    {
+        return g_last_lod_level;
+    }
+
+
+    // ============================================================================
+    // Skinned Geometry Buffers
+    // ============================================================================
+    //
+    // A geometry buffer with skin data is posed by render_geometry_buffer using
+    // the current joint palette (see skin_geometry_vertices). The palette holds
+    // up to MAX_JOINTS row-major matrices in the buffer's object space (Z-up for
+    // glTF meshes: convert as for vertices), uploaded per draw before rendering.
+    // Picking raycasts, BVHs and cached normals keep using the bind pose.
+
+    // Allocate skin data for vertexCount vertices; JS writes 4 joint indices
+    // (u16) per vertex here and 4 weights per vertex via the weights pointer.
+    // Returns the joints array, or nullptr on failure.
+    EMSCRIPTEN_KEEPALIVE
+    uint16_t *geometry_buffer_alloc_skin(int32_t handle, int32_t vertexCount)
+    {
+        if (!lookup_geometry_buffer(handle) || vertexCount <= 0)
+            return nullptr;
+        SkinData *skin = ensure_skin_data(handle - 1, vertexCount);
+        return skin ? skin->joints : nullptr;
+    }
 
-                    switch (op)
-                    {
-                    case BAKE_OP_FLAT_COLOR:
-                    {
-                        // Same color for all 4 pixels
-                        int r = *pc++;
-                        int g = *pc++;
-                        int b = *pc++;
-                        int a = *pc++;
-                        stack_r[stackPtr] = wasm_i32x4_splat(r);
-                        stack_g[stackPtr] = wasm_i32x4_splat(g);
-                        stack_b[stackPtr] = wasm_i32x4_splat(b);
-                        stack_a[stackPtr] = wasm_i32x4_splat(a);
-                        stackPtr++;
-                        break;
-                    }
+    EMSCRIPTEN_KEEPALIVE
+    float *geometry_buffer_get_skin_weights_ptr(int32_t handle)
+    {
+        SkinData *skin = lookup_geometry_buffer(handle) ? g_geometry_skins[handle - 1] : nullptr;
+        return skin ? skin->weights : nullptr;
+    }
 
-                    case BAKE_OP_SAMPLE_TEXTURE:
-                    {
-                        if (srcTex && srcWidth > 0 && srcHeight > 0)
-                        {
-                            // Calculate texture coordinates for 4 pixels
-                            // Note: Invert V for texture sampling (1-v) to match image coordinate system
-                            // where row 0 is at top of image but V=1 is at top in OpenGL/UV space
-                            v128_t v_tx_f = wasm_f32x4_mul(v_u, v_srcWidth);
-                            v128_t v_ty_f = wasm_f32x4_mul(wasm_f32x4_sub(v_one, v_v), v_srcHeight);
+    // 1 if the buffer has skin data matching its vertices
+    EMSCRIPTEN_KEEPALIVE
+    int32_t geometry_buffer_has_skin(int32_t handle)
+    {
+        GeometryBuffer *buf = lookup_geometry_buffer(handle);
+        SkinData *skin = buf ? g_geometry_skins[handle - 1] : nullptr;
+        return skin && skin->vertexCount == buf->vertexCount ? 1 : 0;
+    }
 
-                            // Convert to int and wrap
-                            v128_t v_tx = wasm_i32x4_trunc_sat_f32x4(v_tx_f);
-                            v128_t v_ty = wasm_i32x4_trunc_sat_f32x4(v_ty_f);
+    EMSCRIPTEN_KEEPALIVE
+    void geometry_buffer_clear_skin(int32_t handle)
+    {
+        if (!lookup_geometry_buffer(handle))
+            return;
+        free_skin_data(g_geometry_skins[handle - 1]);
+        g_geometry_skins[handle - 1] = nullptr;
+    }
 
-                            // Modulo wrap (simplified - assumes positive)
-                            v128_t v_srcW_i = wasm_i32x4_splat(srcWidth);
-                            v128_t v_srcH_i = wasm_i32x4_splat(srcHeight);
+    // Joint palette (MAX_JOINTS * 16 floats)
+    EMSCRIPTEN_KEEPALIVE
+    float *get_joint_palette_ptr()
+    {
+        return g_joint_palette;
+    }
 
-                            // tx = tx % srcWidth (using mask for power-of-2 or fallback)
-                            // For simplicity, extract and sample individually
-                            alignas(16) int32_t tx[4], ty[4];
-                            wasm_v128_store(tx, v_tx);
-                            wasm_v128_store(ty, v_ty);
+    // Number of palette matrices used by following draws (0 = bind pose)
+    EMSCRIPTEN_KEEPALIVE
+    void set_joint_count(int32_t count)
+    {
+        g_joint_count = count < 0 ? 0 : (count > MAX_JOINTS ? MAX_JOINTS : count);
+    }
 
-                            alignas(16) int32_t r[4], g[4], b[4], a[4];
-                            for (int i = 0; i < 4; i++)
-                            {
-                                int txi = tx[i] % srcWidth;
-                                int tyi = ty[i] % srcHeight;
-                                if (txi < 0)
-                                    txi += srcWidth;
-                                if (tyi < 0)
-                                    tyi += srcHeight;
-                                int tidx = (tyi * srcWidth + txi) * 4;
-                                r[i] = srcTex[tidx];
-                                g[i] = srcTex[tidx + 1];
-                                b[i] = srcTex[tidx + 2];
-                                a[i] = srcTex[tidx + 3];
-                            }
+    EMSCRIPTEN_KEEPALIVE
+    int32_t get_max_joints()
+    {
+        return MAX_JOINTS;
+    }
 
-                            stack_r[stackPtr] = wasm_v128_load(r);
-                            stack_g[stackPtr] = wasm_v128_load(g);
-                            stack_b[stackPtr] = wasm_v128_load(b);
-                            stack_a[stackPtr] = wasm_v128_load(a);
-                        }
-                        else
-                        {
-                            // Checkerboard pattern
-                            v128_t v_cu = wasm_f32x4_mul(v_u, v_eight);
-                            v128_t v_cv = wasm_f32x4_mul(v_v, v_eight);
-                            v128_t v_cui = wasm_i32x4_trunc_sat_f32x4(v_cu);
-                            v128_t v_cvi = wasm_i32x4_trunc_sat_f32x4(v_cv);
-                            v128_t v_sum = wasm_i32x4_add(v_cui, v_cvi);
-                            v128_t v_checker = wasm_v128_and(v_sum, wasm_i32x4_splat(1));
 
-                            // checker ? 255 : 0 for R and B, 0 for G
-                            v128_t v_mask = wasm_i32x4_eq(v_checker, wasm_i32x4_splat(1));
-                            stack_r[stackPtr] = wasm_v128_and(v_mask, v_255);
-                            stack_g[stackPtr] = v_zero;
-                            stack_b[stackPtr] = wasm_v128_and(v_mask, v_255);
-                            stack_a[stackPtr] = v_255;
-                        }
-                        stackPtr++;
-                        break;
-                    }
+    // ============================================================================
+    // Morph Targets
+    // ============================================================================
+    //
+    // Blend shapes are uploaded once as sparse deltas (only the vertices a
+    // target moves) and evaluated by render_geometry_buffer before skinning
+    // (see morph_geometry_vertices). Animating weights costs one pass over the
+    // affected vertices, with no vertex re-upload from JS. Targets are tied to
+    // the buffer's vertex count at creation and ignored once it changes.
+
+    // Morph set for a buffer, created on first use for its current vertices
+    static MorphSet *get_morph_set(int32_t handle)
+    {
+        GeometryBuffer *buf = lookup_geometry_buffer(handle);
+        if (!buf)
+            return nullptr;
+        MorphSet *morph = g_geometry_morphs[handle - 1];
+        if (morph && morph->vertexCount != buf->vertexCount)
+        {
+            free_morph_set(morph);
+            morph = nullptr;
+        }
+        if (!morph)
+        {
+            morph = (MorphSet *)calloc(1, sizeof(MorphSet));
+            if (!morph)
+                return nullptr;
+            morph->vertexCount = buf->vertexCount;
+            morph->dirty = 1;
+            g_geometry_morphs[handle - 1] = morph;
+        }
+        return morph;
+    }
 
-                    case BAKE_OP_MIX_MULTIPLY:
-                    {
-                        pc++; // skip factor byte
-                        if (stackPtr >= 2)
-                        {
-                            stackPtr--;
-                            // c1 * c2 / 255 using SIMD
-                            v128_t r1 = stack_r[stackPtr - 1];
-                            v128_t g1 = stack_g[stackPtr - 1];
-                            v128_t b1 = stack_b[stackPtr - 1];
-                            v128_t a1 = stack_a[stackPtr - 1];
-                            v128_t r2 = stack_r[stackPtr];
-                            v128_t g2 = stack_g[stackPtr];
-                            v128_t b2 = stack_b[stackPtr];
-                            v128_t a2 = stack_a[stackPtr];
+    // Append a target with entryCount sparse entries; fill them through
+    // geometry_buffer_get_morph_indices_ptr / _deltas_ptr before drawing.
+    // Returns the target index (weight 0), -1 on failure.
+    EMSCRIPTEN_KEEPALIVE
+    int32_t geometry_buffer_add_morph_target(int32_t handle, int32_t entryCount)
+    {
+        MorphSet *morph = get_morph_set(handle);
+        if (!morph || morph->targetCount >= MAX_MORPH_TARGETS || entryCount < 0)
+            return -1;
+        int32_t start = morph->targetStart[morph->targetCount];
+        int32_t end = start + entryCount;
+        if (!grow_array(morph->indices, morph->indexCapacity, end > 0 ? end : 1) ||
+            !grow_array(morph->deltas, morph->deltaCapacity, (end > 0 ? end : 1) * 6))
+            return -1;
+        __builtin_memset(&morph->indices[start], 0, (size_t)entryCount * sizeof(uint32_t));
+        __builtin_memset(&morph->deltas[start * 6], 0, (size_t)entryCount * 6 * sizeof(float));
+        int32_t target = morph->targetCount++;
+        morph->targetStart[morph->targetCount] = end;
+        morph->weights[target] = 0.0f;
+        free(morph->affected);
+        morph->affected = nullptr;
+        morph->dirty = 1;
+        return target;
+    }
 
-                            // Multiply and divide by 255
-                            stack_r[stackPtr - 1] = wasm_i32x4_shr(wasm_i32x4_mul(r1, r2), 8);
-                            stack_g[stackPtr - 1] = wasm_i32x4_shr(wasm_i32x4_mul(g1, g2), 8);
-                            stack_b[stackPtr - 1] = wasm_i32x4_shr(wasm_i32x4_mul(b1, b2), 8);
-                            stack_a[stackPtr - 1] = wasm_i32x4_shr(wasm_i32x4_mul(a1, a2), 8);
-                        }
-                        break;
-                    }
+    // Dense input for geometry_buffer_add_morph_target_dense
+    // (6 floats per vertex: dx, dy, dz, dnx, dny, dnz)
+    static float *g_morph_dense_input = nullptr;
+    static int32_t g_morph_dense_capacity = 0;
 
-                    case BAKE_OP_MIX_ADD:
-                    {
-                        int factor = *pc++;
-                        if (stackPtr >= 2)
-                        {
-                            stackPtr--;
-                            v128_t v_factor = wasm_i32x4_splat(factor);
+    EMSCRIPTEN_KEEPALIVE
+    float *morph_get_dense_input_ptr(int32_t vertexCount)
+    {
+        if (vertexCount <= 0 || !grow_array(g_morph_dense_input, g_morph_dense_capacity, vertexCount * 6))
+            return nullptr;
+        return g_morph_dense_input;
+    }
 
-                            v128_t r1 = stack_r[stackPtr - 1];
-                            v128_t g1 = stack_g[stackPtr - 1];
-                            v128_t b1 = stack_b[stackPtr - 1];
-                            v128_t r2 = stack_r[stackPtr];
-                            v128_t g2 = stack_g[stackPtr];
-                            v128_t b2 = stack_b[stackPtr];
+    // Add a target from per-vertex deltas in the dense input, keeping only
+    // vertices whose position or normal delta exceeds epsilon (e.g. glTF
+    // targets or a sculpted copy of the mesh). Returns the target index.
+    EMSCRIPTEN_KEEPALIVE
+    int32_t geometry_buffer_add_morph_target_dense(int32_t handle, float epsilon)
+    {
+        GeometryBuffer *buf = lookup_geometry_buffer(handle);
+        if (!buf || !g_morph_dense_input || g_morph_dense_capacity < buf->vertexCount * 6)
+            return -1;
+        const float *d = g_morph_dense_input;
+        int32_t entryCount = 0;
+        for (int32_t v = 0; v < buf->vertexCount; v++, d += 6)
+            if (fabsf(d[0]) > epsilon || fabsf(d[1]) > epsilon || fabsf(d[2]) > epsilon ||
+                fabsf(d[3]) > epsilon || fabsf(d[4]) > epsilon || fabsf(d[5]) > epsilon)
+                entryCount++;
+
+        int32_t target = geometry_buffer_add_morph_target(handle, entryCount);
+        if (target < 0)
+            return -1;
+        MorphSet *morph = g_geometry_morphs[handle - 1];
+        int32_t e = morph->targetStart[target];
+        d = g_morph_dense_input;
+        for (int32_t v = 0; v < buf->vertexCount; v++, d += 6)
+        {
+            if (fabsf(d[0]) > epsilon || fabsf(d[1]) > epsilon || fabsf(d[2]) > epsilon ||
+                fabsf(d[3]) > epsilon || fabsf(d[4]) > epsilon || fabsf(d[5]) > epsilon)
+            {
+                morph->indices[e] = (uint32_t)v;
+                __builtin_memcpy(&morph->deltas[e * 6], d, 6 * sizeof(float));
+                e++;
+            }
+        }
+        return target;
+    }
 
-                            // c1 + (c2 * factor) / 255, clamped to 255
-                            v128_t add_r = wasm_i32x4_add(r1, wasm_i32x4_shr(wasm_i32x4_mul(r2, v_factor), 8));
-                            v128_t add_g = wasm_i32x4_add(g1, wasm_i32x4_shr(wasm_i32x4_mul(g2, v_factor), 8));
-                            v128_t add_b = wasm_i32x4_add(b1, wasm_i32x4_shr(wasm_i32x4_mul(b2, v_factor), 8));
+    EMSCRIPTEN_KEEPALIVE
+    uint32_t *geometry_buffer_get_morph_indices_ptr(int32_t handle, int32_t target)
+    {
+        MorphSet *morph = lookup_geometry_buffer(handle) ? g_geometry_morphs[handle - 1] : nullptr;
+        if (!morph || target < 0 || target >= morph->targetCount)
+            return nullptr;
+        // JS is about to (re)write entries
+        free(morph->affected);
+        morph->affected = nullptr;
+        morph->dirty = 1;
+        return &morph->indices[morph->targetStart[target]];
+    }
 
-                            stack_r[stackPtr - 1] = wasm_i32x4_min(add_r, v_255);
-                            stack_g[stackPtr - 1] = wasm_i32x4_min(add_g, v_255);
-                            stack_b[stackPtr - 1] = wasm_i32x4_min(add_b, v_255);
-                        }
-                        break;
-                    }
+    EMSCRIPTEN_KEEPALIVE
+    float *geometry_buffer_get_morph_deltas_ptr(int32_t handle, int32_t target)
+    {
+        MorphSet *morph = lookup_geometry_buffer(handle) ? g_geometry_morphs[handle - 1] : nullptr;
+        if (!morph || target < 0 || target >= morph->targetCount)
+            return nullptr;
+        morph->dirty = 1;
+        return &morph->deltas[morph->targetStart[target] * 6];
+    }
 
-                    case BAKE_OP_MIX_LERP:
-                    {
-                        int factor = *pc++;
-                        if (stackPtr >= 2)
-                        {
-                            stackPtr--;
-                            v128_t v_factor = wasm_i32x4_splat(factor);
-                            v128_t v_inv_factor = wasm_i32x4_splat(255 - factor);
+    EMSCRIPTEN_KEEPALIVE
+    int32_t geometry_buffer_get_morph_entry_count(int32_t handle, int32_t target)
+    {
+        MorphSet *morph = lookup_geometry_buffer(handle) ? g_geometry_morphs[handle - 1] : nullptr;
+        if (!morph || target < 0 || target >= morph->targetCount)
+            return 0;
+        return morph->targetStart[target + 1] - morph->targetStart[target];
+    }
 
-                            v128_t r1 = stack_r[stackPtr - 1];
-                            v128_t g1 = stack_g[stackPtr - 1];
-                            v128_t b1 = stack_b[stackPtr - 1];
-                            v128_t a1 = stack_a[stackPtr - 1];
-                            v128_t r2 = stack_r[stackPtr];
-                            v128_t g2 = stack_g[stackPtr];
-                            v128_t b2 = stack_b[stackPtr];
-                            v128_t a2 = stack_a[stackPtr];
+    EMSCRIPTEN_KEEPALIVE
+    int32_t geometry_buffer_get_morph_target_count(int32_t handle)
+    {
+        MorphSet *morph = lookup_geometry_buffer(handle) ? g_geometry_morphs[handle - 1] : nullptr;
+        return morph ? morph->targetCount : 0;
+    }
 
-                            // (c1 * invF + c2 * factor) / 255
-                            stack_r[stackPtr - 1] = wasm_i32x4_shr(
-                                wasm_i32x4_add(wasm_i32x4_mul(r1, v_inv_factor), wasm_i32x4_mul(r2, v_factor)), 8);
-                            stack_g[stackPtr - 1] = wasm_i32x4_shr(
-                                wasm_i32x4_add(wasm_i32x4_mul(g1, v_inv_factor), wasm_i32x4_mul(g2, v_factor)), 8);
-                            stack_b[stackPtr - 1] = wasm_i32x4_shr(
-                                wasm_i32x4_add(wasm_i32x4_mul(b1, v_inv_factor), wasm_i32x4_mul(b2, v_factor)), 8);
-                            stack_a[stackPtr - 1] = wasm_i32x4_shr(
-                                wasm_i32x4_add(wasm_i32x4_mul(a1, v_inv_factor), wasm_i32x4_mul(a2, v_factor)), 8);
-                        }
-                        break;
-                    }
+    // Weights only mark the set dirty when they actually change
+    EMSCRIPTEN_KEEPALIVE
+    void geometry_buffer_set_morph_weight(int32_t handle, int32_t target, float weight)
+    {
+        MorphSet *morph = lookup_geometry_buffer(handle) ? g_geometry_morphs[handle - 1] : nullptr;
+        if (!morph || target < 0 || target >= morph->targetCount || morph->weights[target] == weight)
+            return;
+        morph->weights[target] = weight;
+        morph->dirty = 1;
+    }
 
-                    case BAKE_OP_COLOR_RAMP:
-                    {
-                        // Read inline color ramp data from bytecode
-                        // Format: [stopCount, ...stops(pos, r, g, b, a)]
-                        int stopCount = *pc++;
-                        if (stopCount > 16)
-                            stopCount = 16;
+    EMSCRIPTEN_KEEPALIVE
+    float geometry_buffer_get_morph_weight(int32_t handle, int32_t target)
+    {
+        MorphSet *morph = lookup_geometry_buffer(handle) ? g_geometry_morphs[handle - 1] : nullptr;
+        return morph && target >= 0 && target < morph->targetCount ? morph->weights[target] : 0.0f;
+    }
 
-                        // Read stop data into local array
-                        uint8_t rampData[16 * 5];
-                        for (int s = 0; s < stopCount; s++)
-                        {
-                            rampData[s * 5] = *pc++;     // position
-                            rampData[s * 5 + 1] = *pc++; // r
-                            rampData[s * 5 + 2] = *pc++; // g
-                            rampData[s * 5 + 3] = *pc++; // b
-                            rampData[s * 5 + 4] = *pc++; // a
-                        }
+    EMSCRIPTEN_KEEPALIVE
+    void geometry_buffer_clear_morph_targets(int32_t handle)
+    {
+        if (!lookup_geometry_buffer(handle))
+            return;
+        free_morph_set(g_geometry_morphs[handle - 1]);
+        g_geometry_morphs[handle - 1] = nullptr;
+    }
 
-                        if (stackPtr >= 1 && stopCount > 0)
-                        {
-                            // Extract red channel as factor for each pixel
-                            alignas(16) int32_t fac[4];
-                            wasm_v128_store(fac, stack_r[stackPtr - 1]);
 
-                            alignas(16) int32_t r[4], g[4], b[4], a[4];
-                            for (int i = 0; i < 4; i++)
-                            {
-                                int pos = fac[i];
+    // ============================================================================
+    // Sprite Batches
+    // ============================================================================
+    //
+    // Axis-aligned textured or flat rectangles in the spirit of the PS1 SPRT
+    // command, for billboards, particles and overlay handles. JS fills the
+    // sprite input (SPRITE_FLOATS per sprite) and draws the batch in one call.
+    // Each sprite is clipped to the viewport once and filled span by span (see
+    // fill_rect_spans / fill_textured_rect_spans), instead of as two triangles.
+    //
+    // Sprite layout: x, y, z, width, height, u0, v0, u1, v1, r, g, b
+    //  - Screen sprites: (x, y) is the top-left pixel, z the NDC depth.
+    //  - SPRITE_WORLD: (x, y, z) is an object-space anchor projected through
+    //    g_mvp_matrix; the sprite is centered on it.
+    //  - SPRITE_WORLD_SIZE: width/height are object units scaled by distance
+    //    (otherwise pixels).
+    //  - (u0, v0) maps to the bottom-left corner and (u1, v1) to the top-right
+    //    (v up, as for triangles). Colors are 0-255 and modulate the bound
+    //    texture, or are the fill color when untextured.
+    //  - SPRITE_DEPTH_TEST / SPRITE_DEPTH_WRITE control the depth buffer; with
+    //    neither set a sprite is an overlay.
+    //  - SPRITE_ID_WRITE tags the ID buffer with the current object ID and the
+    //    sprite's index as the face ID; without it picking ignores the batch.
+
+    constexpr int SPRITE_FLOATS = 12;
+    constexpr int32_t SPRITE_WORLD = 4;
+    constexpr int32_t SPRITE_WORLD_SIZE = 8;
+    constexpr int32_t SPRITE_TEXTURED = 16;
+
+    static float *g_sprite_input = nullptr;
+    static int32_t g_sprite_capacity = 0;
+
+    // Input for render_sprites (count * SPRITE_FLOATS floats), nullptr on failure
+    EMSCRIPTEN_KEEPALIVE
+    float *sprite_get_input_ptr(int32_t count)
+    {
+        if (count <= 0 || !grow_array(g_sprite_input, g_sprite_capacity, count * SPRITE_FLOATS))
+            return nullptr;
+        return g_sprite_input;
+    }
+
+    // Draw count sprites from the input; returns how many touched the viewport
+    EMSCRIPTEN_KEEPALIVE
+    int32_t render_sprites(int32_t count, int32_t flags)
+    {
+        if (count <= 0 || count * SPRITE_FLOATS > g_sprite_capacity)
+            return 0;
 
-                                // Find surrounding stops
-                                int lowIdx = 0;
-                                int highIdx = stopCount - 1;
-                                for (int s = 0; s < stopCount - 1; s++)
-                                {
-                                    int stopPos = rampData[s * 5];
-                                    int nextPos = rampData[(s + 1) * 5];
-                                    if (pos >= stopPos && pos <= nextPos)
-                                    {
-                                        lowIdx = s;
-                                        highIdx = s + 1;
-                                        break;
-                                    }
-                                }
+        int32_t texW = 0, texH = 0;
+        const uint8_t *tex = (flags & SPRITE_TEXTURED) ? bound_texture(texW, texH) : nullptr;
+        if (texW <= 0 || texH <= 0)
+            tex = nullptr;
+        int32_t depthMode = flags & (SPRITE_DEPTH_TEST | SPRITE_DEPTH_WRITE | SPRITE_ID_WRITE);
 
-                                uint8_t *low = &rampData[lowIdx * 5];
-                                uint8_t *high = &rampData[highIdx * 5];
-                                int lowPos = low[0];
-                                int highPos = high[0];
+        // Pixels per object unit at w = 1 (as in select_geometry_lod)
+        const float *m = g_mvp_matrix;
+        float unitScale = sqrtf(m[4] * m[4] + m[5] * m[5] + m[6] * m[6]) * 0.5f * (float)g_render_height;
 
-                                if (pos <= lowPos)
-                                {
-                                    r[i] = low[1];
-                                    g[i] = low[2];
-                                    b[i] = low[3];
-                                    a[i] = low[4];
-                                }
-                                else if (pos >= highPos)
-                                {
-                                    r[i] = high[1];
-                                    g[i] = high[2];
-                                    b[i] = high[3];
-                                    a[i] = high[4];
-                                }
-                                else
-                                {
-                                    // Interpolate
-                                    int range = highPos - lowPos;
-                                    int t = ((pos - lowPos) * 255) / range;
-                                    int invT = 255 - t;
-                                    r[i] = (low[1] * invT + high[1] * t) >> 8;
-                                    g[i] = (low[2] * invT + high[2] * t) >> 8;
-                                    b[i] = (low[3] * invT + high[3] * t) >> 8;
-                                    a[i] = (low[4] * invT + high[4] * t) >> 8;
-                                }
-                            }
+        int32_t drawn = 0;
+        for (int32_t i = 0; i < count; i++)
+        {
+            const float *s = &g_sprite_input[i * SPRITE_FLOATS];
+            float left = s[0], top = s[1], depthNdc = s[2];
+            float width = s[3], height = s[4];
 
-                            stack_r[stackPtr - 1] = wasm_v128_load(r);
-                            stack_g[stackPtr - 1] = wasm_v128_load(g);
-                            stack_b[stackPtr - 1] = wasm_v128_load(b);
-                            stack_a[stackPtr - 1] = wasm_v128_load(a);
-                        }
-                        break;
-                    }
+            if (flags & SPRITE_WORLD)
+            {
+                Vec4 clip = mat4_mul_vec4(g_mvp_matrix, Vec4(s[0], s[1], s[2], 1.0f));
+                if (clip.w <= 0.001f)
+                    continue;
+                Vec3 ndc = clip.perspectiveDivide();
+                if (ndc.z < -1.0f || ndc.z > 1.0f)
+                    continue;
+                if (flags & SPRITE_WORLD_SIZE)
+                {
+                    width *= unitScale / clip.w;
+                    height *= unitScale / clip.w;
+                }
+                left = (ndc.x + 1.0f) * 0.5f * (float)g_render_width - width * 0.5f;
+                top = (1.0f - ndc.y) * 0.5f * (float)g_render_height - height * 0.5f;
+                depthNdc = ndc.z;
+            }
+            if (!(width > 0.0f) || !(height > 0.0f))
+                continue;
 
-                    case BAKE_OP_VORONOI:
-                    {
-                        // Voronoi texture - scale is next byte (1-255), mode is next byte (0=F1, 1=edge)
-                        float scale = (float)*pc++;
-                        if (scale < 1.0f)
-                            scale = 1.0f;
-                        uint8_t mode = *pc++; // 0 = distance to point (F1), 1 = distance to edge (F2-F1)
+            // Pixels whose centers fall inside, clipped to the viewport
+            float fx0 = floorf(left + 0.5f), fy0 = floorf(top + 0.5f);
+            float fx1 = floorf(left + width + 0.5f), fy1 = floorf(top + height + 0.5f);
+            int32_t x0 = fx0 > 0.0f ? (int32_t)fminf(fx0, (float)g_render_width) : 0;
+            int32_t y0 = fy0 > 0.0f ? (int32_t)fminf(fy0, (float)g_render_height) : 0;
+            int32_t x1 = fx1 > 0.0f ? (int32_t)fminf(fx1, (float)g_render_width) : 0;
+            int32_t y1 = fy1 > 0.0f ? (int32_t)fminf(fy1, (float)g_render_height) : 0;
+            if (x0 >= x1 || y0 >= y1)
+                continue;
 
-                        // Process 4 pixels - extract UV coordinates
-                        alignas(16) float u_arr[4], v_arr[4];
-                        wasm_v128_store(u_arr, v_u);
-                        // v_v is a splat, so all 4 values are the same
-                        float v_val = 1.0f - ((float)y + 0.5f) / (float)height;
+            float depthF = (fminf(fmaxf(depthNdc, -1.0f), 1.0f) + 1.0f) * 32767.5f;
+            uint16_t depth = (uint16_t)fminf(depthF, 65535.0f);
+            int32_t r = (int32_t)fminf(fmaxf(s[9], 0.0f), 255.0f);
+            int32_t g = (int32_t)fminf(fmaxf(s[10], 0.0f), 255.0f);
+            int32_t b = (int32_t)fminf(fmaxf(s[11], 0.0f), 255.0f);
+            g_id_current_face = (uint32_t)i;
 
-                        alignas(16) int32_t dist[4];
-                        for (int i = 0; i < 4; i++)
-                        {
-                            float pu = u_arr[i] * scale;
-                            float pv = v_val * scale;
+            if (tex)
+            {
+                // Texel position of the first pixel center and per-pixel steps
+                float du = (s[7] - s[5]) * (float)texW / width;
+                float dv = (s[8] - s[6]) * (float)texH / height; // v up, rows down
+                float u = s[5] * (float)texW + ((float)x0 + 0.5f - left) * du;
+                float v = (1.0f - s[8]) * (float)texH + ((float)y0 + 0.5f - top) * dv;
+                fill_textured_rect_spans(x0, y0, x1, y1, tex, texW, texH, u, v, du, dv, r, g, b, depth, depthMode);
+            }
+            else
+            {
+                uint32_t color = 0xFF000000 | ((uint32_t)b << 16) | ((uint32_t)g << 8) | (uint32_t)r;
+                fill_rect_spans(x0, y0, x1, y1, color, depth, depthMode);
+            }
+            drawn++;
+        }
+        return drawn;
+    }
 
-                            // Cell coordinates
-                            int cellX = (int)floorf(pu);
-                            int cellY = (int)floorf(pv);
 
-                            // Find F1 (nearest) and F2 (second nearest) distances
-                            float f1 = 1e10f;
-                            float f2 = 1e10f;
+    // ============================================================================
+    // Scene Lights and Static Lighting
+    // ============================================================================
+    //
+    // Scene lights plus per-buffer lighting bakes. JS fills the light array
+    // (LIGHT_FLOATS per light) and calls set_light_count to commit it. Each
+    // draw lights with the main light, all directional lights and only the
+    // point lights whose range reaches its bounding sphere (see
+    // gather_draw_lights), so its cost follows the lights that touch it.
+    //
+    // A buffer with static lighting enabled stores its lit colors (see
+    // current_lighting_bake) and draws through the unlit fast path; it is
+    // re-baked on the first draw after a light, its model matrix, the shading
+    // mode or its vertices change. Skinned and morphed draws always light
+    // dynamically.
 
-                            // Check 3x3 neighborhood of cells
-                            for (int dy = -1; dy <= 1; dy++)
-                            {
-                                for (int dx = -1; dx <= 1; dx++)
-                                {
-                                    int cx = cellX + dx;
-                                    int cy = cellY + dy;
+    EMSCRIPTEN_KEEPALIVE
+    float *get_lights_ptr()
+    {
+        return g_lights;
+    }
 
-                                    // Hash function for pseudo-random point in cell
-                                    // Simple but effective hash
-                                    uint32_t h = (uint32_t)(cx * 374761393 + cy * 668265263);
-                                    h = (h ^ (h >> 13)) * 1274126177;
+    EMSCRIPTEN_KEEPALIVE
+    int32_t get_max_lights()
+    {
+        return MAX_LIGHTS;
+    }
 
-                                    // Random point in cell (0-1 range)
-                                    float rx = (float)(h & 0xFFFF) / 65535.0f;
-                                    h = h * 1103515245 + 12345;
-                                    float ry = (float)(h & 0xFFFF) / 65535.0f;
+    // Lights (main light included) gathered by the last lit draw
+    EMSCRIPTEN_KEEPALIVE
+    int32_t get_last_light_count()
+    {
+        return g_last_draw_light_count;
+    }
 
-                                    // Point position in world space
-                                    float px = (float)cx + rx;
-                                    float py = (float)cy + ry;
+    // Commit the first count lights of the light array (directions are
+    // normalized in place)
+    EMSCRIPTEN_KEEPALIVE
+    void set_light_count(int32_t count)
+    {
+        g_light_count = count < 0 ? 0 : (count > MAX_LIGHTS ? MAX_LIGHTS : count);
+        for (int32_t i = 0; i < g_light_count; i++)
+        {
+            float *light = &g_lights[i * LIGHT_FLOATS];
+            if ((int32_t)light[3] == LIGHT_POINT)
+                continue;
+            float len = sqrtf(light[0] * light[0] + light[1] * light[1] + light[2] * light[2]);
+            if (len > 0.0001f)
+            {
+                light[0] /= len;
+                light[1] /= len;
+                light[2] /= len;
+            }
+        }
+        g_lighting_version++;
+    }
 
-                                    // Distance to this point
-                                    float ddx = pu - px;
-                                    float ddy = pv - py;
-                                    float d = sqrtf(ddx * ddx + ddy * ddy);
+    // Enable (1) or drop (0) a buffer's lighting bake. Returns 1 on success.
+    EMSCRIPTEN_KEEPALIVE
+    int32_t geometry_buffer_set_static_lighting(int32_t handle, int32_t enable)
+    {
+        if (!lookup_geometry_buffer(handle))
+            return 0;
+        int slot = handle - 1;
+        if (!enable)
+        {
+            free_lighting_bake(g_geometry_lighting[slot]);
+            g_geometry_lighting[slot] = nullptr;
+            return 1;
+        }
+        if (!g_geometry_lighting[slot])
+        {
+            LightingBake *bake = (LightingBake *)calloc(1, sizeof(LightingBake));
+            if (!bake)
+                return 0;
+            g_geometry_lighting[slot] = bake;
+        }
+        return 1;
+    }
 
-                                    // Track F1 and F2
-                                    if (d < f1)
-                                    {
-                                        f2 = f1;
-                                        f1 = d;
-                                    }
-                                    else if (d < f2)
-                                    {
-                                        f2 = d;
-                                    }
-                                }
-                            }
+    EMSCRIPTEN_KEEPALIVE
+    int32_t geometry_buffer_has_static_lighting(int32_t handle)
+    {
+        return lookup_geometry_buffer(handle) && g_geometry_lighting[handle - 1] ? 1 : 0;
+    }
 
-                            // Calculate output based on mode
-                            float outVal;
-                            if (mode == 1)
-                            {
-                                // Distance to edge: F2 - F1 (smaller = closer to edge)
-                                // Invert so edges are white
-                                outVal = 1.0f - (f2 - f1) * 2.0f;
-                                if (outVal < 0.0f)
-                                    outVal = 0.0f;
-                                if (outVal > 1.0f)
-                                    outVal = 1.0f;
-                            }
-                            else
-                            {
-                                // Distance to point (F1)
-                                outVal = f1 * 1.4f;
-                                if (outVal > 1.0f)
-                                    outVal = 1.0f;
-                            }
+    // Bake now for the current lights and model matrix (e.g. at load time, so
+    // the first frame does not pay for it). Returns 1 on success.
+    EMSCRIPTEN_KEEPALIVE
+    int32_t geometry_buffer_bake_lighting(int32_t handle)
+    {
+        GeometryBuffer *buf = lookup_geometry_buffer(handle);
+        if (!buf || !buf->vertices || !buf->indices || !g_geometry_lighting[handle - 1])
+            return 0;
+        gather_draw_lights(g_light_count > 0 ? geometry_bounding_sphere(handle - 1, buf) : nullptr);
+        return current_lighting_bake(handle, buf) ? 1 : 0;
+    }
 
-                            int val = (int)(outVal * 255.0f);
-                            if (val > 255)
-                                val = 255;
-                            if (val < 0)
-                                val = 0;
-                            dist[i] = val;
-                        }
+    // ============================================================================
+    // Ambient Occlusion Rays (shared by the texture and vertex bakes)
+    // ============================================================================
+    //
+    // AO rays start in the baked buffer's object space and are traced against
+    // its own BVH plus any occluders added with ao_add_occluder (other buffers
+    // placed with their model matrices, e.g. the rest of the scene). Each
+    // occluder gets a baked-object to occluder-object transform and a bounding
+    // sphere in baked-object space, so only occluders within the AO radius of
+    // a sample point are traced.
 
-                        // Push grayscale result (distance in all channels)
-                        stack_r[stackPtr] = wasm_v128_load(dist);
-                        stack_g[stackPtr] = wasm_v128_load(dist);
-                        stack_b[stackPtr] = wasm_v128_load(dist);
-                        stack_a[stackPtr] = v_255;
-                        stackPtr++;
-                        break;
-                    }
+    constexpr int MAX_AO_OCCLUDERS = 256;
 
-                    case BAKE_OP_ALPHA_CUTOFF:
-                    {
-                        // Alpha cutoff - threshold is next byte (0-255)
-                        uint8_t threshold = *pc++;
+    struct AoOccluder
+    {
+        int32_t geometry; // Geometry buffer handle
+        float model[16];  // Model matrix (row-major)
+    };
 
-                        if (stackPtr > 0)
-                        {
-                            // Pop color and apply alpha cutoff
-                            stackPtr--;
-                            alignas(16) int32_t a_arr[4];
-                            wasm_v128_store(a_arr, stack_a[stackPtr]);
+    // Occluder resolved for the current bake
+    struct AoTrace
+    {
+        const TriangleBVH *bvh;
+        float transform[16]; // Baked object space -> occluder object space
+        float sphere[4];     // Bounds in baked object space (conservative radius)
+    };
 
-                            // Binary cutoff: alpha >= threshold -> 255, else 0
-                            for (int i = 0; i < 4; i++)
-                            {
-                                a_arr[i] = (a_arr[i] >= threshold) ? 255 : 0;
-                            }
+    static AoOccluder g_ao_occluders[MAX_AO_OCCLUDERS];
+    static int32_t g_ao_occluder_count = 0;
+    static AoTrace g_ao_traces[MAX_AO_OCCLUDERS]; // Resolved occluders (the baked buffer excluded)
+    static int32_t g_ao_trace_count = 0;
+    static const TriangleBVH *g_ao_self_bvh = nullptr; // The baked buffer
 
-                            // Push back with modified alpha
-                            stack_r[stackPtr] = stack_r[stackPtr]; // unchanged
-                            stack_g[stackPtr] = stack_g[stackPtr]; // unchanged
-                            stack_b[stackPtr] = stack_b[stackPtr]; // unchanged
-                            stack_a[stackPtr] = wasm_v128_load(a_arr);
-                            stackPtr++;
-                        }
-                        break;
-                    }
+    // Integer hash (lowbias32) for per-sample decorrelation
+    static inline uint32_t ao_hash(uint32_t x)
+    {
+        x ^= x >> 16;
+        x *= 0x7feb352dU;
+        x ^= x >> 15;
+        x *= 0x846ca68bU;
+        x ^= x >> 16;
+        return x;
+    }
 
-                    case BAKE_OP_NOISE:
-                    {
-                        // Noise texture - scale (1-255), octaves (1-8), mode (0=value, 1=simplex)
-                        float scale = (float)*pc++;
-                        if (scale < 1.0f)
-                            scale = 1.0f;
-                        int octaves = *pc++;
-                        if (octaves < 1)
-                            octaves = 1;
-                        if (octaves > 8)
-                            octaves = 8;
-                        uint8_t mode = *pc++; // 0 = value noise, 1 = simplex
+    // Cosine-weighted direction k of count around unit normal n. The
+    // stratified sequence is rotated per seed so neighbouring samples
+    // (texels, vertices) trade banding for fine noise.
+    static inline Vec3 ao_sample_direction(const Vec3 &n, int32_t k, int32_t count, uint32_t seed)
+    {
+        uint32_t h = ao_hash(seed);
+        float r1 = ((float)k + (float)(h & 0xFFFF) * (1.0f / 65536.0f)) / (float)count;
+        float r2 = (float)k * 0.618034f + (float)(h >> 16) * (1.0f / 65536.0f);
+        r2 -= floorf(r2);
+        float r = sqrtf(r1);
+        float phi = 6.2831853f * r2;
+        float lx = r * cosf(phi), ly = r * sinf(phi);
+        float lz = sqrtf(fmaxf(1.0f - r1, 0.0f));
+
+        // Orthonormal basis around n (Duff et al. 2017)
+        float sign = n.z >= 0.0f ? 1.0f : -1.0f;
+        float a = -1.0f / (sign + n.z);
+        float b = n.x * n.y * a;
+        Vec3 t(1.0f + sign * n.x * n.x * a, sign * b, -sign * n.x);
+        Vec3 bt(b, sign + n.y * n.y * a, -n.y);
+        return Vec3(t.x * lx + bt.x * ly + n.x * lz, t.y * lx + bt.y * ly + n.y * lz,
+                    t.z * lx + bt.z * ly + n.z * lz);
+    }
 
-                        // Process 4 pixels
-                        alignas(16) float u_arr[4];
-                        wasm_v128_store(u_arr, v_u);
-                        float v_val = 1.0f - ((float)y + 0.5f) / (float)height;
+    // Resolve the BVHs traced when baking handle placed with model. Occluders
+    // that were deleted or have a singular matrix are skipped, as is an
+    // occluder entry for the baked buffer at the same placement. Returns
+    // false if the buffer's own BVH could not be built.
+    static bool prepare_ao_traces(int32_t handle, const float *model)
+    {
+        g_ao_trace_count = 0;
+        g_ao_self_bvh = get_geometry_bvh(handle);
+        if (!g_ao_self_bvh)
+            return false;
+        float invModel[16];
+        if (!g_ao_occluder_count || !mat4_invert(invModel, model))
+            return true;
+
+        for (int32_t i = 0; i < g_ao_occluder_count; i++)
+        {
+            const AoOccluder &o = g_ao_occluders[i];
+            if (o.geometry == handle && memcmp(o.model, model, sizeof(o.model)) == 0)
+                continue;
+            GeometryBuffer *buf = lookup_geometry_buffer(o.geometry);
+            const TriangleBVH *bvh = buf ? get_geometry_bvh(o.geometry) : nullptr;
+            float invOccluder[16];
+            if (!bvh || !mat4_invert(invOccluder, o.model))
+                continue;
+            AoTrace &trace = g_ao_traces[g_ao_trace_count++];
+            trace.bvh = bvh;
+            mat4_mul(trace.transform, invOccluder, model);
+
+            // Occluder bounds in baked object space; the Frobenius norm bounds
+            // the largest axis scale
+            float toBaked[16];
+            mat4_mul(toBaked, invModel, o.model);
+            const float *s = geometry_bounding_sphere(o.geometry - 1, buf);
+            Vec4 c = mat4_mul_vec4(toBaked, Vec4(s[0], s[1], s[2], 1.0f));
+            float scale = 0.0f;
+            for (int r = 0; r < 3; r++)
+                for (int k = 0; k < 3; k++)
+                    scale += toBaked[r * 4 + k] * toBaked[r * 4 + k];
+            trace.sphere[0] = c.x;
+            trace.sphere[1] = c.y;
+            trace.sphere[2] = c.z;
+            trace.sphere[3] = s[3] * sqrtf(scale);
+        }
+        return true;
+    }
 
-                        alignas(16) int32_t noise_out[4];
-                        for (int i = 0; i < 4; i++)
-                        {
-                            float px = u_arr[i] * scale;
-                            float py = v_val * scale;
+    // Unoccluded fraction of samples rays from pos (unit normal n) within
+    // radius, against the traces set up by prepare_ao_traces
+    static float trace_ambient_occlusion(const Vec3 &pos, const Vec3 &n, int32_t samples, float radius,
+                                         float bias, uint32_t seed)
+    {
+        float ray[RAY_FLOATS];
+        ray[0] = pos.x + n.x * bias;
+        ray[1] = pos.y + n.y * bias;
+        ray[2] = pos.z + n.z * bias;
+        ray[3] = bias;
+        ray[7] = radius;
+
+        // Occluders within reach of this point, with the ray origin in their space
+        int32_t nearby[MAX_AO_OCCLUDERS];
+        float origins[MAX_AO_OCCLUDERS][3];
+        int32_t nearCount = 0;
+        for (int32_t i = 0; i < g_ao_trace_count; i++)
+        {
+            const AoTrace &trace = g_ao_traces[i];
+            float dx = ray[0] - trace.sphere[0], dy = ray[1] - trace.sphere[1], dz = ray[2] - trace.sphere[2];
+            float reach = trace.sphere[3] + radius;
+            if (dx * dx + dy * dy + dz * dz > reach * reach)
+                continue;
+            Vec4 o = mat4_mul_vec4(trace.transform, Vec4(ray[0], ray[1], ray[2], 1.0f));
+            origins[nearCount][0] = o.x;
+            origins[nearCount][1] = o.y;
+            origins[nearCount][2] = o.z;
+            nearby[nearCount++] = i;
+        }
 
-                            float noiseVal = 0.0f;
-                            float amplitude = 1.0f;
-                            float frequency = 1.0f;
-                            float maxValue = 0.0f;
+        int32_t open = 0;
+        for (int32_t k = 0; k < samples; k++)
+        {
+            Vec3 d = ao_sample_direction(n, k, samples, seed);
+            ray[4] = d.x;
+            ray[5] = d.y;
+            ray[6] = d.z;
+            RayHit hit;
+            bvh_trace(g_ao_self_bvh, ray, hit, true);
+
+            // Affine transforms keep the ray parameter, so tmin/tmax carry over
+            for (int32_t j = 0; j < nearCount && hit.triangle < 0; j++)
+            {
+                const AoTrace &trace = g_ao_traces[nearby[j]];
+                Vec3 od = mat4_mul_dir(trace.transform, d);
+                float local[RAY_FLOATS] = {origins[j][0], origins[j][1], origins[j][2], ray[3],
+                                           od.x, od.y, od.z, ray[7]};
+                bvh_trace(trace.bvh, local, hit, true);
+            }
+            if (hit.triangle < 0)
+                open++;
+        }
+        return (float)open / (float)samples;
+    }
 
-                            // Fractal noise with octaves
-                            for (int o = 0; o < octaves; o++)
-                            {
-                                float nx = px * frequency;
-                                float ny = py * frequency;
+    EMSCRIPTEN_KEEPALIVE
+    void ao_clear_occluders()
+    {
+        g_ao_occluder_count = 0;
+    }
 
-                                if (mode == 1)
-                                {
-                                    // Simplex-like noise using gradient method
-                                    int ix = (int)floorf(nx);
-                                    int iy = (int)floorf(ny);
-                                    float fx = nx - (float)ix;
-                                    float fy = ny - (float)iy;
+    // Add a geometry buffer placed with the current model matrix as an AO
+    // occluder for later bakes. Returns its index, -1 if the list is full.
+    EMSCRIPTEN_KEEPALIVE
+    int32_t ao_add_occluder(int32_t geometry)
+    {
+        if (g_ao_occluder_count >= MAX_AO_OCCLUDERS || !lookup_geometry_buffer(geometry))
+            return -1;
+        AoOccluder &o = g_ao_occluders[g_ao_occluder_count];
+        o.geometry = geometry;
+        memcpy(o.model, g_model_matrix, sizeof(o.model));
+        return g_ao_occluder_count++;
+    }
 
-                                    // Smooth interpolation
-                                    float u_interp = fx * fx * (3.0f - 2.0f * fx);
-                                    float v_interp = fy * fy * (3.0f - 2.0f * fy);
+    // ============================================================================
+    // Texture-Space Lighting Bake (lightmaps and ambient occlusion)
+    // ============================================================================
+    //
+    // Rasterizes a geometry buffer in UV space into a texture buffer and
+    // evaluates lighting and/or ray-traced ambient occlusion at every covered
+    // texel, optionally multiplied over a source texture, so the result can be
+    // drawn with lighting off. UVs should be a non-overlapping layout inside
+    // [0, 1]; where triangles overlap in UV space the last one wins.
+    //
+    // The module is single-threaded, so a bake is a resumable session rather
+    // than one long call: lightmap_bake_begin() builds the texel-to-triangle
+    // map and captures the lights, lightmap_bake_step() shades the next band of
+    // rows (the worker can report progress and stay responsive between calls)
+    // and lightmap_bake_finish() dilates the result over UV seams.
+    //
+    // Lighting uses the lights, ambient level, model matrix and shading mode
+    // current at begin time. AO rays are cosine-distributed over the shading
+    // normal and traced against the buffer's BVH (base LOD, bind pose) and any
+    // AO occluders; aoRadius is in object units.
+
+    enum LightmapFlags : int32_t
+    {
+        LIGHTMAP_LIGHTING = 1, // Multiply by the evaluated light
+        LIGHTMAP_AO = 2,       // Multiply by ambient occlusion
+    };
 
-                                    // Gradient hash at corners
-                                    auto grad = [](int hash, float x, float y) -> float
-                                    {
-                                        int h = hash & 7;
-                                        float u_g = h < 4 ? x : y;
-                                        float v_g = h < 4 ? y : x;
-                                        return ((h & 1) ? -u_g : u_g) + ((h & 2) ? -2.0f * v_g : 2.0f * v_g);
-                                    };
+    constexpr int MAX_LIGHTMAP_SIZE = 4096; // Texels per side
+    constexpr int MAX_AO_SAMPLES = 256;
+    constexpr int MAX_LIGHTMAP_DILATION = 64;
 
-                                    auto hash2 = [](int x, int y) -> int
-                                    {
-                                        uint32_t h = (uint32_t)(x * 374761393 + y * 668265263);
-                                        h = (h ^ (h >> 13)) * 1274126177;
-                                        return (int)(h & 0xFF);
-                                    };
+    struct LightmapSession
+    {
+        int32_t geometry; // Geometry buffer handle
+        int32_t target;   // Texture buffer handle receiving the bake
+        int32_t source;   // Texture buffer handle multiplied in (0 = white)
+        int32_t width, height;
+        int32_t flags;
+        int32_t aoSamples;
+        float aoRadius;
+        float aoBias;         // Ray origin offset and tmin (object units)
+        int32_t nextRow = -1; // -1 when no session is active
+        int32_t smooth;
+        float ambient;
+        float model[16];
+        float normalMatrix[9];
+        // Geometry state at begin time (a mismatch ends the session)
+        uint32_t version; // g_geometry_vertex_versions entry
+        int32_t vertexCount, indexCount;
+    };
 
-                                    float n00 = grad(hash2(ix, iy), fx, fy);
-                                    float n10 = grad(hash2(ix + 1, iy), fx - 1.0f, fy);
-                                    float n01 = grad(hash2(ix, iy + 1), fx, fy - 1.0f);
-                                    float n11 = grad(hash2(ix + 1, iy + 1), fx - 1.0f, fy - 1.0f);
+    static LightmapSession g_lightmap = {};
+    static DrawLights g_lightmap_lights;               // Lights captured at begin
+    static int32_t *g_lightmap_triangles = nullptr;   // Triangle covering each texel (-1 = none)
+    static int32_t g_lightmap_triangles_capacity = 0;
+    static uint8_t *g_lightmap_coverage = nullptr; // Dilation generation per texel (0 = empty)
+    static int32_t g_lightmap_coverage_capacity = 0;
 
-                                    float nx0 = n00 + u_interp * (n10 - n00);
-                                    float nx1 = n01 + u_interp * (n11 - n01);
-                                    float octaveNoise = nx0 + v_interp * (nx1 - nx0);
+    // Texel-space corners of triangle t: x = u * width, y = (1 - v) * height
+    static inline void lightmap_triangle_uv(const float *vertices, const uint32_t *indices, int32_t t,
+                                            float *x, float *y)
+    {
+        for (int c = 0; c < 3; c++)
+        {
+            const float *v = &vertices[indices[t * 3 + c] * 12];
+            x[c] = v[6] * (float)g_lightmap.width;
+            y[c] = (1.0f - v[7]) * (float)g_lightmap.height;
+        }
+    }
 
-                                    noiseVal += (octaveNoise * 0.5f + 0.5f) * amplitude;
-                                }
-                                else
-                                {
-                                    // Value noise
-                                    int ix = (int)floorf(nx);
-                                    int iy = (int)floorf(ny);
-                                    float fx = nx - (float)ix;
-                                    float fy = ny - (float)iy;
+    // Barycentrics of the texel center (px, py); false if outside or degenerate
+    static inline bool lightmap_barycentrics(const float *x, const float *y, int32_t px, int32_t py, float *w)
+    {
+        float area = (x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0]);
+        if (fabsf(area) < 1e-12f)
+            return false;
+        float cx = (float)px + 0.5f, cy = (float)py + 0.5f;
+        float inv = 1.0f / area;
+        w[1] = ((cx - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (cy - y[0])) * inv;
+        w[2] = ((x[1] - x[0]) * (cy - y[0]) - (cx - x[0]) * (y[1] - y[0])) * inv;
+        w[0] = 1.0f - w[1] - w[2];
+        const float eps = -1e-5f;
+        return w[0] >= eps && w[1] >= eps && w[2] >= eps;
+    }
 
-                                    // Smooth interpolation
-                                    float u_interp = fx * fx * (3.0f - 2.0f * fx);
-                                    float v_interp = fy * fy * (3.0f - 2.0f * fy);
+    // The session's buffers if they are unchanged since begin, else nullptr
+    static GeometryBuffer *lightmap_session_geometry(TextureBuffer *&target)
+    {
+        GeometryBuffer *buf = lookup_geometry_buffer(g_lightmap.geometry);
+        int32_t slot = g_lightmap.target - 1;
+        target = slot >= 0 && slot < MAX_TEXTURE_BUFFERS ? g_texture_buffers[slot] : nullptr;
+        if (!buf || g_geometry_vertex_versions[g_lightmap.geometry - 1] != g_lightmap.version ||
+            buf->vertexCount != g_lightmap.vertexCount || buf->indexCount != g_lightmap.indexCount)
+            return nullptr;
+        if (!target || !target->data || target->width != g_lightmap.width || target->height != g_lightmap.height)
+            return nullptr;
+        return buf;
+    }
 
-                                    // Hash at corners
-                                    auto hash2 = [](int x, int y) -> float
-                                    {
-                                        uint32_t h = (uint32_t)(x * 374761393 + y * 668265263);
-                                        h = (h ^ (h >> 13)) * 1274126177;
-                                        return (float)(h & 0xFFFF) / 65535.0f;
-                                    };
+    // Start baking a geometry buffer into a texture buffer (allocated to
+    // width x height and cleared to transparent black). flags combines
+    // LIGHTMAP_LIGHTING and LIGHTMAP_AO; aoRadius <= 0 uses the buffer's
+    // bounding radius. Returns the number of rows to step through, 0 on failure.
+    EMSCRIPTEN_KEEPALIVE
+    int32_t lightmap_bake_begin(int32_t geometry, int32_t target, int32_t width, int32_t height,
+                                int32_t source, int32_t flags, int32_t aoSamples, float aoRadius)
+    {
+        g_lightmap.nextRow = -1;
+        GeometryBuffer *buf = lookup_geometry_buffer(geometry);
+        if (!buf || !buf->vertices || !buf->indices || buf->indexCount < 3)
+            return 0;
+        if (width < 1 || height < 1 || width > MAX_LIGHTMAP_SIZE || height > MAX_LIGHTMAP_SIZE)
+            return 0;
+        if (source == target)
+            return 0;
+        if (source != 0 && (source < 1 || source > MAX_TEXTURE_BUFFERS || !g_texture_buffers[source - 1] ||
+                            !g_texture_buffers[source - 1]->data))
+            return 0;
 
-                                    float n00 = hash2(ix, iy);
-                                    float n10 = hash2(ix + 1, iy);
-                                    float n01 = hash2(ix, iy + 1);
-                                    float n11 = hash2(ix + 1, iy + 1);
+        const float *sphere = geometry_bounding_sphere(geometry - 1, buf);
+        if (flags & LIGHTMAP_AO)
+        {
+            if (!prepare_ao_traces(geometry, g_model_matrix))
+                return 0;
+            aoSamples = aoSamples < 1 ? 1 : (aoSamples > MAX_AO_SAMPLES ? MAX_AO_SAMPLES : aoSamples);
+            if (!(aoRadius > 0.0f))
+                aoRadius = sphere[3] > 0.0f ? sphere[3] : 1.0f;
+        }
 
-                                    float nx0 = n00 + u_interp * (n10 - n00);
-                                    float nx1 = n01 + u_interp * (n11 - n01);
-                                    float octaveNoise = nx0 + v_interp * (nx1 - nx0);
+        uint8_t *data = texture_buffer_alloc(target, width, height);
+        int32_t texels = width * height;
+        if (!data || !grow_array(g_lightmap_triangles, g_lightmap_triangles_capacity, texels))
+            return 0;
+        memset(data, 0, (size_t)texels * 4);
+        for (int32_t i = 0; i < texels; i++)
+            g_lightmap_triangles[i] = -1;
+
+        g_lightmap.geometry = geometry;
+        g_lightmap.target = target;
+        g_lightmap.source = source;
+        g_lightmap.width = width;
+        g_lightmap.height = height;
+        g_lightmap.flags = flags;
+        g_lightmap.aoSamples = aoSamples;
+        g_lightmap.aoRadius = aoRadius;
+        g_lightmap.aoBias = fmaxf(sphere[3], 1e-3f) * 1e-4f;
+        g_lightmap.smooth = g_enable_smooth_shading ? 1 : 0;
+        g_lightmap.ambient = g_ambient_light;
+        memcpy(g_lightmap.model, g_model_matrix, sizeof(g_lightmap.model));
+        model_normal_matrix(g_model_matrix, g_lightmap.normalMatrix);
+        g_lightmap.version = g_geometry_vertex_versions[geometry - 1];
+        g_lightmap.vertexCount = buf->vertexCount;
+        g_lightmap.indexCount = buf->indexCount;
+
+        if (flags & LIGHTMAP_LIGHTING)
+        {
+            gather_draw_lights(g_light_count > 0 ? sphere : nullptr);
+            memcpy(&g_lightmap_lights, &g_draw_lights, sizeof(DrawLights));
+        }
 
-                                    noiseVal += octaveNoise * amplitude;
-                                }
+        // Texel-to-triangle map: texel centers inside each UV triangle
+        int32_t triCount = buf->indexCount / 3;
+        for (int32_t t = 0; t < triCount; t++)
+        {
+            if (buf->indices[t * 3] >= (uint32_t)buf->vertexCount ||
+                buf->indices[t * 3 + 1] >= (uint32_t)buf->vertexCount ||
+                buf->indices[t * 3 + 2] >= (uint32_t)buf->vertexCount)
+                continue;
+            float x[3], y[3];
+            lightmap_triangle_uv(buf->vertices, buf->indices, t, x, y);
+            float minX = fminf(x[0], fminf(x[1], x[2])), maxX = fmaxf(x[0], fmaxf(x[1], x[2]));
+            float minY = fminf(y[0], fminf(y[1], y[2])), maxY = fmaxf(y[0], fmaxf(y[1], y[2]));
+            int32_t x0 = (int32_t)fmaxf(ceilf(minX - 0.5f), 0.0f);
+            int32_t y0 = (int32_t)fmaxf(ceilf(minY - 0.5f), 0.0f);
+            int32_t x1 = (int32_t)fminf(floorf(maxX - 0.5f), (float)(width - 1));
+            int32_t y1 = (int32_t)fminf(floorf(maxY - 0.5f), (float)(height - 1));
+            for (int32_t py = y0; py <= y1; py++)
+            {
+                for (int32_t px = x0; px <= x1; px++)
+                {
+                    float w[3];
+                    if (lightmap_barycentrics(x, y, px, py, w))
+                        g_lightmap_triangles[py * width + px] = t;
+                }
+            }
+        }
 
-                                maxValue += amplitude;
-                                amplitude *= 0.5f;
-                                frequency *= 2.0f;
-                            }
+        g_lightmap.nextRow = 0;
+        return height;
+    }
 
-                            // Normalize
-                            noiseVal /= maxValue;
+    // Shade the next rowCount rows. Returns the rows still left (0 = ready
+    // to finish), or -1 if there is no session or its buffers changed.
+    EMSCRIPTEN_KEEPALIVE
+    int32_t lightmap_bake_step(int32_t rowCount)
+    {
+        if (g_lightmap.nextRow < 0)
+            return -1;
+        TextureBuffer *target = nullptr;
+        GeometryBuffer *buf = lightmap_session_geometry(target);
+        if (!buf || ((g_lightmap.flags & LIGHTMAP_AO) && !prepare_ao_traces(g_lightmap.geometry, g_lightmap.model)))
+        {
+            g_lightmap.nextRow = -1;
+            return -1;
+        }
 
-                            int val = (int)(noiseVal * 255.0f);
-                            if (val > 255)
-                                val = 255;
-                            if (val < 0)
-                                val = 0;
-                            noise_out[i] = val;
-                        }
+        const uint8_t *src = nullptr;
+        int32_t srcW = 0, srcH = 0, srcMaskX = 0, srcMaskY = 0;
+        if (g_lightmap.source)
+        {
+            const TextureBuffer *s = g_texture_buffers[g_lightmap.source - 1];
+            if (s && s->data && s->width > 0 && s->height > 0)
+            {
+                src = s->data;
+                srcW = s->width;
+                srcH = s->height;
+                srcMaskX = (srcW & (srcW - 1)) == 0 ? srcW - 1 : 0;
+                srcMaskY = (srcH & (srcH - 1)) == 0 ? srcH - 1 : 0;
+            }
+        }
 
-                        // Push grayscale result
-                        stack_r[stackPtr] = wasm_v128_load(noise_out);
-                        stack_g[stackPtr] = wasm_v128_load(noise_out);
-                        stack_b[stackPtr] = wasm_v128_load(noise_out);
-                        stack_a[stackPtr] = v_255;
-                        stackPtr++;
-                        break;
-                    }
+        // Evaluate with the lights and ambient level captured at begin
+        float savedAmbient = g_ambient_light;
+        if (g_lightmap.flags & LIGHTMAP_LIGHTING)
+        {
+            memcpy(&g_draw_lights, &g_lightmap_lights, sizeof(DrawLights));
+            g_ambient_light = g_lightmap.ambient;
+        }
 
-                    case BAKE_OP_END:
-                    default:
-                        done = true;
-                        break;
-                    }
+        const float *nm = g_lightmap.normalMatrix;
+        int32_t width = g_lightmap.width;
+        int32_t end = g_lightmap.nextRow + (rowCount > 0 ? rowCount : 1);
+        if (end > g_lightmap.height)
+            end = g_lightmap.height;
+
+        for (int32_t py = g_lightmap.nextRow; py < end; py++)
+        {
+            for (int32_t px = 0; px < width; px++)
+            {
+                int32_t texel = py * width + px;
+                int32_t t = g_lightmap_triangles[texel];
+                if (t < 0)
+                    continue;
+                float x[3], y[3], w[3];
+                lightmap_triangle_uv(buf->vertices, buf->indices, t, x, y);
+                if (!lightmap_barycentrics(x, y, px, py, w))
+                {
+                    g_lightmap_triangles[texel] = -1; // Left for dilation to fill
+                    continue;
+                }
+                const float *v0 = &buf->vertices[buf->indices[t * 3] * 12];
+                const float *v1 = &buf->vertices[buf->indices[t * 3 + 1] * 12];
+                const float *v2 = &buf->vertices[buf->indices[t * 3 + 2] * 12];
+
+                Vec3 pos(w[0] * v0[0] + w[1] * v1[0] + w[2] * v2[0],
+                         w[0] * v0[1] + w[1] * v1[1] + w[2] * v2[1],
+                         w[0] * v0[2] + w[1] * v1[2] + w[2] * v2[2]);
+                Vec3 face = Vec3(v1[0] - v0[0], v1[1] - v0[1], v1[2] - v0[2])
+                                .cross(Vec3(v2[0] - v0[0], v2[1] - v0[1], v2[2] - v0[2]))
+                                .normalize();
+                Vec3 normal = face;
+                if (g_lightmap.smooth)
+                {
+                    Vec3 smooth(w[0] * v0[3] + w[1] * v1[3] + w[2] * v2[3],
+                                w[0] * v0[4] + w[1] * v1[4] + w[2] * v2[4],
+                                w[0] * v0[5] + w[1] * v1[5] + w[2] * v2[5]);
+                    if (smooth.dot(smooth) > 1e-12f)
+                        normal = smooth.normalize();
                 }
 
-                // Write output for 4 pixels
-                alignas(16) int32_t out_r[4], out_g[4], out_b[4], out_a[4];
-                if (stackPtr > 0)
+                float light[3] = {1.0f, 1.0f, 1.0f};
+                if (g_lightmap.flags & LIGHTMAP_LIGHTING)
                 {
-                    wasm_v128_store(out_r, stack_r[0]);
-                    wasm_v128_store(out_g, stack_g[0]);
-                    wasm_v128_store(out_b, stack_b[0]);
-                    wasm_v128_store(out_a, stack_a[0]);
+                    Vec4 world = mat4_mul_vec4(g_lightmap.model, Vec4(pos.x, pos.y, pos.z, 1.0f));
+                    Vec3 worldNormal = Vec3(nm[0] * normal.x + nm[1] * normal.y + nm[2] * normal.z,
+                                            nm[3] * normal.x + nm[4] * normal.y + nm[5] * normal.z,
+                                            nm[6] * normal.x + nm[7] * normal.y + nm[8] * normal.z)
+                                           .normalize();
+                    evaluate_draw_lights(Vec3(world.x, world.y, world.z), worldNormal, light, nullptr);
                 }
-                else
+                if ((g_lightmap.flags & LIGHTMAP_AO) && normal.dot(normal) > 0.5f)
                 {
-                    // Error - magenta
-                    for (int i = 0; i < 4; i++)
-                    {
-                        out_r[i] = 255;
-                        out_g[i] = 0;
-                        out_b[i] = 255;
-                        out_a[i] = 255;
-                    }
+                    float ao = trace_ambient_occlusion(pos, normal, g_lightmap.aoSamples, g_lightmap.aoRadius,
+                                                       g_lightmap.aoBias, (uint32_t)texel);
+                    light[0] *= ao;
+                    light[1] *= ao;
+                    light[2] *= ao;
                 }
 
-                // Write to output buffer
-                for (int i = 0; i < pixelCount; i++)
+                float r = 255.0f, g = 255.0f, b = 255.0f, a = 255.0f;
+                if (src)
                 {
-                    int outIdx = (y * width + x + i) * 4;
-                    g_bake_output[outIdx] = (uint8_t)out_r[i];
-                    g_bake_output[outIdx + 1] = (uint8_t)out_g[i];
-                    g_bake_output[outIdx + 2] = (uint8_t)out_b[i];
-                    g_bake_output[outIdx + 3] = (uint8_t)out_a[i];
+                    float u = w[0] * v0[6] + w[1] * v1[6] + w[2] * v2[6];
+                    float vv = w[0] * v0[7] + w[1] * v1[7] + w[2] * v2[7];
+                    int32_t sx = wrap_texel((int32_t)floorf(u * (float)srcW), srcW, srcMaskX);
+                    int32_t sy = wrap_texel((int32_t)floorf((1.0f - vv) * (float)srcH), srcH, srcMaskY);
+                    const uint8_t *s = &src[(sy * srcW + sx) * 4];
+                    r = s[0];
+                    g = s[1];
+                    b = s[2];
+                    a = s[3];
+                }
+                uint8_t *out = &target->data[texel * 4];
+                out[0] = (uint8_t)fminf(r * light[0] + 0.5f, 255.0f);
+                out[1] = (uint8_t)fminf(g * light[1] + 0.5f, 255.0f);
+                out[2] = (uint8_t)fminf(b * light[2] + 0.5f, 255.0f);
+                out[3] = (uint8_t)a;
+            }
+        }
+
+        g_ambient_light = savedAmbient;
+        g_lightmap.nextRow = end;
+        return g_lightmap.height - end;
+    }
+
+    // Grow the baked texels outwards by `dilation` rings (averaging covered
+    // neighbours) so filtering and snapping across UV seams never reach
+    // unbaked texels, then end the session. Returns the number of covered
+    // texels (dilation included), -1 if there is no session.
+    EMSCRIPTEN_KEEPALIVE
+    int32_t lightmap_bake_finish(int32_t dilation)
+    {
+        if (g_lightmap.nextRow < 0)
+            return -1;
+        TextureBuffer *target = nullptr;
+        GeometryBuffer *buf = lightmap_session_geometry(target);
+        int32_t width = g_lightmap.width, height = g_lightmap.height;
+        g_lightmap.nextRow = -1;
+        if (!buf || !grow_array(g_lightmap_coverage, g_lightmap_coverage_capacity, width * height))
+            return -1;
+
+        int32_t covered = 0;
+        for (int32_t i = 0; i < width * height; i++)
+        {
+            g_lightmap_coverage[i] = g_lightmap_triangles[i] >= 0 ? 1 : 0;
+            covered += g_lightmap_coverage[i];
+        }
+
+        // Texels filled in pass p are tagged p + 1, so each pass only reads
+        // the rings that existed before it
+        dilation = dilation < 0 ? 0 : (dilation > MAX_LIGHTMAP_DILATION ? MAX_LIGHTMAP_DILATION : dilation);
+        uint8_t *data = target->data;
+        for (int32_t pass = 1; pass <= dilation; pass++)
+        {
+            int32_t filled = 0;
+            for (int32_t py = 0; py < height; py++)
+            {
+                for (int32_t px = 0; px < width; px++)
+                {
+                    if (g_lightmap_coverage[py * width + px])
+                        continue;
+                    int32_t sum[4] = {0, 0, 0, 0};
+                    int32_t count = 0;
+                    for (int32_t ny = py - 1; ny <= py + 1; ny++)
+                    {
+                        if (ny < 0 || ny >= height)
+                            continue;
+                        for (int32_t nx = px - 1; nx <= px + 1; nx++)
+                        {
+                            if (nx < 0 || nx >= width)
+                                continue;
+                            uint8_t gen = g_lightmap_coverage[ny * width + nx];
+                            if (gen == 0 || gen > pass)
+                                continue;
+                            const uint8_t *n = &data[(ny * width + nx) * 4];
+                            sum[0] += n[0];
+                            sum[1] += n[1];
+                            sum[2] += n[2];
+                            sum[3] += n[3];
+                            count++;
+                        }
+                    }
+                    if (!count)
+                        continue;
+                    uint8_t *out = &data[(py * width + px) * 4];
+                    for (int c = 0; c < 4; c++)
+                        out[c] = (uint8_t)((sum[c] + count / 2) / count);
+                    g_lightmap_coverage[py * width + px] = (uint8_t)(pass + 1);
+                    filled++;
                 }
             }
+            if (!filled)
+                break;
+            covered += filled;
+        }
+        return covered;
+    }
+
+    // ============================================================================
+    // Vertex Ambient Occlusion Bake
+    // ============================================================================
+    //
+    // Traces cosine-distributed rays around each vertex normal (against the
+    // buffer and any AO occluders, see Ambient Occlusion Rays) and multiplies
+    // the vertex color by the unoccluded fraction, for vertex-colored assets
+    // that carry their AO without a texture. Alpha is left alone. Colors are
+    // multiplied in place, so re-baking compounds; restore the colors first.
+    //
+    // bake_vertex_ao() bakes in one call. For progress reporting the same
+    // bake can run as a session: vertex_ao_begin() then vertex_ao_step() until
+    // it returns 0 (the module is single-threaded, so the worker reports
+    // between steps).
+
+    struct VertexAoSession
+    {
+        int32_t geometry; // Geometry buffer handle
+        int32_t samples;
+        float radius;
+        float bias;         // Ray origin offset and tmin (object units)
+        int32_t nextVertex = -1; // -1 when no session is active
+        float model[16];         // Placement for occluder transforms
+        // Geometry state at begin time (a mismatch ends the session)
+        uint32_t version; // g_geometry_vertex_versions entry
+        int32_t vertexCount;
+    };
+
+    static VertexAoSession g_vertex_ao = {};
+
+    // Start a vertex AO bake of a geometry buffer placed with the current
+    // model matrix. radius <= 0 uses the buffer's bounding radius. Returns
+    // the number of vertices to step through, 0 on failure.
+    EMSCRIPTEN_KEEPALIVE
+    int32_t vertex_ao_begin(int32_t handle, int32_t samples, float radius)
+    {
+        g_vertex_ao.nextVertex = -1;
+        GeometryBuffer *buf = lookup_geometry_buffer(handle);
+        if (!buf || !buf->vertices || !buf->indices || buf->vertexCount <= 0)
+            return 0;
+        if (!prepare_ao_traces(handle, g_model_matrix))
+            return 0;
+        const float *sphere = geometry_bounding_sphere(handle - 1, buf);
+
+        g_vertex_ao.geometry = handle;
+        g_vertex_ao.samples = samples < 1 ? 1 : (samples > MAX_AO_SAMPLES ? MAX_AO_SAMPLES : samples);
+        g_vertex_ao.radius = radius > 0.0f ? radius : (sphere[3] > 0.0f ? sphere[3] : 1.0f);
+        g_vertex_ao.bias = fmaxf(sphere[3], 1e-3f) * 1e-4f;
+        memcpy(g_vertex_ao.model, g_model_matrix, sizeof(g_vertex_ao.model));
+        g_vertex_ao.version = g_geometry_vertex_versions[handle - 1];
+        g_vertex_ao.vertexCount = buf->vertexCount;
+        g_vertex_ao.nextVertex = 0;
+        return buf->vertexCount;
+    }
+
+    // Bake the next count vertices. Returns the vertices still left (0 =
+    // done, which ends the session), or -1 if there is no session or the
+    // buffer was re-uploaded.
+    EMSCRIPTEN_KEEPALIVE
+    int32_t vertex_ao_step(int32_t count)
+    {
+        if (g_vertex_ao.nextVertex < 0)
+            return -1;
+        GeometryBuffer *buf = lookup_geometry_buffer(g_vertex_ao.geometry);
+        if (!buf || g_geometry_vertex_versions[g_vertex_ao.geometry - 1] != g_vertex_ao.version ||
+            buf->vertexCount != g_vertex_ao.vertexCount ||
+            !prepare_ao_traces(g_vertex_ao.geometry, g_vertex_ao.model))
+        {
+            g_vertex_ao.nextVertex = -1;
+            return -1;
+        }
+
+        int32_t end = g_vertex_ao.nextVertex + (count > 0 ? count : 1);
+        if (end > buf->vertexCount || end < 0)
+            end = buf->vertexCount;
+        for (int32_t i = g_vertex_ao.nextVertex; i < end; i++)
+        {
+            float *v = &buf->vertices[i * 12];
+            Vec3 normal(v[3], v[4], v[5]);
+            if (normal.dot(normal) < 1e-12f)
+                continue;
+            float ao = trace_ambient_occlusion(Vec3(v[0], v[1], v[2]), normal.normalize(), g_vertex_ao.samples,
+                                               g_vertex_ao.radius, g_vertex_ao.bias, (uint32_t)i);
+            v[8] *= ao;
+            v[9] *= ao;
+            v[10] *= ao;
         }
+        touch_geometry_morphs(g_vertex_ao.geometry - 1); // The morphed copy holds the old colors
+
+        g_vertex_ao.nextVertex = end < buf->vertexCount ? end : -1;
+        return buf->vertexCount - end;
+    }
+
+    // Bake AO into a buffer's vertex colors in one call (samples rays per
+    // vertex within radius). Returns the number of vertices baked, -1 on
+    // failure.
+    EMSCRIPTEN_KEEPALIVE
+    int32_t bake_vertex_ao(int32_t handle, int32_t samples, float radius)
+    {
+        int32_t count = vertex_ao_begin(handle, samples, radius);
+        if (count <= 0 || vertex_ao_step(count) != 0)
+            return -1;
+        return count;
+    }
+
+    // ============================================================================
+    // Face Materials
+    // ============================================================================
+    //
+    // A buffer can carry one material id per triangle, so a multi-material
+    // mesh draws in a single render_geometry_buffer call over shared vertices.
+    // Before the draw JS fills the material table (MATERIAL_INTS per entry:
+    // texture buffer handle, MATERIAL_* flags) and commits it with
+    // set_material_count; the raster loop rebinds the texture whenever the
+    // material changes between triangles. The count is reset after every
+    // render_geometry_buffer / modifier_stack_render call, so a table never
+    // leaks into later draws. Buffers without ids, or draws with a count of 0,
+    // use the bound texture as before.
+
+    // Allocate material ids for triangleCount triangles (existing ids are
+    // kept, new ones are 0); JS writes one byte per triangle. Call it again
+    // after editing ids in place. Returns the ids array, or nullptr on failure.
+    EMSCRIPTEN_KEEPALIVE
+    uint8_t *geometry_buffer_alloc_materials(int32_t handle, int32_t triangleCount)
+    {
+        if (!lookup_geometry_buffer(handle) || triangleCount <= 0)
+            return nullptr;
+        FaceMaterials *materials = ensure_face_materials(handle - 1, triangleCount);
+        return materials ? materials->ids : nullptr;
+    }
+
+    // 1 if the buffer has material ids matching its triangles
+    EMSCRIPTEN_KEEPALIVE
+    int32_t geometry_buffer_has_materials(int32_t handle)
+    {
+        GeometryBuffer *buf = lookup_geometry_buffer(handle);
+        FaceMaterials *materials = buf ? g_geometry_materials[handle - 1] : nullptr;
+        return materials && materials->triangleCount == buf->indexCount / 3 ? 1 : 0;
+    }
+
+    EMSCRIPTEN_KEEPALIVE
+    void geometry_buffer_clear_materials(int32_t handle)
+    {
+        if (!lookup_geometry_buffer(handle))
+            return;
+        free_face_materials(g_geometry_materials[handle - 1]);
+        g_geometry_materials[handle - 1] = nullptr;
+    }
+
+    // Material table (MAX_MATERIALS * MATERIAL_INTS ints)
+    EMSCRIPTEN_KEEPALIVE
+    int32_t *get_material_table_ptr()
+    {
+        return g_material_table;
+    }
+
+    // Number of table entries used by the next draw (0 = ignore face materials)
+    EMSCRIPTEN_KEEPALIVE
+    void set_material_count(int32_t count)
+    {
+        g_material_count = count < 0 ? 0 : (count > MAX_MATERIALS ? MAX_MATERIALS : count);
+    }
+
+    EMSCRIPTEN_KEEPALIVE
+    int32_t get_max_materials()
+    {
+        return MAX_MATERIALS;
     }
 
 } // extern "C"
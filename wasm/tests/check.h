@@ -0,0 +1,60 @@
+// Minimal test helpers for the native tests in wasm/tests.
+//
+// Each test is one translation unit that includes rasterizer.cpp directly
+// (so static helpers and globals are reachable) and compiles it for the host
+// against the stand-in headers in tests/host. Run them with `make test`.
+#pragma once
+#include <cmath>
+#include <cstdio>
+
+static int g_check_failures = 0;
+
+#define CHECK(cond)                                                              \
+    do                                                                           \
+    {                                                                            \
+        if (!(cond))                                                             \
+        {                                                                        \
+            fprintf(stderr, "%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, #cond); \
+            g_check_failures++;                                                  \
+        }                                                                        \
+    } while (0)
+
+#define CHECK_EQ(a, b)                                                                  \
+    do                                                                                  \
+    {                                                                                   \
+        long long check_a = (long long)(a), check_b = (long long)(b);                   \
+        if (check_a != check_b)                                                         \
+        {                                                                               \
+            fprintf(stderr, "%s:%d: CHECK_EQ failed: %s == %s (%lld vs %lld)\n", __FILE__, \
+                    __LINE__, #a, #b, check_a, check_b);                                \
+            g_check_failures++;                                                         \
+        }                                                                               \
+    } while (0)
+
+#define CHECK_NEAR(a, b, eps)                                                               \
+    do                                                                                      \
+    {                                                                                       \
+        double check_a = (double)(a), check_b = (double)(b);                                \
+        if (!(fabs(check_a - check_b) <= (eps)))                                            \
+        {                                                                                   \
+            fprintf(stderr, "%s:%d: CHECK_NEAR failed: %s ~ %s (%g vs %g)\n", __FILE__,     \
+                    __LINE__, #a, #b, check_a, check_b);                                    \
+            g_check_failures++;                                                             \
+        }                                                                                   \
+    } while (0)
+
+// Run a test function and report it
+#define RUN_TEST(fn)                                   \
+    do                                                 \
+    {                                                  \
+        int check_before = g_check_failures;           \
+        fn();                                          \
+        printf("%s %s\n", check_before == g_check_failures ? "ok  " : "FAIL", #fn); \
+    } while (0)
+
+static inline int check_summary()
+{
+    if (g_check_failures)
+        fprintf(stderr, "%d check(s) failed\n", g_check_failures);
+    return g_check_failures ? 1 : 0;
+}
@@ -0,0 +1,125 @@
+// Edit mesh tests: loading, validating and exporting the polygon cages that
+// subdivision surfaces and modifier stacks are built from.
+
+#include "../rasterizer.cpp"
+#include "check.h"
+
+// Unit cube, six CCW quads
+static const int32_t CUBE_FACES[6][4] = {
+    {0, 3, 2, 1}, {4, 5, 6, 7}, {0, 1, 5, 4}, {1, 2, 6, 5}, {2, 3, 7, 6}, {3, 0, 4, 7},
+};
+
+static int32_t make_cube_buffer()
+{
+    int32_t handle = create_geometry_buffer();
+    float *v = geometry_buffer_alloc_vertices(handle, 8);
+    memset(v, 0, 8 * 12 * sizeof(float));
+    for (int32_t i = 0; i < 8; i++)
+    {
+        v[i * 12] = (float)((i & 1) ^ ((i >> 1) & 1));
+        v[i * 12 + 1] = (float)((i >> 1) & 1);
+        v[i * 12 + 2] = (float)(i >> 2);
+    }
+    return handle;
+}
+
+static int32_t load_faces(int32_t mesh, const int32_t (*faces)[4], int32_t count)
+{
+    int32_t *input = edit_mesh_get_input_ptr(count * 5);
+    for (int32_t f = 0; f < count; f++)
+        input[f] = 4;
+    memcpy(&input[count], faces, (size_t)count * 4 * sizeof(int32_t));
+    return edit_mesh_set_faces(mesh, count);
+}
+
+static void test_closed_cube_has_all_twins()
+{
+    int32_t geometry = make_cube_buffer();
+    int32_t mesh = edit_mesh_create(geometry);
+    CHECK(mesh > 0);
+    CHECK_EQ(load_faces(mesh, CUBE_FACES, 6), 24);
+    const EditMesh *m = lookup_edit_mesh(mesh);
+    int32_t boundaries = 0;
+    for (int32_t h = 0; h < m->halfEdgeCount; h++)
+    {
+        boundaries += m->heTwin[h] < 0 ? 1 : 0;
+        if (m->heTwin[h] >= 0)
+        {
+            CHECK_EQ(m->heTwin[m->heTwin[h]], h);
+            CHECK_EQ(edit_dest(m, m->heTwin[h]), m->heVertex[h]);
+        }
+    }
+    CHECK_EQ(boundaries, 0);
+
+    // An open box (no top) has one boundary loop of four edges
+    CHECK_EQ(load_faces(mesh, CUBE_FACES, 5), 20);
+    boundaries = 0;
+    for (int32_t h = 0; h < m->halfEdgeCount; h++)
+        boundaries += m->heTwin[h] < 0 ? 1 : 0;
+    CHECK_EQ(boundaries, 4);
+
+    edit_mesh_delete(mesh);
+    delete_geometry_buffer(geometry);
+}
+
+static void test_invalid_faces_leave_mesh_unchanged()
+{
+    int32_t geometry = make_cube_buffer();
+    int32_t mesh = edit_mesh_create(geometry);
+    load_faces(mesh, CUBE_FACES, 6);
+
+    int32_t bad[1][4] = {{0, 1, 2, 8}}; // Vertex 8 is out of range
+    CHECK_EQ(load_faces(mesh, bad, 1), -1);
+    int32_t *input = edit_mesh_get_input_ptr(3);
+    input[0] = 1; // A one-corner face
+    input[1] = 0;
+    CHECK_EQ(edit_mesh_set_faces(mesh, 1), -1);
+    CHECK_EQ(edit_mesh_get_face_count(mesh), 6);
+    CHECK_EQ(lookup_edit_mesh(mesh)->halfEdgeCount, 24);
+
+    CHECK_EQ(edit_mesh_create(0), 0);
+    CHECK_EQ(edit_mesh_set_faces(0, 0), -1);
+    edit_mesh_delete(mesh);
+    delete_geometry_buffer(geometry);
+}
+
+static void test_faces_round_trip_and_write_back()
+{
+    int32_t geometry = make_cube_buffer();
+    int32_t mesh = edit_mesh_create(geometry);
+    load_faces(mesh, CUBE_FACES, 6);
+
+    CHECK_EQ(edit_mesh_get_faces(mesh), 6 + 24);
+    const int32_t *results = edit_mesh_get_results_ptr();
+    for (int32_t f = 0; f < 6; f++)
+    {
+        CHECK_EQ(results[f], 4);
+        for (int32_t i = 0; i < 4; i++)
+            CHECK_EQ(results[6 + f * 4 + i], CUBE_FACES[f][i]);
+    }
+
+    // Fans: two triangles per quad
+    CHECK_EQ(edit_mesh_write_back(mesh), 36);
+    GeometryBuffer *buf = lookup_geometry_buffer(geometry);
+    CHECK_EQ(buf->indexCount, 36);
+    CHECK_EQ(buf->indices[3], 0);
+    CHECK_EQ(buf->indices[4], 2);
+    CHECK_EQ(buf->indices[5], 1);
+
+    // The cage drives subdivision: one level over a cube gives 8 + 12 + 6
+    int32_t surface = subdiv_create(mesh, 1);
+    CHECK(surface > 0);
+    CHECK_EQ(subdiv_get_vertex_count(surface, 1), 26);
+    subdiv_delete(surface);
+
+    edit_mesh_delete(mesh);
+    delete_geometry_buffer(geometry);
+}
+
+int main()
+{
+    RUN_TEST(test_closed_cube_has_all_twins);
+    RUN_TEST(test_invalid_faces_leave_mesh_unchanged);
+    RUN_TEST(test_faces_round_trip_and_write_back);
+    return check_summary();
+}
@@ -0,0 +1,3 @@
+// Host stand-in for <emscripten.h>, used only by the native tests in wasm/tests.
+#pragma once
+#define EMSCRIPTEN_KEEPALIVE __attribute__((used))
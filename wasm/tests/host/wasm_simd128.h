@@ -0,0 +1,134 @@
+// Host stand-in for <wasm_simd128.h>: scalar/GCC-vector versions of the
+// intrinsics rasterizer.cpp uses, so the native tests in wasm/tests can
+// compile the module with g++ (GCC vector extensions) without a WebAssembly target.
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <cstdlib>
+#include <cmath>
+typedef int32_t v128_t __attribute__((vector_size(16)));
+typedef float f4 __attribute__((vector_size(16)));
+typedef uint32_t u4 __attribute__((vector_size(16)));
+typedef int16_t s8 __attribute__((vector_size(16)));
+typedef uint16_t us8 __attribute__((vector_size(16)));
+typedef int8_t s16 __attribute__((vector_size(16)));
+typedef uint8_t us16 __attribute__((vector_size(16)));
+#define F(v) ((f4)(v))
+#define R(v) ((v128_t)(v))
+static inline v128_t wasm_f32x4_make(float a,float b,float c,float d){f4 r={a,b,c,d};return R(r);}
+static inline v128_t wasm_i32x4_make(int32_t a,int32_t b,int32_t c,int32_t d){v128_t r={a,b,c,d};return r;}
+static inline v128_t wasm_u32x4_make(uint32_t a,uint32_t b,uint32_t c,uint32_t d){v128_t r={(int)a,(int)b,(int)c,(int)d};return r;}
+static inline v128_t wasm_f32x4_splat(float a){return wasm_f32x4_make(a,a,a,a);}
+static inline v128_t wasm_i32x4_splat(int32_t a){return wasm_i32x4_make(a,a,a,a);}
+static inline v128_t wasm_u32x4_splat(uint32_t a){return wasm_i32x4_splat((int32_t)a);}
+static inline v128_t wasm_i16x8_splat(int16_t a){s8 r={a,a,a,a,a,a,a,a};return R(r);}
+static inline v128_t wasm_u16x8_splat(uint16_t a){return wasm_i16x8_splat((int16_t)a);}
+static inline v128_t wasm_i8x16_splat(int8_t a){s16 r; for(int i=0;i<16;i++) r[i]=a; return R(r);}
+static inline v128_t wasm_u8x16_splat(uint8_t a){return wasm_i8x16_splat((int8_t)a);}
+static inline v128_t wasm_f32x4_add(v128_t a,v128_t b){return R(F(a)+F(b));}
+static inline v128_t wasm_f32x4_sub(v128_t a,v128_t b){return R(F(a)-F(b));}
+static inline v128_t wasm_f32x4_mul(v128_t a,v128_t b){return R(F(a)*F(b));}
+static inline v128_t wasm_f32x4_div(v128_t a,v128_t b){return R(F(a)/F(b));}
+static inline v128_t wasm_f32x4_neg(v128_t a){return R(-F(a));}
+static inline v128_t wasm_f32x4_abs(v128_t a){f4 x=F(a);for(int i=0;i<4;i++)x[i]=fabsf(x[i]);return R(x);}
+static inline v128_t wasm_f32x4_sqrt(v128_t a){f4 x=F(a);for(int i=0;i<4;i++)x[i]=sqrtf(x[i]);return R(x);}
+static inline v128_t wasm_f32x4_floor(v128_t a){f4 x=F(a);for(int i=0;i<4;i++)x[i]=floorf(x[i]);return R(x);}
+static inline v128_t wasm_f32x4_ceil(v128_t a){f4 x=F(a);for(int i=0;i<4;i++)x[i]=ceilf(x[i]);return R(x);}
+static inline v128_t wasm_f32x4_nearest(v128_t a){f4 x=F(a);for(int i=0;i<4;i++)x[i]=__builtin_rintf(x[i]);return R(x);}
+static inline v128_t wasm_f32x4_min(v128_t a,v128_t b){f4 x=F(a),y=F(b);for(int i=0;i<4;i++)x[i]=fminf(x[i],y[i]);return R(x);}
+static inline v128_t wasm_f32x4_max(v128_t a,v128_t b){f4 x=F(a),y=F(b);for(int i=0;i<4;i++)x[i]=fmaxf(x[i],y[i]);return R(x);}
+static inline v128_t wasm_f32x4_pmin(v128_t a,v128_t b){f4 x=F(a),y=F(b);for(int i=0;i<4;i++)x[i]=y[i]<x[i]?y[i]:x[i];return R(x);}
+static inline v128_t wasm_f32x4_pmax(v128_t a,v128_t b){f4 x=F(a),y=F(b);for(int i=0;i<4;i++)x[i]=x[i]<y[i]?y[i]:x[i];return R(x);}
+static inline v128_t wasm_f32x4_lt(v128_t a,v128_t b){return R(F(a)<F(b));}
+static inline v128_t wasm_f32x4_le(v128_t a,v128_t b){return R(F(a)<=F(b));}
+static inline v128_t wasm_f32x4_gt(v128_t a,v128_t b){return R(F(a)>F(b));}
+static inline v128_t wasm_f32x4_ge(v128_t a,v128_t b){return R(F(a)>=F(b));}
+static inline v128_t wasm_f32x4_eq(v128_t a,v128_t b){return R(F(a)==F(b));}
+static inline v128_t wasm_f32x4_ne(v128_t a,v128_t b){return R(F(a)!=F(b));}
+static inline v128_t wasm_f32x4_relaxed_madd(v128_t a,v128_t b,v128_t c){return R(F(a)*F(b)+F(c));}
+static inline v128_t wasm_f32x4_relaxed_nmadd(v128_t a,v128_t b,v128_t c){return R(-(F(a)*F(b))+F(c));}
+static inline v128_t wasm_f32x4_convert_i32x4(v128_t a){f4 r;for(int i=0;i<4;i++)r[i]=(float)a[i];return R(r);}
+static inline v128_t wasm_f32x4_convert_u32x4(v128_t a){f4 r;for(int i=0;i<4;i++)r[i]=(float)(uint32_t)a[i];return R(r);}
+static inline float wasm_f32x4_extract_lane(v128_t a,int l){return F(a)[l];}
+static inline v128_t wasm_f32x4_replace_lane(v128_t a,int l,float v){f4 x=F(a);x[l]=v;return R(x);}
+static inline int32_t wasm_i32x4_extract_lane(v128_t a,int l){return a[l];}
+static inline v128_t wasm_i32x4_replace_lane(v128_t a,int l,int32_t v){a[l]=v;return a;}
+static inline uint32_t wasm_u32x4_extract_lane(v128_t a,int l){return (uint32_t)a[l];}
+static inline v128_t wasm_i32x4_trunc_sat_f32x4(v128_t a){f4 x=F(a);v128_t r;for(int i=0;i<4;i++){float v=x[i]; r[i]= v!=v?0: v>=2147483647.f?2147483647: v<=-2147483648.f?(-2147483647-1):(int32_t)v;}return r;}
+static inline v128_t wasm_u32x4_trunc_sat_f32x4(v128_t a){f4 x=F(a);v128_t r;for(int i=0;i<4;i++){float v=x[i]; r[i]= (int32_t)(v!=v||v<=0?0u: v>=4294967295.f?4294967295u:(uint32_t)v);}return r;}
+static inline v128_t wasm_i32x4_add(v128_t a,v128_t b){return a+b;}
+static inline v128_t wasm_i32x4_sub(v128_t a,v128_t b){return a-b;}
+static inline v128_t wasm_i32x4_mul(v128_t a,v128_t b){return R((u4)a*(u4)b);}
+static inline v128_t wasm_i32x4_neg(v128_t a){return -a;}
+static inline v128_t wasm_i32x4_shl(v128_t a,int s){return R((u4)a<<(s&31));}
+static inline v128_t wasm_i32x4_shr(v128_t a,int s){return a>>(s&31);}
+static inline v128_t wasm_u32x4_shr(v128_t a,int s){return R((u4)a>>(s&31));}
+static inline v128_t wasm_i32x4_min(v128_t a,v128_t b){v128_t r;for(int i=0;i<4;i++)r[i]=a[i]<b[i]?a[i]:b[i];return r;}
+static inline v128_t wasm_i32x4_max(v128_t a,v128_t b){v128_t r;for(int i=0;i<4;i++)r[i]=a[i]>b[i]?a[i]:b[i];return r;}
+static inline v128_t wasm_u32x4_min(v128_t a,v128_t b){v128_t r;for(int i=0;i<4;i++)r[i]=(uint32_t)a[i]<(uint32_t)b[i]?a[i]:b[i];return r;}
+static inline v128_t wasm_u32x4_max(v128_t a,v128_t b){v128_t r;for(int i=0;i<4;i++)r[i]=(uint32_t)a[i]>(uint32_t)b[i]?a[i]:b[i];return r;}
+static inline v128_t wasm_i32x4_eq(v128_t a,v128_t b){return R(a==b);}
+static inline v128_t wasm_i32x4_ne(v128_t a,v128_t b){return R(a!=b);}
+static inline v128_t wasm_i32x4_lt(v128_t a,v128_t b){return R(a<b);}
+static inline v128_t wasm_i32x4_le(v128_t a,v128_t b){return R(a<=b);}
+static inline v128_t wasm_i32x4_gt(v128_t a,v128_t b){return R(a>b);}
+static inline v128_t wasm_i32x4_ge(v128_t a,v128_t b){return R(a>=b);}
+static inline v128_t wasm_u32x4_lt(v128_t a,v128_t b){return R((u4)a<(u4)b);}
+static inline v128_t wasm_u32x4_gt(v128_t a,v128_t b){return R((u4)a>(u4)b);}
+static inline v128_t wasm_u32x4_le(v128_t a,v128_t b){return R((u4)a<=(u4)b);}
+static inline v128_t wasm_u32x4_ge(v128_t a,v128_t b){return R((u4)a>=(u4)b);}
+static inline v128_t wasm_i32x4_abs(v128_t a){v128_t r;for(int i=0;i<4;i++)r[i]=a[i]<0?-a[i]:a[i];return r;}
+static inline uint32_t wasm_i32x4_bitmask(v128_t a){uint32_t m=0;for(int i=0;i<4;i++)if(a[i]<0)m|=1u<<i;return m;}
+static inline bool wasm_i32x4_all_true(v128_t a){for(int i=0;i<4;i++)if(!a[i])return false;return true;}
+static inline bool wasm_v128_any_true(v128_t a){for(int i=0;i<4;i++)if(a[i])return true;return false;}
+static inline v128_t wasm_v128_and(v128_t a,v128_t b){return a&b;}
+static inline v128_t wasm_v128_or(v128_t a,v128_t b){return a|b;}
+static inline v128_t wasm_v128_xor(v128_t a,v128_t b){return a^b;}
+static inline v128_t wasm_v128_not(v128_t a){return ~a;}
+static inline v128_t wasm_v128_andnot(v128_t a,v128_t b){return a&~b;}
+static inline v128_t wasm_v128_bitselect(v128_t a,v128_t b,v128_t m){return (a&m)|(b&~m);}
+static inline v128_t wasm_v128_load(const void*p){v128_t r;memcpy(&r,p,16);return r;}
+static inline void wasm_v128_store(void*p,v128_t a){memcpy(p,&a,16);}
+static inline v128_t wasm_v128_load64_zero(const void*p){v128_t r={0,0,0,0};memcpy(&r,p,8);return r;}
+static inline v128_t wasm_v128_load32_zero(const void*p){v128_t r={0,0,0,0};memcpy(&r,p,4);return r;}
+static inline void wasm_v128_store64_lane(void*p,v128_t a,int l){memcpy(p,((char*)&a)+8*l,8);}
+static inline void wasm_v128_store32_lane(void*p,v128_t a,int l){memcpy(p,((char*)&a)+4*l,4);}
+static inline v128_t wasm_u32x4_extend_low_u16x8(v128_t a){us8 x=(us8)a;v128_t r;for(int i=0;i<4;i++)r[i]=x[i];return r;}
+static inline v128_t wasm_u32x4_extend_high_u16x8(v128_t a){us8 x=(us8)a;v128_t r;for(int i=0;i<4;i++)r[i]=x[i+4];return r;}
+static inline v128_t wasm_i32x4_extend_low_i16x8(v128_t a){s8 x=(s8)a;v128_t r;for(int i=0;i<4;i++)r[i]=x[i];return r;}
+static inline v128_t wasm_i32x4_extend_high_i16x8(v128_t a){s8 x=(s8)a;v128_t r;for(int i=0;i<4;i++)r[i]=x[i+4];return r;}
+static inline v128_t wasm_u16x8_extend_low_u8x16(v128_t a){us16 x=(us16)a;us8 r;for(int i=0;i<8;i++)r[i]=x[i];return R(r);}
+static inline v128_t wasm_u16x8_extend_high_u8x16(v128_t a){us16 x=(us16)a;us8 r;for(int i=0;i<8;i++)r[i]=x[i+8];return R(r);}
+static inline v128_t wasm_i16x8_extend_low_i8x16(v128_t a){s16 x=(s16)a;s8 r;for(int i=0;i<8;i++)r[i]=x[i];return R(r);}
+static inline v128_t wasm_i16x8_extend_high_i8x16(v128_t a){s16 x=(s16)a;s8 r;for(int i=0;i<8;i++)r[i]=x[i+8];return R(r);}
+static inline int16_t sat16(int32_t v){return v>32767?32767:v<-32768?-32768:v;}
+static inline uint16_t satu16(int32_t v){return v>65535?65535:v<0?0:v;}
+static inline v128_t wasm_i16x8_narrow_i32x4(v128_t a,v128_t b){s8 r;for(int i=0;i<4;i++){r[i]=sat16(a[i]);r[i+4]=sat16(b[i]);}return R(r);}
+static inline v128_t wasm_u16x8_narrow_i32x4(v128_t a,v128_t b){us8 r;for(int i=0;i<4;i++){r[i]=satu16(a[i]);r[i+4]=satu16(b[i]);}return R(r);}
+static inline v128_t wasm_u8x16_narrow_i16x8(v128_t a,v128_t b){s8 x=(s8)a,y=(s8)b;us16 r;for(int i=0;i<8;i++){int v=x[i];r[i]=v>255?255:v<0?0:v;v=y[i];r[i+8]=v>255?255:v<0?0:v;}return R(r);}
+static inline v128_t wasm_i16x8_add(v128_t a,v128_t b){return R((s8)a+(s8)b);}
+static inline v128_t wasm_i16x8_sub(v128_t a,v128_t b){return R((s8)a-(s8)b);}
+static inline v128_t wasm_i16x8_mul(v128_t a,v128_t b){return R((s8)((us8)a*(us8)b));}
+static inline v128_t wasm_u16x8_shr(v128_t a,int s){return R((us8)a>>(s&15));}
+static inline v128_t wasm_i16x8_shr(v128_t a,int s){return R((s8)a>>(s&15));}
+static inline v128_t wasm_i16x8_shl(v128_t a,int s){return R((s8)((us8)a<<(s&15)));}
+static inline v128_t wasm_i8x16_add(v128_t a,v128_t b){return R((s16)a+(s16)b);}
+static inline v128_t wasm_i8x16_sub(v128_t a,v128_t b){return R((s16)a-(s16)b);}
+static inline v128_t wasm_i8x16_eq(v128_t a,v128_t b){return R((s16)a==(s16)b);}
+static inline v128_t wasm_u8x16_min(v128_t a,v128_t b){us16 x=(us16)a,y=(us16)b;for(int i=0;i<16;i++)x[i]=x[i]<y[i]?x[i]:y[i];return R(x);}
+static inline v128_t wasm_u8x16_max(v128_t a,v128_t b){us16 x=(us16)a,y=(us16)b;for(int i=0;i<16;i++)x[i]=x[i]>y[i]?x[i]:y[i];return R(x);}
+static inline uint32_t wasm_i8x16_bitmask(v128_t a){s16 x=(s16)a;uint32_t m=0;for(int i=0;i<16;i++)if(x[i]<0)m|=1u<<i;return m;}
+static inline uint32_t wasm_i16x8_bitmask(v128_t a){s8 x=(s8)a;uint32_t m=0;for(int i=0;i<8;i++)if(x[i]<0)m|=1u<<i;return m;}
+static inline uint8_t wasm_u8x16_extract_lane(v128_t a,int l){return ((us16)a)[l];}
+static inline uint16_t wasm_u16x8_extract_lane(v128_t a,int l){return ((us8)a)[l];}
+static inline v128_t wasm_u16x8_min(v128_t a,v128_t b){us8 x=(us8)a,y=(us8)b;for(int i=0;i<8;i++)x[i]=x[i]<y[i]?x[i]:y[i];return R(x);}
+static inline v128_t wasm_u16x8_lt(v128_t a,v128_t b){return R((us8)a<(us8)b);}
+static inline v128_t wasm_u16x8_make(uint16_t a,uint16_t b,uint16_t c,uint16_t d,uint16_t e,uint16_t f,uint16_t g,uint16_t h){us8 r={a,b,c,d,e,f,g,h};return R(r);}
+static inline v128_t wasm_i16x8_make(int16_t a,int16_t b,int16_t c,int16_t d,int16_t e,int16_t f,int16_t g,int16_t h){s8 r={a,b,c,d,e,f,g,h};return R(r);}
+static inline v128_t wasm_i8x16_swizzle(v128_t a,v128_t idx){us16 x=(us16)a,ix=(us16)idx,r;for(int i=0;i<16;i++)r[i]=ix[i]<16?x[ix[i]]:0;return R(r);}
+static inline v128_t wasm_i8x16_relaxed_swizzle(v128_t a,v128_t idx){return wasm_i8x16_swizzle(a,idx);}
+static inline v128_t wasm_i32x4_dot_i16x8(v128_t a,v128_t b){s8 x=(s8)a,y=(s8)b;v128_t r;for(int i=0;i<4;i++)r[i]=x[2*i]*y[2*i]+x[2*i+1]*y[2*i+1];return r;}
+#define wasm_i32x4_shuffle(a,b,c0,c1,c2,c3) R(__builtin_shuffle((a),(b),(v128_t){c0,c1,c2,c3}))
+#define wasm_i8x16_shuffle(a,b,...) R(__builtin_shuffle((us16)(a),(us16)(b),(us16){__VA_ARGS__}))
+#define wasm_i64x2_shuffle(a,b,c0,c1) wasm_i32x4_shuffle(a,b,2*(c0),2*(c0)+1,2*(c1),2*(c1)+1)
+static inline v128_t wasm_i64x2_splat(int64_t a){v128_t r;memcpy(&r,&a,8);memcpy(((char*)&r)+8,&a,8);return r;}
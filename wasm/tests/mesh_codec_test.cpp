@@ -0,0 +1,273 @@
+// Mesh codec tests: encode/decode round trips and malformed streams. Saves
+// are untrusted input, so every bad stream must be rejected without touching
+// the target buffer.
+
+#include "../rasterizer.cpp"
+#include "check.h"
+
+static const int32_t GRID = 24;
+
+// GRID x GRID vertex grid with a wavy surface, two triangles per cell
+static int32_t make_grid_buffer()
+{
+    int32_t handle = create_geometry_buffer();
+    float *v = geometry_buffer_alloc_vertices(handle, GRID * GRID);
+    for (int32_t y = 0; y < GRID; y++)
+        for (int32_t x = 0; x < GRID; x++)
+        {
+            float *p = &v[(y * GRID + x) * 12];
+            p[0] = x * 0.25f;
+            p[1] = y * 0.25f;
+            p[2] = sinf(x * 0.3f) * cosf(y * 0.2f);
+            Vec3 n = Vec3(-0.3f * cosf(x * 0.3f), 0.2f * sinf(y * 0.2f), 1.0f).normalize();
+            p[3] = n.x;
+            p[4] = n.y;
+            p[5] = n.z;
+            p[6] = x / (float)(GRID - 1);
+            p[7] = y / (float)(GRID - 1);
+            p[8] = (float)((x * 11) & 255);
+            p[9] = (float)((y * 7) & 255);
+            p[10] = 128.0f;
+            p[11] = 255.0f;
+        }
+    uint32_t *ix = geometry_buffer_alloc_indices(handle, (GRID - 1) * (GRID - 1) * 6);
+    int32_t k = 0;
+    for (int32_t y = 0; y < GRID - 1; y++)
+        for (int32_t x = 0; x < GRID - 1; x++)
+        {
+            uint32_t a = y * GRID + x, b = a + 1, c = a + GRID, d = c + 1;
+            uint32_t tris[6] = {a, b, d, a, d, c};
+            for (int i = 0; i < 6; i++)
+                ix[k++] = tris[i];
+        }
+    return handle;
+}
+
+// Encode a buffer and return a malloc'd copy of the stream
+static uint8_t *encode_copy(int32_t handle, int32_t &size)
+{
+    size = mesh_encode(handle, 16, 12);
+    if (size <= 0)
+        return nullptr;
+    uint8_t *copy = (uint8_t *)malloc(size);
+    memcpy(copy, mesh_codec_get_output_ptr(), size);
+    return copy;
+}
+
+// Same triangle up to rotation (the encoder may rotate corners)
+static bool same_triangle(const uint32_t *a, const uint32_t *b)
+{
+    for (int r = 0; r < 3; r++)
+        if (a[0] == b[r] && a[1] == b[(r + 1) % 3] && a[2] == b[(r + 2) % 3])
+            return true;
+    return false;
+}
+
+static void test_round_trip()
+{
+    int32_t source = make_grid_buffer();
+    int32_t size = 0;
+    uint8_t *stream = encode_copy(source, size);
+    CHECK(stream != nullptr);
+    if (!stream)
+        return;
+
+    int32_t target = create_geometry_buffer();
+    CHECK_EQ(mesh_decode(target, stream, size), GRID * GRID);
+    GeometryBuffer *a = lookup_geometry_buffer(source);
+    GeometryBuffer *b = lookup_geometry_buffer(target);
+    CHECK_EQ(b->vertexCount, a->vertexCount);
+    CHECK_EQ(b->indexCount, a->indexCount);
+
+    // 16-bit positions over a 5.75 unit extent, 12-bit UVs, 8-bit normals
+    int32_t badVertices = 0, badTriangles = 0;
+    for (int32_t i = 0; i < a->vertexCount && i < b->vertexCount; i++)
+    {
+        const float *p = &a->vertices[i * 12];
+        const float *q = &b->vertices[i * 12];
+        bool ok = fabsf(p[0] - q[0]) < 1e-4f && fabsf(p[1] - q[1]) < 1e-4f && fabsf(p[2] - q[2]) < 1e-4f &&
+                  fabsf(p[3] - q[3]) < 0.02f && fabsf(p[4] - q[4]) < 0.02f && fabsf(p[5] - q[5]) < 0.02f &&
+                  fabsf(p[6] - q[6]) < 1e-3f && fabsf(p[7] - q[7]) < 1e-3f;
+        for (int c = 8; c < 12; c++)
+            ok = ok && p[c] == q[c];
+        badVertices += ok ? 0 : 1;
+    }
+    for (int32_t t = 0; t + 2 < a->indexCount && t + 2 < b->indexCount; t += 3)
+        badTriangles += same_triangle(&a->indices[t], &b->indices[t]) ? 0 : 1;
+    CHECK_EQ(badVertices, 0);
+    CHECK_EQ(badTriangles, 0);
+
+    free(stream);
+    delete_geometry_buffer(source);
+    delete_geometry_buffer(target);
+}
+
+// Decode into a buffer holding a mesh; failure must leave it as it was
+static void check_rejected(const uint8_t *data, int32_t size, int32_t &failures)
+{
+    static int32_t target = 0;
+    if (!target)
+        target = make_grid_buffer();
+    GeometryBuffer *buf = lookup_geometry_buffer(target);
+    float *vertices = buf->vertices;
+    float first = vertices[0];
+    if (mesh_decode(target, data, size) != -1)
+        failures++;
+    if (buf->vertices != vertices || buf->vertexCount != GRID * GRID ||
+        buf->indexCount != (GRID - 1) * (GRID - 1) * 6 || buf->vertices[0] != first)
+        failures++;
+}
+
+static void test_truncated_streams_are_rejected()
+{
+    int32_t source = make_grid_buffer();
+    int32_t size = 0;
+    uint8_t *stream = encode_copy(source, size);
+    if (!stream)
+        return;
+
+    int32_t failures = 0;
+    for (int32_t cut = 0; cut < size; cut += (cut < 64 ? 1 : 37))
+        check_rejected(stream, cut, failures);
+    check_rejected(stream, size - 1, failures);
+    CHECK_EQ(failures, 0);
+
+    free(stream);
+    delete_geometry_buffer(source);
+}
+
+static void test_bad_headers_are_rejected()
+{
+    int32_t source = make_grid_buffer();
+    int32_t size = 0;
+    uint8_t *stream = encode_copy(source, size);
+    if (!stream)
+        return;
+    MeshCodecHeader h;
+    memcpy(&h, stream, sizeof(h));
+    int32_t failures = 0;
+
+    MeshCodecHeader bad = h;
+    bad.magic ^= 1;
+    memcpy(stream, &bad, sizeof(bad));
+    check_rejected(stream, size, failures);
+
+    bad = h;
+    bad.indexCount += 1; // Not a multiple of 3
+    memcpy(stream, &bad, sizeof(bad));
+    check_rejected(stream, size, failures);
+
+    bad = h;
+    bad.vertexStreamSize = (uint32_t)size; // Past the end
+    memcpy(stream, &bad, sizeof(bad));
+    check_rejected(stream, size, failures);
+
+    bad = h;
+    bad.vertexStreamSize -= 5; // Short vertex lanes
+    memcpy(stream, &bad, sizeof(bad));
+    check_rejected(stream, size, failures);
+
+    bad = h;
+    bad.vertexCount = 0x7fffffff; // More vertices than the stream holds
+    memcpy(stream, &bad, sizeof(bad));
+    check_rejected(stream, size, failures);
+
+    CHECK_EQ(failures, 0);
+    free(stream);
+    delete_geometry_buffer(source);
+}
+
+// A triangle of explicit indices 3, 4, 5 spliced behind a 3-vertex stream
+static void test_out_of_range_indices_are_rejected()
+{
+    int32_t small = create_geometry_buffer();
+    float *v = geometry_buffer_alloc_vertices(small, 6);
+    for (int32_t i = 0; i < 6 * 12; i++)
+        v[i] = (float)(i % 7);
+    uint32_t *ix = geometry_buffer_alloc_indices(small, 3);
+    ix[0] = 0;
+    ix[1] = 1;
+    ix[2] = 2;
+    int32_t size3 = 0;
+    GeometryBuffer *buf = lookup_geometry_buffer(small);
+    buf->vertexCount = 3;
+    uint8_t *three = encode_copy(small, size3);
+
+    buf->vertexCount = 6;
+    ix[0] = 3;
+    ix[1] = 4;
+    ix[2] = 5;
+    int32_t size6 = 0;
+    uint8_t *six = encode_copy(small, size6);
+    if (!three || !six)
+        return;
+
+    MeshCodecHeader h3, h6;
+    memcpy(&h3, three, sizeof(h3));
+    memcpy(&h6, six, sizeof(h6));
+    const uint8_t *indexStream = six + sizeof(h6) + h6.vertexStreamSize;
+    int32_t indexSize = size6 - (int32_t)(sizeof(h6) + h6.vertexStreamSize);
+    int32_t vertexPart = (int32_t)(sizeof(h3) + h3.vertexStreamSize);
+    uint8_t *spliced = (uint8_t *)malloc(vertexPart + indexSize);
+    memcpy(spliced, three, vertexPart);
+    memcpy(spliced + vertexPart, indexStream, indexSize);
+
+    int32_t failures = 0;
+    check_rejected(spliced, vertexPart + indexSize, failures);
+    CHECK_EQ(failures, 0);
+
+    // The unspliced six-vertex stream decodes fine
+    int32_t target = create_geometry_buffer();
+    CHECK_EQ(mesh_decode(target, six, size6), 6);
+
+    free(three);
+    free(six);
+    free(spliced);
+    delete_geometry_buffer(small);
+    delete_geometry_buffer(target);
+}
+
+// Random byte flips must either be rejected or decode to in-range indices
+static void test_corrupted_streams_stay_in_range()
+{
+    int32_t source = make_grid_buffer();
+    int32_t size = 0;
+    uint8_t *stream = encode_copy(source, size);
+    if (!stream)
+        return;
+    uint8_t *mutated = (uint8_t *)malloc(size);
+    int32_t target = create_geometry_buffer();
+    uint32_t seed = 12345;
+    int32_t outOfRange = 0;
+    for (int32_t trial = 0; trial < 300; trial++)
+    {
+        memcpy(mutated, stream, size);
+        for (int flips = 0; flips < 4; flips++)
+        {
+            seed = seed * 1664525u + 1013904223u;
+            int32_t at = (int32_t)sizeof(MeshCodecHeader) + (int32_t)((seed >> 8) % (uint32_t)(size - sizeof(MeshCodecHeader)));
+            mutated[at] ^= (uint8_t)(1u << (seed & 7));
+        }
+        int32_t count = mesh_decode(target, mutated, size);
+        if (count < 0)
+            continue;
+        GeometryBuffer *buf = lookup_geometry_buffer(target);
+        for (int32_t i = 0; i < buf->indexCount; i++)
+            outOfRange += buf->indices[i] >= (uint32_t)buf->vertexCount ? 1 : 0;
+    }
+    CHECK_EQ(outOfRange, 0);
+    free(mutated);
+    free(stream);
+    delete_geometry_buffer(source);
+    delete_geometry_buffer(target);
+}
+
+int main()
+{
+    RUN_TEST(test_round_trip);
+    RUN_TEST(test_truncated_streams_are_rejected);
+    RUN_TEST(test_bad_headers_are_rejected);
+    RUN_TEST(test_out_of_range_indices_are_rejected);
+    RUN_TEST(test_corrupted_streams_stay_in_range);
+    return check_summary();
+}
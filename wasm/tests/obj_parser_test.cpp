@@ -0,0 +1,154 @@
+// Native OBJ parser tests. The parity fixture is shared with
+// src/obj-loader.test.ts: both tests expect the same per-group triangle
+// corners, so the native parser and OBJLoader.parse stay in agreement.
+
+#include "../rasterizer.cpp"
+#include "check.h"
+
+static const char *PARITY_OBJ =
+    "# parity fixture\n"
+    "v 0 0 0\n"
+    "v 1 0 0 2.0\n" // Homogeneous w, not a color
+    "v 1 1 0\n"
+    "v 0 1 0 0.5 0.25 1\n" // Vertex color extension
+    "vt 0 0\n"
+    "vt 1 0\n"
+    "vt 1 1\n"
+    "vt 0 1\n"
+    "vn 0 0 1\n"
+    "g first\n"
+    "s off\n"
+    "f 1/1/1 2/2/1 3/3/1 4/4/1\n"
+    "g second\n"
+    "s 1\n"
+    "f -4/-4/-1 -2/-2/-1 -1/-1/-1\n";
+
+// Expected corners per group: x, y, z, u, v (as OBJLoader.parse produces them)
+static const float FIRST_CORNERS[6][5] = {
+    {0, 0, 0, 0, 0}, {1, 0, 0, 1, 0}, {1, 1, 0, 1, 1},
+    {0, 0, 0, 0, 0}, {1, 1, 0, 1, 1}, {0, 1, 0, 0, 1},
+};
+static const float SECOND_CORNERS[3][5] = {
+    {0, 0, 0, 0, 0}, {1, 1, 0, 1, 1}, {0, 1, 0, 0, 1},
+};
+
+// Parse text in chunks of chunkSize bytes; returns the number of meshes
+static int32_t parse_obj(const char *text, int32_t chunkSize)
+{
+    obj_parser_begin(255.0f, 255.0f, 255.0f);
+    int32_t size = (int32_t)strlen(text);
+    for (int32_t offset = 0; offset < size; offset += chunkSize)
+    {
+        int32_t n = size - offset < chunkSize ? size - offset : chunkSize;
+        memcpy(obj_parser_get_input_ptr(n), text + offset, n);
+        if (!obj_parser_feed(n))
+            return -1;
+    }
+    return obj_parser_finish(0);
+}
+
+static void check_corners(int32_t mesh, const float (*corners)[5], int32_t count)
+{
+    GeometryBuffer *buf = lookup_geometry_buffer(obj_parser_get_mesh_handle(mesh));
+    CHECK(buf != nullptr);
+    if (!buf)
+        return;
+    CHECK_EQ(buf->indexCount, count);
+    for (int32_t i = 0; i < count && i < buf->indexCount; i++)
+    {
+        const float *v = &buf->vertices[buf->indices[i] * 12];
+        for (int k = 0; k < 3; k++)
+            CHECK_NEAR(v[k], corners[i][k], 1e-6);
+        CHECK_NEAR(v[6], corners[i][3], 1e-6);
+        CHECK_NEAR(v[7], corners[i][4], 1e-6);
+        CHECK_NEAR(v[5], 1.0, 1e-6); // vn 0 0 1
+    }
+}
+
+static void free_meshes(int32_t count)
+{
+    for (int32_t i = 0; i < count; i++)
+        delete_geometry_buffer(obj_parser_get_mesh_handle(i));
+    obj_parser_reset();
+}
+
+static void test_parity_with_obj_loader()
+{
+    int32_t count = parse_obj(PARITY_OBJ, 1 << 20);
+    CHECK_EQ(count, 2); // The empty "default" group is dropped
+    if (count != 2)
+        return;
+    CHECK(strcmp(obj_parser_get_mesh_name(0), "first") == 0);
+    CHECK(strcmp(obj_parser_get_mesh_name(1), "second") == 0);
+    CHECK_EQ(obj_parser_get_mesh_smooth(0), 0);
+    CHECK_EQ(obj_parser_get_mesh_smooth(1), 1);
+    CHECK_EQ(obj_parser_get_mesh_face_count(0), 1); // One quad
+    CHECK_EQ(obj_parser_get_mesh_face_sizes(0)[0], 4);
+    check_corners(0, FIRST_CORNERS, 6);
+    check_corners(1, SECOND_CORNERS, 3);
+    free_meshes(count);
+}
+
+static void test_w_is_not_a_color()
+{
+    int32_t count = parse_obj(PARITY_OBJ, 1 << 20);
+    CHECK_EQ(count, 2);
+    GeometryBuffer *buf = lookup_geometry_buffer(obj_parser_get_mesh_handle(0));
+    if (!buf)
+        return;
+    const float *w = &buf->vertices[buf->indices[1] * 12];     // v 1 0 0 2.0
+    const float *color = &buf->vertices[buf->indices[5] * 12]; // v 0 1 0 0.5 0.25 1
+    CHECK_NEAR(w[8], 255.0, 1e-3);
+    CHECK_NEAR(w[9], 255.0, 1e-3);
+    CHECK_NEAR(w[10], 255.0, 1e-3);
+    CHECK_NEAR(color[8], 127.5, 1e-3);
+    CHECK_NEAR(color[9], 63.75, 1e-3);
+    CHECK_NEAR(color[10], 255.0, 1e-3);
+    free_meshes(count);
+}
+
+// Lines split across feed calls must parse the same as one feed
+static void test_chunked_feed_matches()
+{
+    int32_t sizes[] = {1, 3, 7, 64};
+    for (int32_t s = 0; s < 4; s++)
+    {
+        int32_t count = parse_obj(PARITY_OBJ, sizes[s]);
+        CHECK_EQ(count, 2);
+        if (count != 2)
+            continue;
+        check_corners(0, FIRST_CORNERS, 6);
+        check_corners(1, SECOND_CORNERS, 3);
+        free_meshes(count);
+    }
+}
+
+// Overlong indices saturate and resolve as missing (origin), like OBJLoader
+static void test_overlong_index()
+{
+    int32_t count = parse_obj("v 1 2 3\nv 4 5 6\nf 1 2 99999999999999999999\n", 1 << 20);
+    CHECK_EQ(count, 1);
+    GeometryBuffer *buf = lookup_geometry_buffer(obj_parser_get_mesh_handle(0));
+    if (!buf)
+        return;
+    CHECK_EQ(buf->indexCount, 3);
+    const float *v = &buf->vertices[buf->indices[2] * 12];
+    CHECK(v[0] == 0.0f && v[1] == 0.0f && v[2] == 0.0f);
+
+    int32_t value = 0;
+    bool found = false;
+    const char *text = "-99999999999";
+    obj_parse_int(text, text + strlen(text), value, found);
+    CHECK(found);
+    CHECK_EQ(value, -INT32_MAX);
+    free_meshes(count);
+}
+
+int main()
+{
+    RUN_TEST(test_parity_with_obj_loader);
+    RUN_TEST(test_w_is_not_a_color);
+    RUN_TEST(test_chunked_feed_matches);
+    RUN_TEST(test_overlong_index);
+    return check_summary();
+}
@@ -0,0 +1,226 @@
+// Snapshot tests: snapshot_state -> restore_state round trips and rejection of
+// foreign, mismatched or truncated images. A rejected image must leave every
+// resource as it was.
+
+#include "../rasterizer.cpp"
+#include "check.h"
+
+static int32_t g_texture = 0;
+
+// Drop every resource so each test starts from an empty renderer
+static void reset_scene()
+{
+    for (int32_t i = 0; i < MAX_GEOMETRY_BUFFERS; i++)
+        delete_geometry_buffer(i + 1);
+    for (int32_t i = 0; i < MAX_TEXTURE_BUFFERS; i++)
+        delete_texture_buffer(i + 1);
+    set_texture_size(3, 0, 0);
+}
+
+// One triangle buffer with skin, morph, material and lighting extras, plus a
+// texture buffer and a fixed texture slot
+static int32_t build_scene()
+{
+    int32_t handle = create_geometry_buffer();
+    float *v = geometry_buffer_alloc_vertices(handle, 3);
+    for (int32_t i = 0; i < 3 * 12; i++)
+        v[i] = (float)i * 0.5f;
+    uint32_t *ix = geometry_buffer_alloc_indices(handle, 3);
+    ix[0] = 0;
+    ix[1] = 2;
+    ix[2] = 1;
+
+    uint16_t *joints = geometry_buffer_alloc_skin(handle, 3);
+    float *weights = geometry_buffer_get_skin_weights_ptr(handle);
+    for (int32_t i = 0; i < 3 * SKIN_INFLUENCES; i++)
+    {
+        joints[i] = (uint16_t)(i + 1);
+        weights[i] = 0.25f;
+    }
+
+    float *dense = morph_get_dense_input_ptr(3);
+    memset(dense, 0, 3 * 6 * sizeof(float));
+    dense[6] = 1.0f; // Moves vertex 1 along x
+    int32_t target = geometry_buffer_add_morph_target_dense(handle, 1e-6f);
+    geometry_buffer_set_morph_weight(handle, target, 0.75f);
+
+    uint8_t *ids = geometry_buffer_alloc_materials(handle, 1);
+    ids[0] = 7;
+    geometry_buffer_set_static_lighting(handle, 1);
+
+    g_texture = create_texture_buffer();
+    uint8_t *pixels = texture_buffer_alloc(g_texture, 2, 2);
+    for (int32_t i = 0; i < 16; i++)
+        pixels[i] = (uint8_t)(i * 9);
+
+    set_texture_size(3, 4, 4);
+    for (int32_t i = 0; i < 64; i++)
+        get_texture(3)[i] = (uint8_t)(255 - i);
+    return handle;
+}
+
+// Copy the current snapshot so restore_state reads from a separate image
+static uint8_t *take_snapshot(int32_t &size)
+{
+    size = snapshot_state();
+    if (size <= 0)
+        return nullptr;
+    uint8_t *image = (uint8_t *)malloc(size);
+    memcpy(image, get_snapshot_ptr(), size);
+    return image;
+}
+
+static void test_round_trip()
+{
+    int32_t handle = build_scene();
+    int32_t size = 0;
+    uint8_t *image = take_snapshot(size);
+    CHECK(image != nullptr);
+    if (!image)
+        return;
+
+    // Wipe everything so restore has to rebuild it
+    reset_scene();
+    memset(get_texture(3), 0, 64);
+
+    CHECK_EQ(restore_state(image, size), 1);
+    GeometryBuffer *buf = lookup_geometry_buffer(handle);
+    CHECK(buf != nullptr);
+    if (!buf)
+    {
+        free(image);
+        return;
+    }
+    CHECK_EQ(buf->vertexCount, 3);
+    CHECK_EQ(buf->indexCount, 3);
+    CHECK_EQ(buf->vertices[35], 17.5f);
+    CHECK_EQ(buf->indices[1], 2);
+
+    CHECK_EQ(geometry_buffer_has_skin(handle), 1);
+    CHECK_EQ(g_geometry_skins[handle - 1]->joints[5], 6);
+    CHECK_EQ(geometry_buffer_get_skin_weights_ptr(handle)[11], 0.25f);
+
+    CHECK_EQ(geometry_buffer_get_morph_target_count(handle), 1);
+    CHECK_EQ(geometry_buffer_get_morph_entry_count(handle, 0), 1);
+    CHECK_EQ(geometry_buffer_get_morph_indices_ptr(handle, 0)[0], 1);
+    CHECK_EQ(geometry_buffer_get_morph_deltas_ptr(handle, 0)[0], 1.0f);
+    CHECK_EQ(g_geometry_morphs[handle - 1]->weights[0], 0.75f);
+
+    CHECK_EQ(geometry_buffer_has_materials(handle), 1);
+    CHECK_EQ(g_geometry_materials[handle - 1]->ids[0], 7);
+    CHECK(g_geometry_lighting[handle - 1] != nullptr);
+
+    CHECK_EQ(texture_buffer_get_width(g_texture), 2);
+    CHECK_EQ(texture_buffer_get_height(g_texture), 2);
+    CHECK_EQ(g_texture_buffers[g_texture - 1]->data[15], 135);
+    CHECK_EQ(get_texture_sizes()[6], 4);
+    CHECK_EQ(get_texture(3)[63], 192);
+
+    // A second snapshot of the restored state is byte-identical
+    int32_t again = 0;
+    uint8_t *second = take_snapshot(again);
+    CHECK_EQ(again, size);
+    CHECK(second && again == size && memcmp(image, second, size) == 0);
+
+    free(image);
+    free(second);
+    reset_scene();
+}
+
+// restore_state must fail and leave the live buffer in place
+static void check_rejected(const uint8_t *image, int32_t size, int32_t handle, int32_t &failures)
+{
+    GeometryBuffer *before = lookup_geometry_buffer(handle);
+    if (restore_state(image, size) != 0)
+        failures++;
+    if (lookup_geometry_buffer(handle) != before || !before || before->vertexCount != 3)
+        failures++;
+}
+
+static void test_header_mismatch_is_rejected()
+{
+    int32_t handle = build_scene();
+    int32_t size = 0;
+    uint8_t *image = take_snapshot(size);
+    if (!image)
+        return;
+    SnapshotHeader header;
+    memcpy(&header, image, sizeof(header));
+    int32_t failures = 0;
+
+    SnapshotHeader bad = header;
+    bad.magic = 0x46464952; // "RIFF"
+    memcpy(image, &bad, sizeof(bad));
+    check_rejected(image, size, handle, failures);
+
+    bad = header;
+    bad.version = 0;
+    memcpy(image, &bad, sizeof(bad));
+    check_rejected(image, size, handle, failures);
+
+    bad = header;
+    bad.version = SNAPSHOT_VERSION + 1;
+    memcpy(image, &bad, sizeof(bad));
+    check_rejected(image, size, handle, failures);
+
+    bad = header;
+    bad.totalSize = (uint32_t)size + 4;
+    memcpy(image, &bad, sizeof(bad));
+    check_rejected(image, size, handle, failures);
+    CHECK_EQ(failures, 0);
+
+    // Version 1 images are still accepted
+    bad = header;
+    bad.version = 1;
+    memcpy(image, &bad, sizeof(bad));
+    CHECK_EQ(restore_state(image, size), 1);
+    CHECK(lookup_geometry_buffer(handle) != nullptr);
+
+    free(image);
+    reset_scene();
+}
+
+static void test_truncated_images_are_rejected()
+{
+    int32_t handle = build_scene();
+    int32_t size = 0;
+    uint8_t *image = take_snapshot(size);
+    if (!image)
+        return;
+    uint8_t *cut = (uint8_t *)malloc(size);
+    int32_t failures = 0;
+    for (int32_t length = 0; length < size; length++)
+    {
+        // Short read of an intact image
+        check_rejected(image, length, handle, failures);
+
+        // Image cut short with its header patched to match
+        memcpy(cut, image, length);
+        if (length >= (int32_t)sizeof(SnapshotHeader))
+        {
+            uint32_t total = (uint32_t)length;
+            memcpy(cut + 8, &total, 4); // totalSize
+        }
+        check_rejected(cut, length, handle, failures);
+    }
+    CHECK_EQ(failures, 0);
+
+    // A bad GEOM handle is caught before anything is dropped
+    memcpy(cut, image, size);
+    uint32_t badHandle = MAX_GEOMETRY_BUFFERS + 1;
+    memcpy(cut + sizeof(SnapshotHeader) + 8, &badHandle, 4);
+    check_rejected(cut, size, handle, failures);
+    CHECK_EQ(failures, 0);
+
+    free(cut);
+    free(image);
+    reset_scene();
+}
+
+int main()
+{
+    RUN_TEST(test_round_trip);
+    RUN_TEST(test_header_mismatch_is_rejected);
+    RUN_TEST(test_truncated_images_are_rejected);
+    return check_summary();
+}